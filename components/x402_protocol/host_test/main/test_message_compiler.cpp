@@ -0,0 +1,92 @@
+#include <cstring>
+#include <vector>
+#include "unity.h"
+#include "solana_client.h"
+
+// Keys are 32 copies of one byte: payer 0x11, payTo 0x22, fee payer 0x33,
+// mint 0x44; blockhash 0x55
+static const char* PAY_TO    = "3JF3sEqM796hk5WFqA6EtmEwJQ9quALszsfJyvXNQKy3";
+static const char* FEE_PAYER = "4Ss5JMkXAD9Z7cktFEdrqeMuT6jGMF1pVozTyPHZ6zT4";
+static const char* MINT      = "5bV6jUfhDHCQVA1WfKBUnXUsboJgoKgkzkKcxr3joew5";
+static constexpr uint64_t AMOUNT = 1000;
+static constexpr uint8_t DECIMALS = 6;
+
+static const uint8_t SOURCE_ATA[32] = {
+    0x29, 0x4f, 0xeb, 0x8c, 0xdc, 0xb9, 0xc6, 0x3c, 0x39, 0x54, 0x4a, 0x29, 0x10, 0x35, 0xc0, 0xb6,
+    0x40, 0x98, 0xc2, 0x59, 0x43, 0xfa, 0x04, 0xa0, 0xaa, 0xbf, 0x7c, 0x40, 0x34, 0x64, 0x48, 0x87,
+};
+static const uint8_t DEST_ATA[32] = {
+    0xb4, 0xd3, 0xf1, 0x06, 0xd5, 0x97, 0xb7, 0x89, 0x67, 0x16, 0x9f, 0x35, 0x36, 0x34, 0x1f, 0xe9,
+    0x56, 0xb5, 0xb7, 0x55, 0x46, 0x33, 0x40, 0x75, 0xe1, 0x8d, 0x6f, 0x50, 0xd9, 0xa4, 0x01, 0xbd,
+};
+
+static void append(std::vector<uint8_t>& out, const uint8_t* bytes, size_t len) {
+    out.insert(out.end(), bytes, bytes + len);
+}
+
+static void appendRepeated(std::vector<uint8_t>& out, uint8_t byte) {
+    out.insert(out.end(), 32, byte);
+}
+
+// The message the builder before MessageCompiler produced for these
+// inputs (header {2,0,3}, seven static keys, compute budget on program 6,
+// TransferChecked on program 5 with accounts {2,4,3,1}); 298 bytes
+static std::vector<uint8_t> baselineMessage() {
+    std::vector<uint8_t> m;
+    const uint8_t header[] = {2, 0, 3, 7};
+    append(m, header, sizeof(header));
+    appendRepeated(m, 0x33);                                    // Fee payer
+    appendRepeated(m, 0x11);                                    // Payer
+    append(m, SOURCE_ATA, 32);
+    append(m, DEST_ATA, 32);
+    appendRepeated(m, 0x44);                                    // Mint
+    append(m, SolanaClient::SPL_TOKEN_PROGRAM_ID, 32);
+    append(m, SolanaClient::COMPUTE_BUDGET_PROGRAM_ID, 32);
+    appendRepeated(m, 0x55);                                    // Blockhash
+
+    const uint8_t instructions[] = {
+        3,
+        6, 0, 5, 0x02, 0x40, 0x9c, 0x00, 0x00,                  // SetComputeUnitLimit 40000
+        6, 0, 9, 0x03, 0x01, 0, 0, 0, 0, 0, 0, 0,               // SetComputeUnitPrice 1
+        5, 4, 2, 4, 3, 1, 10, 12, 0xe8, 0x03, 0, 0, 0, 0, 0, 0, DECIMALS,
+    };
+    append(m, instructions, sizeof(instructions));
+    return m;
+}
+
+TEST_CASE("legacy payment message matches the original builder byte for byte", "[message]")
+{
+    uint8_t payer[32], blockhash[32];
+    memset(payer, 0x11, sizeof(payer));
+    memset(blockhash, 0x55, sizeof(blockhash));
+
+    SolanaClient solana("");
+    std::vector<uint8_t> message;
+    TEST_ASSERT_TRUE(solana.buildTransaction(payer, PAY_TO, FEE_PAYER, MINT, AMOUNT, DECIMALS,
+                                             blockhash, message));
+
+    std::vector<uint8_t> expected = baselineMessage();
+    TEST_ASSERT_EQUAL_size_t(298, expected.size());
+    TEST_ASSERT_EQUAL_size_t(expected.size(), message.size());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected.data(), message.data(), expected.size());
+}
+
+// The client's path: one transfer through buildBatchTransaction with the
+// original compute budget
+TEST_CASE("single-transfer batch with the original budget is the same message", "[message]")
+{
+    uint8_t payer[32], blockhash[32];
+    memset(payer, 0x11, sizeof(payer));
+    memset(blockhash, 0x55, sizeof(blockhash));
+
+    SolanaClient solana("");
+    SolanaClient::Transfer transfer = {PAY_TO, AMOUNT};
+    SolanaClient::ComputeBudget budget = {40000, 1};
+    std::vector<uint8_t> message;
+    TEST_ASSERT_TRUE(solana.buildBatchTransaction(payer, &transfer, 1, FEE_PAYER, MINT, DECIMALS,
+                                                  blockhash, message, nullptr, nullptr, &budget));
+
+    std::vector<uint8_t> expected = baselineMessage();
+    TEST_ASSERT_EQUAL_size_t(expected.size(), message.size());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected.data(), message.data(), expected.size());
+}
@@ -0,0 +1,46 @@
+#include <cstring>
+#include <memory>
+#include <unistd.h>
+#include "unity.h"
+#include "payment_journal.h"
+
+static const char* JOURNAL_PATH = "test_journal.bin";
+
+TEST_CASE("unresolved wallet payment keeps its payer across a wrap", "[journal]")
+{
+    unlink(JOURNAL_PATH);
+    uint8_t signature[64];
+    memset(signature, 0xA5, sizeof(signature));
+
+    {
+        auto journal = std::make_unique<PaymentJournal>();
+        TEST_ASSERT_TRUE(journal->open(JOURNAL_PATH));
+
+        // Signed by payer wallet 2 (Entry::payer 3) and left SUBMITTED
+        uint32_t id = journal->begin("http://merchant/wallet", 1234, 3);
+        TEST_ASSERT_NOT_EQUAL(0, id);
+        TEST_ASSERT_TRUE(journal->record(id, PaymentJournal::SIGNED, signature));
+        TEST_ASSERT_TRUE(journal->record(id, PaymentJournal::SUBMITTED));
+
+        // Settled traffic laps the file twice, so the SUBMITTED record is
+        // only kept by compaction copies
+        const size_t slots = PaymentJournal::FILE_SIZE / PaymentJournal::RECORD_SIZE;
+        for (size_t i = 0; i < slots; i++) {
+            uint32_t other = journal->begin("http://merchant/other", 1);
+            TEST_ASSERT_NOT_EQUAL(0, other);
+            TEST_ASSERT_TRUE(journal->record(other, PaymentJournal::SETTLED));
+        }
+        TEST_ASSERT_TRUE(journal->flush());
+    }
+
+    PaymentJournal reopened;
+    TEST_ASSERT_TRUE(reopened.open(JOURNAL_PATH));
+    PaymentJournal::Entry entry;
+    TEST_ASSERT_TRUE(reopened.findUnresolved("http://merchant/wallet", entry));
+    TEST_ASSERT_EQUAL(PaymentJournal::SUBMITTED, entry.state);
+    TEST_ASSERT_EQUAL_UINT8(3, entry.payer);
+    TEST_ASSERT_EQUAL_UINT64(1234, entry.amount);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(signature, entry.signature, 64);
+    TEST_ASSERT_EQUAL(1, reopened.unresolved(&entry, PaymentJournal::MAX_LIVE));
+    unlink(JOURNAL_PATH);
+}
@@ -0,0 +1,148 @@
+#include <arpa/inet.h>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "unity.h"
+#include "http_client.h"
+
+// Set by main/CMakeLists.txt
+#ifndef STANDIN_MERCHANT
+#define STANDIN_MERCHANT "../../../tools/standin_merchant.py"
+#endif
+
+static constexpr size_t CONTENT_SIZE = 3 * 1024 * 1024 + 100;
+static constexpr size_t DROP_EVERY = 1000000;
+static constexpr int READY_TIMEOUT_MS = 10000;
+
+// tools/standin_merchant.py on a port of its own, killed when the test ends
+class Merchant {
+public:
+    Merchant(int port, const char* extra1 = nullptr, const char* extra2 = nullptr) : port_(port) {
+        char port_arg[8], size_arg[16], drop_arg[16];
+        snprintf(port_arg, sizeof(port_arg), "%d", port);
+        snprintf(size_arg, sizeof(size_arg), "%zu", CONTENT_SIZE);
+        snprintf(drop_arg, sizeof(drop_arg), "%zu", DROP_EVERY);
+        pid_ = fork();
+        if (pid_ == 0) {
+            const char* argv[] = {"python3", STANDIN_MERCHANT, "--quiet", "--port", port_arg,
+                                  "--size", size_arg, "--drop-every", drop_arg,
+                                  extra1, extra2, nullptr};
+            execvp("python3", const_cast<char* const*>(argv));
+            _exit(127);
+        }
+    }
+
+    ~Merchant() {
+        if (pid_ > 0) {
+            kill(pid_, SIGTERM);
+            waitpid(pid_, nullptr, 0);
+        }
+    }
+
+    // Polls until the merchant accepts connections
+    bool ready() const {
+        for (int waited = 0; pid_ > 0 && waited < READY_TIMEOUT_MS; waited += 50) {
+            int fd = socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in addr = {};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(port_);
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            bool up = connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+            close(fd);
+            if (up) return true;
+            usleep(50 * 1000);
+        }
+        return false;
+    }
+
+    void url(char* out, size_t cap) const {
+        snprintf(out, cap, "http://127.0.0.1:%d/premium", port_);
+    }
+
+private:
+    int port_;
+    pid_t pid_;
+};
+
+// Checks every byte against the merchant's 16-byte "<offset in hex>\n" lines
+struct ContentCheck {
+    size_t offset = 0;
+    size_t bad = 0;
+
+    AsyncHttp::Sink sink() {
+        return [this](const char* data, size_t len) {
+            for (size_t i = 0; i < len; i++, offset++) {
+                char line[17];
+                snprintf(line, sizeof(line), "%015zx\n", offset - offset % 16);
+                if (data[i] != line[offset % 16]) bad++;
+            }
+            return true;
+        };
+    }
+};
+
+static void streamFrom(const Merchant& merchant, ContentCheck& check,
+                       HttpClient::StreamResult& result, bool& ok) {
+    TEST_ASSERT_TRUE_MESSAGE(merchant.ready(), "standin_merchant.py did not start");
+    char url[64];
+    merchant.url(url, sizeof(url));
+    HttpClientConfig cfg = {"x402-host-test/1.0"};
+    HttpClient http(cfg);
+    ok = http.submit_payment_stream(url, "aG9zdC10ZXN0", check.sink(), &result);
+}
+
+TEST_CASE("dropped stream resumes with Range to the exact content", "[stream]")
+{
+    Merchant merchant(18411);
+    ContentCheck check;
+    HttpClient::StreamResult result;
+    bool ok = false;
+    streamFrom(merchant, check, result, ok);
+
+    TEST_ASSERT_TRUE(ok);
+    TEST_ASSERT_EQUAL(200, result.status);
+    TEST_ASSERT_EQUAL_size_t(CONTENT_SIZE, result.received);
+    TEST_ASSERT_EQUAL_size_t(CONTENT_SIZE, check.offset);
+    TEST_ASSERT_EQUAL_size_t(0, check.bad);
+    TEST_ASSERT_EQUAL_INT64((int64_t)CONTENT_SIZE, result.total);
+    TEST_ASSERT_EQUAL_UINT8(CONTENT_SIZE / DROP_EVERY, result.resumes);
+}
+
+TEST_CASE("chunked stream without a length learns it from Content-Range", "[stream]")
+{
+    Merchant merchant(18412, "--chunked");
+    ContentCheck check;
+    HttpClient::StreamResult result;
+    bool ok = false;
+    streamFrom(merchant, check, result, ok);
+
+    TEST_ASSERT_TRUE(ok);
+    TEST_ASSERT_EQUAL_size_t(CONTENT_SIZE, check.offset);
+    TEST_ASSERT_EQUAL_size_t(0, check.bad);
+    TEST_ASSERT_EQUAL_INT64((int64_t)CONTENT_SIZE, result.total);
+    TEST_ASSERT_EQUAL_UINT8(CONTENT_SIZE / DROP_EVERY, result.resumes);
+}
+
+// Every resend starts over at byte 0 and drops at the same place, so the
+// download cannot finish; what matters is that no byte reaches the sink twice
+TEST_CASE("merchant ignoring Range never duplicates content", "[stream]")
+{
+    for (const char* chunked : {(const char*)nullptr, "--chunked"}) {
+        Merchant merchant(chunked ? 18414 : 18413, "--no-range", chunked);
+        ContentCheck check;
+        HttpClient::StreamResult result;
+        bool ok = true;
+        streamFrom(merchant, check, result, ok);
+
+        TEST_ASSERT_FALSE(ok);
+        TEST_ASSERT_EQUAL(200, result.status);
+        TEST_ASSERT_EQUAL_size_t(DROP_EVERY, result.received);
+        TEST_ASSERT_EQUAL_size_t(DROP_EVERY, check.offset);
+        TEST_ASSERT_EQUAL_size_t(0, check.bad);
+        TEST_ASSERT_EQUAL_UINT8(HttpClient::MAX_RESUMES, result.resumes);
+    }
+}
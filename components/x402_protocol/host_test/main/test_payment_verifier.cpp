@@ -0,0 +1,246 @@
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sodium.h>
+#include "unity.h"
+#include "crypto_utils.h"
+#include "payment_scheme.h"
+#include "payment_verifier.h"
+#include "solana_client.h"
+#include "transaction_view.h"
+
+// Same keys as test_message_compiler.cpp: payTo 0x22, fee payer 0x33,
+// mint 0x44, blockhash 0x55. The payer is a real keypair so that its
+// signature verifies.
+static const char* PAY_TO    = "3JF3sEqM796hk5WFqA6EtmEwJQ9quALszsfJyvXNQKy3";
+static const char* FEE_PAYER = "4Ss5JMkXAD9Z7cktFEdrqeMuT6jGMF1pVozTyPHZ6zT4";
+static const char* MINT      = "5bV6jUfhDHCQVA1WfKBUnXUsboJgoKgkzkKcxr3joew5";
+static constexpr uint64_t AMOUNT = 1000;
+static constexpr uint8_t DECIMALS = 6;
+
+using Result = PaymentVerifier::Result;
+
+static const char* network() {
+    return x402::DEVNET_ENABLED ? x402::Devnet::NAME : x402::Mainnet::NAME;
+}
+
+static PaymentVerifier::Offer offer(const AddressLookupTable* table = nullptr) {
+    return {network(), PAY_TO, MINT, FEE_PAYER, AMOUNT, table};
+}
+
+// The payment as the client builds it, before it is signed
+struct Payment {
+    uint8_t payer_public[32];
+    uint8_t payer_secret[64];
+    std::vector<uint8_t> message;
+
+    Payment() {
+        static const uint8_t seed[32] = {0x11};
+        crypto_sign_seed_keypair(payer_public, payer_secret, seed);
+    }
+
+    bool build(const SolanaClient::Transfer* transfers, size_t count,
+               const SolanaClient::NonceAccount* nonce = nullptr,
+               const AddressLookupTable* table = nullptr,
+               const SolanaClient::ComputeBudget* budget = nullptr) {
+        uint8_t blockhash[32];
+        memset(blockhash, 0x55, sizeof(blockhash));
+        return SolanaClient("").buildBatchTransaction(payer_public, transfers, count, FEE_PAYER, MINT,
+                                                      DECIMALS, blockhash, message, nonce, table, budget);
+    }
+
+    bool build(const SolanaClient::NonceAccount* nonce = nullptr,
+               const AddressLookupTable* table = nullptr,
+               const SolanaClient::ComputeBudget* budget = nullptr) {
+        SolanaClient::Transfer transfer = {PAY_TO, AMOUNT};
+        return build(&transfer, 1, nonce, table, budget);
+    }
+
+    // Offset into message of instruction i's account indexes
+    size_t accountsOffset(size_t i) {
+        std::vector<uint8_t> tx = wire(nullptr);
+        TransactionView view;
+        TEST_ASSERT_TRUE(view.parse(tx.data(), tx.size()));
+        TEST_ASSERT_TRUE(i < view.instructionCount());
+        const uint8_t* start = tx.data() + tx.size() - message.size();
+        return view.instruction(i).accounts.data() - start;
+    }
+
+    // Signed wire transaction; a null secret leaves the payer's slot zero
+    std::vector<uint8_t> wire(const uint8_t* secret) {
+        uint8_t signature[64] = {};
+        if (secret) {
+            TEST_ASSERT_TRUE(CryptoUtils::ed25519Sign(signature, message.data(), message.size(),
+                                                      secret, payer_public));
+        }
+        std::string base64_tx;
+        TEST_ASSERT_TRUE(SolanaClient("").buildSignedTransaction(message, signature, base64_tx));
+        std::vector<uint8_t> tx(base64_tx.size());
+        size_t len = 0;
+        TEST_ASSERT_TRUE(CryptoUtils::base64Decode(base64_tx.c_str(), base64_tx.size(),
+                                                   tx.data(), tx.size(), &len));
+        tx.resize(len);
+        return tx;
+    }
+
+    // X-PAYMENT for the signed message, optionally with a corrupted signature
+    std::string header(bool corrupt_signature = false) {
+        std::vector<uint8_t> tx = wire(payer_secret);
+        if (corrupt_signature) {
+            tx[tx.size() - message.size() - 1] ^= 0x01;     // Last byte of the payer's signature
+        }
+        char* base64_tx = CryptoUtils::base64Encode(tx.data(), tx.size());
+        TEST_ASSERT_NOT_NULL(base64_tx);
+        int policy = x402::EnabledSchemes::match(x402::SolanaExact::NAME, network());
+        char* encoded = x402::EnabledSchemes::buildHeader(policy, base64_tx);
+        free(base64_tx);
+        TEST_ASSERT_NOT_NULL(encoded);
+        std::string out(encoded);
+        free(encoded);
+        return out;
+    }
+};
+
+static Result verify(const PaymentVerifier::Offer& o, const std::string& header) {
+    PaymentVerifier verifier;
+    TEST_ASSERT_TRUE(verifier.init(o, 1));
+    return verifier.verify(header.c_str(), header.size());
+}
+
+static void assertResult(Result expected, Result actual) {
+    TEST_ASSERT_EQUAL_STRING(PaymentVerifier::resultName(expected), PaymentVerifier::resultName(actual));
+}
+
+// Nonce account 0x66 with the payer as authority
+static SolanaClient::NonceAccount nonceAccount(const Payment& p) {
+    SolanaClient::NonceAccount nonce = {};
+    memset(nonce.address, 0x66, sizeof(nonce.address));
+    memcpy(nonce.authority, p.payer_public, sizeof(nonce.authority));
+    memset(nonce.nonce, 0x77, sizeof(nonce.nonce));
+    nonce.lamportsPerSignature = 5000;
+    nonce.valid = true;
+    return nonce;
+}
+
+// Table 0x88 holding the mint and payTo's ATA, so a v0 message loads both
+static AddressLookupTable lookupTable() {
+    AddressLookupTable table = {};
+    memset(table.address, 0x88, sizeof(table.address));
+    memset(table.addresses[0], 0x44, 32);
+    uint8_t owner[32];
+    memset(owner, 0x22, sizeof(owner));
+    uint8_t bump;
+    TEST_ASSERT_TRUE(SolanaClient("").deriveAssociatedTokenAddress(owner, table.addresses[0],
+                                                                   table.addresses[1], &bump));
+    table.count = 2;
+    table.valid = true;
+    return table;
+}
+
+// TransferChecked is last: source, mint, destination, authority
+static constexpr size_t SOURCE = 0, MINT_ACCOUNT = 1, DESTINATION = 2, AUTHORITY = 3;
+
+TEST_CASE("verifier accepts a legacy payment", "[verifier]")
+{
+    Payment p;
+    TEST_ASSERT_TRUE(p.build());
+    assertResult(Result::Ok, verify(offer(), p.header()));
+}
+
+TEST_CASE("verifier accepts a durable nonce payment", "[verifier]")
+{
+    Payment p;
+    SolanaClient::NonceAccount nonce = nonceAccount(p);
+    TEST_ASSERT_TRUE(p.build(&nonce));
+    assertResult(Result::Ok, verify(offer(), p.header()));
+}
+
+TEST_CASE("verifier accepts a v0 payment and needs the table to resolve it", "[verifier]")
+{
+    Payment p;
+    AddressLookupTable table = lookupTable();
+    TEST_ASSERT_TRUE(p.build(nullptr, &table));
+    TEST_ASSERT_EQUAL_UINT8(0x80, p.message[0]);       // Versioned prefix
+    std::string header = p.header();
+    assertResult(Result::Ok, verify(offer(&table), header));
+    assertResult(Result::Unresolved, verify(offer(), header));
+}
+
+TEST_CASE("verifier refuses the fee payer as transfer source or authority", "[verifier]")
+{
+    const size_t accounts[] = {SOURCE, AUTHORITY};
+    for (size_t account : accounts) {
+        Payment p;
+        TEST_ASSERT_TRUE(p.build());
+        p.message[p.accountsOffset(2) + account] = 0;
+        assertResult(Result::FeePayerSpends, verify(offer(), p.header()));
+    }
+}
+
+TEST_CASE("verifier refuses the fee payer as nonce account or authority", "[verifier]")
+{
+    const size_t accounts[] = {0, 2};   // AdvanceNonceAccount: nonce, RecentBlockhashes, authority
+    for (size_t account : accounts) {
+        Payment p;
+        SolanaClient::NonceAccount nonce = nonceAccount(p);
+        TEST_ASSERT_TRUE(p.build(&nonce));
+        p.message[p.accountsOffset(0) + account] = 0;
+        assertResult(Result::FeePayerSpends, verify(offer(), p.header()));
+    }
+}
+
+TEST_CASE("verifier refuses a second TransferChecked", "[verifier]")
+{
+    Payment p;
+    SolanaClient::Transfer transfers[] = {{PAY_TO, AMOUNT}, {PAY_TO, AMOUNT}};
+    TEST_ASSERT_TRUE(p.build(transfers, 2));
+    assertResult(Result::ExtraTransfer, verify(offer(), p.header()));
+}
+
+TEST_CASE("verifier refuses a unit limit or price above the caps", "[verifier]")
+{
+    const SolanaClient::ComputeBudget budgets[] = {
+        {PaymentVerifier::MAX_UNIT_LIMIT + 1, 1},
+        {40000, PaymentVerifier::MAX_UNIT_PRICE + 1},
+    };
+    for (const SolanaClient::ComputeBudget& budget : budgets) {
+        Payment p;
+        TEST_ASSERT_TRUE(p.build(nullptr, nullptr, &budget));
+        assertResult(Result::ComputeBudget, verify(offer(), p.header()));
+    }
+
+    // At the caps is still accepted
+    Payment p;
+    SolanaClient::ComputeBudget budget = {PaymentVerifier::MAX_UNIT_LIMIT, PaymentVerifier::MAX_UNIT_PRICE};
+    TEST_ASSERT_TRUE(p.build(nullptr, nullptr, &budget));
+    assertResult(Result::Ok, verify(offer(), p.header()));
+}
+
+TEST_CASE("verifier refuses the wrong mint, amount or recipient", "[verifier]")
+{
+    // The source ATA in place of the mint, then of the destination
+    Payment mint;
+    TEST_ASSERT_TRUE(mint.build());
+    size_t transfer = mint.accountsOffset(2);
+    mint.message[transfer + MINT_ACCOUNT] = mint.message[transfer + SOURCE];
+    assertResult(Result::WrongMint, verify(offer(), mint.header()));
+
+    Payment recipient;
+    TEST_ASSERT_TRUE(recipient.build());
+    recipient.message[transfer + DESTINATION] = recipient.message[transfer + SOURCE];
+    assertResult(Result::WrongRecipient, verify(offer(), recipient.header()));
+
+    Payment amount;
+    TEST_ASSERT_TRUE(amount.build());
+    PaymentVerifier::Offer more = offer();
+    more.amount = AMOUNT + 1;
+    assertResult(Result::WrongAmount, verify(more, amount.header()));
+}
+
+TEST_CASE("verifier refuses a bad payer signature", "[verifier]")
+{
+    Payment p;
+    TEST_ASSERT_TRUE(p.build());
+    assertResult(Result::BadSignature, verify(offer(), p.header(true)));
+}
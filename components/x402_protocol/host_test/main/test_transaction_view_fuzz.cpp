@@ -0,0 +1,114 @@
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <string>
+#include <vector>
+#include "unity.h"
+#include "transaction_view.h"
+
+// Set by main/CMakeLists.txt
+#ifndef FUZZ_CORPUS
+#define FUZZ_CORPUS "../corpus/transaction_view"
+#endif
+
+static constexpr size_t MUTATIONS = 300000;
+
+// Keeps the reads in LLVMFuzzerTestOneInput from being optimized away
+static volatile unsigned g_sink;
+
+/**
+ * One input: parse an exact-size heap copy, so a sanitizer build catches
+ * any read past the end, and touch everything a valid view points at.
+ * Also the libFuzzer entry point when built with -fsanitize=fuzzer.
+ */
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t len) {
+    std::vector<uint8_t> buf(data, data + len);
+    TransactionView view;
+    if (!view.parse(buf.data(), buf.size())) {
+        return 0;
+    }
+
+    unsigned sum = 0;
+    for (size_t i = 0; i < view.signatureCount(); i++) sum += view.signature(i)[63];
+    for (size_t i = 0; i < view.accountKeyCount(); i++) sum += view.accountKey(i)[31];
+    sum += view.blockhash()[0];
+    for (size_t i = 0; i < view.instructionCount(); i++) {
+        const auto& ix = view.instruction(i);
+        for (uint8_t account : ix.accounts) {
+            const uint8_t* key = view.resolve(account);
+            if (key) sum += key[0];
+            sum += view.isWritable(account);
+        }
+        for (uint8_t b : ix.data) sum += b;
+    }
+    for (size_t i = 0; i < view.lookupCount(); i++) sum += view.lookup(i).table[0];
+    g_sink = sum;
+
+    // The message runs exactly to the end of the input
+    if (view.message().data() + view.message().size() != buf.data() + buf.size()) {
+        TEST_FAIL_MESSAGE("message does not end at the end of the transaction");
+    }
+    return 0;
+}
+
+static std::vector<std::vector<uint8_t>> loadCorpus() {
+    std::vector<std::vector<uint8_t>> seeds;
+    DIR* dir = opendir(FUZZ_CORPUS);
+    if (!dir) {
+        return seeds;
+    }
+    while (dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') continue;
+        std::string path = std::string(FUZZ_CORPUS) + "/" + entry->d_name;
+        FILE* f = fopen(path.c_str(), "rb");
+        if (!f) continue;
+        std::vector<uint8_t> seed;
+        uint8_t chunk[512];
+        size_t n;
+        while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) seed.insert(seed.end(), chunk, chunk + n);
+        fclose(f);
+        seeds.push_back(std::move(seed));
+    }
+    closedir(dir);
+    return seeds;
+}
+
+TEST_CASE("TransactionView seeds parse", "[fuzz]")
+{
+    auto seeds = loadCorpus();
+    TEST_ASSERT_EQUAL_size_t(3, seeds.size());
+    for (const auto& seed : seeds) {
+        TransactionView view;
+        TEST_ASSERT_TRUE(view.parse(seed.data(), seed.size()));
+    }
+}
+
+// Bit flips, byte stores, truncations and insertions of the legacy, nonce
+// and v0 seeds; the same sequence every run
+TEST_CASE("TransactionView survives mutated transactions", "[fuzz]")
+{
+    auto seeds = loadCorpus();
+    TEST_ASSERT_FALSE(seeds.empty());
+
+    uint32_t state = 0x9E3779B9;
+    auto next = [&state]() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    };
+
+    for (size_t i = 0; i < MUTATIONS; i++) {
+        std::vector<uint8_t> input = seeds[next() % seeds.size()];
+        size_t edits = 1 + next() % 6;
+        for (size_t e = 0; e < edits && !input.empty(); e++) {
+            switch (next() % 4) {
+                case 0: input[next() % input.size()] ^= 1 << (next() % 8); break;
+                case 1: input[next() % input.size()] = (uint8_t)next(); break;
+                case 2: input.resize(next() % (input.size() + 1)); break;
+                case 3: input.insert(input.begin() + next() % (input.size() + 1), (uint8_t)next()); break;
+            }
+        }
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+    }
+}
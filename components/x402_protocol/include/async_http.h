@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <functional>
+#include <esp_err.h>
+#include <esp_http_client.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include "inflater.h"
+
+/**
+ * @brief Single-task HTTP request engine on esp_http_client's async mode
+ *
+ * Requests are submitted from any task and driven by one executor task,
+ * which polls every in-flight request with esp_http_client_perform() until
+ * it stops returning ESP_ERR_HTTP_EAGAIN, then runs the completion callback
+ * on the executor. Each request owns its response buffer, so concurrent
+ * flows no longer share (and serialize on) one static buffer.
+ *
+ * Requests advertise gzip/deflate while a decoder is free (MAX_INFLATERS);
+ * a compressed body is inflated chunk by chunk in the data callback, so
+ * buffers and sinks only ever see decoded bytes.
+ *
+ * esp_http_client only supports async mode over HTTPS. Plain HTTP requests
+ * are handed to a pool of BLOCKING_WORKERS tasks that run them with a
+ * blocking perform; the executor still runs their completion callbacks, so
+ * an http:// merchant never stalls the requests being polled.
+ *
+ * The linux target runs the same engine: ESP-IDF's linux port provides
+ * esp_http_client over POSIX sockets, so a separate epoll backend would
+ * only duplicate the HTTP, TLS and chunked/compressed body handling that
+ * esp_http_client already does on both targets.
+ */
+class AsyncHttp {
+public:
+    static constexpr size_t MAX_IN_FLIGHT = 6;
+    static constexpr uint32_t POLL_INTERVAL_MS = 10;
+    static constexpr size_t MAX_INFLATERS = 2;     // ~43 KB each while decoding
+    static constexpr size_t BLOCKING_WORKERS = 2;  // Plain HTTP requests at once
+
+    // Receives a 2xx body chunk by chunk on the executor task (a blocking
+    // worker for plain HTTP); return false to stop delivery (the request
+    // still runs to completion)
+    using Sink = std::function<bool(const char* data, size_t len)>;
+
+    struct Request {
+        const char* url = nullptr;
+        esp_http_client_method_t method = HTTP_METHOD_GET;
+        const char* user_agent = nullptr;
+        const char* header_name = nullptr;      // One extra header (e.g. X-PAYMENT)
+        const char* header_value = nullptr;
+        const char* content_type = nullptr;
+        const char* if_none_match = nullptr;    // Validators for a conditional GET
+        const char* if_modified_since = nullptr;
+        const char* body = nullptr;             // Copied, may be freed after submit
+        int timeout_ms = 15000;
+        int buffer_size_tx = 0;                 // 0 = esp_http_client default
+        size_t max_response = 4096;             // Buffered body limit (non-2xx only with a sink)
+        Sink sink;                              // Stream a 2xx body here instead of buffering it
+        int64_t range_from = -1;                // Send "Range: bytes=N-"; a 200 reply is skipped to N
+        bool accept_compressed = true;          // Offer gzip/deflate (off for byte ranges)
+    };
+
+    // Response headers that decide whether and how long content may be cached
+    struct Headers {
+        char cache_control[96];
+        char etag[80];
+        char last_modified[40];
+        char expires[40];
+        char date[40];
+        char content_range[64];
+        char content_encoding[24];
+    };
+
+    struct Response {
+        esp_err_t err;
+        int status;
+        const char* body;       // NUL-terminated, valid only during the callback
+        size_t len;
+        bool truncated;         // Body exceeded max_response, the sink refused data, or it failed to decode
+        const Headers* headers; // Valid only during the callback; over-long values are cut
+        size_t streamed;        // Body bytes handed to the sink
+        bool complete;          // Whole body received (Content-Length or final chunk seen)
+        int64_t content_length; // -1 if not sent (chunked) or the body was decoded
+        size_t wire_bytes;      // Body bytes as received
+        size_t decoded_bytes;   // Body bytes after Content-Encoding was undone
+    };
+
+    using Callback = std::function<void(const Response&)>;
+
+    /**
+     * @brief Process-wide engine; the executor task starts on first use
+     */
+    static AsyncHttp& instance();
+
+    /**
+     * @brief Start a request; cb runs on the executor task when it completes
+     * @return false if all MAX_IN_FLIGHT slots are busy or setup failed (cb not called)
+     */
+    bool submit(const Request& req, Callback cb);
+
+    /**
+     * @brief Submit and block the calling task until cb has run
+     * Waits for a free slot instead of failing when the engine is busy.
+     * Never call it from a callback or sink: the engine would wait on itself.
+     */
+    bool perform(const Request& req, Callback cb);
+
+    size_t inFlight() const { return in_flight_.load(); }
+
+private:
+    enum SlotState : uint8_t {
+        SLOT_FREE,
+        SLOT_RESERVED,
+        SLOT_ACTIVE,        // Polled by the executor
+        SLOT_BLOCKING,      // Running on a blocking worker
+        SLOT_DONE,          // Worker finished, completion pending on the executor
+    };
+
+    struct Slot {
+        std::atomic<uint8_t> state;
+        esp_http_client_handle_t handle;
+        char* buf;
+        size_t cap;
+        size_t len;
+        bool truncated;
+        char* body;
+        Headers headers;
+        Sink sink;
+        int64_t range_from;
+        int64_t skip;           // Bytes still to drop before the sink, -1 = not decided yet
+        size_t streamed;
+        bool sink_failed;
+        char range[32];
+        bool inflate_reserved;  // Accept-Encoding sent, holds one of MAX_INFLATERS
+        bool decode_decided;
+        bool decode_failed;
+        Inflater* inflater;     // Only while a compressed body is arriving
+        size_t wire;
+        size_t decoded;
+        Callback cb;
+        int64_t deadline_us;
+        esp_err_t result;       // Set by the blocking worker
+    };
+
+    AsyncHttp();
+    bool submit(const Request& req, Callback cb, bool* busy);
+    static void executorEntry(void* arg);
+    void executorLoop();
+    static void workerEntry(void* arg);
+    void workerLoop();
+    bool onEngineTask() const;
+    void complete(Slot& slot, esp_err_t err);
+    static esp_err_t eventHandler(esp_http_client_event_t* evt);
+    // Decoded body bytes -> sink or response buffer
+    static void deliver(Slot* slot, int status, const char* data, size_t len);
+    static void startDecoding(Slot* slot);
+    bool reserveInflater();
+
+    Slot slots_[MAX_IN_FLIGHT];
+    std::atomic<size_t> in_flight_;
+    std::atomic<size_t> inflaters_;
+    TaskHandle_t executor_;
+    QueueHandle_t blocking_;            // Slot* waiting for a worker
+    TaskHandle_t workers_[BLOCKING_WORKERS];
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <freertos/FreeRTOS.h>
+
+/**
+ * @brief Local view of the payer's token balance.
+ *
+ * Seeded from getTokenAccountBalance on the source ATA, debited optimistically
+ * for every payment sent and reconciled against the chain in the background.
+ * All checks are O(1) and never touch the network, so unaffordable payments
+ * are rejected before the blockhash/sign/submit cycle starts.
+ */
+class BalanceLedger {
+public:
+    BalanceLedger();
+
+    /**
+     * @brief RAII reservation: released on destruction unless committed
+     */
+    class Reservation {
+    public:
+        Reservation(BalanceLedger& ledger, uint64_t amount)
+            : ledger_(ledger), amount_(amount), done_(false) {}
+        ~Reservation() { if (!done_) ledger_.release(amount_); }
+
+        Reservation(const Reservation&) = delete;
+        Reservation& operator=(const Reservation&) = delete;
+
+        void commit() { if (!done_) { ledger_.commit(amount_); done_ = true; } }
+
+    private:
+        BalanceLedger& ledger_;
+        uint64_t amount_;
+        bool done_;
+    };
+
+    /**
+     * @brief Check and reserve funds for a payment
+     * @return false if the known balance cannot cover amount. Always succeeds
+     *         while the ledger is not yet seeded.
+     */
+    bool tryReserve(uint64_t amount);
+
+    /**
+     * @brief Turn a reservation into a debit (payment accepted by merchant)
+     */
+    void commit(uint64_t amount);
+
+    /**
+     * @brief Return a reservation (payment never reached the chain)
+     */
+    void release(uint64_t amount);
+
+    /**
+     * @brief Compare against an on-chain balance and adopt it
+     *
+     * Seeds the ledger on first call. Deferred while reservations are in
+     * flight, since the chain may or may not include them yet.
+     * @return true if the ledger now matches onChainBalance
+     */
+    bool reconcile(uint64_t onChainBalance);
+
+    /**
+     * @brief Balance minus in-flight reservations
+     */
+    uint64_t available() const;
+
+    bool isSeeded() const;
+
+private:
+    mutable portMUX_TYPE lock_;
+    bool seeded_;
+    uint64_t balance_;   // Expected on-chain balance after committed debits
+    uint64_t reserved_;  // Sum of in-flight reservations
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include "async_http.h"
+
+/**
+ * @brief Host benchmarks for the linux target (CONFIG_X402_BENCHMARKS)
+ *
+ * app_main runs these instead of the client and exits with the result, so
+ * a build host can track regressions without the board. Each benchmark
+ * logs its own figures.
+ */
+class Benchmarks {
+public:
+    static constexpr size_t UI_CYCLES = 20;             // Payment UI sequences per run
+    static constexpr uint32_t UI_FRAME_MS = 33;         // LVGL time per pump
+    static constexpr size_t HTTP_FLOWS = AsyncHttp::MAX_IN_FLIGHT;
+    static constexpr uint32_t FLOW_TASK_STACK = 8192;   // As the payment worker
+    static constexpr size_t SHARD_WALLETS = 4;          // PayerWallets::simulate
+    static constexpr size_t SHARD_PAYMENTS = 32;
+    static constexpr size_t TX_PARSES = 100000;
+    static constexpr size_t VERIFY_HEADERS = 20000;
+    static constexpr size_t TX_BUILDS = 2000;           // Per transaction version
+    static constexpr size_t TX_SUBMITS = 50;
+
+    /**
+     * @brief Run every benchmark
+     * @return false if any could not run
+     */
+    static bool run();
+
+    /**
+     * @brief Drive the payment UI sequence on HeadlessBackend and log frames,
+     * render/flush time and flushed/invalidated pixels per transition
+     *
+     * Runs the sequence on the baseline widgets that were rebuilt per call
+     * ("rebuilt"), then on DisplayManager's retained screens ("retained").
+     */
+    static bool uiFrames(size_t cycles = UI_CYCLES);
+
+    /**
+     * @brief Heap per concurrent request flow: all of them submitted to
+     * AsyncHttp, then one FLOW_TASK_STACK task per flow blocked in perform()
+     *
+     * Logs bytes per flow and flows per MB for each model. Submitted https
+     * URLs run on the executor; plain http ones run on the blocking workers,
+     * and are logged as "http-workers". The engine's own stacks are shared
+     * and not counted.
+     */
+    static bool httpFlows(const char* url, size_t flows = HTTP_FLOWS);
+
+    /**
+     * @brief TransactionView::benchmark on a legacy payment built by
+     * SolanaClient, as the verifier parses them
+     */
+    static bool transactionParse(size_t iterations = TX_PARSES);
+
+    /**
+     * @brief PaymentVerifier::benchmark on a signed legacy payment for the
+     * first network built in
+     */
+    static bool paymentVerify(size_t count = VERIFY_HEADERS);
+
+    /**
+     * @brief The same payment as a legacy and as a v0 message (against a
+     * lookup table holding its token accounts and mint)
+     *
+     * Logs message and X-PAYMENT header bytes, build+sign+encode time and,
+     * if url is set, submit latency of the header to that merchant.
+     */
+    static bool versionedTx(const char* url, size_t builds = TX_BUILDS, size_t submits = TX_SUBMITS);
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief Boot-phase timeline
+ *
+ * Any task can mark a phase (string literal) as it completes; each mark
+ * records the time since boot and the calling task. dump() prints the
+ * timeline in completion order, so phases that ran concurrently show up
+ * interleaved with their own finish times. Every boot path ends in
+ * finish(), whether it reaches the network or gives up on the way.
+ */
+class BootProfiler {
+public:
+    static constexpr size_t MAX_PHASES = 16;
+
+    /**
+     * @brief Record that phase finished now
+     */
+    static void mark(const char* phase);
+
+    /**
+     * @brief Milliseconds since boot at which phase was marked, -1 if never
+     */
+    static int64_t elapsedMs(const char* phase);
+
+    /**
+     * @brief Print the timeline at INFO level
+     */
+    static void dump();
+
+    /**
+     * @brief Mark phase and print the timeline: the last phase a boot path reaches
+     */
+    static void finish(const char* phase);
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief On-flash layout of the binary configuration blob
+ *
+ * Generated at build time from config.json by tools/config_blob.py and
+ * flashed to the "config" partition. Fields are little endian and
+ * naturally aligned so the blob is read in place from mapped flash; the
+ * NUL-terminated strings follow the header and X402Config string fields
+ * point straight into them.
+ */
+struct ConfigBlob {
+    static constexpr uint32_t MAGIC = 0x46433458;       // "X4CF"
+    static constexpr uint16_t VERSION = 2;
+    static constexpr size_t CRC_OFFSET = 16;            // CRC-32 covers [CRC_OFFSET, size)
+
+    // Order is part of the format; append only
+    enum StringId : uint8_t {
+        WIFI_SSID,
+        WIFI_PASSWORD,
+        PAYAI_URL,
+        SOLANA_RPC_URL,
+        USER_AGENT,
+        TOKEN_MINT,
+        NONCE_ACCOUNT,
+        LOOKUP_TABLE,
+        NETWORK,
+        STRING_COUNT,
+    };
+
+    uint32_t magic;
+    uint16_t version;
+    uint16_t string_count;                  // Offsets actually present
+    uint32_t size;                          // Whole blob, header included
+    uint32_t crc32;
+    uint8_t payer_private_key[32];
+    uint8_t payer_public_key[32];
+    uint32_t fee_target_ms;
+    uint8_t token_decimals;
+    uint8_t payer_wallets;                  // 0 in blobs written before it existed
+    uint8_t reserved[2];
+    uint16_t string_offsets[STRING_COUNT];  // From blob start, 0 = not set
+};
+
+static_assert(sizeof(ConfigBlob) == 108, "ConfigBlob layout must match tools/config_blob.py");
@@ -1,8 +1,44 @@
 #pragma once
 #include "x402_client.h"
+#include "sdkconfig.h"
 
 class ConfigManager {
 public:
-    static bool init();  // Mounts SPIFFS (new)
+    // Where loadBinary() finds the blob: a partition label on the device,
+    // a file path on the linux target
+#if CONFIG_IDF_TARGET_LINUX
+    static constexpr const char* BLOB_SOURCE = "config.bin";
+#else
+    static constexpr const char* BLOB_SOURCE = "config";
+#endif
+
+    // config.json for load(): on SPIFFS on the device, in the source tree
+    // (run from the project directory) on the linux target
+#if CONFIG_IDF_TARGET_LINUX
+    static constexpr const char* JSON_PATH = "main/spiffs/config.json";
+#else
+    static constexpr const char* JSON_PATH = "/spiffs/config.json";
+#endif
+
+    static bool init();  // Mounts SPIFFS (nothing to do on linux)
     static bool load(const char* path, X402Config& out_config);
+
+    /**
+     * @brief Load the binary config blob (see config_blob.h) without copying
+     *
+     * Maps the blob read-only (esp_partition_mmap on the device, mmap on
+     * linux), checks magic, version and CRC, and points the X402Config
+     * string fields into the mapping, which stays mapped for the life of
+     * the program. Nothing is allocated on the heap.
+     * @param source Partition label, or file path on linux (BLOB_SOURCE)
+     * @return false if the blob is missing or invalid (fall back to load())
+     */
+    static bool loadBinary(const char* source, X402Config& out_config);
+
+    /**
+     * @brief Time loadBinary() against load() and log both
+     * Mounts SPIFFS if needed. Also reports the heap each path keeps and
+     * whether both produced the same configuration.
+     */
+    static void benchmark(const char* blob_source, const char* json_path);
 };
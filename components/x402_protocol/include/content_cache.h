@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include "sdkconfig.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "async_http.h"
+
+/**
+ * @brief Two-tier cache of paid content, so a repeat view is not paid again
+ *
+ * Entries are keyed by resource URL and payment scope (who paid), hashed
+ * with SHA-256. The RAM tier holds up to MAX_RAM_ENTRIES bodies within
+ * RAM_BUDGET bytes and evicts the least recently used; the disk tier keeps
+ * one file per entry under the cache directory within DISK_BUDGET bytes, so
+ * purchases survive a reboot. A disk hit is promoted to RAM.
+ *
+ * Freshness follows the merchant's Cache-Control (no-store, no-cache,
+ * max-age) and Expires/Date headers, with DEFAULT_MAX_AGE_S when neither is
+ * sent. Stale entries are returned with their validators (ETag,
+ * Last-Modified) for a conditional request; refresh() renews them on 304.
+ * A no-cache entry is stale from the start but only expires with its
+ * lifetime, which Hit::expired tells apart.
+ * Without a synchronized wall clock, a disk entry from a previous boot is
+ * always treated as stale.
+ *
+ * Thread-safe: the maintenance task opens the disk tier while the payment
+ * worker may already be looking up entries. Every public method holds one
+ * mutex, disk I/O included.
+ */
+class ContentCache {
+public:
+    // Where openDisk() keeps entry files: the SPIFFS mount on the device,
+    // a directory on the linux target
+#if CONFIG_IDF_TARGET_LINUX
+    static constexpr const char* CACHE_DIR = "cache";
+#else
+    static constexpr const char* CACHE_DIR = "/spiffs";
+#endif
+
+    static constexpr size_t MAX_RAM_ENTRIES  = 8;
+    static constexpr size_t RAM_BUDGET       = 16 * 1024;
+    static constexpr size_t MAX_DISK_ENTRIES = 32;
+    static constexpr size_t DISK_BUDGET      = 128 * 1024;
+    static constexpr size_t MAX_ENTRY_BYTES  = 8 * 1024;
+    static constexpr uint32_t DEFAULT_MAX_AGE_S = 60;
+
+    struct Hit {
+        char* content;          // malloc'd, NUL-terminated, caller frees
+        size_t len;
+        bool fresh;             // false: revalidate with the validators first
+        bool expired;           // Past max-age/Expires; a no-cache entry may not be yet
+        char etag[sizeof(AsyncHttp::Headers::etag)];
+        char last_modified[sizeof(AsyncHttp::Headers::last_modified)];
+    };
+
+    ContentCache();
+    ~ContentCache();
+
+    ContentCache(const ContentCache&) = delete;
+    ContentCache& operator=(const ContentCache&) = delete;
+
+    /**
+     * @brief Index the entry files in dir and enable the disk tier
+     * @return false if dir cannot be read (RAM tier only)
+     */
+    bool openDisk(const char* dir);
+
+    /**
+     * @brief Look up url for scope
+     * @return false on miss; on hit the caller owns out.content
+     */
+    bool get(const char* url, const char* scope, Hit& out);
+
+    /**
+     * @brief Store content received for url unless the headers forbid it
+     */
+    void put(const char* url, const char* scope, const char* content, size_t len,
+             const AsyncHttp::Headers& headers);
+
+    /**
+     * @brief Renew freshness after a 304 Not Modified
+     */
+    void refresh(const char* url, const char* scope, const AsyncHttp::Headers& headers);
+
+    void remove(const char* url, const char* scope);
+
+private:
+    struct Meta {
+        uint8_t key[32];
+        size_t len;
+        int64_t fresh_until_us;     // esp_timer time, 0 = stale
+        int64_t expires_unix;       // Wall-clock expiry, 0 = unknown
+        bool revalidate;            // no-cache / must-revalidate
+        char etag[sizeof(AsyncHttp::Headers::etag)];
+        char last_modified[sizeof(AsyncHttp::Headers::last_modified)];
+    };
+
+    struct RamEntry {
+        Meta meta;
+        char* data;
+        uint32_t last_used;
+    };
+
+    struct DiskEntry {
+        uint8_t key[32];
+        size_t len;
+        uint32_t last_used;
+    };
+
+    // Whether and for how long headers allow the content to be reused
+    static bool applyHeaders(const AsyncHttp::Headers& headers, Meta& meta);
+    static void makeKey(const char* url, const char* scope, uint8_t key[32]);
+    static bool isFresh(const Meta& meta);
+    static bool isExpired(const Meta& meta);
+
+    // Callers below hold mutex_
+    void removeKey(const uint8_t key[32]);
+    RamEntry* findRam(const uint8_t key[32]);
+    DiskEntry* findDisk(const uint8_t key[32]);
+    void insertRam(const Meta& meta, const char* content);
+    void evictRam(size_t needed);
+    void dropRam(RamEntry& e);
+    bool readDisk(const uint8_t key[32], Meta& meta, char** content);
+    void writeDisk(const Meta& meta, const char* content);
+    void dropDisk(DiskEntry& e);
+    void pathFor(const uint8_t key[32], char* out, size_t cap) const;
+
+    RamEntry ram_[MAX_RAM_ENTRIES];
+    size_t ram_bytes_;
+    DiskEntry disk_[MAX_DISK_ENTRIES];
+    size_t disk_bytes_;
+    uint32_t clock_;            // Recency counter shared by both tiers
+    char dir_[32];
+    bool disk_ready_;
+
+    uint32_t hits_;
+    uint32_t lookups_;
+    SemaphoreHandle_t mutex_;
+};
@@ -15,6 +15,13 @@ public:
      */
     static bool base58ToBytes(const char* base58_str, uint8_t out32[32]);
 
+    /**
+     * @brief Encode bytes (e.g. a 32-byte public key) as a Base58 string.
+     * @param out Output buffer; 45 bytes is enough for a 32-byte key
+     * @return false if out is too small
+     */
+    static bool bytesToBase58(const uint8_t* data, size_t len, char* out, size_t out_size);
+
     /**
      * @brief Sign a message with ED25519 using secret + public key (32 bytes each).
      */
@@ -26,9 +33,28 @@ public:
         const uint8_t public_key[32]
     );
 
+    /**
+     * @brief SLIP-0010 ed25519 private key along a derivation path
+     *
+     * ed25519 only has hardened children, so every index is used with the
+     * hardened bit set (path {44, 501, 0, 0} is m/44'/501'/0'/0').
+     * @param key_out Private key (an ed25519 seed for crypto_sign_seed_keypair)
+     */
+    static bool slip10DeriveEd25519(const uint8_t* seed, size_t seed_len,
+                                    const uint32_t* path, size_t depth,
+                                    uint8_t key_out[32]);
+
     /**
      * @brief Encode binary data into Base64 (null-terminated string).
      * Caller must free() the returned pointer.
      */
     static char* base64Encode(const unsigned char* data, size_t input_length);
+
+    /**
+     * @brief Decode standard Base64 into a caller-provided buffer.
+     * @param out_len Receives the number of decoded bytes
+     * @return false on invalid input or if out is too small
+     */
+    static bool base64Decode(const char* input, size_t input_length,
+                             uint8_t* out, size_t out_size, size_t* out_len);
 };
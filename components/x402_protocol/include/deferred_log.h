@@ -0,0 +1,216 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+#include <esp_log.h>
+#include "sdkconfig.h"
+
+/**
+ * @brief Logging for the payment hot path without formatting on the caller
+ *
+ * A DLOGx() call site owns a static Site (level, format, and an ID hashed
+ * from the file name and format at compile time). Logging copies the Site
+ * pointer, a timestamp and the raw arguments into a lock-free MpscRing
+ * (shared with UiCommandQueue) and returns; no printf, no UART. A
+ * low-priority task drains the ring and either formats the records as
+ * ordinary log lines or writes them as binary frames that
+ * tools/dlog_decode.py turns back into text on the host. Frame bytes that
+ * read as CR, LF or the escape byte are escaped, so the console's newline
+ * translation cannot corrupt them.
+ *
+ * Calls above CONFIG_X402_DEFERRED_LOG_LEVEL compile to nothing. Formats
+ * are checked like printf; strings and byte buffers are copied and
+ * truncated to fit a record, and arguments that do not fit print as "?".
+ * A full ring drops records and counts them ("log.dropped").
+ *
+ * tools/dlog_decode.py reads formats from the sources, so write them as
+ * plain literals: cast to int or unsigned long long instead of using the
+ * PRIu32-style macros, whose expansion differs per target.
+ */
+class DeferredLog {
+public:
+    static constexpr size_t CAPACITY = 32;          // Power of two (MpscRing)
+    static constexpr size_t PAYLOAD_MAX = 96;       // Argument bytes per record
+    static constexpr uint32_t DRAIN_PERIOD_MS = 50;
+
+    // Argument encoding: one type byte, then the value. Strings and bytes
+    // carry a length byte before their contents.
+    enum ArgType : uint8_t {
+        ARG_INT32 = 'i',
+        ARG_UINT32 = 'u',
+        ARG_INT64 = 'q',
+        ARG_UINT64 = 'Q',
+        ARG_DOUBLE = 'd',
+        ARG_STRING = 's',
+        ARG_POINTER = 'p',      // Stored as 64 bits
+        ARG_BYTES = 'x',
+    };
+
+    struct Site {
+        esp_log_level_t level;
+        const char* fmt;
+        uint32_t id;
+    };
+
+    /**
+     * @brief Byte buffer argument, printed as hex by DLOG_BUFFER_HEX
+     */
+    struct Bytes {
+        const void* data;
+        size_t len;
+    };
+
+    struct Record {
+        const Site* site;
+        const char* tag;            // Must outlive the record: use the file's TAG
+        uint32_t timestamp_ms;
+        uint8_t len;
+        uint8_t payload[PAYLOAD_MAX];
+    };
+
+    /**
+     * @brief FNV-1a over the base name of file, ':' and fmt
+     *
+     * Stable across builds and machines, so the decoder can recompute it
+     * from the sources.
+     */
+    static constexpr uint32_t siteId(const char* file, const char* fmt) {
+        const char* base = file;
+        for (const char* p = file; *p; p++) {
+            if (*p == '/' || *p == '\\') base = p + 1;
+        }
+        uint32_t h = 2166136261u;
+        for (const char* p = base; *p; p++) h = (h ^ (uint8_t)*p) * 16777619u;
+        h = (h ^ (uint8_t)':') * 16777619u;
+        for (const char* p = fmt; *p; p++) h = (h ^ (uint8_t)*p) * 16777619u;
+        return h;
+    }
+
+    /**
+     * @brief Start the drain task (idempotent)
+     */
+    static bool start();
+
+    /**
+     * @brief Output every queued record; consumer only
+     *
+     * The drain task calls this. Call it directly only if start() was not
+     * called, e.g. on the host or before a deliberate restart.
+     * @return Number of records written
+     */
+    static size_t drain();
+
+    /**
+     * @brief Records dropped on a full ring since boot
+     */
+    static uint32_t dropped();
+
+    template <typename... Args>
+    static void write(const Site& site, const char* tag, Args... args) {
+        uint32_t pos;
+        Record* record = claim(pos);
+        if (!record) {
+            return;
+        }
+        record->site = &site;
+        record->tag = tag;
+        record->timestamp_ms = esp_log_timestamp();
+        size_t len = 0;
+        bool fits = true;
+        ((fits = fits && pack(record->payload, len, args)), ...);
+        (void)fits;
+        record->len = (uint8_t)len;
+        publish(pos);
+    }
+
+private:
+    static Record* claim(uint32_t& pos);
+    static void publish(uint32_t pos);
+
+    static bool put(uint8_t* payload, size_t& len, uint8_t type, const void* value, size_t size) {
+        if (len + 1 + size > PAYLOAD_MAX) {
+            return false;
+        }
+        payload[len] = type;
+        memcpy(payload + len + 1, value, size);
+        len += 1 + size;
+        return true;
+    }
+
+    // Copies as much of data as fits after the type and length bytes
+    static bool putBlob(uint8_t* payload, size_t& len, uint8_t type, const void* data, size_t size) {
+        if (len + 2 > PAYLOAD_MAX) {
+            return false;
+        }
+        size_t n = size < PAYLOAD_MAX - len - 2 ? size : PAYLOAD_MAX - len - 2;
+        payload[len] = type;
+        payload[len + 1] = (uint8_t)n;
+        memcpy(payload + len + 2, data, n);
+        len += 2 + n;
+        return true;
+    }
+
+    static bool pack(uint8_t* payload, size_t& len, Bytes bytes) {
+        return putBlob(payload, len, ARG_BYTES, bytes.data, bytes.len);
+    }
+
+    template <typename T>
+    static bool pack(uint8_t* payload, size_t& len, T value) {
+        if constexpr (std::is_enum_v<T>) {
+            return pack(payload, len, (std::underlying_type_t<T>)value);
+        } else if constexpr (std::is_floating_point_v<T>) {
+            double d = value;
+            return put(payload, len, ARG_DOUBLE, &d, sizeof(d));
+        } else if constexpr (std::is_integral_v<T> && sizeof(T) <= 4) {
+            if constexpr (std::is_signed_v<T>) {
+                int32_t v = value;
+                return put(payload, len, ARG_INT32, &v, sizeof(v));
+            } else {
+                uint32_t v = value;
+                return put(payload, len, ARG_UINT32, &v, sizeof(v));
+            }
+        } else if constexpr (std::is_integral_v<T>) {
+            if constexpr (std::is_signed_v<T>) {
+                int64_t v = value;
+                return put(payload, len, ARG_INT64, &v, sizeof(v));
+            } else {
+                uint64_t v = value;
+                return put(payload, len, ARG_UINT64, &v, sizeof(v));
+            }
+        } else if constexpr (std::is_same_v<std::remove_cv_t<std::remove_pointer_t<T>>, char>) {
+            const char* s = value ? value : "(null)";
+            return putBlob(payload, len, ARG_STRING, s, strnlen(s, PAYLOAD_MAX));
+        } else {
+            static_assert(std::is_pointer_v<T>, "DLOG arguments must be numbers, strings or pointers");
+            uint64_t v = (uintptr_t)value;
+            return put(payload, len, ARG_POINTER, &v, sizeof(v));
+        }
+    }
+};
+
+// The unreachable printf keeps -Wformat checking every call site
+#define DLOG_LEVEL(level, tag, fmt, ...) do {                                               \
+        if constexpr ((level) <= CONFIG_X402_DEFERRED_LOG_LEVEL) {                          \
+            static constexpr DeferredLog::Site dlog_site_ = {                               \
+                (level), fmt, DeferredLog::siteId(__FILE__, fmt)};                          \
+            if (false) printf(fmt, ##__VA_ARGS__);                                          \
+            DeferredLog::write(dlog_site_, tag, ##__VA_ARGS__);                             \
+        }                                                                                   \
+    } while (0)
+
+#define DLOGE(tag, fmt, ...) DLOG_LEVEL(ESP_LOG_ERROR, tag, fmt, ##__VA_ARGS__)
+#define DLOGW(tag, fmt, ...) DLOG_LEVEL(ESP_LOG_WARN, tag, fmt, ##__VA_ARGS__)
+#define DLOGI(tag, fmt, ...) DLOG_LEVEL(ESP_LOG_INFO, tag, fmt, ##__VA_ARGS__)
+#define DLOGD(tag, fmt, ...) DLOG_LEVEL(ESP_LOG_DEBUG, tag, fmt, ##__VA_ARGS__)
+
+// Hex dump of up to PAYLOAD_MAX - 2 bytes, 16 per line
+#define DLOG_BUFFER_HEX(tag, buffer, buff_len, level) do {                                  \
+        if constexpr ((level) <= CONFIG_X402_DEFERRED_LOG_LEVEL) {                          \
+            static constexpr DeferredLog::Site dlog_site_ = {                               \
+                (level), "%b", DeferredLog::siteId(__FILE__, "%b")};                        \
+            DeferredLog::write(dlog_site_, tag, DeferredLog::Bytes{(buffer), (buff_len)});  \
+        }                                                                                   \
+    } while (0)
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include "lvgl.h"
+
+/**
+ * @brief Panel, touch and LVGL runtime behind DisplayManager
+ *
+ * A backend owns everything below the widget tree: LVGL initialization,
+ * the lv_display_t and its flush path, the input device, the lock that
+ * serializes LVGL calls and the backlight. DisplayManager only builds and
+ * switches screens on whatever display the backend registers.
+ */
+class DisplayBackend {
+public:
+    virtual ~DisplayBackend() = default;
+
+    /**
+     * @brief Initialize LVGL, register the display and input device
+     * @return true if the display is ready for widgets
+     */
+    virtual bool init() = 0;
+
+    /**
+     * @brief Remove the display and release the hardware
+     */
+    virtual void deinit() = 0;
+
+    /**
+     * @brief Display registered by init(), nullptr before
+     */
+    virtual lv_display_t* display() const = 0;
+
+    /**
+     * @brief Take the LVGL lock
+     * @param timeout_ms Maximum wait, 0 waits forever
+     * @return true if the lock was taken
+     */
+    virtual bool lock(uint32_t timeout_ms) = 0;
+
+    /**
+     * @brief Release the LVGL lock
+     */
+    virtual void unlock() = 0;
+
+    /**
+     * @brief Set backlight level (0-100%)
+     */
+    virtual void setBacklight(uint8_t brightness) = 0;
+};
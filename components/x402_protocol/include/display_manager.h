@@ -1,21 +1,39 @@
 #pragma once
 
+#include <atomic>
 #include <string>
+#include <memory>
 #include <functional>
 #include "lvgl.h"
-#include "esp_lcd_panel_io.h"
-#include "esp_lcd_panel_vendor.h"
-#include "esp_lcd_touch.h"
+#include "display_backend.h"
+#include "frame_profiler.h"
+#include "ui_command_queue.h"
 
 /**
- * @brief Display Manager for ESP32-C6 Touch LCD 1.69"
+ * @brief Display Manager for the payment UI
  * 
- * Manages LVGL initialization, display lifecycle, touch input,
- * and provides simple text display methods for status updates.
+ * Builds the UI on the display of a DisplayBackend (the ST7789 panel on
+ * the board, or a headless framebuffer on the build host) and provides
+ * simple text display methods for status updates.
+ *
+ * Every screen (idle, progress, success, error) is built once in init()
+ * and kept alive; the show* methods switch screens with lv_scr_load and
+ * only rewrite labels whose text actually changed, so a status update
+ * invalidates just the label that moved instead of the whole panel.
+ *
+ * The show* methods never take the LVGL lock: they copy the update into
+ * a lock-free UiCommandQueue and return. An LVGL timer drains the queue
+ * on the LVGL task, collapsing status updates that a later command
+ * superseded before they were drawn.
  */
 class DisplayManager {
 public:
-    DisplayManager();
+    static constexpr uint32_t DRAIN_PERIOD_MS = 10;
+
+    /**
+     * @param backend Panel/touch driver; DisplayManager takes ownership
+     */
+    explicit DisplayManager(std::unique_ptr<DisplayBackend> backend);
     ~DisplayManager();
 
     // Disable copy/move
@@ -36,6 +54,7 @@ public:
     /**
      * @brief Show idle screen with "Start Payment" button
      * @param callback Function to call when button is clicked
+     * Swapping the callback takes the LVGL lock; only the screen switch is queued.
      */
     void showIdleScreen(std::function<void()> callback);
 
@@ -86,35 +105,63 @@ public:
      */
     bool isInitialized() const { return initialized_; }
 
+    /**
+     * @brief Copy the profiler's per-refresh samples, oldest first
+     * @return Number of samples written
+     */
+    size_t frameSamples(FrameProfiler::FrameSample* out, size_t max);
+
+    /**
+     * @brief Drop the profiler's samples, e.g. between benchmark steps
+     */
+    void resetFrameSamples();
+
+    DisplayBackend* backend() const { return backend_.get(); }
+
 private:
-    void initLVGL();
-    void initDisplay();
-    void initTouch();
-    void initBacklight();
     void lockLVGL();
     void unlockLVGL();
+
+    void post(UiCommandQueue::Type type, const char* title, const char* message = nullptr);
+    void applyCommand(const UiCommandQueue::Command& cmd);
+    static void drainTimerCallback(lv_timer_t* timer);
     
-    static void touchReadCallback(lv_indev_t* indev, lv_indev_data_t* data);
+    void buildScreens();
+    lv_obj_t* createScreen();
+    lv_obj_t* createMessageScreen(uint32_t color, lv_obj_t** label_out);
+    void loadScreen(lv_obj_t* screen);
+    void setProgressLayout(uint8_t layout);
+    static void setLabelText(lv_obj_t* label, const char* text);
+
     static void buttonEventCallback(lv_event_t* e);
 
-    // Hardware handles
-    esp_lcd_panel_io_handle_t io_handle_;
-    esp_lcd_panel_handle_t panel_handle_;
-    esp_lcd_touch_handle_t touch_handle_;
-    lv_disp_t* lvgl_disp_;
-    lv_indev_t* lvgl_touch_;
+    std::unique_ptr<DisplayBackend> backend_;
+    FrameProfiler profiler_;
+    UiCommandQueue commands_;
+    lv_timer_t* drain_timer_;
+    int32_t hres_;
+    int32_t vres_;
     
-    // UI elements
-    lv_obj_t* label_;
-    lv_obj_t* idle_container_;
+    // Retained screens
+    lv_obj_t* idle_screen_;
+    lv_obj_t* progress_screen_;
+    lv_obj_t* success_screen_;
+    lv_obj_t* error_screen_;
+    lv_obj_t* blank_screen_;
+
+    // Widgets updated in place
+    lv_obj_t* progress_title_;
+    lv_obj_t* progress_message_;
+    lv_obj_t* success_label_;
+    lv_obj_t* error_label_;
     lv_obj_t* button_;
-    lv_obj_t* button_label_;
     lv_obj_t* wallet_address_label_;
+    uint8_t progress_layout_;
     
     // Callback for button press
     std::function<void()> button_callback_;
     
-    // State
-    bool initialized_;
+    // State: set on the boot_display task, read from the UI and payment tasks
+    std::atomic<bool> initialized_;
     uint8_t brightness_;
 };
\ No newline at end of file
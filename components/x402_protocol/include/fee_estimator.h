@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <freertos/FreeRTOS.h>
+
+/**
+ * @brief Rolling model of recent priority fees and compute usage.
+ *
+ * Fed from the background task with getRecentPrioritizationFees windows
+ * and simulateTransaction results; the payment path only reads the cached
+ * price and limit. The percentile used for the price is chosen from the
+ * landing-latency target: a tighter target bids higher in the distribution.
+ */
+class FeeEstimator {
+public:
+    static constexpr size_t MAX_FEE_SAMPLES = 300;       // ~2 RPC windows of 150 slots
+    static constexpr size_t MAX_UNIT_SAMPLES = 8;
+    static constexpr uint32_t DEFAULT_TARGET_MS = 2000;
+    static constexpr uint64_t MIN_UNIT_PRICE = 1;        // micro-lamports per CU
+    static constexpr uint64_t MAX_UNIT_PRICE = 100000;   // caps the fee at 0.1 lamport/CU
+    static constexpr uint32_t MAX_UNIT_LIMIT = 1400000;
+
+    /**
+     * @param target_latency_ms Desired time to land; 0 selects DEFAULT_TARGET_MS
+     */
+    explicit FeeEstimator(uint32_t target_latency_ms);
+
+    /**
+     * @brief Add one window of per-slot prioritization fees (micro-lamports/CU)
+     * Oldest samples are overwritten once MAX_FEE_SAMPLES is reached.
+     */
+    void addFeeSamples(const uint64_t* fees, size_t count);
+
+    /**
+     * @brief Record the compute units a single-transfer payment consumed
+     */
+    void addUnitsSample(uint32_t units_consumed);
+
+    /**
+     * @brief Price for the latency target, clamped to [MIN, MAX]_UNIT_PRICE
+     */
+    uint64_t unitPrice() const;
+
+    /**
+     * @brief Compute-unit limit for a transaction with transfers transfers
+     * @return 0 until a measurement exists (caller keeps its default)
+     */
+    uint32_t unitLimit(size_t transfers) const;
+
+    uint8_t percentile() const { return percentile_; }
+
+private:
+    uint8_t percentile_;
+
+    // Written only by the background task
+    uint32_t fees_[MAX_FEE_SAMPLES];
+    uint32_t scratch_[MAX_FEE_SAMPLES];
+    size_t fee_count_;
+    size_t fee_head_;
+    uint32_t units_[MAX_UNIT_SAMPLES];
+    size_t unit_count_;
+    size_t unit_head_;
+
+    // Cached results, read from the payment path
+    uint64_t price_;
+    uint32_t units_max_;
+    mutable portMUX_TYPE lock_;
+};
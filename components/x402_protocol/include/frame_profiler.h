@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include "lvgl.h"
+
+/**
+ * @brief Per-refresh timing and pixel counts from LVGL display events
+ *
+ * Attached to a display, it records one FrameSample for every refresh
+ * that had something invalidated, tagged with the UI transition that
+ * caused it. Samples are kept in a ring for host-side benchmarks and
+ * also fed to Metrics (ui.*) on the device.
+ *
+ * Event handlers run on the LVGL task, so read samples with the LVGL
+ * lock held (DisplayManager::frameSamples does this).
+ */
+class FrameProfiler {
+public:
+    static constexpr size_t MAX_SAMPLES = 64;
+
+    struct FrameSample {
+        const char* transition;     // Last markTransition() name, nullptr if none
+        uint32_t render_us;         // Refresh time minus flush time
+        uint32_t flush_us;          // flush_cb calls plus waits for the panel
+        uint32_t flushed_px;        // Pixels handed to flush_cb
+        uint32_t invalidated_px;    // Area invalidated since the previous refresh
+    };
+
+    FrameProfiler();
+
+    /**
+     * @brief Start receiving refresh events from disp
+     */
+    void attach(lv_display_t* disp);
+
+    /**
+     * @brief Tag the following refreshes with a transition name
+     * @param name String literal, stored by pointer
+     */
+    void markTransition(const char* name);
+
+    /**
+     * @brief Copy recorded samples, oldest first
+     * @return Number of samples written to out
+     */
+    size_t samples(FrameSample* out, size_t max) const;
+
+    /**
+     * @brief Drop all recorded samples
+     */
+    void reset();
+
+private:
+    static void eventCallback(lv_event_t* e);
+    void record(uint32_t total_us);
+
+    FrameSample ring_[MAX_SAMPLES];
+    size_t head_;
+    size_t count_;
+
+    const char* transition_;
+    int64_t refresh_start_us_;
+    int64_t flush_start_us_;
+    int64_t flush_us_;
+    uint32_t flushed_px_;
+    uint32_t invalidated_px_;
+};
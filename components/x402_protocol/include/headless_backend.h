@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "display_backend.h"
+
+/**
+ * @brief In-memory display for running the UI without a panel
+ *
+ * Renders into an RGB565 framebuffer through the same partial-refresh
+ * buffer size as the ST7789 backend, so render and flush profiles are
+ * comparable. By default there is no LVGL task: the owner advances time
+ * and runs the LVGL timers with pump(), so benchmarks control every
+ * frame. runTask() instead pumps from a task, as the client does on the
+ * linux target. Touches are injected with press()/release().
+ *
+ * LVGL keeps its state in globals, so several backends (one per client in
+ * LoadGenerator) share one lock; LVGL is initialized with the first and
+ * torn down with the last.
+ */
+class HeadlessBackend : public DisplayBackend {
+public:
+    static constexpr int32_t DEFAULT_WIDTH = 240;
+    static constexpr int32_t DEFAULT_HEIGHT = 280;
+    static constexpr int32_t BUFFER_LINES = 40;
+    static constexpr uint32_t TASK_PERIOD_MS = 10;
+
+    HeadlessBackend(int32_t width = DEFAULT_WIDTH, int32_t height = DEFAULT_HEIGHT);
+    ~HeadlessBackend() override;
+
+    HeadlessBackend(const HeadlessBackend&) = delete;
+    HeadlessBackend& operator=(const HeadlessBackend&) = delete;
+
+    bool init() override;
+    void deinit() override;
+    lv_display_t* display() const override { return disp_; }
+    bool lock(uint32_t timeout_ms) override;
+    void unlock() override;
+    void setBacklight(uint8_t brightness) override { backlight_ = brightness; }
+
+    /**
+     * @brief Advance the LVGL tick by elapsed_ms and run due timers
+     * (including the display refresh) under the lock
+     */
+    void pump(uint32_t elapsed_ms);
+
+    /**
+     * @brief Call pump(period_ms) from a task every period_ms between
+     * init() and deinit(); call before init()
+     */
+    void runTask(uint32_t period_ms) { task_period_ms_ = period_ms; }
+
+    /**
+     * @brief Report a touch at (x, y) until release()
+     */
+    void press(int32_t x, int32_t y);
+    void release();
+
+    /**
+     * @brief Rendered pixels, row-major RGB565, width() * height() entries
+     */
+    const uint16_t* framebuffer() const { return framebuffer_.get(); }
+    int32_t width() const { return width_; }
+    int32_t height() const { return height_; }
+    uint8_t backlight() const { return backlight_; }
+
+private:
+    static void flushCallback(lv_display_t* disp, const lv_area_t* area, uint8_t* px_map);
+    static void touchReadCallback(lv_indev_t* indev, lv_indev_data_t* data);
+    static void taskEntry(void* arg);
+
+    int32_t width_;
+    int32_t height_;
+    std::unique_ptr<uint16_t[]> framebuffer_;
+    std::unique_ptr<uint16_t[]> draw_buf_;
+    lv_display_t* disp_;
+    lv_indev_t* touch_;
+    static std::recursive_timed_mutex mutex_;
+    static size_t instances_;               // Initialized backends, under mutex_
+
+    int32_t touch_x_;
+    int32_t touch_y_;
+    bool touch_pressed_;
+    uint8_t backlight_;
+    bool initialized_;
+
+    uint32_t task_period_ms_;
+    std::atomic<bool> task_running_;     // Cleared to stop the task
+    std::atomic<bool> task_alive_;       // Cleared by the task as it exits
+};
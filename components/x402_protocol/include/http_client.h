@@ -2,7 +2,8 @@
 
 #include <cJSON.h>
 #include <esp_err.h>
-#include <esp_http_client.h>  
+#include <functional>
+#include "async_http.h"
 
 struct HttpClientConfig {
     const char* user_agent;
@@ -14,13 +15,38 @@ public:
     explicit HttpClient(const HttpClientConfig& config);
     ~HttpClient();
 
-    bool get(const char* url, char** response_out, size_t* response_len_out = nullptr);
     bool get_402(const char* url, cJSON** json_out, char** raw_response = nullptr);
-    bool submit_payment(const char* url, const char* b64_payment, char** content_out = nullptr);
+
+    struct StreamResult {
+        int status;                 // Status of the paying request, 0 if no response arrived
+        esp_err_t err;              // Transport error of the paying request
+        char error[160];            // Start of a non-2xx body (facilitator error), NUL-terminated
+        size_t received;            // Body bytes handed to the sink
+        int64_t total;              // Content size, -1 if the merchant did not say
+        uint8_t resumes;            // Range requests needed after dropped connections
+        AsyncHttp::Headers headers; // Of the paying request
+    };
+    static constexpr int MAX_RESUMES = 4;
+    static constexpr uint32_t RESUME_DELAY_MS = 500;
+
+    // Paid content of any size, handed to sink chunk by chunk as it arrives.
+    // A dropped transfer is resumed with "Range: bytes=<received>-" and the
+    // same X-PAYMENT proof, which the merchant has already accepted. Returns
+    // true once the whole body reached the sink; status 200 with false means
+    // paid but not fully delivered.
+    bool submit_payment_stream(const char* url, const char* b64_payment,
+                               const AsyncHttp::Sink& sink, StreamResult* out);
+
+    // Conditional GET with the validators of a cached copy (either may be
+    // nullptr). Returns the HTTP status (304 = still valid), 0 on failure;
+    // body_out receives a 200 body.
+    int get_conditional(const char* url, const char* etag, const char* last_modified,
+                        char** body_out, AsyncHttp::Headers* headers_out);
+
+    // Non-blocking get_402: done runs on the HTTP executor task and takes
+    // ownership of json (nullptr on failure). false = not started.
+    bool get_402_async(const char* url, std::function<void(cJSON* json)> done);
 
 private:
-    static char response_buffer[4096];
-    static int response_len;
     HttpClientConfig cfg_;
-    static esp_err_t event_handler(esp_http_client_event_t *evt);
 };
\ No newline at end of file
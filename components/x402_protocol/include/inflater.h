@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include "sdkconfig.h"
+
+#if CONFIG_IDF_TARGET_LINUX
+#include <zlib.h>
+#else
+#include "miniz.h"
+#endif
+
+/**
+ * @brief Streaming decoder for gzip and deflate Content-Encoding
+ *
+ * Compressed bytes are fed as they come off the socket and decoded bytes
+ * are handed to the caller piece by piece, so memory is fixed at the 32 KB
+ * deflate window plus decoder state whatever the body size. "deflate" is
+ * accepted both zlib-wrapped (as specified) and raw (as some servers send
+ * it). The gzip CRC and length are checked.
+ *
+ * ROM miniz (tinfl) on the device, zlib on the linux target.
+ */
+class Inflater {
+public:
+    enum class Format : uint8_t {
+        Gzip,
+        Deflate,
+    };
+
+    using Output = std::function<bool(const char* data, size_t len)>;
+
+    static constexpr size_t WINDOW_SIZE = 32 * 1024;
+
+    /**
+     * @brief Map a Content-Encoding value to a format
+     * @return false for identity or an encoding that cannot be decoded
+     */
+    static bool parseEncoding(const char* content_encoding, Format* out);
+
+    explicit Inflater(Format format);
+    ~Inflater();
+
+    Inflater(const Inflater&) = delete;
+    Inflater& operator=(const Inflater&) = delete;
+
+    /**
+     * @brief false if the window or decoder state could not be allocated
+     */
+    bool ok() const;
+
+    /**
+     * @brief Decode the next compressed bytes
+     * @param out Receives decoded bytes; returning false stops decoding
+     * @return false on corrupt input or when out refused data
+     */
+    bool feed(const uint8_t* data, size_t len, const Output& out);
+
+    /**
+     * @brief End of the compressed stream reached (and the gzip trailer checked)
+     */
+    bool finished() const { return stage_ == Stage::Done; }
+
+    size_t decoded() const { return decoded_; }
+
+private:
+    enum class Stage : uint8_t {
+        Header,         // gzip fixed header, or the first two bytes of deflate
+        GzipExtraLen,
+        GzipExtra,
+        GzipName,
+        GzipComment,
+        GzipHeaderCrc,
+        Body,
+        GzipTrailer,
+        Done,
+        Failed,
+    };
+
+    // Consume gzip framing (or sniff zlib vs raw deflate) before the body
+    size_t parseHeader(const uint8_t* data, size_t len, const Output& out);
+    // Move past a finished header field to the next one flags_ announces
+    void nextField(Stage after);
+    bool startBody(bool zlib);
+    size_t inflateBody(const uint8_t* data, size_t len, const Output& out);
+    void endBody();
+    bool emit(const uint8_t* data, size_t len, const Output& out);
+    bool checkTrailer() const;
+
+    Format format_;
+    Stage stage_;
+    uint8_t head_[10];
+    size_t head_len_;
+    size_t skip_;           // Bytes left of the current gzip header field
+    uint8_t flags_;         // gzip FLG
+    uint32_t crc_;
+    size_t decoded_;
+
+#if CONFIG_IDF_TARGET_LINUX
+    static constexpr size_t OUT_CHUNK = 4096;
+    z_stream zs_;           // Keeps its own window
+    bool zs_ready_;
+    uint8_t* out_;          // OUT_CHUNK output staging
+#else
+    tinfl_decompressor* tinfl_;
+    uint32_t tinfl_flags_;
+    uint8_t* window_;       // WINDOW_SIZE, power of two, wraps
+    size_t window_pos_;
+#endif
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include "x402_client.h"
+
+/**
+ * @brief Sustained payment load against stand-in servers, for the linux target
+ *
+ * Every worker task owns an X402PaymentClient on its own headless display,
+ * paying from its own key derived from the configured payer, with its own
+ * journal and cache under loadgen/. A worker runs executePaymentFlow
+ * unpaced, as a tap would: cache, pre-signed pool, offer, journal and
+ * ledger checks, blockhash, build, sign, encode and the streamed paid
+ * content. The clients report each stage as it ends, so a report shows
+ * where time goes as load rises and not just the end-to-end figure.
+ *
+ * Workers pay concurrently; what they still share is the process's
+ * AsyncHttp engine and the stand-in servers. ClosedLoop keeps `workers`
+ * payments outstanding. OpenLoop schedules arrivals at a fixed `rate`
+ * whatever the response times and hands each to the next free worker; a
+ * payment's latency counts from its scheduled arrival, so time spent
+ * waiting for a free worker is reported (as "queue") instead of hidden.
+ *
+ * The report is one JSON object written to report_path: throughput,
+ * p50/p90/p99/p99.9/max per stage, failures by stage and submission
+ * outcome, and CPU time and heap growth per payment.
+ */
+class LoadGenerator {
+public:
+    enum class Mode : uint8_t {
+        ClosedLoop,     // Fixed concurrency
+        OpenLoop,       // Fixed arrival rate
+    };
+
+    struct Options {
+        Mode mode;
+        size_t workers;             // Tasks, each paying through its own client
+        uint32_t rate;              // Arrivals per second (OpenLoop)
+        uint32_t duration_s;
+        const char* merchant_url;   // Answers 402, then serves the paid content
+        const char* rpc_url;
+        const char* report_path;
+    };
+
+    static constexpr size_t MAX_WORKERS = 64;
+    static constexpr size_t ARRIVAL_QUEUE_DEPTH = 1024;    // Open loop backlog before drops
+
+    static const char* modeName(Mode mode);
+
+    /**
+     * @brief Options from Kconfig, overridden by LOADGEN_MODE, LOADGEN_WORKERS,
+     * LOADGEN_RATE, LOADGEN_DURATION_S and LOADGEN_REPORT from the environment
+     */
+    static Options defaults();
+
+    /**
+     * @brief Run for options.duration_s with keys derived from config's payer, write the report
+     * @return false if the run could not start or the report could not be written
+     */
+    static bool run(const X402Config& config, const Options& options);
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief Contents of an address lookup table (for v0 messages)
+ */
+struct AddressLookupTable {
+    // Tables may hold 256; a payment only looks up a handful, so larger
+    // tables are refused rather than stored
+    static constexpr int MAX_ADDRESSES = 32;
+    uint8_t address[32];
+    uint8_t addresses[MAX_ADDRESSES][32];
+    int count;
+    bool valid;
+
+    // Index of key in the table, or -1
+    int find(const uint8_t key[32]) const;
+};
+
+/**
+ * @brief Compiles instructions into a Solana message in fixed-size storage
+ *
+ * Accounts are deduplicated (signer/writable flags are merged) and ordered
+ * as the runtime requires: signed writable, signed readonly, unsigned
+ * writable, unsigned readonly. Within a group, accounts keep the order in
+ * which they were first seen, so addAccount() can pin a layout before any
+ * instruction is added. The first account is the fee payer.
+ *
+ * No heap is used; the compiler is meant to live on the stack of the
+ * building task. Errors (capacity exceeded) are sticky and reported by
+ * compile().
+ */
+class MessageCompiler {
+public:
+    static constexpr size_t MAX_ACCOUNTS = 24;
+    static constexpr size_t MAX_INSTRUCTIONS = 12;
+    static constexpr size_t MAX_INSTRUCTION_ACCOUNTS = 8;
+    static constexpr size_t MAX_INSTRUCTION_DATA = 256;   // Total over all instructions
+    static constexpr size_t PACKET_DATA_SIZE = 1232;      // Max serialized transaction
+
+    struct AccountMeta {
+        const uint8_t* pubkey;
+        bool isSigner;
+        bool isWritable;
+    };
+
+    MessageCompiler();
+
+    void reset();
+
+    /**
+     * @brief Register an account, merging flags if already present
+     * @return Position in insertion order, or -1 if full
+     */
+    int addAccount(const uint8_t pubkey[32], bool isSigner, bool isWritable);
+
+    bool addInstruction(const uint8_t programId[32],
+                        const AccountMeta* metas, size_t metaCount,
+                        const uint8_t* data, size_t dataLen);
+
+    /**
+     * @brief Order accounts and serialize the message
+     *
+     * With a lookup table a v0 message is produced: unsigned accounts that
+     * are found in the table and never invoked as a program are loaded from
+     * it instead of being listed inline.
+     */
+    bool compile(const uint8_t recentBlockhash[32], const AddressLookupTable* lookupTable = nullptr);
+
+    const uint8_t* data() const { return out_; }
+    size_t size() const { return outLen_; }
+    uint8_t numRequiredSignatures() const { return numSigners_; }
+    int numLoadedAccounts() const { return numLoaded_; }
+    size_t numInstructions() const { return instructionCount_; }
+
+private:
+    struct Account {
+        uint8_t pubkey[32];
+        bool isSigner;
+        bool isWritable;
+        bool isInvoked;
+    };
+
+    struct Instruction {
+        uint8_t programPos;                             // Insertion-order positions
+        uint8_t accountPos[MAX_INSTRUCTION_ACCOUNTS];
+        uint8_t accountCount;
+        uint16_t dataOffset;
+        uint16_t dataLen;
+    };
+
+    void put(const void* bytes, size_t len);
+    void putCompactU16(uint16_t value);
+
+    Account accounts_[MAX_ACCOUNTS];
+    size_t accountCount_;
+    Instruction instructions_[MAX_INSTRUCTIONS];
+    size_t instructionCount_;
+    uint8_t instructionData_[MAX_INSTRUCTION_DATA];
+    size_t instructionDataLen_;
+
+    uint8_t out_[PACKET_DATA_SIZE];
+    size_t outLen_;
+    uint8_t numSigners_;
+    int numLoaded_;
+    bool overflow_;
+};
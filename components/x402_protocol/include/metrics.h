@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief Lightweight in-process metrics registry.
+ *
+ * Counters and value summaries live in a fixed-size table (no heap use),
+ * keyed by string-literal names such as "ledger.mismatch". Safe to call
+ * from any task. The client's maintenance task dumps the whole table to the
+ * log every CONFIG_X402_METRICS_DUMP_PERIOD_S seconds.
+ */
+class Metrics {
+public:
+    /**
+     * @brief Add delta to a counter
+     */
+    static void increment(const char* name, uint32_t delta = 1);
+
+    /**
+     * @brief Record one sample of a value (count/sum/min/max/last are kept)
+     */
+    static void observe(const char* name, int64_t value);
+
+    /**
+     * @brief Current count for a counter or number of samples for a value
+     */
+    static uint32_t count(const char* name);
+
+    /**
+     * @brief Print all registered metrics at INFO level
+     */
+    static void dump();
+
+    static constexpr size_t MAX_METRICS = 128;
+};
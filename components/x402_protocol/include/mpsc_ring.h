@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+
+/**
+ * @brief Bounded lock-free multi-producer, single-consumer ring (Vyukov)
+ *
+ * Each cell carries a sequence number: a producer claims a position with
+ * one CAS, fills the cell in place and publishes it by bumping the cell's
+ * sequence; the consumer reads it and hands the cell back the same way.
+ * Producers never wait for the consumer: a full ring makes claim() fail.
+ *
+ * Sequences are stored relative to the cell index, so the all-zero state
+ * is an empty ring. A ring with static storage is therefore ready before
+ * any constructor runs.
+ *
+ * Used by UiCommandQueue and DeferredLog.
+ */
+template <typename T, size_t N>
+class MpscRing {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "MpscRing capacity must be a power of two");
+
+public:
+    static constexpr size_t CAPACITY = N;
+
+    constexpr MpscRing() = default;
+
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    /**
+     * @brief Claim the next cell; fill it, then publish(pos)
+     * @return nullptr if the consumer is a whole ring behind
+     */
+    T* claim(uint32_t& pos) {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+        while (1) {
+            Cell& cell = cells_[pos & (N - 1)];
+            int32_t diff = (int32_t)(sequence(cell, pos) - pos);
+            if (diff == 0) {
+                // Cell is free for this position; claim it
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    return &cell.value;
+                }
+            } else if (diff < 0) {
+                // Consumer hasn't released the cell from the previous lap
+                return nullptr;
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Make the cell claimed at pos visible to the consumer
+     */
+    void publish(uint32_t pos) {
+        store(cells_[pos & (N - 1)], pos, pos + 1);
+    }
+
+    /**
+     * @brief Oldest published cell, nullptr if none; consumer only
+     * The cell stays valid until release().
+     */
+    T* front() {
+        Cell& cell = cells_[dequeue_pos_ & (N - 1)];
+        if ((int32_t)(sequence(cell, dequeue_pos_) - (dequeue_pos_ + 1)) < 0) {
+            return nullptr;
+        }
+        return &cell.value;
+    }
+
+    /**
+     * @brief Hand the front() cell back to the producers; consumer only
+     */
+    void release() {
+        store(cells_[dequeue_pos_ & (N - 1)], dequeue_pos_, dequeue_pos_ + N);
+        dequeue_pos_++;
+    }
+
+    /**
+     * @brief Copy out and release the oldest cell; consumer only
+     */
+    bool pop(T& out) {
+        T* value = front();
+        if (!value) {
+            return false;
+        }
+        out = *value;
+        release();
+        return true;
+    }
+
+private:
+    struct Cell {
+        std::atomic<uint32_t> seq;      // Sequence minus the cell's index
+        T value;
+    };
+
+    static uint32_t sequence(const Cell& cell, uint32_t pos) {
+        return cell.seq.load(std::memory_order_acquire) + (uint32_t)(pos & (N - 1));
+    }
+
+    static void store(Cell& cell, uint32_t pos, uint32_t seq) {
+        cell.seq.store(seq - (uint32_t)(pos & (N - 1)), std::memory_order_release);
+    }
+
+    Cell cells_[N] = {};
+    std::atomic<uint32_t> enqueue_pos_{0};
+    uint32_t dequeue_pos_ = 0;      // Consumer-owned
+};
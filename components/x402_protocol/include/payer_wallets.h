@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include "balance_ledger.h"
+#include <freertos/FreeRTOS.h>
+
+class SolanaClient;
+
+/**
+ * @brief Payer sub-wallets derived from the configured key
+ *
+ * Every payment signed by the configured payer debits the same source
+ * token account, and the runtime serializes transactions that write the
+ * same account. Wallet i is derived from the payer's private key with
+ * SLIP-0010 along m/44'/501'/i'/0' (the path Solana wallets use) and has
+ * its own associated token account and BalanceLedger, so payments spread
+ * over several wallets stop queueing on one source account.
+ *
+ * pick() assigns payments round-robin or to the wallet with the fewest
+ * payments in flight. The configured payer stays the treasury: it pays
+ * whenever no wallet can cover an amount, and planTopUps() decides which
+ * wallets it refills in the background.
+ */
+class PayerWallets {
+public:
+    static constexpr size_t MAX_WALLETS = 8;
+    static constexpr size_t MAX_TOPUPS = 4;        // Wallets funded by one top-up transaction
+    static constexpr int TREASURY = -1;            // pick() result: pay from the configured payer
+
+    // A sent top-up may land until its blockhash expires
+    static constexpr int64_t TOPUP_WINDOW_US = 90LL * 1000 * 1000;
+
+    enum class Policy : uint8_t {
+        RoundRobin,
+        LeastOutstanding,   // Fewest payments in flight, then least recently used
+    };
+
+    struct Wallet {
+        uint8_t public_key[32];
+        uint8_t secret_key[32];
+        uint8_t ata[32];
+        BalanceLedger ledger;
+        uint32_t in_flight;
+        int64_t last_used_us;
+        int64_t topup_until_us;     // A top-up for this wallet may still land
+    };
+
+    struct TopUp {
+        uint8_t wallet;
+        uint64_t amount;
+    };
+
+    /**
+     * @brief Marks a wallet busy from signing until the merchant answers
+     */
+    class Lease {
+    public:
+        Lease(PayerWallets& wallets, int index);
+        ~Lease();
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+    private:
+        PayerWallets& wallets_;
+        int index_;
+    };
+
+    static const char* policyName(Policy policy);
+
+    /**
+     * @brief Keys of wallet index, m/44'/501'/index'/0' from seed
+     */
+    static bool derive(const uint8_t seed[32], size_t index,
+                       uint8_t public_key[32], uint8_t secret_key[32]);
+
+    explicit PayerWallets(Policy policy);
+    ~PayerWallets();
+
+    PayerWallets(const PayerWallets&) = delete;
+    PayerWallets& operator=(const PayerWallets&) = delete;
+
+    /**
+     * @brief Derive count wallets from seed and their token accounts for mint
+     * @param count Fewer than 2 leaves sharding off (count() stays 0)
+     */
+    bool init(const uint8_t seed[32], size_t count, const uint8_t mint[32], SolanaClient& solana);
+
+    size_t count() const { return count_; }
+    const Wallet& wallet(size_t index) const { return wallets_[index]; }
+    BalanceLedger& ledger(size_t index) { return wallets_[index].ledger; }
+
+    /**
+     * @brief Choose the wallet to pay amount from (nothing is reserved)
+     * @return Wallet index, or TREASURY if no seeded wallet can cover amount
+     */
+    int pick(uint64_t amount);
+
+    /**
+     * @brief Top-ups that bring low wallets back to an even share
+     *
+     * The treasury and the wallets share the total balance; a wallet
+     * below half its share is refilled to the full share, largest
+     * shortfall first. Unseeded wallets count as empty; wallets with a
+     * top-up still in its landing window are skipped.
+     * @return Number of entries written to out (at most MAX_TOPUPS)
+     */
+    size_t planTopUps(uint64_t treasury_available, TopUp* out) const;
+
+    /**
+     * @brief Record a sent top-up so it is not planned again while it may land
+     */
+    void markToppedUp(const TopUp* topups, size_t count);
+
+    /**
+     * @brief Count the lock rounds payments need with and without wallets
+     *
+     * Builds and parses real payment transactions, then schedules them
+     * greedily into rounds in which no two write the same account, the
+     * way the runtime may execute them in parallel. Logs one line per
+     * scenario (one or `wallets` payers, one or many merchants, one or
+     * many fee payers).
+     */
+    static void simulate(const uint8_t seed[32], size_t wallets, size_t payments);
+
+private:
+    void finish(int index);
+
+    Policy policy_;
+    Wallet wallets_[MAX_WALLETS];
+    size_t count_;
+    size_t next_;                   // Round-robin cursor
+    mutable portMUX_TYPE lock_;
+};
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include "sdkconfig.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#if !CONFIG_IDF_TARGET_LINUX
+#include <esp_partition.h>
+#endif
+
+/**
+ * @brief Append-only, crash-safe log of payment state changes
+ *
+ * Every payment moves through INTENT -> SIGNED -> SUBMITTED and ends in
+ * SETTLED or ABORTED. Each state change is one fixed-size record that
+ * carries the whole payment (amount, signature, resource), so the newest
+ * record of a payment is all recovery needs.
+ *
+ * Records are staged in RAM and written in batches; only SUBMITTED is
+ * flushed before returning, since that is the record that prevents paying
+ * twice after a reboot. The log runs sequentially through the partition and
+ * wraps, so every sector is erased once per pass. The sector ahead of the
+ * write position is always kept erased: before it is reused, the records of
+ * unfinished payments it still holds are copied forward.
+ *
+ * Backed by a flash partition on the device and a plain file on linux.
+ * Every call is a no-op while the journal is not open, so a missing
+ * partition never blocks a payment.
+ */
+class PaymentJournal {
+public:
+    // Where open() finds the journal: a partition label on the device,
+    // a file path on the linux target
+#if CONFIG_IDF_TARGET_LINUX
+    static constexpr const char* JOURNAL_SOURCE = "journal.bin";
+#else
+    static constexpr const char* JOURNAL_SOURCE = "journal";
+#endif
+
+    enum Type : uint8_t {
+        INTENT = 1,     // Offer accepted, funds reserved
+        SIGNED,         // Transaction signed, not sent yet
+        SUBMITTED,      // X-PAYMENT sent; may or may not have settled
+        SETTLED,        // Merchant accepted, or found on chain
+        ABORTED,        // Never left the device, or did not land
+    };
+
+    static constexpr size_t RECORD_SIZE     = 256;
+    static constexpr size_t SECTOR_SIZE     = 4096;
+    static constexpr size_t FILE_SIZE       = 64 * 1024;   // linux backing file
+    static constexpr size_t STAGE_CAPACITY  = 8;
+    static constexpr size_t MAX_LIVE        = 8;
+    static constexpr size_t RESOURCE_MAX    = 168;         // Including NUL
+
+    // A payment that is not SETTLED or ABORTED yet
+    struct Entry {
+        uint32_t id;
+        Type state;
+        uint64_t amount;
+        uint8_t payer;              // Signing key: 0 = configured payer, i + 1 = payer wallet i
+        uint8_t signature[64];      // Payer signature, zero before SIGNED
+        char resource[RESOURCE_MAX];
+        int64_t recorded_at_us;     // Last state change, 0 if recovered from a previous boot
+    };
+
+    PaymentJournal();
+    ~PaymentJournal();
+
+    PaymentJournal(const PaymentJournal&) = delete;
+    PaymentJournal& operator=(const PaymentJournal&) = delete;
+
+    /**
+     * @brief Open the journal and recover unfinished payments
+     *
+     * Replays every record with a valid CRC in sequence order. Payments
+     * that never reached SUBMITTED did not leave the device and are marked
+     * ABORTED; SUBMITTED ones stay unresolved for the caller to look up.
+     * @param source Partition label, or file path on linux (JOURNAL_SOURCE)
+     */
+    bool open(const char* source);
+
+    bool isOpen() const { return open_; }
+
+    /**
+     * @brief Start a payment with an INTENT record (staged)
+     * @param payer Key that signs it (Entry::payer)
+     * @return Payment ID, 0 if the journal is not open or full
+     */
+    uint32_t begin(const char* resource, uint64_t amount, uint8_t payer = 0);
+
+    /**
+     * @brief Record a state change for payment id
+     *
+     * SUBMITTED is written to flash before returning; everything else is
+     * staged. SETTLED and ABORTED end the payment.
+     * @param signature Payer signature, required for SIGNED, optional otherwise
+     */
+    bool record(uint32_t id, Type type, const uint8_t signature[64] = nullptr);
+
+    /**
+     * @brief Write all staged records to flash
+     */
+    bool flush();
+
+    /**
+     * @brief Unresolved (SUBMITTED) payment for resource, if any
+     */
+    bool findUnresolved(const char* resource, Entry& out) const;
+
+    /**
+     * @brief Copy up to max unresolved (SUBMITTED) payments into out
+     * @return Number copied
+     */
+    size_t unresolved(Entry* out, size_t max) const;
+
+    size_t staged() const;
+
+private:
+    struct Record;
+
+    bool openBacking(const char* source);
+    void closeBacking();
+    bool readRecord(size_t slot, Record& out) const;
+    bool writeRecords(size_t slot, Record* records, size_t count);
+    bool eraseSector(size_t sector);
+    bool isSectorErased(size_t sector) const;
+    bool enterSector(size_t sector);
+    bool appendLocked(const Entry& entry);
+    bool flushLocked();
+    bool applyLocked(const Entry& entry);
+    int findLocked(uint32_t id) const;
+
+    bool open_;
+    size_t size_;
+    size_t slots_;
+    size_t next_slot_;      // Flash slot of the next record
+    size_t prepared_sector_;    // Sector whose successor is known to be erased
+    uint32_t next_seq_;
+    uint32_t next_id_;
+#if CONFIG_IDF_TARGET_LINUX
+    int fd_;
+#else
+    const esp_partition_t* partition_;
+#endif
+
+    Record* stage_;         // STAGE_CAPACITY records, heap
+    size_t stage_count_;
+
+    Entry live_[MAX_LIVE];
+    bool live_used_[MAX_LIVE];
+
+    SemaphoreHandle_t mutex_;
+};
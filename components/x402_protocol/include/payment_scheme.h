@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+#include "sdkconfig.h"
+#include "crypto_utils.h"
+
+/**
+ * @brief x402 payment schemes and networks as compile-time policies
+ *
+ * A PaymentScheme<Scheme, Network> knows how to recognise its offers in a
+ * 402 "accepts" list and how to serialize the X-PAYMENT header for them.
+ * Everything it writes apart from the transaction is a constexpr string
+ * assembled at compile time.
+ *
+ * Only the networks enabled in Kconfig (X402_NETWORK_*) are listed in
+ * EnabledSchemes; the others are replaced by DisabledScheme, which matches
+ * nothing, so their names and code never reach the firmware.
+ */
+namespace x402 {
+
+// x402 protocol version written into every X-PAYMENT header
+inline constexpr char VERSION[] = "1";
+
+// === Schemes ===
+
+// SPL TransferChecked signed by the payer, settled by the facilitator
+struct SolanaExact {
+    static constexpr char NAME[] = "exact";
+    static constexpr char PAYLOAD_FIELD[] = "transaction";  // Base64 wire TX
+};
+
+// === Networks ===
+
+struct Devnet {
+    static constexpr char NAME[] = "solana-devnet";
+};
+
+struct Mainnet {
+    static constexpr char NAME[] = "solana";
+};
+
+// Joins string literals at compile time (without their NULs, plus one)
+template <size_t... Ns>
+constexpr std::array<char, (Ns + ...) - sizeof...(Ns) + 1> concat(const char (&... parts)[Ns]) {
+    std::array<char, (Ns + ...) - sizeof...(Ns) + 1> out{};
+    size_t pos = 0;
+    ((std::copy_n(parts, Ns - 1, out.begin() + pos), pos += Ns - 1), ...);
+    return out;
+}
+
+template <typename Scheme, typename Network>
+struct PaymentScheme {
+    // {"x402Version":1,"scheme":"...","network":"...","payload":{"<field>":"<tx>"}}
+    static constexpr auto HEADER_PREFIX = concat(
+        "{\"x402Version\":", VERSION,
+        ",\"scheme\":\"", Scheme::NAME,
+        "\",\"network\":\"", Network::NAME,
+        "\",\"payload\":{\"", Scheme::PAYLOAD_FIELD, "\":\"");
+    static constexpr char HEADER_SUFFIX[] = "\"}}";
+
+    static bool matches(const char* scheme, const char* network) {
+        return scheme && network &&
+               strcmp(scheme, Scheme::NAME) == 0 && strcmp(network, Network::NAME) == 0;
+    }
+
+    /**
+     * @brief Base64 X-PAYMENT header carrying base64_tx (malloc'd, nullptr on failure)
+     */
+    static char* buildHeader(const char* base64_tx) {
+        const size_t prefix_len = HEADER_PREFIX.size() - 1;
+        const size_t suffix_len = sizeof(HEADER_SUFFIX) - 1;
+        const size_t tx_len = strlen(base64_tx);     // Base64: nothing to escape
+        const size_t len = prefix_len + tx_len + suffix_len;
+
+        char* json = (char*)malloc(len);
+        if (!json) return nullptr;
+        memcpy(json, HEADER_PREFIX.data(), prefix_len);
+        memcpy(json + prefix_len, base64_tx, tx_len);
+        memcpy(json + prefix_len + tx_len, HEADER_SUFFIX, suffix_len);
+
+        char* header = CryptoUtils::base64Encode(reinterpret_cast<const unsigned char*>(json), len);
+        free(json);
+        return header;
+    }
+};
+
+// Placeholder for a network left out of the build
+struct DisabledScheme {
+    static constexpr bool matches(const char*, const char*) { return false; }
+    static char* buildHeader(const char*) { return nullptr; }
+};
+
+/**
+ * @brief The built-in policies; offers are matched against them in order
+ */
+template <typename... Policies>
+struct SchemeList {
+    static constexpr size_t SIZE = sizeof...(Policies);
+
+    /**
+     * @brief Index of the policy for scheme/network, -1 if none is built in
+     */
+    static int match(const char* scheme, const char* network) {
+        int index = 0;
+        int found = -1;
+        ((found < 0 && Policies::matches(scheme, network) ? found = index : 0, ++index), ...);
+        return found;
+    }
+
+    static char* buildHeader(int policy, const char* base64_tx) {
+        int index = 0;
+        char* header = nullptr;
+        ((index++ == policy ? header = Policies::buildHeader(base64_tx) : nullptr), ...);
+        return header;
+    }
+};
+
+#ifdef CONFIG_X402_NETWORK_SOLANA_DEVNET
+inline constexpr bool DEVNET_ENABLED = true;
+#else
+inline constexpr bool DEVNET_ENABLED = false;
+#endif
+#ifdef CONFIG_X402_NETWORK_SOLANA_MAINNET
+inline constexpr bool MAINNET_ENABLED = true;
+#else
+inline constexpr bool MAINNET_ENABLED = false;
+#endif
+
+static_assert(DEVNET_ENABLED || MAINNET_ENABLED, "Enable at least one X402_NETWORK_* in menuconfig");
+
+// Network offers must be for when the config does not name one: the only
+// network built in, or nullptr when there are several
+inline constexpr const char* DEFAULT_NETWORK =
+    DEVNET_ENABLED && !MAINNET_ENABLED ? Devnet::NAME :
+    MAINNET_ENABLED && !DEVNET_ENABLED ? Mainnet::NAME : nullptr;
+
+using EnabledSchemes = SchemeList<
+    std::conditional_t<DEVNET_ENABLED, PaymentScheme<SolanaExact, Devnet>, DisabledScheme>,
+    std::conditional_t<MAINNET_ENABLED, PaymentScheme<SolanaExact, Mainnet>, DisabledScheme>>;
+
+} // namespace x402
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "message_compiler.h"
+
+/**
+ * @brief Merchant-side check of X-PAYMENT headers, for the linux target
+ *
+ * A header is unwrapped the way this client builds it (base64 → JSON →
+ * base64 → wire transaction) and accepted only if the transaction:
+ *  - names the offer's fee payer as account 0,
+ *  - calls nothing but ComputeBudget, AdvanceNonceAccount and TransferChecked,
+ *  - keeps the compute unit limit and price within MAX_UNIT_LIMIT and
+ *    MAX_UNIT_PRICE, since the fee payer pays for them,
+ *  - carries exactly one TransferChecked, of the offered mint and amount
+ *    into the associated token account of payTo,
+ *  - never uses the fee payer as transfer source or authority, or as nonce
+ *    account or nonce authority,
+ *  - is signed by the transfer authority (the fee payer's slot is left to
+ *    the facilitator).
+ * Nothing is sent to the chain; replay and balance checks stay with the
+ * facilitator that settles the payment.
+ *
+ * init() decodes the offer's keys and derives the destination ATA once.
+ * verify() then works in caller-provided stack buffers and may be called
+ * from any number of threads. verifyAll() spreads a batch over a pool of
+ * worker threads: each claims BATCH_SIZE headers at a time, parses and
+ * checks all of them, then runs their ed25519 verifications back to back.
+ */
+class PaymentVerifier {
+public:
+    struct Offer {
+        const char* network;                        // e.g. "solana-devnet"
+        const char* pay_to;                         // Base58 owner, not the ATA
+        const char* asset;                          // Base58 mint
+        const char* fee_payer;                      // Base58, extra.feePayer
+        uint64_t amount;                            // maxAmountRequired
+        const AddressLookupTable* lookup_table;     // Optional, resolves v0 lookups
+    };
+
+    enum class Result : uint8_t {
+        Ok,
+        BadEncoding,        // Header or transaction is not valid base64
+        BadJson,            // No x402Version/scheme/network/payload.transaction
+        WrongScheme,        // Version, scheme or network differ from the offer
+        Malformed,          // Wire bytes do not parse as a transaction
+        WrongFeePayer,
+        UnknownInstruction, // Program or instruction the payment may not carry
+        ComputeBudget,      // Unit limit or price above the caps
+        FeePayerSpends,     // Fee payer as transfer source/authority or nonce account/authority
+        ExtraTransfer,      // More than one TransferChecked
+        NoTransfer,
+        WrongRecipient,
+        WrongMint,
+        WrongAmount,
+        Unresolved,         // Account loaded from a lookup table we do not have
+        BadSignature,
+    };
+
+    struct Job {
+        const char* header;
+        size_t len;
+        Result result;
+    };
+
+    static constexpr size_t MAX_HEADER = 4096;      // Base64 X-PAYMENT
+    static constexpr size_t BATCH_SIZE = 32;        // Headers claimed per worker turn
+
+    // The fee payer's exposure per payment: at most 200,000 CU at 0.1
+    // lamport each (FeeEstimator's price ceiling), 20,000 lamports
+    static constexpr uint32_t MAX_UNIT_LIMIT = 200000;
+    static constexpr uint64_t MAX_UNIT_PRICE = 100000;  // micro-lamports per CU
+
+    static const char* resultName(Result result);
+
+    PaymentVerifier();
+    ~PaymentVerifier();
+
+    PaymentVerifier(const PaymentVerifier&) = delete;
+    PaymentVerifier& operator=(const PaymentVerifier&) = delete;
+
+    /**
+     * @brief Decode the offer and start the worker pool
+     * @param threads Workers for verifyAll(); 0 uses one per core
+     * @return false if a key does not decode or the ATA cannot be derived
+     */
+    bool init(const Offer& offer, size_t threads = 0);
+
+    /**
+     * @brief Verify one header on the calling thread
+     */
+    Result verify(const char* header, size_t len) const;
+
+    /**
+     * @brief Verify count headers on the worker pool; returns when all are done
+     *
+     * Callers are serialized; each job's result is written in place.
+     */
+    void verifyAll(Job* jobs, size_t count);
+
+    size_t threads() const { return workers_.size(); }
+
+    /**
+     * @brief Log verifications/second, overall and per core, for 1..N workers
+     * @param header A valid X-PAYMENT for offer, verified count times per run
+     */
+    static void benchmark(const Offer& offer, const char* header, size_t count);
+
+private:
+    // A parsed payment whose signature is still to be checked
+    struct Signed {
+        const uint8_t* message;
+        size_t message_len;
+        const uint8_t* signature;
+        const uint8_t* signer;
+    };
+
+    // Decode, parse and check against the offer; tx must hold PACKET_DATA_SIZE
+    Result check(const char* header, size_t len, uint8_t* tx, Signed* out) const;
+    static bool signatureValid(const Signed& s);
+
+    void workerLoop();
+    void runBatch(Job* jobs, size_t count, uint8_t* tx, Signed* pending) const;
+
+    uint8_t pay_to_[32];
+    uint8_t mint_[32];
+    uint8_t fee_payer_[32];
+    uint8_t destination_[32];                       // ATA of pay_to_ for mint_
+    char network_[32];
+    uint64_t amount_;
+    const AddressLookupTable* lookup_table_;
+    bool ready_;
+
+    // === Worker pool ===
+    std::vector<std::thread> workers_;
+    std::mutex call_mutex_;                         // One verifyAll() at a time
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    uint64_t generation_;                           // Bumped per verifyAll()
+    size_t active_;                                 // Workers inside a generation
+    bool stop_;
+    Job* jobs_;
+    size_t count_;
+    std::atomic<size_t> next_;                      // Next unclaimed job
+    std::atomic<size_t> done_;
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <freertos/FreeRTOS.h>
+
+/**
+ * @brief Pool of pre-built, pre-signed X-PAYMENT headers.
+ *
+ * Filled during idle time for the configured merchant URL(s), so a tap can
+ * go straight to submit_payment. Each entry is tied to the offer it was built
+ * for (SHA-256 fingerprint) and, unless it uses a durable nonce, to the age
+ * of its blockhash. Every entry, nonce or not, expires after MAX_ENTRY_AGE_US.
+ */
+class PresignedPool {
+public:
+    struct Entry {
+        char url[256];            // Merchant URL the offer came from (lookup key)
+        char resource[256];       // Submission target from the offer
+        uint8_t offer_hash[32];
+        uint64_t amount;
+        char* header;             // X-PAYMENT header, owned by the entry
+        uint8_t signature[64];    // Payer signature inside header
+        int8_t wallet;            // Payer wallet that signed, PayerWallets::TREASURY for the configured payer
+        bool uses_nonce;
+        int64_t built_at_us;
+    };
+
+    static constexpr size_t CAPACITY = 2;
+
+    // Blockhashes expire after ~60-90 s; leave headroom for the submit round trip
+    static constexpr int64_t MAX_BLOCKHASH_AGE_US = 45LL * 1000 * 1000;
+
+    // Durable-nonce entries included: an offer this old is not trusted any more
+    static constexpr int64_t MAX_ENTRY_AGE_US = 10LL * 60 * 1000 * 1000;
+
+    PresignedPool();
+    ~PresignedPool();
+
+    PresignedPool(const PresignedPool&) = delete;
+    PresignedPool& operator=(const PresignedPool&) = delete;
+
+    /**
+     * @brief Remove and return a fresh entry for url
+     * @return false on miss; on hit the caller owns out.header
+     */
+    bool take(const char* url, Entry& out);
+
+    /**
+     * @brief Store an entry, replacing any existing one for the same URL
+     * Takes ownership of entry.header.
+     */
+    void put(const Entry& entry);
+
+    /**
+     * @brief True if a fresh entry exists for url built from this exact offer
+     */
+    bool isCurrent(const char* url, const uint8_t offer_hash[32]) const;
+
+    /**
+     * @brief Drop entries for url that are expired or not built for offer_hash
+     * @param dropped_nonce Set to true if a dropped entry held the durable nonce
+     * @return Number of entries dropped
+     */
+    size_t invalidate(const char* url, const uint8_t offer_hash[32], bool* dropped_nonce);
+
+    /**
+     * @brief Drop expired entries for every URL, freeing their headers
+     * @param dropped_nonce Set to true if a dropped entry held the durable nonce
+     * @return Number of entries dropped
+     */
+    size_t expire(bool* dropped_nonce);
+
+private:
+    static bool isFresh(const Entry& e, int64_t now_us);
+    void freeSlot(size_t i);
+
+    Entry entries_[CAPACITY];
+    bool used_[CAPACITY];
+    mutable portMUX_TYPE lock_;
+};
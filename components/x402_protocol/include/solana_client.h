@@ -4,9 +4,67 @@
 #include <cstddef>
 #include <string>
 #include <vector>
+#include <cJSON.h>
+#include "message_compiler.h"
 
 class SolanaClient {
 public:
+    /**
+     * @brief Cached state of a durable nonce account
+     */
+    struct NonceAccount {
+        uint8_t address[32];
+        uint8_t authority[32];
+        uint8_t nonce[32];          // Used in place of a recent blockhash
+        uint64_t lamportsPerSignature;
+        bool valid;                 // Initialized and not yet used by a sent TX
+    };
+
+    using AddressLookupTable = ::AddressLookupTable;
+
+    /**
+     * @brief One TransferChecked within a batch transaction
+     */
+    struct Transfer {
+        const char* paytoBase58;
+        uint64_t amount;
+    };
+
+    /**
+     * @brief Tokens moved to one wallet by a funding transaction
+     */
+    struct Funding {
+        const uint8_t* owner;       // Wallet public key; its ATA is the destination
+        uint64_t amount;
+    };
+
+    static constexpr size_t MAX_BATCH_TRANSFERS = 8;
+    static constexpr size_t MAX_FUNDINGS = 4;
+    static constexpr size_t MAX_FEE_ACCOUNTS = 4;
+    static constexpr size_t SIGNATURE_SCAN_LIMIT = 5;
+
+    enum class TxStatus : uint8_t {
+        NotFound,       // Not among the signer's recent confirmed transactions
+        Landed,         // Confirmed and succeeded
+        Failed,         // Confirmed with an error (fee charged, transfer reverted)
+    };
+
+    /**
+     * @brief Compute-budget overrides; zero fields keep the builder defaults
+     */
+    struct ComputeBudget {
+        uint32_t unitLimit;
+        uint64_t unitPrice;         // micro-lamports per compute unit
+    };
+
+    // === Program IDs ===
+    static const uint8_t SPL_TOKEN_PROGRAM_ID[32];
+    static const uint8_t ASSOCIATED_TOKEN_PROGRAM_ID[32];
+    static const uint8_t COMPUTE_BUDGET_PROGRAM_ID[32];
+    static const uint8_t SYSTEM_PROGRAM_ID[32];
+    static const uint8_t SYSVAR_RECENT_BLOCKHASHES_ID[32];
+    static const uint8_t ADDRESS_LOOKUP_TABLE_PROGRAM_ID[32];
+
     SolanaClient(const std::string& rpcUrl);
 
     // === PDA & ATA ===
@@ -29,7 +87,86 @@ public:
     // === RPC ===
     bool fetchRecentBlockhash(uint8_t blockhashOut[32]);
 
+    /**
+     * @brief Fetch the raw token amount held by an SPL token account
+     */
+    bool fetchTokenAccountBalance(const uint8_t tokenAccount[32], uint64_t* amountOut);
+
+    /**
+     * @brief Per-slot prioritization fees paid by TXs locking the given accounts
+     * @param accounts Writable accounts of the TX (up to MAX_FEE_ACCOUNTS)
+     * @param feesOut Receives up to feesCap fees (micro-lamports/CU), ~150 slots
+     */
+    bool fetchRecentPrioritizationFees(
+        const uint8_t (*accounts)[32],
+        size_t accountCount,
+        uint64_t* feesOut,
+        size_t feesCap,
+        size_t* feesLen
+    );
+
+    /**
+     * @brief Simulate a payment message with zeroed signatures (no sig check)
+     *
+     * The signed transaction never leaves the device before the merchant
+     * gets it. The blockhash is replaced unless the message uses a durable
+     * nonce, whose AdvanceNonce only passes against the stored value.
+     * @return true only if the simulation succeeded and reported unitsConsumed
+     */
+    bool simulateUnitsConsumed(const std::vector<uint8_t>& txMessage, bool durableNonce,
+                               uint32_t* unitsOut);
+
+    /**
+     * @brief Look for a transaction carrying signature among signer's recent ones
+     *
+     * The transaction ID is the fee payer's signature, which a payer that
+     * is not the fee payer never learns. The payer's own signature is
+     * matched instead against the SIGNATURE_SCAN_LIMIT most recent
+     * transactions that name signer (getSignaturesForAddress, then
+     * getTransaction per candidate).
+     * @return false if an RPC failed (status unknown)
+     */
+    bool findSignedTransaction(const uint8_t signer[32], const uint8_t signature[64], TxStatus* statusOut);
+
+    /**
+     * @brief Fetch raw account data (getAccountInfo, base64 encoding)
+     * @param dataLen Receives the data length; if it exceeds dataCap the
+     *        call fails with the account's full length here
+     * @param ownerOut Optional, receives the owning program id
+     */
+    bool fetchAccountInfo(
+        const uint8_t address[32],
+        uint8_t* dataOut,
+        size_t dataCap,
+        size_t* dataLen,
+        uint8_t ownerOut[32] = nullptr
+    );
+
+    /**
+     * @brief Load a durable nonce account and parse its current nonce value
+     */
+    bool fetchNonceAccount(const uint8_t address[32], NonceAccount& out);
+
+    /**
+     * @brief Load an active address lookup table
+     *
+     * Fails if the table holds more than AddressLookupTable::MAX_ADDRESSES
+     * entries, since they are kept in fixed storage.
+     */
+    bool fetchAddressLookupTable(const uint8_t address[32], AddressLookupTable& out);
+
     // === Transactions ===
+    /**
+     * @brief Build the TransferChecked payment message
+     *
+     * With a nonce, AdvanceNonceAccount (authority = payer) is emitted as the
+     * first instruction and the nonce value replaces the recent blockhash, so
+     * the message does not expire; blockhash may then be nullptr.
+     *
+     * With a lookup table, a v0 message is built: accounts found in the table
+     * (other than signers and invoked programs) are referenced by 1-byte
+     * table index instead of being inlined.
+     */
     bool buildTransaction(
         const uint8_t payerPubkey[32],
         const char* paytoBase58,
@@ -38,9 +175,56 @@ public:
         uint64_t amount,
         uint8_t decimals,
         const uint8_t blockhash[32],
+        std::vector<uint8_t>& txOut,
+        const NonceAccount* nonce = nullptr,
+        const AddressLookupTable* lookupTable = nullptr
+    );
+
+    /**
+     * @brief Build one message carrying several TransferChecked instructions
+     *
+     * All transfers share the payer, fee payer, mint and compute-budget
+     * instructions; the compute-unit limit is scaled to the transfer count
+     * unless budget provides one. Fails if the signed transaction would
+     * exceed the 1232-byte packet limit.
+     */
+    bool buildBatchTransaction(
+        const uint8_t payerPubkey[32],
+        const Transfer* transfers,
+        size_t transferCount,
+        const char* feePayerBase58,
+        const char* mintBase58,
+        uint8_t decimals,
+        const uint8_t blockhash[32],
+        std::vector<uint8_t>& txOut,
+        const NonceAccount* nonce = nullptr,
+        const AddressLookupTable* lookupTable = nullptr,
+        const ComputeBudget* budget = nullptr
+    );
+
+    /**
+     * @brief Move tokens from funder's token account to other wallets
+     *
+     * Each wallet gets CreateAssociatedTokenAccountIdempotent (rent paid by
+     * the funder, a no-op once the account exists) followed by
+     * TransferChecked. The funder is the fee payer and only signer, so it
+     * needs SOL as well as tokens.
+     */
+    bool buildFundingTransaction(
+        const uint8_t funderPubkey[32],
+        const Funding* fundings,
+        size_t fundingCount,
+        const char* mintBase58,
+        uint8_t decimals,
+        const uint8_t blockhash[32],
         std::vector<uint8_t>& txOut
     );
 
+    /**
+     * @brief Submit a message signed by its only signer (sendTransaction)
+     */
+    bool sendTransaction(const std::vector<uint8_t>& txMessage, const uint8_t signature[64]);
+
     bool buildSignedTransaction(
         const std::vector<uint8_t>& txMessage,
         const uint8_t signature[64],
@@ -48,17 +232,12 @@ public:
     );
 
 private:
-    // === Internal helpers ===
-    struct ByteBuffer {
-        std::vector<uint8_t> data;
-        void append(const void* ptr, size_t len);
-    };
-
-    static size_t encodeCompactU16(uint16_t value, uint8_t* output);
-
-    static const uint8_t SPL_TOKEN_PROGRAM_ID[32];
-    static const uint8_t ASSOCIATED_TOKEN_PROGRAM_ID[32];
-    static const uint8_t COMPUTE_BUDGET_PROGRAM_ID[32];
+    // POST a JSON-RPC request; on success *rootOut holds the parsed response
+    // (caller must cJSON_Delete) and *resultOut points at its "result" member.
+    bool rpcCall(const char* request, cJSON** rootOut, cJSON** resultOut);
 
     std::string rpcUrl_;
+
+    // getRecentPrioritizationFees returns ~150 entries (~6.5 KB)
+    static constexpr size_t RPC_MAX_RESPONSE = 8192;
 };
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "display_backend.h"
+#include "esp_lcd_panel_io.h"
+#include "esp_lcd_panel_vendor.h"
+#include "esp_lcd_touch.h"
+
+/**
+ * @brief ST7789 panel and CST816S touch on the ESP32-C6 Touch LCD 1.69"
+ *
+ * LVGL runs on the esp_lvgl_port task; lock() maps to lvgl_port_lock().
+ */
+class St7789Backend : public DisplayBackend {
+public:
+    St7789Backend();
+    ~St7789Backend() override;
+
+    St7789Backend(const St7789Backend&) = delete;
+    St7789Backend& operator=(const St7789Backend&) = delete;
+
+    bool init() override;
+    void deinit() override;
+    lv_display_t* display() const override { return lvgl_disp_; }
+    bool lock(uint32_t timeout_ms) override;
+    void unlock() override;
+    void setBacklight(uint8_t brightness) override;
+
+private:
+    void initLVGL();
+    void initDisplay();
+    void initTouch();
+    void initBacklight();
+
+    esp_lcd_panel_io_handle_t io_handle_;
+    esp_lcd_panel_handle_t panel_handle_;
+    esp_lcd_touch_handle_t touch_handle_;
+    lv_disp_t* lvgl_disp_;
+    lv_indev_t* lvgl_touch_;
+    bool initialized_;
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include "message_compiler.h"
+
+/**
+ * @brief Read-only index of a signed Solana wire transaction
+ *
+ * parse() validates a borrowed buffer in one pass (compact-u16 lengths,
+ * signatures, message header, account keys, blockhash, instructions and,
+ * for v0, address table lookups) and records where each part lies.
+ * Accessors return spans into that buffer; nothing is copied, so the
+ * buffer must outlive the view.
+ *
+ * Malformed input (truncation, trailing bytes, non-canonical lengths, an
+ * inconsistent header, out-of-range account indexes) is rejected with an
+ * Error; no read ever leaves the buffer. Instruction and lookup slots are
+ * fixed, so a view needs no heap and takes about 1.4 KB.
+ */
+class TransactionView {
+public:
+    static constexpr size_t MAX_INSTRUCTIONS = 24;
+    static constexpr size_t MAX_LOOKUPS = 8;
+
+    using Bytes = std::span<const uint8_t>;
+    using Key = std::span<const uint8_t, 32>;
+    using Signature = std::span<const uint8_t, 64>;
+
+    enum class Error : uint8_t {
+        None,
+        Truncated,              // A length runs past the end of the buffer
+        TrailingBytes,
+        BadLength,              // Non-canonical or oversized compact-u16
+        UnsupportedVersion,     // Versioned message other than v0
+        BadHeader,              // Signer/readonly counts do not fit the keys
+        SignatureCount,         // Signatures present != required signatures
+        TooManyInstructions,
+        TooManyLookups,
+        AccountIndex,           // Program or account index out of range
+    };
+
+    struct Instruction {
+        uint8_t program;        // Index into the static account keys
+        Bytes accounts;         // One account index per byte
+        Bytes data;
+    };
+
+    struct Lookup {
+        const uint8_t* table;   // 32-byte table address
+        Bytes writable;         // Table entry indexes
+        Bytes readonly;
+    };
+
+    static const char* errorName(Error error);
+
+    /**
+     * @brief Validate and index data; on failure the view is empty
+     */
+    bool parse(const uint8_t* data, size_t len);
+
+    Error error() const { return error_; }
+    bool valid() const { return error_ == Error::None && message_.data() != nullptr; }
+
+    // === Signatures ===
+    size_t signatureCount() const { return header_[0]; }
+    Signature signature(size_t i) const { return Signature(signatures_ + 64 * i, 64); }
+
+    /**
+     * @brief The signed bytes (everything after the signatures)
+     */
+    Bytes message() const { return message_; }
+
+    // === Message ===
+    bool versioned() const { return versioned_; }
+    uint8_t numRequiredSignatures() const { return header_[0]; }
+    uint8_t numReadonlySigned() const { return header_[1]; }
+    uint8_t numReadonlyUnsigned() const { return header_[2]; }
+
+    size_t accountKeyCount() const { return key_count_; }
+    Key accountKey(size_t i) const { return Key(keys_ + 32 * i, 32); }
+    Key blockhash() const { return Key(blockhash_, 32); }
+
+    size_t instructionCount() const { return instruction_count_; }
+    const Instruction& instruction(size_t i) const { return instructions_[i]; }
+
+    size_t lookupCount() const { return lookup_count_; }
+    const Lookup& lookup(size_t i) const { return lookups_[i]; }
+
+    /**
+     * @brief Static keys plus accounts loaded through lookups
+     */
+    size_t accountCount() const { return key_count_ + loaded_count_; }
+
+    bool isSigner(size_t index) const { return index < header_[0]; }
+    bool isWritable(size_t index) const;
+
+    /**
+     * @brief Key of an account index, loading table entries from table
+     * @return nullptr if the index is loaded from a table other than table
+     */
+    const uint8_t* resolve(size_t index, const AddressLookupTable* table = nullptr) const;
+
+    /**
+     * @brief Log parses/second and MB/s for one transaction
+     */
+    static void benchmark(const uint8_t* data, size_t len, size_t iterations);
+
+private:
+    bool fail(Error error);
+
+    const uint8_t* signatures_ = nullptr;
+    Bytes message_;
+    bool versioned_ = false;
+    uint8_t header_[3] = {};
+    const uint8_t* keys_ = nullptr;
+    size_t key_count_ = 0;
+    const uint8_t* blockhash_ = nullptr;
+    Instruction instructions_[MAX_INSTRUCTIONS];
+    size_t instruction_count_ = 0;
+    Lookup lookups_[MAX_LOOKUPS];
+    size_t lookup_count_ = 0;
+    size_t loaded_writable_ = 0;
+    size_t loaded_count_ = 0;
+    Error error_ = Error::None;
+};
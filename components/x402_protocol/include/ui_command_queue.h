@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include "mpsc_ring.h"
+
+/**
+ * @brief Bounded lock-free multi-producer, single-consumer ring of UI updates
+ *
+ * Any task can push a command without taking the LVGL lock; the LVGL task
+ * is the only consumer. Commands live in an MpscRing, so push() costs a
+ * fixed copy plus a CAS and never waits on rendering.
+ */
+class UiCommandQueue {
+public:
+    static constexpr size_t CAPACITY = 16;      // Power of two
+    static constexpr size_t TITLE_MAX = 64;
+    static constexpr size_t MESSAGE_MAX = 128;
+
+    enum Type : uint8_t {
+        CMD_STATUS,         // title + optional message on the progress screen
+        CMD_TEXT_CENTERED,
+        CMD_TEXT_LEFT,
+        CMD_SUCCESS,
+        CMD_ERROR,
+        CMD_IDLE,
+        CMD_CLEAR,
+    };
+
+    struct Command {
+        Type type;
+        bool has_message;
+        char title[TITLE_MAX];      // CMD_STATUS only
+        char message[MESSAGE_MAX];  // Status message, or the text of every other type
+    };
+
+    /**
+     * @brief Copy a command into the ring
+     *
+     * Texts are truncated to fit, on a UTF-8 character boundary.
+     * @return false if the ring is full; the command is dropped
+     */
+    bool push(Type type, const char* title, const char* message = nullptr);
+
+    /**
+     * @brief Take the oldest command; consumer task only
+     * @return false if the ring is empty
+     */
+    bool pop(Command& out);
+
+    /**
+     * @brief True if a status-type command only changes the progress screen
+     */
+    static bool isStatus(Type type) {
+        return type == CMD_STATUS || type == CMD_TEXT_CENTERED || type == CMD_TEXT_LEFT;
+    }
+
+private:
+    MpscRing<Command, CAPACITY> ring_;
+};
@@ -1,6 +1,26 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include "sdkconfig.h"
+
+#if CONFIG_IDF_TARGET_LINUX
+
+// The linux target uses the host's network, which is up from the start
+class WiFiManager {
+public:
+    static constexpr uint32_t WAIT_FOREVER = UINT32_MAX;
+
+    explicit WiFiManager(const std::string&, const std::string&) {}
+
+    bool start() { return true; }
+    bool waitConnected(uint32_t) { return true; }
+    bool connect() { return true; }
+    bool isConnected() const { return true; }
+};
+
+#else
+
 #include <freertos/FreeRTOS.h>
 #include <freertos/event_groups.h>
 #include <esp_err.h>
@@ -11,10 +31,14 @@
 
 class WiFiManager {
 public:
+    static constexpr uint32_t WAIT_FOREVER = UINT32_MAX;
+
     explicit WiFiManager(const std::string& ssid, const std::string& password);
     ~WiFiManager();
 
-    bool connect();          // Connect to WiFi network
+    bool start();            // Start the station and return; connects in the background
+    bool waitConnected(uint32_t timeout_ms); // Block until an IP is assigned or timeout
+    bool connect();          // start() + waitConnected(WAIT_FOREVER)
     bool isConnected() const; // Check connection state
 
 private:
@@ -26,5 +50,7 @@ private:
     std::string ssid_;
     std::string password_;
     EventGroupHandle_t eventGroup_;
-    bool connected_;
+    bool started_;
 };
+
+#endif
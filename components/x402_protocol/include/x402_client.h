@@ -2,12 +2,24 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <atomic>
 #include <memory>
 #include <string>
 #include "solana_client.h"
 #include "wifi_manager.h"
 #include "http_client.h"
 #include "display_manager.h"
+#include "balance_ledger.h"
+#include "presigned_pool.h"
+#include "fee_estimator.h"
+#include "payment_journal.h"
+#include "content_cache.h"
+#include "payment_scheme.h"
+#include "payer_wallets.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/event_groups.h>
 
 struct X402Config {
     const char* wifi_ssid;
@@ -19,6 +31,11 @@ struct X402Config {
     const char* payai_url;
     const char* solana_rpc_url;
     const char* user_agent;
+    const char* nonce_account;   // Optional durable nonce account (Base58)
+    const char* lookup_table;    // Optional address lookup table (Base58), enables v0 TXs
+    uint32_t fee_target_ms;      // Landing-latency target for priority fees (0 = default)
+    uint8_t payer_wallets;       // Derived payer wallets to spread payments over (0/1 = off)
+    const char* network;         // x402 network offers must be for (nullptr = the one built in)
 };
 
 class X402PaymentClient {
@@ -27,21 +44,47 @@ public:
 
     /**
      * @brief Initialize display and environment (crypto, NVS, WiFi)
+     *
+     * The display comes up on its own task while crypto and NVS initialize
+     * and the WiFi station starts. Returns once the display and the payment
+     * worker are ready, without waiting for an IP: network work waits for
+     * WiFi on the task that needs it.
      * @return true if initialization successful
      */
     bool init();
     
     /**
      * @brief Start the event loop (blocking)
-     * Handles idle state and payment processing
+     * Shows the idle screen and dispatches UI events; payments run on the
+     * payment worker task
      */
     void runEventLoop();
+
+    /**
+     * @brief Queue a payment for url on the payment worker
+     * url must stay valid until the payment has finished.
+     * @return false if the same URL is already queued/running or the queue is full
+     */
+    bool enqueuePayment(const char* url);
     
     /**
      * @brief Execute the complete payment flow
      * @return true if payment successful
      */
     bool executePaymentFlow();
+
+    /**
+     * @brief Pay for several resources at once
+     *
+     * Fetches every offer concurrently and reserves the total from one payer
+     * wallet. When the offers share merchant, fee payer, asset and network,
+     * one transaction carrying a TransferChecked per offer is signed and the
+     * same X-PAYMENT header is presented to every resource. Otherwise each
+     * resource is paid in turn with its own transaction, so a facilitator
+     * only ever settles transfers to its own merchant.
+     * @return true if every resource accepted the payment
+     */
+    bool executeBatchPaymentFlow(const char* const* urls, size_t count);
     
     /**
      * @brief Return to idle screen after a delay
@@ -49,12 +92,288 @@ public:
      */
     void returnToIdleAfterDelay(uint32_t delay_ms);
 
+    /**
+     * @brief Receive paid content as it streams in
+     *
+     * Every body chunk of a paid response is passed to sink on the HTTP
+     * executor task, however large the content is; return false to stop the
+     * transfer. Without a sink only the first ContentCache::MAX_ENTRY_BYTES
+     * are kept, for the display and the cache. Set before payments start.
+     */
+    void setContentSink(AsyncHttp::Sink sink) { content_sink_ = std::move(sink); }
+
+    /**
+     * @brief Hold status and error screens long enough to read (the default)
+     *
+     * Unpaced, the payment flows run without their display pauses; retry
+     * backoff still applies. For LoadGenerator, where nobody reads the screen.
+     */
+    void setPaced(bool paced) { paced_ = paced; }
+
+    /**
+     * @brief Keep the payment journal and content cache elsewhere
+     *
+     * The defaults (PaymentJournal::JOURNAL_SOURCE, ContentCache::CACHE_DIR)
+     * belong to one client; another client in the same process needs its
+     * own. For LoadGenerator. Both strings must outlive the client; call
+     * before init().
+     */
+    void setStorage(const char* journal_source, const char* cache_dir) {
+        journal_source_ = journal_source;
+        cache_dir_ = cache_dir;
+    }
+
+    /**
+     * @brief Called as each stage of executePaymentFlow ends, on its task
+     *
+     * stage is "pool", "offer", "parse", "reserve", "blockhash", "build",
+     * "sign", "encode" or "submit" with the microseconds since the previous
+     * stage ended (or the flow began). A stage that fails is reported with
+     * ok false and the flow stops there, except that a submission rejected
+     * for its blockhash is built and submitted again. A failed submission
+     * is reported as "submit.network", "submit.server", "submit.blockhash",
+     * "submit.rejected" or "submit.undelivered". Set before payments start.
+     */
+    using StageObserver = std::function<void(const char* stage, int64_t us, bool ok)>;
+    void setStageObserver(StageObserver observer) { stage_observer_ = std::move(observer); }
+
+    // Fields of the first accepts[] entry with a built-in scheme/network
+    struct PaymentOffer {
+        char pay_to[48];
+        char asset[48];
+        char fee_payer[48];
+        char resource[256];
+        uint64_t amount;
+        int policy;             // Index into x402::EnabledSchemes
+        uint8_t hash[32];       // Fingerprint used to detect offer changes
+    };
+
+    /**
+     * @brief Pick the first payable entry of a 402 body's "accepts" list
+     *
+     * Only entries for config's network (x402::DEFAULT_NETWORK if unset)
+     * and in config.token_mint are payable.
+     */
+    static bool parseOffer(cJSON* offer_json, const X402Config& config, PaymentOffer& out);
+
 private:
+    // Signed X-PAYMENT header ready for submit_payment_stream
+    struct PreparedPayment {
+        char* header;           // malloc'd, caller frees
+        uint8_t signature[64];  // Payer signature, how the journal finds the TX on chain
+        bool uses_nonce;
+        int64_t built_at_us;
+    };
+
     bool fetchPaymentOffer(cJSON** offer_json);
+
+    /**
+     * @brief Blockhash/nonce, build, sign and encode a payment for offers
+     * @param count Number of offers settled by the one transaction (batch if > 1)
+     * @param wallet Payer wallet that signs, or PayerWallets::TREASURY
+     * @param interactive Show progress on the display (false for idle pre-signing)
+     * @param allow_nonce May use the durable nonce; only one of several
+     *        transactions built together can, or only one of them lands
+     */
+    bool buildPayment(const PaymentOffer* offers, size_t count, int wallet,
+                      PreparedPayment& out, bool interactive, bool allow_nonce = true);
+
+    // Marks a tapped flow as running: the pool filler stays off the network
+    // until it ends, then refills. Also counts as use of the pool.
+    class ActiveFlow {
+    public:
+        explicit ActiveFlow(X402PaymentClient* client);
+        ~ActiveFlow();
+
+    private:
+        X402PaymentClient* client_;
+    };
+
+    // === Submission and retries ===
+    // Why a submission failed, which decides what a retry has to redo
+    enum class SubmitFailure : uint8_t {
+        None,
+        Network,            // No response: the same bytes may be sent again
+        ServerError,        // 408/429/5xx: same bytes again after a pause
+        BlockhashExpired,   // Rejected for its blockhash: sign again with a fresh one
+        Rejected,           // Any other refusal: not retried
+        Undelivered,        // Paid, but the content did not arrive in full
+    };
+
+    static constexpr int MAX_SUBMIT_ATTEMPTS = 4;      // Same bytes, per signed TX
+    static constexpr int MAX_RESIGNS = 2;              // Fresh blockhash, per flow
+    static constexpr uint32_t RETRY_BASE_MS = 300;
+    static constexpr int64_t PAYMENT_DEADLINE_US = 60LL * 1000 * 1000;
+
+    static SubmitFailure classifySubmit(const HttpClient::StreamResult& result, bool delivered);
+    static const char* failureName(SubmitFailure failure);
+    // Exponential backoff with "equal jitter": half fixed, half random
+    static uint32_t retryDelayMs(int attempt);
+
+    /**
+     * @brief Send the X-PAYMENT header once
+     * @param cache_url URL the content is cached under (the URL the flow was asked for)
+     * @param resent An earlier send of the same header got no usable answer.
+     *        A 402 then leaves the entry SUBMITTED until the chain shows
+     *        whether that send settled.
+     */
+    SubmitFailure submitPayment(const char* resource, const char* x_payment_header,
+                                BalanceLedger::Reservation& reservation, uint32_t journal_id,
+                                const char* cache_url, bool resent);
+    /**
+     * @brief submitPayment, resending the same header after network and
+     * server errors until MAX_SUBMIT_ATTEMPTS or deadline_us
+     *
+     * Records SUBMITTED once up front. Other failures are returned at once:
+     * a blockhash rejection is for the caller to re-sign, since only it has
+     * the offers.
+     */
+    SubmitFailure submitWithRetry(const char* resource, const char* x_payment_header,
+                                  BalanceLedger::Reservation& reservation, uint32_t journal_id,
+                                  const char* cache_url, int64_t deadline_us);
+    /**
+     * @brief Wait before the next retry
+     * @return false if the wait would run past deadline_us
+     */
+    bool retryPause(int attempt, int64_t deadline_us);
+    void showSubmitFailure(SubmitFailure failure);
+    void showPaymentResult(const char* content);
+
+    /**
+     * @brief Sign offer and submit it until it settles or fails for good,
+     * signing again with a fresh blockhash after a blockhash rejection
+     * @param failure None once paid, otherwise why the last submission failed
+     * @return false if no payment could be built (already shown)
+     */
+    bool payOffer(const PaymentOffer& offer, const char* cache_url, int wallet,
+                  BalanceLedger::Reservation& reservation, int64_t deadline_us,
+                  bool allow_nonce, SubmitFailure& failure);
+
+    // === Batch submission ===
+    // Whether one transaction may pay all of offers
+    static bool sharesTransaction(const PaymentOffer* offers, size_t count);
+    /**
+     * @brief Sign one transaction paying every offer and present it to each
+     * resource in turn, signing again if the first one rejects its blockhash
+     * @param reservation The whole batch's reservation
+     * @return Number of resources that accepted the payment
+     */
+    size_t payShared(const PaymentOffer* offers, const char* const* urls, size_t count,
+                     int wallet, BalanceLedger::Reservation& reservation, int64_t deadline_us);
+
+    void uiStatus(bool interactive, const char* title, const char* message, uint32_t pause_ms);
+    void uiError(bool interactive, const char* message);
+    void uiPause(uint32_t ms);      // Only while paced
+    static const char* submitStage(SubmitFailure failure);
+    // Reports stage to the observer if the calling task runs executePaymentFlow
+    void stageDone(const char* stage, bool ok = true);
     
-    void onPaymentButtonPressed();  // Callback for button press
+    void onPaymentButtonPressed();  // Callback for button press (LVGL context)
+
+    // === UI dispatch and payment worker ===
+    enum class UiEvent : uint8_t {
+        PaymentTap,
+    };
+
+    struct PaymentJob {
+        const char* url;        // Must outlive the job (config strings do)
+        int64_t enqueued_at_us;
+    };
+
+    static constexpr UBaseType_t UI_EVENT_QUEUE_DEPTH = 8;
+    static constexpr UBaseType_t PAYMENT_QUEUE_DEPTH  = 4;
+
+    static void paymentWorkerEntry(void* arg);
+    void paymentWorkerLoop();
+    bool markPending(const char* url);
+    void clearPending(const char* url);
+
+
+    // === Boot ===
+    static constexpr EventBits_t BOOT_DISPLAY_OK     = BIT0;
+    static constexpr EventBits_t BOOT_DISPLAY_FAILED = BIT1;
+    static constexpr uint32_t WIFI_CONNECT_TIMEOUT_MS = 10000;
+
+    static void displayInitEntry(void* arg);
+    bool waitDisplayReady();
+
+    // === Background maintenance (runs off the payment path) ===
+    static constexpr uint32_t MAINT_RECONCILE_BALANCE = 1u << 0;
+    static constexpr uint32_t MAINT_REFRESH_NONCE     = 1u << 1;
+    static constexpr uint32_t MAINT_REFILL_POOL       = 1u << 2;
+    static constexpr uint32_t MAINT_LOAD_LOOKUP_TABLE = 1u << 3;
+    static constexpr uint32_t MAINT_REFRESH_FEES      = 1u << 4;
+    static constexpr uint32_t MAINT_RESOLVE_JOURNAL   = 1u << 5;
+    static constexpr uint32_t MAINTENANCE_PERIOD_MS   = 15000;
+    static constexpr uint32_t RECONCILE_PERIOD_MS     = 60000;
+    static constexpr uint32_t FEE_REFRESH_PERIOD_MS   = 30000;
+
+    static void maintenanceTaskEntry(void* arg);
+    void maintenanceLoop();
+    void requestMaintenance(uint32_t bits);
+    // @return false if a balance could not be read
+    bool reconcileBalance();
+
+    // === Payer wallets ===
+    /**
+     * @brief Wallet to pay amount from, counted in the wallet metrics
+     * @return Wallet index, or PayerWallets::TREASURY (configured payer)
+     */
+    int pickPayer(uint64_t amount);
+    BalanceLedger& payerLedger(int wallet);
+    /**
+     * @brief Public key of a journal payer index (PaymentJournal::Entry::payer)
+     */
+    bool journalPayerKey(uint8_t payer, uint8_t out[32]) const;
+    /**
+     * @brief Fund wallets that ran low from the configured payer
+     * Uses the balances of the reconcile pass that just ran.
+     */
+    bool rebalanceWallets();
+
+    // === Durable nonce ===
+    bool refreshNonce();
+    bool acquireNonce(SolanaClient::NonceAccount& out);
 
-    static char* buildPaymentPayload(const char* base64_tx);
+    // === Address lookup table (v0 transactions) ===
+    bool loadLookupTable();
+
+    // === Priority fees ===
+    bool refreshFees();
+
+    // === Payment journal ===
+    // A blockhash expires ~150 slots (~60-90 s) after it was fetched; a TX
+    // still missing after that will never land
+    static constexpr int64_t TX_LANDING_WINDOW_US = 90LL * 1000 * 1000;
+
+    /**
+     * @brief Close an unresolved payment if the chain tells how it ended
+     * @return SETTLED or ABORTED once decided, SUBMITTED while still unknown
+     */
+    PaymentJournal::Type resolvePayment(const PaymentJournal::Entry& entry);
+    void resolveJournal();
+
+    /**
+     * @brief Guard against paying resource twice
+     * Resolves an unresolved earlier payment for resource first.
+     * @param already_paid Set when the earlier payment turned out to have landed
+     * @return true if a new payment may go ahead
+     */
+    bool clearToPay(const char* resource, bool* already_paid);
+
+    // === Paid-content cache ===
+    /**
+     * @brief Show url's content from the cache instead of paying for it
+     * Revalidates a stale entry with a conditional GET first.
+     * @return true if the content was shown
+     */
+    bool serveCached(const char* url);
+
+    // === Pre-signed pool (filled while the idle screen is up) ===
+    // No flow for this long: stop fetching the offer until the next one
+    static constexpr uint32_t POOL_IDLE_TIMEOUT_MS = 5 * 60 * 1000;
+
+    void refillPool();
 
     X402Config cfg_;
     std::unique_ptr<SolanaClient> solana_;
@@ -62,5 +381,48 @@ private:
     std::unique_ptr<HttpClient> http_;
     std::unique_ptr<DisplayManager> display_;
     
-    bool env_initialized_;
+    BalanceLedger ledger_;          // Configured payer (the treasury when wallets are on)
+    PayerWallets wallets_;
+    uint8_t source_ata_[32];
+    bool source_ata_ready_;
+    TaskHandle_t maintenance_task_;
+    EventGroupHandle_t boot_events_;
+
+    // Cached nonce; valid is cleared while a built TX may still consume it
+    bool nonce_mode_;
+    SolanaClient::NonceAccount nonce_;
+    portMUX_TYPE nonce_lock_;
+
+    // Loaded once by the maintenance task, read-only after lookup_table_ready_
+    std::unique_ptr<SolanaClient::AddressLookupTable> lookup_table_;
+    std::atomic<bool> lookup_table_ready_;
+
+    QueueHandle_t ui_events_;
+    QueueHandle_t payment_jobs_;
+    TaskHandle_t payment_worker_;
+
+    // URLs queued or running, for de-duplicating taps
+    const char* pending_urls_[PAYMENT_QUEUE_DEPTH + 1];
+    portMUX_TYPE pending_lock_;
+
+    FeeEstimator fees_;
+    uint8_t fee_payer_key_[32];   // From the last offer seen by the background task
+    bool fee_payer_known_;
+
+    PresignedPool pool_;
+    std::atomic<int64_t> last_flow_us_;   // Start of the last flow, for POOL_IDLE_TIMEOUT_MS
+    bool pool_paused_;                    // Maintenance task only
+    PaymentJournal journal_;
+    const char* journal_source_;
+    const char* cache_dir_;
+    AsyncHttp::Sink content_sink_;
+    bool paced_;
+    StageObserver stage_observer_;
+    TaskHandle_t stage_task_;       // Task inside executePaymentFlow, if any
+    int64_t stage_mark_us_;
+    ContentCache cache_;
+    char cache_scope_[48];        // Payer address: content is cached per wallet
+    std::atomic<bool> payment_active_;
+
+    std::atomic<bool> env_initialized_;   // Set by init(), read by every flow's task
 };
\ No newline at end of file
@@ -0,0 +1,391 @@
+#include "async_http.h"
+#include "metrics.h"
+#include <esp_crt_bundle.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/semphr.h>
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <strings.h>
+
+static const char* TAG = "AsyncHttp";
+
+// Bytes to drop before a resumed body reaches the sink, -1 if it starts too late
+static int64_t rangeSkip(int64_t range_from, const char* content_range, int status) {
+    if (range_from <= 0) return 0;
+    if (status == 200) return range_from;       // Range ignored, whole body resent
+    long long first = 0;
+    if (sscanf(content_range, "bytes %lld-", &first) != 1 || first > range_from) {
+        return -1;
+    }
+    return range_from - first;
+}
+
+template <size_t N>
+static void keepHeader(char (&dst)[N], const char* key, const char* name, const char* value) {
+    if (strcasecmp(key, name) == 0) {
+        strncpy(dst, value, N - 1);
+        dst[N - 1] = '\0';
+    }
+}
+
+AsyncHttp& AsyncHttp::instance() {
+    static AsyncHttp engine;
+    return engine;
+}
+
+AsyncHttp::AsyncHttp() : in_flight_(0), inflaters_(0), executor_(nullptr), blocking_(nullptr), workers_{} {
+    for (Slot& slot : slots_) {
+        slot.state = SLOT_FREE;
+        slot.handle = nullptr;
+        slot.buf = nullptr;
+        slot.body = nullptr;
+        slot.inflater = nullptr;
+    }
+    // Every slot fits, so handing one to the workers never waits
+    blocking_ = xQueueCreate(MAX_IN_FLIGHT, sizeof(Slot*));
+    for (size_t i = 0; blocking_ && i < BLOCKING_WORKERS; i++) {
+        if (xTaskCreate(workerEntry, "http_block", 6144, this, 5, &workers_[i]) != pdPASS) {
+            ESP_LOGE(TAG, "❌ Failed to create HTTP worker task");
+            workers_[i] = nullptr;
+        }
+    }
+    if (!blocking_ || !workers_[0]) {
+        ESP_LOGW(TAG, "⚠️ No HTTP workers, plain HTTP requests will fail");
+    }
+    if (xTaskCreate(executorEntry, "http_exec", 6144, this, 5, &executor_) != pdPASS) {
+        ESP_LOGE(TAG, "❌ Failed to create HTTP executor task");
+        executor_ = nullptr;
+    }
+}
+
+esp_err_t AsyncHttp::eventHandler(esp_http_client_event_t* evt) {
+    Slot* slot = static_cast<Slot*>(evt->user_data);
+    if (evt->event_id == HTTP_EVENT_ON_HEADER) {
+        Headers& h = slot->headers;
+        keepHeader(h.cache_control, evt->header_key, "Cache-Control", evt->header_value);
+        keepHeader(h.etag, evt->header_key, "ETag", evt->header_value);
+        keepHeader(h.last_modified, evt->header_key, "Last-Modified", evt->header_value);
+        keepHeader(h.expires, evt->header_key, "Expires", evt->header_value);
+        keepHeader(h.date, evt->header_key, "Date", evt->header_value);
+        keepHeader(h.content_range, evt->header_key, "Content-Range", evt->header_value);
+        keepHeader(h.content_encoding, evt->header_key, "Content-Encoding", evt->header_value);
+    } else if (evt->event_id == HTTP_EVENT_ON_DATA) {
+        int status = esp_http_client_get_status_code(evt->client);
+        const char* data = static_cast<const char*>(evt->data);
+        slot->wire += evt->data_len;
+        if (!slot->decode_decided) {
+            startDecoding(slot);
+        }
+        if (!slot->inflater) {
+            if (!slot->decode_failed) deliver(slot, status, data, evt->data_len);
+            return ESP_OK;
+        }
+        bool fed = slot->inflater->feed(reinterpret_cast<const uint8_t*>(data), evt->data_len,
+                                        [slot, status](const char* out, size_t len) {
+            deliver(slot, status, out, len);
+            return !slot->sink_failed && !slot->truncated;
+        });
+        if (!fed && !slot->sink_failed && !slot->truncated) {
+            slot->decode_failed = true;
+        }
+    }
+    return ESP_OK;
+}
+
+void AsyncHttp::startDecoding(Slot* slot) {
+    slot->decode_decided = true;
+    Inflater::Format format;
+    if (!slot->inflate_reserved || !Inflater::parseEncoding(slot->headers.content_encoding, &format)) {
+        return;     // Identity, or sent compressed without being asked
+    }
+    slot->inflater = new (std::nothrow) Inflater(format);
+    if (!slot->inflater || !slot->inflater->ok()) {
+        ESP_LOGE(TAG, "❌ No memory to decode %s body", slot->headers.content_encoding);
+        delete slot->inflater;
+        slot->inflater = nullptr;
+        slot->decode_failed = true;
+    }
+}
+
+void AsyncHttp::deliver(Slot* slot, int status, const char* data, size_t len) {
+    slot->decoded += len;
+    if (slot->sink && status >= 200 && status < 300) {
+        if (slot->skip < 0) {
+            slot->skip = rangeSkip(slot->range_from, slot->headers.content_range, status);
+            if (slot->skip < 0) {
+                ESP_LOGW(TAG, "⚠️ Content-Range '%s' does not start at %" PRId64,
+                         slot->headers.content_range, slot->range_from);
+                slot->sink_failed = true;
+                slot->skip = INT64_MAX;
+            }
+        }
+        size_t drop = (size_t)std::min<int64_t>(slot->skip, len);
+        slot->skip -= drop;
+        data += drop;
+        len -= drop;
+        if (len && !slot->sink_failed) {
+            if (slot->sink(data, len)) {
+                slot->streamed += len;
+            } else {
+                slot->sink_failed = true;
+            }
+        }
+        return;
+    }
+    if (slot->len + len <= slot->cap) {
+        memcpy(slot->buf + slot->len, data, len);
+        slot->len += len;
+    } else {
+        slot->truncated = true;
+    }
+}
+
+bool AsyncHttp::reserveInflater() {
+    size_t n = inflaters_.load();
+    while (n < MAX_INFLATERS) {
+        if (inflaters_.compare_exchange_weak(n, n + 1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool AsyncHttp::submit(const Request& req, Callback cb) {
+    bool busy;
+    return submit(req, std::move(cb), &busy);
+}
+
+bool AsyncHttp::submit(const Request& req, Callback cb, bool* busy) {
+    *busy = false;
+    if (!executor_) {
+        return false;
+    }
+
+    Slot* slot = nullptr;
+    for (Slot& s : slots_) {
+        uint8_t expected = SLOT_FREE;
+        if (s.state.compare_exchange_strong(expected, SLOT_RESERVED)) {
+            slot = &s;
+            break;
+        }
+    }
+    if (!slot) {
+        *busy = true;
+        Metrics::increment("http.busy");
+        return false;
+    }
+
+    slot->cap = req.max_response;
+    slot->len = 0;
+    slot->truncated = false;
+    memset(&slot->headers, 0, sizeof(slot->headers));
+    slot->sink = req.sink;
+    slot->range_from = req.range_from;
+    slot->skip = -1;
+    slot->streamed = 0;
+    slot->sink_failed = false;
+    slot->decode_decided = false;
+    slot->decode_failed = false;
+    slot->wire = 0;
+    slot->decoded = 0;
+    slot->buf = (char*)malloc(slot->cap + 1);
+    slot->body = req.body ? strdup(req.body) : nullptr;
+
+    esp_http_client_config_t config = {};
+    config.url = req.url;
+    config.method = req.method;
+    config.user_agent = req.user_agent;
+    config.timeout_ms = req.timeout_ms;
+    config.event_handler = eventHandler;
+    config.user_data = slot;
+    config.crt_bundle_attach = esp_crt_bundle_attach;
+    config.is_async = strncmp(req.url, "https", 5) == 0;
+    if (!config.is_async && !workers_[0]) {
+        slot->state = SLOT_FREE;
+        return false;
+    }
+    if (req.buffer_size_tx) {
+        config.buffer_size_tx = req.buffer_size_tx;
+    }
+
+    slot->handle = (slot->buf && (slot->body || !req.body)) ? esp_http_client_init(&config) : nullptr;
+    if (!slot->handle) {
+        ESP_LOGE(TAG, "❌ Request setup failed for %s", req.url);
+        free(slot->buf);
+        free(slot->body);
+        slot->buf = slot->body = nullptr;
+        slot->state = SLOT_FREE;
+        return false;
+    }
+    slot->inflate_reserved = req.accept_compressed && reserveInflater();
+    if (slot->inflate_reserved) {
+        esp_http_client_set_header(slot->handle, "Accept-Encoding", "gzip, deflate");
+    }
+    if (req.header_name) {
+        esp_http_client_set_header(slot->handle, req.header_name, req.header_value);
+    }
+    if (req.content_type) {
+        esp_http_client_set_header(slot->handle, "Content-Type", req.content_type);
+    }
+    if (req.if_none_match) {
+        esp_http_client_set_header(slot->handle, "If-None-Match", req.if_none_match);
+    }
+    if (req.if_modified_since) {
+        esp_http_client_set_header(slot->handle, "If-Modified-Since", req.if_modified_since);
+    }
+    if (req.range_from > 0) {
+        snprintf(slot->range, sizeof(slot->range), "bytes=%" PRId64 "-", req.range_from);
+        esp_http_client_set_header(slot->handle, "Range", slot->range);
+    }
+    if (slot->body) {
+        esp_http_client_set_post_field(slot->handle, slot->body, strlen(slot->body));
+    }
+    slot->cb = std::move(cb);
+    // Slack on top of the socket timeout so a stalled handshake still ends
+    slot->deadline_us = esp_timer_get_time() + (int64_t)(req.timeout_ms + 5000) * 1000;
+
+    size_t n = ++in_flight_;
+    Metrics::observe("http.in_flight", n);
+    if (config.is_async) {
+        slot->state = SLOT_ACTIVE;
+        xTaskNotifyGive(executor_);
+    } else {
+        slot->state = SLOT_BLOCKING;
+        xQueueSend(blocking_, &slot, 0);
+    }
+    return true;
+}
+
+bool AsyncHttp::onEngineTask() const {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    if (self == executor_) {
+        return true;
+    }
+    for (TaskHandle_t worker : workers_) {
+        if (self == worker) return true;
+    }
+    return false;
+}
+
+bool AsyncHttp::perform(const Request& req, Callback cb) {
+    // The engine would block waiting for itself
+    configASSERT(!onEngineTask());
+
+    StaticSemaphore_t done_buf;
+    SemaphoreHandle_t done = xSemaphoreCreateBinaryStatic(&done_buf);
+
+    auto wrapped = [&cb, done](const Response& resp) {
+        cb(resp);
+        xSemaphoreGive(done);
+    };
+
+    bool busy = false;
+    while (!submit(req, wrapped, &busy)) {
+        if (!busy) {
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(POLL_INTERVAL_MS));
+    }
+    xSemaphoreTake(done, portMAX_DELAY);
+    return true;
+}
+
+void AsyncHttp::complete(Slot& slot, esp_err_t err) {
+    slot.buf[slot.len] = '\0';
+    Response resp = {
+        err,
+        esp_http_client_get_status_code(slot.handle),
+        slot.buf,
+        slot.len,
+        slot.truncated || slot.sink_failed || slot.decode_failed,
+        &slot.headers,
+        slot.streamed,
+        err == ESP_OK && esp_http_client_is_complete_data_received(slot.handle) &&
+            (!slot.inflater || slot.inflater->finished()),
+        slot.inflater ? -1 : esp_http_client_get_content_length(slot.handle),
+        slot.wire,
+        slot.decoded,
+    };
+    if (slot.truncated) {
+        ESP_LOGW(TAG, "⚠️ Response exceeded %zu bytes, truncated", slot.cap);
+    }
+    if (slot.inflater) {
+        ESP_LOGD(TAG, "%s: %zu wire bytes -> %zu decoded", slot.headers.content_encoding,
+                 slot.wire, slot.decoded);
+        Metrics::increment("http.compressed_responses");
+    }
+    Metrics::increment("http.wire_bytes", slot.wire);
+    Metrics::increment("http.decoded_bytes", slot.decoded);
+    slot.cb(resp);
+
+    esp_http_client_cleanup(slot.handle);
+    free(slot.buf);
+    free(slot.body);
+    slot.handle = nullptr;
+    slot.buf = slot.body = nullptr;
+    slot.cb = nullptr;
+    slot.sink = nullptr;
+    delete slot.inflater;
+    slot.inflater = nullptr;
+    if (slot.inflate_reserved) {
+        --inflaters_;
+    }
+    --in_flight_;
+    slot.state = SLOT_FREE;
+}
+
+void AsyncHttp::executorEntry(void* arg) {
+    static_cast<AsyncHttp*>(arg)->executorLoop();
+}
+
+void AsyncHttp::executorLoop() {
+    ESP_LOGI(TAG, "🌐 HTTP executor started");
+
+    while (1) {
+        bool pending = false;
+        for (Slot& slot : slots_) {
+            uint8_t state = slot.state;
+            if (state == SLOT_DONE) {
+                complete(slot, slot.result);
+                continue;
+            }
+            if (state != SLOT_ACTIVE) continue;
+
+            esp_err_t err = esp_http_client_perform(slot.handle);
+            if (err == ESP_ERR_HTTP_EAGAIN) {
+                if (esp_timer_get_time() < slot.deadline_us) {
+                    pending = true;
+                    continue;
+                }
+                err = ESP_ERR_TIMEOUT;
+            }
+            complete(slot, err);
+        }
+
+        // Sockets are still busy: come back after a short sleep. Otherwise
+        // sleep until a request is submitted or a worker finishes one.
+        ulTaskNotifyTake(pdTRUE, pending ? pdMS_TO_TICKS(POLL_INTERVAL_MS) : portMAX_DELAY);
+    }
+}
+
+void AsyncHttp::workerEntry(void* arg) {
+    static_cast<AsyncHttp*>(arg)->workerLoop();
+}
+
+void AsyncHttp::workerLoop() {
+    while (1) {
+        Slot* slot = nullptr;
+        if (xQueueReceive(blocking_, &slot, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        // Bounded by the request's socket timeout
+        slot->result = esp_http_client_perform(slot->handle);
+        slot->state = SLOT_DONE;
+        xTaskNotifyGive(executor_);
+    }
+}
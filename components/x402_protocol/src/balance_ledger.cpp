@@ -0,0 +1,93 @@
+#include "balance_ledger.h"
+#include "metrics.h"
+#include <esp_log.h>
+
+static const char* TAG = "BalanceLedger";
+
+BalanceLedger::BalanceLedger()
+    : seeded_(false)
+    , balance_(0)
+    , reserved_(0)
+{
+    portMUX_INITIALIZE(&lock_);
+}
+
+bool BalanceLedger::tryReserve(uint64_t amount) {
+    bool ok;
+    portENTER_CRITICAL(&lock_);
+    ok = !seeded_ || (balance_ >= reserved_ && balance_ - reserved_ >= amount);
+    if (ok) {
+        reserved_ += amount;
+    }
+    portEXIT_CRITICAL(&lock_);
+
+    if (!ok) {
+        Metrics::increment("ledger.rejected");
+    }
+    return ok;
+}
+
+void BalanceLedger::commit(uint64_t amount) {
+    portENTER_CRITICAL(&lock_);
+    reserved_ = (reserved_ >= amount) ? reserved_ - amount : 0;
+    if (seeded_) {
+        balance_ = (balance_ >= amount) ? balance_ - amount : 0;
+    }
+    portEXIT_CRITICAL(&lock_);
+}
+
+void BalanceLedger::release(uint64_t amount) {
+    portENTER_CRITICAL(&lock_);
+    reserved_ = (reserved_ >= amount) ? reserved_ - amount : 0;
+    portEXIT_CRITICAL(&lock_);
+}
+
+bool BalanceLedger::reconcile(uint64_t onChainBalance) {
+    bool wasSeeded;
+    bool deferred = false;
+    int64_t delta = 0;
+
+    portENTER_CRITICAL(&lock_);
+    wasSeeded = seeded_;
+    if (seeded_ && reserved_ > 0) {
+        deferred = true;
+    } else {
+        delta = (int64_t)onChainBalance - (int64_t)balance_;
+        balance_ = onChainBalance;
+        seeded_ = true;
+    }
+    portEXIT_CRITICAL(&lock_);
+
+    if (deferred) {
+        Metrics::increment("ledger.reconcile_deferred");
+        return false;
+    }
+
+    if (!wasSeeded) {
+        ESP_LOGI(TAG, "✅ Ledger seeded: %llu", (unsigned long long)onChainBalance);
+        return true;
+    }
+
+    Metrics::increment("ledger.reconciled");
+    if (delta != 0) {
+        ESP_LOGW(TAG, "⚠️ Ledger mismatch: local off by %lld", (long long)delta);
+        Metrics::increment("ledger.mismatch");
+        Metrics::observe("ledger.mismatch_delta", delta);
+        return false;
+    }
+    return true;
+}
+
+uint64_t BalanceLedger::available() const {
+    portENTER_CRITICAL(&lock_);
+    uint64_t avail = (balance_ >= reserved_) ? balance_ - reserved_ : 0;
+    portEXIT_CRITICAL(&lock_);
+    return avail;
+}
+
+bool BalanceLedger::isSeeded() const {
+    portENTER_CRITICAL(&lock_);
+    bool seeded = seeded_;
+    portEXIT_CRITICAL(&lock_);
+    return seeded;
+}
@@ -0,0 +1,623 @@
+#include "benchmarks.h"
+#include "config_manager.h"
+#include "display_manager.h"
+#include "frame_profiler.h"
+#include "headless_backend.h"
+#include "http_client.h"
+#include "payer_wallets.h"
+#include "payment_scheme.h"
+#include "payment_verifier.h"
+#include "crypto_utils.h"
+#include "solana_client.h"
+#include "transaction_view.h"
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/semphr.h>
+#include <sodium.h>
+#include <malloc.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static const char* TAG = "Benchmarks";
+
+namespace {
+
+// Refreshes per screen change: the drain timer, then the refresh timer
+constexpr size_t PUMPS_PER_STEP = 3;
+constexpr size_t MAX_TRANSITIONS = 8;
+
+struct TransitionStats {
+    const char* name;
+    size_t frames;
+    uint64_t render_us;
+    uint64_t flush_us;
+    uint32_t max_refresh_us;
+    uint64_t flushed_px;
+    uint64_t invalidated_px;
+};
+
+// What one tap shows, in the client's order
+void showStep(DisplayManager& display, size_t step) {
+    switch (step) {
+        case 0: display.showIdleScreen([] {}); break;
+        case 1: display.showStatus("Payment", "Fetching offer..."); break;
+        case 2: display.showStatus("Payment", "Signing..."); break;
+        case 3: display.showStatus("Payment", "Submitting..."); break;
+        case 4: display.showSuccess("Paid 0.01 USDC\nContent received"); break;
+        case 5: display.showError("Payment failed"); break;
+        case 6: display.showText("Premium content\nunlocked for 0.01 USDC", false); break;
+        default: display.clear(); break;
+    }
+}
+constexpr size_t STEPS = 8;
+
+// The widget handling DisplayManager had before it retained its screens:
+// one label restyled for every message, and the idle widgets deleted and
+// created again on every showIdleScreen. Kept here as the baseline.
+class RebuildScreens {
+public:
+    explicit RebuildScreens(lv_display_t* disp) {
+        lv_obj_t* screen = lv_scr_act();
+        int32_t hres = lv_display_get_horizontal_resolution(disp);
+        int32_t vres = lv_display_get_vertical_resolution(disp);
+        lv_obj_set_style_bg_color(screen, lv_color_hex(0x000000), LV_PART_MAIN);
+        lv_obj_set_style_bg_opa(screen, LV_OPA_COVER, LV_PART_MAIN);
+
+        label_ = lv_label_create(screen);
+        lv_obj_set_width(label_, hres - 20);
+        lv_obj_set_style_text_color(label_, lv_color_hex(0xFFFFFF), LV_PART_MAIN);
+        lv_obj_set_style_text_align(label_, LV_TEXT_ALIGN_CENTER, 0);
+        lv_label_set_long_mode(label_, LV_LABEL_LONG_WRAP);
+        lv_obj_align(label_, LV_ALIGN_CENTER, 0, 0);
+        lv_obj_add_flag(label_, LV_OBJ_FLAG_HIDDEN);
+
+        idle_ = lv_obj_create(screen);
+        lv_obj_set_size(idle_, hres, vres);
+        lv_obj_set_style_bg_color(idle_, lv_color_hex(0x000000), LV_PART_MAIN);
+        lv_obj_set_style_bg_opa(idle_, LV_OPA_COVER, LV_PART_MAIN);
+        lv_obj_set_style_border_width(idle_, 0, LV_PART_MAIN);
+        lv_obj_align(idle_, LV_ALIGN_CENTER, 0, 0);
+        lv_obj_add_flag(idle_, LV_OBJ_FLAG_HIDDEN);
+    }
+
+    void showIdleScreen() {
+        lv_obj_add_flag(label_, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_clean(idle_);
+        lv_obj_clear_flag(idle_, LV_OBJ_FLAG_HIDDEN);
+
+        lv_obj_t* title = lv_label_create(idle_);
+        lv_label_set_text(title, "X402 Client");
+        lv_obj_set_style_text_color(title, lv_color_hex(0xFFFFFF), LV_PART_MAIN);
+        lv_obj_align(title, LV_ALIGN_TOP_MID, 0, 30);
+
+        lv_obj_t* subtitle = lv_label_create(idle_);
+        lv_label_set_text(subtitle, "Ready");
+        lv_obj_set_style_text_color(subtitle, lv_color_hex(0x888888), LV_PART_MAIN);
+        lv_obj_align(subtitle, LV_ALIGN_TOP_MID, 0, 55);
+
+        lv_obj_t* button = lv_btn_create(idle_);
+        lv_obj_set_size(button, 160, 50);
+        lv_obj_align(button, LV_ALIGN_CENTER, 0, 20);
+        lv_obj_set_style_bg_color(button, lv_color_hex(0x2196F3), LV_PART_MAIN);
+        lv_obj_set_style_radius(button, 8, LV_PART_MAIN);
+        lv_obj_t* button_label = lv_label_create(button);
+        lv_label_set_text(button_label, "Start Payment");
+        lv_obj_set_style_text_color(button_label, lv_color_hex(0xFFFFFF), LV_PART_MAIN);
+        lv_obj_center(button_label);
+
+        lv_obj_t* instruction = lv_label_create(idle_);
+        lv_label_set_text(instruction, "Tap button to begin");
+        lv_obj_set_style_text_color(instruction, lv_color_hex(0x666666), LV_PART_MAIN);
+        lv_obj_align(instruction, LV_ALIGN_BOTTOM_MID, 0, -50);
+
+        lv_obj_t* wallet = lv_label_create(idle_);
+        lv_label_set_text(wallet, "Wallet: 2KUCmt...2yZ1");
+        lv_obj_set_style_text_color(wallet, lv_color_hex(0x444444), LV_PART_MAIN);
+        lv_obj_set_style_text_font(wallet, &lv_font_montserrat_10, 0);
+        lv_obj_align(wallet, LV_ALIGN_BOTTOM_MID, 0, -10);
+    }
+
+    void showText(const char* text, bool centered, uint32_t color = 0xFFFFFF) {
+        lv_obj_add_flag(idle_, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_clear_flag(label_, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_set_style_text_color(label_, lv_color_hex(color), LV_PART_MAIN);
+        lv_label_set_text(label_, text);
+        lv_obj_set_style_text_align(label_, centered ? LV_TEXT_ALIGN_CENTER : LV_TEXT_ALIGN_LEFT, 0);
+        if (centered) {
+            lv_obj_align(label_, LV_ALIGN_CENTER, 0, 0);
+        } else {
+            lv_obj_align(label_, LV_ALIGN_TOP_LEFT, 10, 10);
+        }
+    }
+
+    void showStatus(const char* title, const char* message) {
+        char buffer[256];
+        snprintf(buffer, sizeof(buffer), "%s\n\n%s", title, message);
+        showText(buffer, true);
+    }
+
+    void clear() {
+        lv_label_set_text(label_, "");
+        lv_obj_add_flag(label_, LV_OBJ_FLAG_HIDDEN);
+    }
+
+private:
+    lv_obj_t* label_;
+    lv_obj_t* idle_;
+};
+
+// The same tap on the baseline widgets; transitions are named as
+// DisplayManager names them
+const char* showStep(RebuildScreens& screens, size_t step) {
+    switch (step) {
+        case 0: screens.showIdleScreen(); return "idle";
+        case 1: screens.showStatus("Payment", "Fetching offer..."); return "status";
+        case 2: screens.showStatus("Payment", "Signing..."); return "status";
+        case 3: screens.showStatus("Payment", "Submitting..."); return "status";
+        case 4: screens.showText("Paid 0.01 USDC\nContent received", true); return "success";
+        case 5: screens.showText("Payment failed", true, 0xFF0000); return "error";
+        case 6: screens.showText("Premium content\nunlocked for 0.01 USDC", false); return "text";
+        default: screens.clear(); return "clear";
+    }
+}
+
+void collect(const FrameProfiler::FrameSample* samples, size_t n, TransitionStats* stats, size_t& count) {
+    for (size_t i = 0; i < n; i++) {
+        const char* name = samples[i].transition ? samples[i].transition : "none";
+        TransitionStats* t = nullptr;
+        for (size_t j = 0; j < count; j++) {
+            if (strcmp(stats[j].name, name) == 0) {
+                t = &stats[j];
+                break;
+            }
+        }
+        if (!t) {
+            if (count == MAX_TRANSITIONS) {
+                continue;
+            }
+            t = &stats[count++];
+            *t = {name, 0, 0, 0, 0, 0, 0};
+        }
+        uint32_t refresh_us = samples[i].render_us + samples[i].flush_us;
+        t->frames++;
+        t->render_us += samples[i].render_us;
+        t->flush_us += samples[i].flush_us;
+        t->max_refresh_us = refresh_us > t->max_refresh_us ? refresh_us : t->max_refresh_us;
+        t->flushed_px += samples[i].flushed_px;
+        t->invalidated_px += samples[i].invalidated_px;
+    }
+}
+
+void logTransitions(const char* path, const TransitionStats* stats, size_t count, size_t cycles) {
+    ESP_LOGI(TAG, "   %-8s %-8s %7s %10s %10s %10s %11s %11s", "path", "step", "frames",
+             "render_us", "flush_us", "max_us", "flushed_px", "invalid_px");
+    for (size_t i = 0; i < count; i++) {
+        const TransitionStats& t = stats[i];
+        ESP_LOGI(TAG, "   %-8s %-8s %7.2f %10llu %10llu %10lu %11llu %11llu", path, t.name,
+                 (double)t.frames / cycles,
+                 (unsigned long long)(t.render_us / t.frames),
+                 (unsigned long long)(t.flush_us / t.frames),
+                 (unsigned long)t.max_refresh_us,
+                 (unsigned long long)(t.flushed_px / t.frames),
+                 (unsigned long long)(t.invalidated_px / t.frames));
+    }
+}
+
+// Bytes held by malloc, arenas and mmap'd blocks; task stacks come from here too
+int64_t heapInUse() {
+    struct mallinfo2 mi = mallinfo2();
+    return (int64_t)(mi.uordblks + mi.hblkhd);
+}
+
+struct FlowRun {
+    AsyncHttp::Request req;
+    std::atomic<int64_t> peak;
+    std::atomic<size_t> answered;   // Completion callbacks run
+    std::atomic<size_t> failed;
+    std::atomic<size_t> finished;   // Flow tasks done with perform()
+    SemaphoreHandle_t hold;         // Holds finished flow tasks until measured
+};
+
+// Runs on the executor while every flow still holds its request
+void onFlowDone(FlowRun& run, const AsyncHttp::Response& resp) {
+    int64_t now = heapInUse();
+    int64_t prev = run.peak.load();
+    while (now > prev && !run.peak.compare_exchange_weak(prev, now)) {}
+    if (resp.err != ESP_OK || resp.status <= 0) {
+        run.failed++;
+    }
+    run.answered++;
+}
+
+void flowTask(void* arg) {
+    FlowRun& run = *static_cast<FlowRun*>(arg);
+    if (!AsyncHttp::instance().perform(run.req, [&run](const AsyncHttp::Response& resp) {
+            onFlowDone(run, resp);
+        })) {
+        run.failed++;
+        run.answered++;
+    }
+    run.finished++;
+    xSemaphoreTake(run.hold, portMAX_DELAY);
+    vTaskDelete(nullptr);
+}
+
+bool waitFor(const std::atomic<size_t>& count, size_t target, int64_t deadline_us) {
+    while (count.load() < target) {
+        if (esp_timer_get_time() > deadline_us) {
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    return true;
+}
+
+void logFlows(const char* model, size_t flows, int64_t base, int64_t peak) {
+    int64_t per_flow = (peak - base) / (int64_t)flows;
+    ESP_LOGI(TAG, "   %-14s %7lld B/flow %8.1f flows/MB", model, (long long)per_flow,
+             per_flow > 0 ? (1024.0 * 1024.0) / per_flow : 0.0);
+}
+
+// Any distinct keys will do: nothing is sent
+struct PaymentKeys {
+    char pay_to[48];
+    char fee_payer[48];
+    char mint[48];
+};
+
+void fillKeys(PaymentKeys& keys) {
+    uint8_t key[32];
+    memset(key, 0x22, sizeof(key));
+    CryptoUtils::bytesToBase58(key, 32, keys.pay_to, sizeof(keys.pay_to));
+    memset(key, 0x33, sizeof(key));
+    CryptoUtils::bytesToBase58(key, 32, keys.fee_payer, sizeof(keys.fee_payer));
+    memset(key, 0x44, sizeof(key));
+    CryptoUtils::bytesToBase58(key, 32, keys.mint, sizeof(keys.mint));
+}
+
+constexpr uint64_t PAYMENT_AMOUNT = 1000;
+
+// A legacy payment message from payer, as the client builds it
+bool buildMessage(const uint8_t payer[32], const PaymentKeys& keys, std::vector<uint8_t>& message) {
+    const uint8_t blockhash[32] = {};
+    SolanaClient solana("");
+    if (!solana.buildTransaction(payer, keys.pay_to, keys.fee_payer, keys.mint, PAYMENT_AMOUNT, 6,
+                                 blockhash, message)) {
+        ESP_LOGE(TAG, "❌ Could not build the benchmark transaction");
+        return false;
+    }
+    return true;
+}
+
+// One payment built, signed and wrapped into an X-PAYMENT header
+struct BuiltPayment {
+    size_t message_bytes;
+    char* header;           // malloc'd
+};
+
+bool buildPayment(SolanaClient& solana, const uint8_t payer_public[32], const uint8_t payer_secret[64],
+                  const PaymentKeys& keys, const AddressLookupTable* table, int policy, BuiltPayment& out) {
+    const uint8_t blockhash[32] = {};
+    SolanaClient::Transfer transfer = {keys.pay_to, PAYMENT_AMOUNT};
+    SolanaClient::ComputeBudget budget = {40000, 1000};
+    std::vector<uint8_t> message;
+    uint8_t signature[64];
+    std::string base64_tx;
+    if (!solana.buildBatchTransaction(payer_public, &transfer, 1, keys.fee_payer, keys.mint, 6,
+                                      blockhash, message, nullptr, table, &budget) ||
+        !CryptoUtils::ed25519Sign(signature, message.data(), message.size(), payer_secret, payer_public) ||
+        !solana.buildSignedTransaction(message, signature, base64_tx)) {
+        return false;
+    }
+    out.message_bytes = message.size();
+    out.header = x402::EnabledSchemes::buildHeader(policy, base64_tx.c_str());
+    return out.header != nullptr;
+}
+
+} // namespace
+
+bool Benchmarks::uiFrames(size_t cycles) {
+    TransitionStats rebuilt[MAX_TRANSITIONS];
+    size_t rebuilt_count = 0;
+    FrameProfiler::FrameSample samples[FrameProfiler::MAX_SAMPLES];
+
+    // Before: the baseline widgets, on a display of their own
+    {
+        HeadlessBackend headless;
+        if (!headless.init()) {
+            ESP_LOGE(TAG, "❌ Headless display init failed");
+            return false;
+        }
+        FrameProfiler profiler;
+        headless.lock(0);
+        profiler.attach(headless.display());
+        RebuildScreens screens(headless.display());
+        headless.unlock();
+
+        for (size_t i = 0; i < PUMPS_PER_STEP; i++) headless.pump(UI_FRAME_MS);
+        profiler.reset();
+        for (size_t c = 0; c < cycles; c++) {
+            for (size_t step = 0; step < STEPS; step++) {
+                headless.lock(0);
+                profiler.markTransition(showStep(screens, step));
+                headless.unlock();
+                for (size_t i = 0; i < PUMPS_PER_STEP; i++) headless.pump(UI_FRAME_MS);
+                size_t n = profiler.samples(samples, FrameProfiler::MAX_SAMPLES);
+                profiler.reset();
+                collect(samples, n, rebuilt, rebuilt_count);
+            }
+        }
+        headless.deinit();
+    }
+
+    // After: DisplayManager's retained screens
+    auto backend = std::make_unique<HeadlessBackend>();
+    HeadlessBackend* headless = backend.get();
+    DisplayManager display(std::move(backend));
+    if (!display.init()) {
+        ESP_LOGE(TAG, "❌ Headless display init failed");
+        return false;
+    }
+
+    // Settle the first screen load so it is not charged to a transition
+    for (size_t i = 0; i < PUMPS_PER_STEP; i++) headless->pump(UI_FRAME_MS);
+    display.resetFrameSamples();
+
+    TransitionStats retained[MAX_TRANSITIONS];
+    size_t retained_count = 0;
+    for (size_t c = 0; c < cycles; c++) {
+        for (size_t step = 0; step < STEPS; step++) {
+            showStep(display, step);
+            for (size_t i = 0; i < PUMPS_PER_STEP; i++) headless->pump(UI_FRAME_MS);
+            size_t n = display.frameSamples(samples, FrameProfiler::MAX_SAMPLES);
+            display.resetFrameSamples();
+            collect(samples, n, retained, retained_count);
+        }
+    }
+
+    ESP_LOGI(TAG, "⏱️ UI frames over %zu payment sequences (%ldx%ld, %ld-line buffer):",
+             cycles, (long)headless->width(), (long)headless->height(), (long)HeadlessBackend::BUFFER_LINES);
+    logTransitions("rebuilt", rebuilt, rebuilt_count, cycles);
+    logTransitions("retained", retained, retained_count, cycles);
+    display.deinit();
+    return true;
+}
+
+bool Benchmarks::httpFlows(const char* url, size_t flows) {
+    if (flows == 0 || flows > AsyncHttp::MAX_IN_FLIGHT) {
+        ESP_LOGE(TAG, "❌ %zu flows, the engine runs 1..%zu at once", flows, AsyncHttp::MAX_IN_FLIGHT);
+        return false;
+    }
+    AsyncHttp& http = AsyncHttp::instance();    // Executor and workers exist before the baseline
+    auto run = std::make_unique<FlowRun>();
+    run->req.url = url;
+    int64_t timeout_us = (int64_t)(run->req.timeout_ms + 5000) * 1000;
+
+    // Executor model: every flow is a submitted request and nothing else
+    run->peak = heapInUse();
+    int64_t base = run->peak;
+    for (size_t i = 0; i < flows; i++) {
+        FlowRun* r = run.get();
+        if (!http.submit(r->req, [r](const AsyncHttp::Response& resp) { onFlowDone(*r, resp); })) {
+            run->failed++;
+            run->answered++;
+        }
+    }
+    if (!waitFor(run->answered, flows, esp_timer_get_time() + timeout_us)) {
+        ESP_LOGE(TAG, "❌ HTTP flows did not finish");
+        return false;
+    }
+    while (http.inFlight() > 0) vTaskDelay(pdMS_TO_TICKS(10));
+    int64_t executor_peak = run->peak;
+    size_t failed = run->failed;
+
+    // Task-per-payment model: each flow also holds a task blocked in perform()
+    run->hold = xSemaphoreCreateCounting(flows, 0);
+    run->answered = 0;
+    run->failed = 0;
+    run->peak = heapInUse();
+    int64_t task_base = run->peak;
+    size_t started = 0;
+    for (; started < flows; started++) {
+        if (xTaskCreate(flowTask, "bench_flow", FLOW_TASK_STACK, run.get(), 5, nullptr) != pdPASS) {
+            break;
+        }
+    }
+    bool done = started == flows && waitFor(run->finished, flows, esp_timer_get_time() + timeout_us);
+    for (size_t i = 0; i < started; i++) xSemaphoreGive(run->hold);
+    if (!done) {
+        // Tasks that are still running hold run; leak it rather than free it under them
+        ESP_LOGE(TAG, "❌ Flow tasks did not finish");
+        run.release();
+        return false;
+    }
+    vTaskDelay(pdMS_TO_TICKS(50));          // Let the released tasks exit
+    vSemaphoreDelete(run->hold);
+    failed += run->failed;
+
+    if (failed > 0) {
+        ESP_LOGE(TAG, "❌ %zu of %zu requests to %s failed (is tools/standin_merchant.py running?)",
+                 failed, 2 * flows, url);
+        return false;
+    }
+    // esp_http_client is async only over TLS: plain HTTP requests run on
+    // the blocking workers, BLOCKING_WORKERS at a time, so the submitted
+    // side measures that path and not the executor's
+    const bool tls = strncmp(url, "https", 5) == 0;
+    ESP_LOGI(TAG, "⏱️ Heap per concurrent flow, %zu flows against %s:", flows, url);
+    if (!tls) {
+        ESP_LOGW(TAG, "⚠️ Plain HTTP: submitted flows ran on the %zu blocking workers, not the executor",
+                 AsyncHttp::BLOCKING_WORKERS);
+    }
+    logFlows(tls ? "executor" : "http-workers", flows, base, executor_peak);
+    logFlows("task-per-flow", flows, task_base, run->peak);
+    return true;
+}
+
+bool Benchmarks::transactionParse(size_t iterations) {
+    // Nothing is signed
+    uint8_t payer[32];
+    memset(payer, 0x11, sizeof(payer));
+    PaymentKeys keys;
+    fillKeys(keys);
+    std::vector<uint8_t> message;
+    if (!buildMessage(payer, keys, message)) {
+        return false;
+    }
+    // Fee payer and payer signatures, left zero
+    std::vector<uint8_t> wire(1 + 64 * 2, 0);
+    wire[0] = 2;
+    wire.insert(wire.end(), message.begin(), message.end());
+
+    TransactionView::benchmark(wire.data(), wire.size(), iterations);
+    return true;
+}
+
+bool Benchmarks::paymentVerify(size_t count) {
+    // The payer has to sign for real, or every header is rejected
+    static const uint8_t seed[32] = {0x55};
+    uint8_t payer_public[32], payer_secret[64];
+    crypto_sign_seed_keypair(payer_public, payer_secret, seed);
+
+    PaymentKeys keys;
+    fillKeys(keys);
+    std::vector<uint8_t> message;
+    if (!buildMessage(payer_public, keys, message)) {
+        return false;
+    }
+    uint8_t signature[64];
+    std::string base64_tx;
+    if (!CryptoUtils::ed25519Sign(signature, message.data(), message.size(), payer_secret, payer_public) ||
+        !SolanaClient("").buildSignedTransaction(message, signature, base64_tx)) {
+        ESP_LOGE(TAG, "❌ Could not sign the benchmark transaction");
+        return false;
+    }
+
+    const char* network = x402::DEVNET_ENABLED ? x402::Devnet::NAME : x402::Mainnet::NAME;
+    int policy = x402::EnabledSchemes::match(x402::SolanaExact::NAME, network);
+    char* header = x402::EnabledSchemes::buildHeader(policy, base64_tx.c_str());
+    if (!header) {
+        ESP_LOGE(TAG, "❌ Could not encode the benchmark header");
+        return false;
+    }
+
+    PaymentVerifier::Offer offer = {network, keys.pay_to, keys.mint, keys.fee_payer,
+                                    PAYMENT_AMOUNT, nullptr};
+    PaymentVerifier::benchmark(offer, header, count);
+    free(header);
+    return true;
+}
+
+bool Benchmarks::versionedTx(const char* url, size_t builds, size_t submits) {
+    static const uint8_t seed[32] = {0x66};
+    uint8_t payer_public[32], payer_secret[64];
+    crypto_sign_seed_keypair(payer_public, payer_secret, seed);
+    PaymentKeys keys;
+    fillKeys(keys);
+
+    // The table the client would be configured with: both token accounts and the mint
+    SolanaClient solana("");
+    auto table = std::make_unique<AddressLookupTable>();
+    memset(table->address, 0x77, 32);
+    uint8_t pay_to[32], bump;
+    bool derived = CryptoUtils::base58ToBytes(keys.mint, table->addresses[0]) &&
+                   CryptoUtils::base58ToBytes(keys.pay_to, pay_to) &&
+                   solana.deriveAssociatedTokenAddress(payer_public, table->addresses[0],
+                                                       table->addresses[1], &bump) &&
+                   solana.deriveAssociatedTokenAddress(pay_to, table->addresses[0],
+                                                       table->addresses[2], &bump);
+    table->count = 3;
+    table->valid = true;
+    if (!derived) {
+        ESP_LOGE(TAG, "❌ Could not derive the lookup table accounts");
+        return false;
+    }
+
+    const char* network = x402::DEVNET_ENABLED ? x402::Devnet::NAME : x402::Mainnet::NAME;
+    int policy = x402::EnabledSchemes::match(x402::SolanaExact::NAME, network);
+    HttpClient http(HttpClientConfig{"x402-bench/1.0"});
+    AsyncHttp::Sink sink = [](const char*, size_t) { return true; };   // Content is not checked
+
+    // SolanaClient logs every build; keep that out of the timings
+    esp_log_level_set("SolanaClient", ESP_LOG_WARN);
+    bool ok = true;
+    ESP_LOGI(TAG, "⏱️ Legacy vs v0 payment, %zu builds%s:", builds, url && url[0] ? ", submitted to" : "");
+    if (url && url[0]) ESP_LOGI(TAG, "   %s", url);
+    ESP_LOGI(TAG, "   %-7s %9s %12s %9s %12s %12s", "version", "msg_bytes", "header_bytes", "build_us",
+             "submit_p50us", "submit_avgus");
+    const AddressLookupTable* modes[] = {nullptr, table.get()};
+    for (const AddressLookupTable* mode : modes) {
+        BuiltPayment payment = {};
+        int64_t start = esp_timer_get_time();
+        for (size_t i = 0; i < builds; i++) {
+            free(payment.header);
+            payment.header = nullptr;
+            if (!buildPayment(solana, payer_public, payer_secret, keys, mode, policy, payment)) {
+                ESP_LOGE(TAG, "❌ Could not build the benchmark payment");
+                ok = false;
+                break;
+            }
+        }
+        if (!ok) {
+            free(payment.header);
+            break;
+        }
+        int64_t build_us = (esp_timer_get_time() - start) / (int64_t)builds;
+
+        std::vector<int64_t> submit_us;
+        for (size_t i = 0; url && url[0] && i < submits; i++) {
+            HttpClient::StreamResult result;
+            start = esp_timer_get_time();
+            if (!http.submit_payment_stream(url, payment.header, sink, &result)) {
+                ESP_LOGE(TAG, "❌ Submit to %s failed (%d; is tools/standin_merchant.py running?)",
+                         url, result.status);
+                ok = false;
+                break;
+            }
+            submit_us.push_back(esp_timer_get_time() - start);
+        }
+        if (!ok) {
+            free(payment.header);
+            break;
+        }
+        int64_t p50 = 0, avg = 0;
+        if (!submit_us.empty()) {
+            std::sort(submit_us.begin(), submit_us.end());
+            p50 = submit_us[submit_us.size() / 2];
+            for (int64_t us : submit_us) avg += us;
+            avg /= (int64_t)submit_us.size();
+        }
+        ESP_LOGI(TAG, "   %-7s %9zu %12zu %9lld %12lld %12lld", mode ? "v0" : "legacy",
+                 payment.message_bytes, strlen(payment.header), (long long)build_us,
+                 (long long)p50, (long long)avg);
+        free(payment.header);
+    }
+    esp_log_level_set("SolanaClient", ESP_LOG_INFO);
+    return ok;
+}
+
+bool Benchmarks::run() {
+    ESP_LOGI(TAG, "🏁 Running host benchmarks");
+    bool ok = uiFrames();
+    ok = transactionParse() && ok;
+    ok = paymentVerify() && ok;
+    ConfigManager::benchmark(ConfigManager::BLOB_SOURCE, ConfigManager::JSON_PATH);
+
+    // Lock rounds with and without payer wallets; any seed will do
+    static const uint8_t seed[32] = {0x42};
+    PayerWallets::simulate(seed, SHARD_WALLETS, SHARD_PAYMENTS);
+#if CONFIG_X402_BENCHMARKS
+    if (strlen(CONFIG_X402_BENCHMARKS_HTTP_URL) > 0) {
+        ok = httpFlows(CONFIG_X402_BENCHMARKS_HTTP_URL) && ok;
+    }
+    ok = versionedTx(CONFIG_X402_BENCHMARKS_HTTP_URL) && ok;
+#else
+    ok = versionedTx(nullptr) && ok;
+#endif
+    ESP_LOGI(TAG, "%s Benchmarks %s", ok ? "✅" : "❌", ok ? "done" : "failed");
+    return ok;
+}
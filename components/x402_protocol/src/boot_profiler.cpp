@@ -0,0 +1,70 @@
+#include "boot_profiler.h"
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <cstring>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char* TAG = "Boot";
+
+namespace {
+
+struct PhaseEntry {
+    const char* phase;
+    const char* task;
+    int64_t at_us;
+};
+
+PhaseEntry s_phases[BootProfiler::MAX_PHASES];
+size_t s_num_phases = 0;
+portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+} // namespace
+
+void BootProfiler::mark(const char* phase) {
+    // esp_timer starts counting at boot, before app_main
+    int64_t now = esp_timer_get_time();
+    const char* task = pcTaskGetName(nullptr);
+
+    portENTER_CRITICAL(&s_lock);
+    if (s_num_phases < MAX_PHASES) {
+        s_phases[s_num_phases++] = { phase, task, now };
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+int64_t BootProfiler::elapsedMs(const char* phase) {
+    int64_t at_us = -1;
+    portENTER_CRITICAL(&s_lock);
+    for (size_t i = 0; i < s_num_phases; i++) {
+        if (s_phases[i].phase == phase || strcmp(s_phases[i].phase, phase) == 0) {
+            at_us = s_phases[i].at_us;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return at_us < 0 ? -1 : at_us / 1000;
+}
+
+void BootProfiler::dump() {
+    PhaseEntry snapshot[MAX_PHASES];
+    portENTER_CRITICAL(&s_lock);
+    size_t n = s_num_phases;
+    memcpy(snapshot, s_phases, n * sizeof(PhaseEntry));
+    portEXIT_CRITICAL(&s_lock);
+
+    ESP_LOGI(TAG, "⏱️ Boot timeline (%zu phases):", n);
+    int64_t prev_us = 0;
+    for (size_t i = 0; i < n; i++) {
+        ESP_LOGI(TAG, "  %6lld ms  (+%5lld)  %-18s [%s]",
+                 (long long)(snapshot[i].at_us / 1000),
+                 (long long)((snapshot[i].at_us - prev_us) / 1000),
+                 snapshot[i].phase, snapshot[i].task);
+        prev_us = snapshot[i].at_us;
+    }
+}
+
+void BootProfiler::finish(const char* phase) {
+    mark(phase);
+    dump();
+}
@@ -1,13 +1,130 @@
 // main/config_manager.cpp
 #include "config_manager.h"
+#include "config_blob.h"
 #include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_system.h>
+#include <esp_rom_crc.h>
 #include <cJSON.h>
+#include <algorithm>
 #include <cstring>
+#if CONFIG_IDF_TARGET_LINUX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <esp_partition.h>
 #include "esp_spiffs.h"
+#endif
 
 static const char* TAG = "ConfigManager";
 
+namespace {
+
+// Read-only view of the blob; stays mapped once a load succeeds
+struct BlobMapping {
+    const uint8_t* data;
+    size_t len;
+#if CONFIG_IDF_TARGET_LINUX
+    void* addr;
+#else
+    esp_partition_mmap_handle_t handle;
+#endif
+};
+
+bool mapBlob(const char* source, BlobMapping& m) {
+#if CONFIG_IDF_TARGET_LINUX
+    int fd = open(source, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    m.addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (m.addr == MAP_FAILED) {
+        return false;
+    }
+    m.data = static_cast<const uint8_t*>(m.addr);
+    m.len = st.st_size;
+    return true;
+#else
+    const esp_partition_t* part = esp_partition_find_first(
+        ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, source);
+    if (!part) {
+        return false;
+    }
+    const void* ptr = nullptr;
+    if (esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA, &ptr, &m.handle) != ESP_OK) {
+        return false;
+    }
+    m.data = static_cast<const uint8_t*>(ptr);
+    m.len = part->size;
+    return true;
+#endif
+}
+
+void unmapBlob(BlobMapping& m) {
+#if CONFIG_IDF_TARGET_LINUX
+    munmap(m.addr, m.len);
+#else
+    esp_partition_munmap(m.handle);
+#endif
+    m.data = nullptr;
+}
+
+bool validateBlob(const BlobMapping& m, const char* strings[ConfigBlob::STRING_COUNT]) {
+    const ConfigBlob* blob = reinterpret_cast<const ConfigBlob*>(m.data);
+    if (m.len < sizeof(ConfigBlob) || blob->magic != ConfigBlob::MAGIC) {
+        ESP_LOGW(TAG, "⚠️ No config blob found");
+        return false;
+    }
+    if (blob->version != ConfigBlob::VERSION) {
+        ESP_LOGW(TAG, "⚠️ Config blob version %u, expected %u", blob->version, ConfigBlob::VERSION);
+        return false;
+    }
+    if (blob->size < sizeof(ConfigBlob) || blob->size > m.len) {
+        ESP_LOGW(TAG, "⚠️ Config blob size %lu out of range", (unsigned long)blob->size);
+        return false;
+    }
+    uint32_t crc = esp_rom_crc32_le(0, m.data + ConfigBlob::CRC_OFFSET, blob->size - ConfigBlob::CRC_OFFSET);
+    if (crc != blob->crc32) {
+        ESP_LOGW(TAG, "⚠️ Config blob CRC mismatch");
+        return false;
+    }
+
+    size_t count = std::min<size_t>(blob->string_count, ConfigBlob::STRING_COUNT);
+    for (size_t i = 0; i < ConfigBlob::STRING_COUNT; i++) {
+        strings[i] = nullptr;
+        uint16_t off = (i < count) ? blob->string_offsets[i] : 0;
+        if (off == 0) {
+            continue;
+        }
+        // Each string must start in the table and end before the blob does
+        if (off < sizeof(ConfigBlob) || off >= blob->size ||
+            !memchr(m.data + off, '\0', blob->size - off)) {
+            ESP_LOGW(TAG, "⚠️ Config blob string %u is malformed", (unsigned)i);
+            return false;
+        }
+        strings[i] = reinterpret_cast<const char*>(m.data + off);
+    }
+    return true;
+}
+
+} // namespace
+
 bool ConfigManager::init() {
+#if CONFIG_IDF_TARGET_LINUX
+    return true;                // JSON_PATH is an ordinary file on the host
+#else
+    if (esp_spiffs_mounted("storage")) {
+        return true;
+    }
+
     ESP_LOGI(TAG, "📂 Mounting SPIFFS...");
 
     esp_vfs_spiffs_conf_t conf = {
@@ -28,6 +145,7 @@ bool ConfigManager::init() {
     ESP_LOGI(TAG, "✅ SPIFFS mounted: total=%d bytes, used=%d bytes", total, used);
 
     return true;
+#endif
 }
 
 bool ConfigManager::load(const char* path, X402Config& cfg) {
@@ -63,10 +181,19 @@ bool ConfigManager::load(const char* path, X402Config& cfg) {
     GET_STR(solana_rpc_url, "solana_rpc_url");
     GET_STR(user_agent, "user_agent");
     GET_STR(token_mint, "token_mint");
+    GET_STR(nonce_account, "nonce_account");
+    GET_STR(lookup_table, "lookup_table");
+    GET_STR(network, "network");
 
     cJSON* dec = cJSON_GetObjectItem(root, "token_decimals");
     if (dec && cJSON_IsNumber(dec)) cfg.token_decimals = dec->valueint;
 
+    cJSON* fee_target = cJSON_GetObjectItem(root, "fee_target_ms");
+    if (fee_target && cJSON_IsNumber(fee_target)) cfg.fee_target_ms = fee_target->valueint;
+
+    cJSON* wallets = cJSON_GetObjectItem(root, "payer_wallets");
+    if (wallets && cJSON_IsNumber(wallets)) cfg.payer_wallets = wallets->valueint;
+
     // Load 32-byte keys
     auto load_bytes = [](uint8_t* dest, cJSON* arr) {
         if (!arr || !cJSON_IsArray(arr) || cJSON_GetArraySize(arr) != 32) return false;
@@ -83,3 +210,85 @@ bool ConfigManager::load(const char* path, X402Config& cfg) {
     ESP_LOGI(TAG, "✅ Configuration loaded successfully from %s", path);
     return true;
 }
+
+bool ConfigManager::loadBinary(const char* source, X402Config& cfg) {
+    BlobMapping m = {};
+    if (!mapBlob(source, m)) {
+        ESP_LOGW(TAG, "⚠️ Config blob source not found: %s", source);
+        return false;
+    }
+
+    const char* strings[ConfigBlob::STRING_COUNT];
+    if (!validateBlob(m, strings)) {
+        unmapBlob(m);
+        return false;
+    }
+
+    const ConfigBlob* blob = reinterpret_cast<const ConfigBlob*>(m.data);
+    cfg.wifi_ssid      = strings[ConfigBlob::WIFI_SSID];
+    cfg.wifi_password  = strings[ConfigBlob::WIFI_PASSWORD];
+    cfg.payai_url      = strings[ConfigBlob::PAYAI_URL];
+    cfg.solana_rpc_url = strings[ConfigBlob::SOLANA_RPC_URL];
+    cfg.user_agent     = strings[ConfigBlob::USER_AGENT];
+    cfg.token_mint     = strings[ConfigBlob::TOKEN_MINT];
+    cfg.nonce_account  = strings[ConfigBlob::NONCE_ACCOUNT];
+    cfg.lookup_table   = strings[ConfigBlob::LOOKUP_TABLE];
+    cfg.network        = strings[ConfigBlob::NETWORK];
+    cfg.token_decimals = blob->token_decimals;
+    cfg.fee_target_ms  = blob->fee_target_ms;
+    cfg.payer_wallets  = blob->payer_wallets;
+    memcpy(cfg.payer_private_key, blob->payer_private_key, 32);
+    memcpy(cfg.payer_public_key, blob->payer_public_key, 32);
+
+    // Intentionally left mapped: the config strings live in the mapping
+    ESP_LOGI(TAG, "✅ Configuration loaded from blob %s (%lu bytes)", source, (unsigned long)blob->size);
+    return true;
+}
+
+static bool sameString(const char* a, const char* b) {
+    return (!a && !b) || (a && b && strcmp(a, b) == 0);
+}
+
+void ConfigManager::benchmark(const char* blob_source, const char* json_path) {
+    X402Config bin_cfg = {};
+    X402Config json_cfg = {};
+
+    size_t heap_before = esp_get_free_heap_size();
+    int64_t t0 = esp_timer_get_time();
+    bool bin_ok = loadBinary(blob_source, bin_cfg);
+    int64_t bin_us = esp_timer_get_time() - t0;
+    size_t bin_heap = heap_before - esp_get_free_heap_size();
+
+    heap_before = esp_get_free_heap_size();
+    t0 = esp_timer_get_time();
+    bool json_ok = init() && load(json_path, json_cfg);
+    int64_t json_us = esp_timer_get_time() - t0;
+    size_t json_heap = heap_before - esp_get_free_heap_size();
+
+    ESP_LOGI(TAG, "⏱️ Config blob: %s in %lld us, %zu heap bytes kept",
+             bin_ok ? "ok" : "failed", (long long)bin_us, bin_heap);
+    ESP_LOGI(TAG, "⏱️ Config JSON: %s in %lld us (SPIFFS mount + parse), %zu heap bytes kept",
+             json_ok ? "ok" : "failed", (long long)json_us, json_heap);
+
+    if (bin_ok && json_ok) {
+        bool same = sameString(bin_cfg.wifi_ssid, json_cfg.wifi_ssid) &&
+                    sameString(bin_cfg.wifi_password, json_cfg.wifi_password) &&
+                    sameString(bin_cfg.payai_url, json_cfg.payai_url) &&
+                    sameString(bin_cfg.solana_rpc_url, json_cfg.solana_rpc_url) &&
+                    sameString(bin_cfg.user_agent, json_cfg.user_agent) &&
+                    sameString(bin_cfg.token_mint, json_cfg.token_mint) &&
+                    sameString(bin_cfg.nonce_account, json_cfg.nonce_account) &&
+                    sameString(bin_cfg.lookup_table, json_cfg.lookup_table) &&
+                    sameString(bin_cfg.network, json_cfg.network) &&
+                    bin_cfg.token_decimals == json_cfg.token_decimals &&
+                    bin_cfg.fee_target_ms == json_cfg.fee_target_ms &&
+                    bin_cfg.payer_wallets == json_cfg.payer_wallets &&
+                    memcmp(bin_cfg.payer_private_key, json_cfg.payer_private_key, 32) == 0 &&
+                    memcmp(bin_cfg.payer_public_key, json_cfg.payer_public_key, 32) == 0;
+        if (same) {
+            ESP_LOGI(TAG, "✅ Blob and JSON configurations match");
+        } else {
+            ESP_LOGW(TAG, "⚠️ Blob and JSON configurations differ, rebuild the blob");
+        }
+    }
+}
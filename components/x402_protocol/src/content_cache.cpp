@@ -0,0 +1,496 @@
+#include "content_cache.h"
+#include "metrics.h"
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <sodium.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <strings.h>
+#include <unistd.h>
+
+static const char* TAG = "ContentCache";
+
+static constexpr uint32_t DISK_MAGIC = 0x31434350;   // "PCC1"
+static constexpr const char* FILE_PREFIX = "pc_";
+
+namespace {
+
+struct MutexGuard {
+    SemaphoreHandle_t m;
+    explicit MutexGuard(SemaphoreHandle_t mutex) : m(mutex) { xSemaphoreTake(m, portMAX_DELAY); }
+    ~MutexGuard() { xSemaphoreGive(m); }
+};
+
+// Header of an entry file; the content follows it
+struct DiskHeader {
+    uint32_t magic;
+    uint32_t len;
+    uint8_t key[32];
+    int64_t expires_unix;
+    uint8_t revalidate;
+    uint8_t reserved[7];
+    char etag[sizeof(AsyncHttp::Headers::etag)];
+    char last_modified[sizeof(AsyncHttp::Headers::last_modified)];
+};
+
+// Before SNTP the clock starts at 1970, which would make every expiry look far off
+bool wallClockValid() {
+    return time(nullptr) > 1700000000;
+}
+
+// IMF-fixdate as used by Date/Expires/Last-Modified: "Sun, 06 Nov 1994 08:49:37 GMT"
+bool parseHttpDate(const char* s, int64_t* out) {
+    static const char* MONTHS = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    char mon[4] = {};
+    int d, y, hh, mm, ss;
+    if (!s[0] || sscanf(s, "%*3s, %d %3s %d %d:%d:%d", &d, mon, &y, &hh, &mm, &ss) != 6) {
+        return false;
+    }
+    const char* m = strstr(MONTHS, mon);
+    if (!m || strlen(mon) != 3) {
+        return false;
+    }
+    int month = (int)(m - MONTHS) / 3 + 1;
+
+    // Days from civil (proleptic Gregorian), no timegm() in newlib
+    int yy = y - (month <= 2);
+    int era = (yy >= 0 ? yy : yy - 399) / 400;
+    int yoe = yy - era * 400;
+    int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int64_t days = (int64_t)era * 146097 + doe - 719468;
+    *out = days * 86400 + hh * 3600 + mm * 60 + ss;
+    return true;
+}
+
+}  // namespace
+
+ContentCache::ContentCache()
+    : ram_{}
+    , ram_bytes_(0)
+    , disk_{}
+    , disk_bytes_(0)
+    , clock_(0)
+    , dir_{}
+    , disk_ready_(false)
+    , hits_(0)
+    , lookups_(0)
+    , mutex_(xSemaphoreCreateMutex())
+{
+}
+
+ContentCache::~ContentCache() {
+    for (RamEntry& e : ram_) {
+        free(e.data);
+    }
+    if (mutex_) {
+        vSemaphoreDelete(mutex_);
+    }
+}
+
+void ContentCache::makeKey(const char* url, const char* scope, uint8_t key[32]) {
+    crypto_hash_sha256_state st;
+    crypto_hash_sha256_init(&st);
+    crypto_hash_sha256_update(&st, reinterpret_cast<const uint8_t*>(url), strlen(url) + 1);
+    crypto_hash_sha256_update(&st, reinterpret_cast<const uint8_t*>(scope), strlen(scope));
+    crypto_hash_sha256_final(&st, key);
+}
+
+bool ContentCache::applyHeaders(const AsyncHttp::Headers& headers, Meta& meta) {
+    bool no_cache = false;
+    int64_t max_age = -1;
+
+    char directives[sizeof(headers.cache_control)];
+    strcpy(directives, headers.cache_control);
+    char* save = nullptr;
+    for (char* tok = strtok_r(directives, ",", &save); tok; tok = strtok_r(nullptr, ",", &save)) {
+        while (*tok == ' ') tok++;
+        if (strcasecmp(tok, "no-store") == 0) {
+            return false;
+        } else if (strcasecmp(tok, "no-cache") == 0) {
+            no_cache = true;
+        } else if (strncasecmp(tok, "max-age=", 8) == 0) {
+            max_age = strtoll(tok + 8, nullptr, 10);
+        }
+    }
+
+    // max-age wins over Expires; Expires - Date needs no synchronized clock
+    int64_t expires, date;
+    int64_t lifetime = DEFAULT_MAX_AGE_S;
+    if (max_age >= 0) {
+        lifetime = max_age;
+    } else if (parseHttpDate(headers.expires, &expires)) {
+        if (parseHttpDate(headers.date, &date)) {
+            lifetime = expires - date;
+        } else if (wallClockValid()) {
+            lifetime = expires - time(nullptr);
+        } else {
+            lifetime = 0;
+        }
+    } else if (headers.expires[0]) {
+        lifetime = 0;   // Invalid Expires means already expired
+    }
+    if (lifetime < 0) {
+        lifetime = 0;
+    }
+
+    meta.revalidate = no_cache;
+    strcpy(meta.etag, headers.etag);
+    strcpy(meta.last_modified, headers.last_modified);
+    if ((no_cache || lifetime == 0) && !meta.etag[0] && !meta.last_modified[0]) {
+        return false;   // Could never be reused without a full download
+    }
+    meta.fresh_until_us = esp_timer_get_time() + lifetime * 1000000;
+    meta.expires_unix = wallClockValid() ? time(nullptr) + lifetime : 0;
+    return true;
+}
+
+bool ContentCache::isFresh(const Meta& meta) {
+    return !meta.revalidate && !isExpired(meta);
+}
+
+bool ContentCache::isExpired(const Meta& meta) {
+    // Stored this boot: the monotonic timer is authoritative
+    if (meta.fresh_until_us) {
+        return esp_timer_get_time() >= meta.fresh_until_us;
+    }
+    return !(meta.expires_unix && wallClockValid() && time(nullptr) < meta.expires_unix);
+}
+
+ContentCache::RamEntry* ContentCache::findRam(const uint8_t key[32]) {
+    for (RamEntry& e : ram_) {
+        if (e.data && memcmp(e.meta.key, key, 32) == 0) {
+            return &e;
+        }
+    }
+    return nullptr;
+}
+
+ContentCache::DiskEntry* ContentCache::findDisk(const uint8_t key[32]) {
+    for (DiskEntry& e : disk_) {
+        if (e.len && memcmp(e.key, key, 32) == 0) {
+            return &e;
+        }
+    }
+    return nullptr;
+}
+
+void ContentCache::dropRam(RamEntry& e) {
+    ram_bytes_ -= e.meta.len;
+    free(e.data);
+    e.data = nullptr;
+}
+
+void ContentCache::evictRam(size_t needed) {
+    while (true) {
+        RamEntry* lru = nullptr;
+        bool slot_free = false;
+        for (RamEntry& e : ram_) {
+            if (!e.data) {
+                slot_free = true;
+            } else if (!lru || e.last_used < lru->last_used) {
+                lru = &e;
+            }
+        }
+        if ((slot_free && ram_bytes_ + needed <= RAM_BUDGET) || !lru) {
+            return;
+        }
+        dropRam(*lru);
+        Metrics::increment("cache.ram_evicted");
+    }
+}
+
+void ContentCache::insertRam(const Meta& meta, const char* content) {
+    if (RamEntry* old = findRam(meta.key)) {
+        dropRam(*old);
+    }
+    evictRam(meta.len);
+
+    char* data = (char*)malloc(meta.len + 1);
+    if (!data) {
+        return;
+    }
+    memcpy(data, content, meta.len);
+    data[meta.len] = '\0';
+    for (RamEntry& e : ram_) {
+        if (!e.data) {
+            e.meta = meta;
+            e.data = data;
+            e.last_used = ++clock_;
+            ram_bytes_ += meta.len;
+            return;
+        }
+    }
+    free(data);
+}
+
+void ContentCache::pathFor(const uint8_t key[32], char* out, size_t cap) const {
+    int n = snprintf(out, cap, "%s/%s", dir_, FILE_PREFIX);
+    for (size_t i = 0; i < 8 && n + 2 < (int)cap; i++) {
+        n += snprintf(out + n, cap - n, "%02x", key[i]);
+    }
+}
+
+bool ContentCache::openDisk(const char* dir) {
+    if (!mutex_ || strlen(dir) >= sizeof(dir_)) {
+        return false;
+    }
+    MutexGuard guard(mutex_);
+    strcpy(dir_, dir);
+#if CONFIG_IDF_TARGET_LINUX
+    mkdir(dir, 0755);
+#endif
+    DIR* d = opendir(dir);
+    if (!d) {
+        ESP_LOGW(TAG, "⚠️ Cache directory %s unavailable, RAM tier only", dir);
+        return false;
+    }
+
+    size_t count = 0;
+    struct dirent* ent;
+    while ((ent = readdir(d)) != nullptr) {
+        if (strncmp(ent->d_name, FILE_PREFIX, strlen(FILE_PREFIX)) != 0) continue;
+
+        char path[96];
+        snprintf(path, sizeof(path), "%s/%s", dir, ent->d_name);
+        FILE* f = fopen(path, "rb");
+        DiskHeader h;
+        bool valid = f && fread(&h, sizeof(h), 1, f) == 1 &&
+                     h.magic == DISK_MAGIC && h.len > 0 && h.len <= MAX_ENTRY_BYTES;
+        if (f) fclose(f);
+        if (!valid || count == MAX_DISK_ENTRIES || disk_bytes_ + h.len > DISK_BUDGET) {
+            unlink(path);
+            continue;
+        }
+        DiskEntry& e = disk_[count++];
+        memcpy(e.key, h.key, 32);
+        e.len = h.len;
+        e.last_used = 0;        // Recency is not persisted
+        disk_bytes_ += h.len;
+    }
+    closedir(d);
+
+    disk_ready_ = true;
+    Metrics::observe("cache.disk_bytes", disk_bytes_);
+    ESP_LOGI(TAG, "🗄️ Disk cache: %zu entries, %zu bytes", count, disk_bytes_);
+    return true;
+}
+
+bool ContentCache::readDisk(const uint8_t key[32], Meta& meta, char** content) {
+    char path[96];
+    pathFor(key, path, sizeof(path));
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+
+    DiskHeader h;
+    char* data = nullptr;
+    bool ok = fread(&h, sizeof(h), 1, f) == 1 && h.magic == DISK_MAGIC &&
+              memcmp(h.key, key, 32) == 0 && h.len <= MAX_ENTRY_BYTES &&
+              (data = (char*)malloc(h.len + 1)) != nullptr &&
+              fread(data, 1, h.len, f) == h.len;
+    fclose(f);
+    if (!ok) {
+        free(data);
+        return false;
+    }
+    data[h.len] = '\0';
+
+    memcpy(meta.key, key, 32);
+    meta.len = h.len;
+    meta.fresh_until_us = 0;     // A previous boot's timer means nothing now
+    meta.expires_unix = h.expires_unix;
+    meta.revalidate = h.revalidate;
+    strcpy(meta.etag, h.etag);
+    strcpy(meta.last_modified, h.last_modified);
+    *content = data;
+    return true;
+}
+
+void ContentCache::dropDisk(DiskEntry& e) {
+    char path[96];
+    pathFor(e.key, path, sizeof(path));
+    unlink(path);
+    disk_bytes_ -= e.len;
+    e.len = 0;
+}
+
+void ContentCache::writeDisk(const Meta& meta, const char* content) {
+    if (!disk_ready_) {
+        return;
+    }
+    if (DiskEntry* old = findDisk(meta.key)) {
+        dropDisk(*old);
+    }
+
+    DiskEntry* slot = nullptr;
+    while (true) {
+        DiskEntry* lru = nullptr;
+        slot = nullptr;
+        for (DiskEntry& e : disk_) {
+            if (!e.len) {
+                slot = &e;
+            } else if (!lru || e.last_used < lru->last_used) {
+                lru = &e;
+            }
+        }
+        if ((slot && disk_bytes_ + meta.len <= DISK_BUDGET) || !lru) {
+            break;
+        }
+        dropDisk(*lru);
+        Metrics::increment("cache.disk_evicted");
+    }
+    if (!slot) {
+        return;
+    }
+
+    DiskHeader h = {};
+    h.magic = DISK_MAGIC;
+    h.len = meta.len;
+    memcpy(h.key, meta.key, 32);
+    h.expires_unix = meta.expires_unix;
+    h.revalidate = meta.revalidate;
+    strcpy(h.etag, meta.etag);
+    strcpy(h.last_modified, meta.last_modified);
+
+    char path[96];
+    pathFor(meta.key, path, sizeof(path));
+    FILE* f = fopen(path, "wb");
+    bool ok = f && fwrite(&h, sizeof(h), 1, f) == 1 && fwrite(content, 1, meta.len, f) == meta.len;
+    if (f) ok = (fclose(f) == 0) && ok;
+    if (!ok) {
+        ESP_LOGW(TAG, "⚠️ Failed to write %s", path);
+        unlink(path);
+        return;
+    }
+    memcpy(slot->key, meta.key, 32);
+    slot->len = meta.len;
+    slot->last_used = ++clock_;
+    disk_bytes_ += meta.len;
+    Metrics::observe("cache.disk_bytes", disk_bytes_);
+}
+
+bool ContentCache::get(const char* url, const char* scope, Hit& out) {
+    if (!mutex_) {
+        return false;
+    }
+    uint8_t key[32];
+    makeKey(url, scope, key);
+    MutexGuard guard(mutex_);
+    lookups_++;
+
+    bool from_disk = false;
+    RamEntry* e = findRam(key);
+    if (!e && disk_ready_) {
+        DiskEntry* d = findDisk(key);
+        Meta meta;
+        char* content = nullptr;
+        if (d && readDisk(key, meta, &content)) {
+            insertRam(meta, content);
+            free(content);
+            e = findRam(key);
+            from_disk = true;
+        } else if (d) {
+            dropDisk(*d);
+        }
+    }
+
+    if (e) {
+        hits_++;
+        e->last_used = ++clock_;
+        if (DiskEntry* d = disk_ready_ ? findDisk(key) : nullptr) {
+            d->last_used = clock_;
+        }
+    }
+    Metrics::increment(!e ? "cache.misses" : from_disk ? "cache.hits_disk" : "cache.hits_ram");
+    Metrics::observe("cache.hit_rate_pct", hits_ * 100 / lookups_);
+    if (!e) {
+        return false;
+    }
+
+    out.content = (char*)malloc(e->meta.len + 1);
+    if (!out.content) {
+        return false;
+    }
+    memcpy(out.content, e->data, e->meta.len + 1);
+    out.len = e->meta.len;
+    out.fresh = isFresh(e->meta);
+    out.expired = isExpired(e->meta);
+    strcpy(out.etag, e->meta.etag);
+    strcpy(out.last_modified, e->meta.last_modified);
+    ESP_LOGI(TAG, "💾 %s hit (%zu bytes, %s)", from_disk ? "Disk" : "RAM", out.len,
+             out.fresh ? "fresh" : "stale");
+    return true;
+}
+
+void ContentCache::put(const char* url, const char* scope, const char* content, size_t len,
+                       const AsyncHttp::Headers& headers) {
+    if (!mutex_ || !content || len == 0 || len > MAX_ENTRY_BYTES) {
+        return;
+    }
+    Meta meta = {};
+    makeKey(url, scope, meta.key);
+    meta.len = len;
+    MutexGuard guard(mutex_);
+    if (!applyHeaders(headers, meta)) {
+        removeKey(meta.key);
+        Metrics::increment("cache.not_stored");
+        return;
+    }
+
+    insertRam(meta, content);
+    writeDisk(meta, content);
+    Metrics::observe("cache.ram_bytes", ram_bytes_);
+}
+
+void ContentCache::refresh(const char* url, const char* scope, const AsyncHttp::Headers& headers) {
+    if (!mutex_) {
+        return;
+    }
+    uint8_t key[32];
+    makeKey(url, scope, key);
+    MutexGuard guard(mutex_);
+    RamEntry* e = findRam(key);
+    if (!e) {
+        return;
+    }
+
+    // A 304 may omit validators; keep the ones already held
+    Meta meta = e->meta;
+    AsyncHttp::Headers merged = headers;
+    if (!merged.etag[0]) strcpy(merged.etag, meta.etag);
+    if (!merged.last_modified[0]) strcpy(merged.last_modified, meta.last_modified);
+    if (!applyHeaders(merged, meta)) {
+        removeKey(key);
+        return;
+    }
+    if (!headers.cache_control[0]) {
+        meta.revalidate = e->meta.revalidate;   // Directives not repeated still apply
+    }
+    e->meta = meta;
+    writeDisk(meta, e->data);
+}
+
+void ContentCache::remove(const char* url, const char* scope) {
+    if (!mutex_) {
+        return;
+    }
+    uint8_t key[32];
+    makeKey(url, scope, key);
+    MutexGuard guard(mutex_);
+    removeKey(key);
+}
+
+void ContentCache::removeKey(const uint8_t key[32]) {
+    if (RamEntry* e = findRam(key)) {
+        dropRam(*e);
+    }
+    if (DiskEntry* d = disk_ready_ ? findDisk(key) : nullptr) {
+        dropDisk(*d);
+    }
+}
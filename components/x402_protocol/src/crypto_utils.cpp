@@ -1,6 +1,8 @@
 #include "crypto_utils.h"
+#include "deferred_log.h"
 #include <esp_log.h>
 #include <sodium.h>
+#include <array>
 #include <cstring>
 #include <cstdlib>
 
@@ -86,14 +88,56 @@ bool CryptoUtils::base58ToBytes(const char* base58_str, uint8_t out32[32]) {
         return false;
     }
 
-    ESP_LOGI(TAG, "Decoding Base58 string of length %d: '%s'", (int)len, base58_str);
+    DLOGI(TAG, "Decoding Base58 string of length %d: '%s'", (int)len, base58_str);
     size_t expected_len = 32;
     bool success = base58_decode(out32, &expected_len, base58_str, len);
     if (!success || expected_len != 32) {
         ESP_LOGE(TAG, "Base58 decode failed");
         return false;
     }
-    ESP_LOGI(TAG, "✅ Successfully decoded to 32 bytes");
+    DLOGI(TAG, "✅ Successfully decoded to 32 bytes");
+    return true;
+}
+
+bool CryptoUtils::bytesToBase58(const uint8_t* data, size_t len, char* out, size_t out_size) {
+    static const char b58digits[] =
+        "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+
+    size_t zeros = 0;
+    while (zeros < len && data[zeros] == 0) zeros++;
+
+    // log(256) / log(58) ~= 1.37, so 138/100 + 1 digits per byte is enough
+    size_t size = (len - zeros) * 138 / 100 + 1;
+    uint8_t buf[size];
+    memset(buf, 0, size);
+
+    size_t high = size - 1;
+    for (size_t i = zeros; i < len; i++) {
+        int carry = data[i];
+        size_t j = size - 1;
+        for (;; j--) {
+            carry += 256 * buf[j];
+            buf[j] = carry % 58;
+            carry /= 58;
+            if (j <= high && carry == 0) break;
+            if (j == 0) break;
+        }
+        high = j;
+    }
+
+    size_t skip = 0;
+    while (skip < size && buf[skip] == 0) skip++;
+
+    size_t needed = zeros + (size - skip) + 1;
+    if (needed > out_size) {
+        ESP_LOGE(TAG, "Base58 output buffer too small (%d < %d)", (int)out_size, (int)needed);
+        return false;
+    }
+
+    size_t k = 0;
+    for (; k < zeros; k++) out[k] = '1';
+    for (size_t i = skip; i < size; i++) out[k++] = b58digits[buf[i]];
+    out[k] = '\0';
     return true;
 }
 
@@ -123,6 +167,94 @@ char* CryptoUtils::base64Encode(const unsigned char* data, size_t input_length)
     return encoded_data;
 }
 
+// Sextet per input byte; 0x80 marks bytes outside the alphabet
+static constexpr std::array<uint8_t, 256> BASE64_DECODE = [] {
+    const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::array<uint8_t, 256> table{};
+    for (auto& v : table) v = 0x80;
+    for (uint8_t i = 0; i < 64; i++) table[(uint8_t)alphabet[i]] = i;
+    return table;
+}();
+
+bool CryptoUtils::base64Decode(const char* input, size_t input_length,
+                               uint8_t* out, size_t out_size, size_t* out_len) {
+    if (input_length % 4 != 0) return false;
+
+    size_t pad = 0;
+    if (input_length >= 1 && input[input_length - 1] == '=') {
+        pad = (input_length >= 2 && input[input_length - 2] == '=') ? 2 : 1;
+    }
+    size_t decoded_len = input_length / 4 * 3 - pad;
+    if (decoded_len > out_size) return false;
+
+    // Whole quads: four lookups, one validity test, three stores
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(input);
+    size_t quads = input_length / 4 - (pad ? 1 : 0);
+    uint8_t* o = out;
+    for (size_t q = 0; q < quads; q++, in += 4, o += 3) {
+        uint32_t a = BASE64_DECODE[in[0]];
+        uint32_t b = BASE64_DECODE[in[1]];
+        uint32_t c = BASE64_DECODE[in[2]];
+        uint32_t d = BASE64_DECODE[in[3]];
+        if ((a | b | c | d) & 0x80) return false;
+        uint32_t triple = (a << 18) | (b << 12) | (c << 6) | d;
+        o[0] = triple >> 16;
+        o[1] = triple >> 8;
+        o[2] = triple;
+    }
+
+    if (pad) {
+        uint32_t a = BASE64_DECODE[in[0]];
+        uint32_t b = BASE64_DECODE[in[1]];
+        uint32_t c = (pad == 2) ? 0 : BASE64_DECODE[in[2]];
+        if ((a | b | c) & 0x80) return false;
+        uint32_t triple = (a << 18) | (b << 12) | (c << 6);
+        o[0] = triple >> 16;
+        if (pad == 1) o[1] = triple >> 8;
+    }
+
+    *out_len = decoded_len;
+    return true;
+}
+
+// I = HMAC-SHA512(key, data): IL is the private key, IR the chain code
+static bool slip10Hmac(const uint8_t* key, size_t key_len, const uint8_t* data, size_t data_len,
+                       uint8_t out[64]) {
+    crypto_auth_hmacsha512_state state;
+    if (crypto_auth_hmacsha512_init(&state, key, key_len) != 0) return false;
+    crypto_auth_hmacsha512_update(&state, data, data_len);
+    crypto_auth_hmacsha512_final(&state, out);
+    sodium_memzero(&state, sizeof(state));
+    return true;
+}
+
+bool CryptoUtils::slip10DeriveEd25519(const uint8_t* seed, size_t seed_len,
+                                      const uint32_t* path, size_t depth,
+                                      uint8_t key_out[32]) {
+    static const char CURVE_KEY[] = "ed25519 seed";
+    uint8_t node[64];           // Private key, then chain code
+    if (!slip10Hmac((const uint8_t*)CURVE_KEY, sizeof(CURVE_KEY) - 1, seed, seed_len, node)) {
+        return false;
+    }
+
+    // Hardened child: HMAC(chain code, 0x00 || key || ser32(index | 2^31))
+    uint8_t data[37];
+    bool ok = true;
+    for (size_t level = 0; ok && level < depth; level++) {
+        uint32_t index = path[level] | 0x80000000u;
+        data[0] = 0x00;
+        memcpy(data + 1, node, 32);
+        for (int i = 0; i < 4; i++) data[33 + i] = (index >> (24 - 8 * i)) & 0xff;
+        ok = slip10Hmac(node + 32, 32, data, sizeof(data), node);
+    }
+    if (ok) {
+        memcpy(key_out, node, 32);
+    }
+    sodium_memzero(node, sizeof(node));
+    sodium_memzero(data, sizeof(data));
+    return ok;
+}
+
 bool CryptoUtils::ed25519Sign(
     uint8_t signature[64],
     const uint8_t* message,
@@ -130,7 +262,7 @@ bool CryptoUtils::ed25519Sign(
     const uint8_t secret_key[32],
     const uint8_t public_key[32]
 ) {
-    ESP_LOGI(TAG, "🔐 Signing message (%d bytes) with ed25519...", (int)message_len);
+    DLOGI(TAG, "🔐 Signing message (%d bytes) with ed25519...", (int)message_len);
 
     uint8_t sk64[64];
     memcpy(sk64, secret_key, 32);
@@ -143,7 +275,7 @@ bool CryptoUtils::ed25519Sign(
         return false;
     }
 
-    ESP_LOGI(TAG, "✅ Generated REAL ed25519 signature");
-    ESP_LOG_BUFFER_HEX_LEVEL(TAG, signature, 64, ESP_LOG_INFO);
+    DLOGI(TAG, "✅ Generated REAL ed25519 signature");
+    DLOG_BUFFER_HEX(TAG, signature, 64, ESP_LOG_INFO);
     return true;
 }
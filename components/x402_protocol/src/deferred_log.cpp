@@ -0,0 +1,299 @@
+#include "deferred_log.h"
+#include "metrics.h"
+#include "mpsc_ring.h"
+#include <atomic>
+#include <cinttypes>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char* TAG = "DeferredLog";
+
+static_assert(DeferredLog::PAYLOAD_MAX <= UINT8_MAX, "Record length is one byte");
+
+namespace {
+
+// Static and zero-initialised, so the first log, before anything is started,
+// already has a ring
+MpscRing<DeferredLog::Record, DeferredLog::CAPACITY> s_ring;
+std::atomic<uint32_t> s_dropped{0};
+std::atomic<bool> s_started{false};
+
+#if !CONFIG_X402_DEFERRED_LOG_BINARY
+char levelLetter(esp_log_level_t level) {
+    switch (level) {
+        case ESP_LOG_ERROR:   return 'E';
+        case ESP_LOG_WARN:    return 'W';
+        case ESP_LOG_INFO:    return 'I';
+        case ESP_LOG_DEBUG:   return 'D';
+        case ESP_LOG_VERBOSE: return 'V';
+        default:              return '?';
+    }
+}
+
+// Walks a record's payload one argument at a time
+class ArgReader {
+public:
+    ArgReader(const uint8_t* payload, size_t len) : p_(payload), end_(payload + len) {}
+
+    // Type of the next argument, 0 once the payload is used up
+    uint8_t next(uint64_t& bits, double& real, const uint8_t*& blob, size_t& blob_len) {
+        if (p_ >= end_) return 0;
+        uint8_t type = *p_++;
+        size_t size = 0;
+        switch (type) {
+            case DeferredLog::ARG_INT32:
+            case DeferredLog::ARG_UINT32:  size = 4; break;
+            case DeferredLog::ARG_INT64:
+            case DeferredLog::ARG_UINT64:
+            case DeferredLog::ARG_POINTER:
+            case DeferredLog::ARG_DOUBLE:  size = 8; break;
+            case DeferredLog::ARG_STRING:
+            case DeferredLog::ARG_BYTES:
+                if (p_ >= end_) return 0;
+                blob_len = *p_++;
+                blob = p_;
+                p_ += blob_len;
+                return p_ <= end_ ? type : 0;
+            default:
+                return 0;
+        }
+        if (p_ + size > end_) return 0;
+        if (type == DeferredLog::ARG_INT32) {
+            int32_t v; memcpy(&v, p_, 4); bits = (uint64_t)(int64_t)v;
+        } else if (type == DeferredLog::ARG_UINT32) {
+            uint32_t v; memcpy(&v, p_, 4); bits = v;
+        } else if (type == DeferredLog::ARG_DOUBLE) {
+            memcpy(&real, p_, 8);
+        } else {
+            memcpy(&bits, p_, 8);
+        }
+        p_ += size;
+        return type;
+    }
+
+private:
+    const uint8_t* p_;
+    const uint8_t* end_;
+};
+
+// Appends to a fixed buffer, silently truncating
+struct Line {
+    char* buf;
+    size_t cap;
+    size_t len;
+
+    void add(const char* s, size_t n) {
+        if (len + 1 >= cap) return;
+        if (n > cap - 1 - len) n = cap - 1 - len;
+        memcpy(buf + len, s, n);
+        len += n;
+        buf[len] = '\0';
+    }
+
+    template <typename... Args>
+    void printf(const char* spec, Args... args) {
+        if (len + 1 >= cap) return;
+        int n = snprintf(buf + len, cap - len, spec, args...);
+        if (n > 0) len += (size_t)n < cap - len ? (size_t)n : cap - len - 1;
+    }
+};
+
+// printf for a record: each conversion is re-run by snprintf with the
+// argument's recorded type, so length modifiers in fmt are replaced
+void format(const DeferredLog::Record& record, Line& out) {
+    ArgReader args(record.payload, record.len);
+    const char* f = record.site->fmt;
+    while (*f) {
+        const char* pct = strchr(f, '%');
+        if (!pct) {
+            out.add(f, strlen(f));
+            break;
+        }
+        out.add(f, pct - f);
+        f = pct + 1;
+        if (*f == '%') {
+            out.add("%", 1);
+            f++;
+            continue;
+        }
+
+        // Flags, width and precision are kept; length modifiers are dropped
+        char spec[24] = "%";
+        size_t n = 1;
+        while (*f && strchr("-+ #0123456789.", *f) && n < sizeof(spec) - 4) spec[n++] = *f++;
+        while (*f && strchr("hlLqjzt", *f)) f++;
+        char conv = *f ? *f++ : '\0';
+
+        uint64_t bits = 0;
+        double real = 0;
+        const uint8_t* blob = nullptr;
+        size_t blob_len = 0;
+        uint8_t type = args.next(bits, real, blob, blob_len);
+
+        if (type == 0) {
+            out.add("?", 1);
+        } else if (type == DeferredLog::ARG_BYTES) {
+            for (size_t i = 0; i < blob_len; i++) {
+                out.printf(i == 0 ? "%02x" : (i % 16 == 0 ? "\n%02x" : " %02x"), blob[i]);
+            }
+        } else if (type == DeferredLog::ARG_STRING) {
+            char str[DeferredLog::PAYLOAD_MAX + 1];
+            memcpy(str, blob, blob_len);
+            str[blob_len] = '\0';
+            spec[n++] = 's';
+            spec[n] = '\0';
+            out.printf(spec, str);
+        } else if (type == DeferredLog::ARG_DOUBLE) {
+            spec[n++] = conv;
+            spec[n] = '\0';
+            out.printf(spec, real);
+        } else if (type == DeferredLog::ARG_POINTER) {
+            spec[n++] = conv;
+            spec[n] = '\0';
+            out.printf(spec, (void*)(uintptr_t)bits);
+        } else if (type == DeferredLog::ARG_INT64 || type == DeferredLog::ARG_UINT64) {
+            spec[n++] = 'l';
+            spec[n++] = 'l';
+            spec[n++] = conv;
+            spec[n] = '\0';
+            out.printf(spec, (unsigned long long)bits);
+        } else {
+            spec[n++] = conv;
+            spec[n] = '\0';
+            if (conv == 'c' || conv == 'd' || conv == 'i') {
+                out.printf(spec, (int)(int32_t)bits);
+            } else {
+                out.printf(spec, (unsigned)bits);
+            }
+        }
+    }
+}
+
+void writeText(const DeferredLog::Record& record) {
+    static char text[384];              // Drain task only
+    Line line = {text, sizeof(text), 0};
+    text[0] = '\0';
+    format(record, line);
+    esp_log_level_t level = record.site->level;
+    esp_log_write(level, record.tag, "%c (%" PRIu32 ") %s: %s\n",
+                  levelLetter(level), record.timestamp_ms, record.tag, text);
+}
+
+#else
+// Console drivers turn LF into CRLF (and monitors may eat CR), so frame bytes
+// that look like line endings go out as ESC, byte ^ ESCAPE_XOR
+constexpr uint8_t ESCAPE = 0x1B;
+constexpr uint8_t ESCAPE_XOR = 0x20;
+
+bool needsEscape(uint8_t b) {
+    return b == '\n' || b == '\r' || b == ESCAPE;
+}
+
+// 'D' 'L' level len | id:u32 | ms:u32 | payload | xor of everything before it,
+// then escaped as above
+void writeBinary(const DeferredLog::Record& record) {
+    uint8_t frame[4 + 8 + DeferredLog::PAYLOAD_MAX + 1];
+    size_t n = 0;
+    frame[n++] = 'D';
+    frame[n++] = 'L';
+    frame[n++] = (uint8_t)record.site->level;
+    frame[n++] = record.len;
+    memcpy(frame + n, &record.site->id, 4);
+    n += 4;
+    memcpy(frame + n, &record.timestamp_ms, 4);
+    n += 4;
+    memcpy(frame + n, record.payload, record.len);
+    n += record.len;
+    uint8_t check = 0;
+    for (size_t i = 0; i < n; i++) check ^= frame[i];
+    frame[n++] = check;
+
+    uint8_t escaped[2 * sizeof(frame)];
+    size_t len = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (needsEscape(frame[i])) {
+            escaped[len++] = ESCAPE;
+            escaped[len++] = frame[i] ^ ESCAPE_XOR;
+        } else {
+            escaped[len++] = frame[i];
+        }
+    }
+    fwrite(escaped, 1, len, stdout);
+}
+#endif
+
+void drainTask(void*) {
+    while (1) {
+        DeferredLog::drain();
+        vTaskDelay(pdMS_TO_TICKS(DeferredLog::DRAIN_PERIOD_MS));
+    }
+}
+
+} // namespace
+
+DeferredLog::Record* DeferredLog::claim(uint32_t& pos) {
+    Record* record = s_ring.claim(pos);
+    if (!record) {
+        // Drain task is behind by a whole ring
+        s_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    return record;
+}
+
+void DeferredLog::publish(uint32_t pos) {
+    s_ring.publish(pos);
+}
+
+size_t DeferredLog::drain() {
+    size_t written = 0;
+    while (const Record* record = s_ring.front()) {
+#if CONFIG_X402_DEFERRED_LOG_BINARY
+        writeBinary(*record);
+#else
+        writeText(*record);
+#endif
+        s_ring.release();
+        written++;
+    }
+#if CONFIG_X402_DEFERRED_LOG_BINARY
+    if (written > 0) {
+        fflush(stdout);
+    }
+#endif
+
+    // Under sustained overload, warn about drops at most once a second
+    static uint32_t reported = 0;
+    static uint32_t reported_ms = 0;
+    uint32_t dropped = s_dropped.load(std::memory_order_relaxed);
+    uint32_t now_ms = esp_log_timestamp();
+    if (dropped != reported && (reported == 0 || now_ms - reported_ms >= 1000)) {
+        ESP_LOGW(TAG, "⚠️ %" PRIu32 " deferred log records dropped (ring full)", dropped - reported);
+        Metrics::increment("log.dropped", dropped - reported);
+        reported = dropped;
+        reported_ms = now_ms;
+    }
+    return written;
+}
+
+uint32_t DeferredLog::dropped() {
+    return s_dropped.load(std::memory_order_relaxed);
+}
+
+bool DeferredLog::start() {
+    bool expected = false;
+    if (!s_started.compare_exchange_strong(expected, true)) {
+        return true;
+    }
+    if (xTaskCreate(drainTask, "dlog_drain", 3072, nullptr, tskIDLE_PRIORITY + 1, nullptr) != pdPASS) {
+        ESP_LOGE(TAG, "❌ Failed to create drain task");
+        s_started.store(false);
+        return false;
+    }
+#if CONFIG_X402_DEFERRED_LOG_BINARY
+    const char* output = "binary";
+#else
+    const char* output = "text";
+#endif
+    ESP_LOGI(TAG, "✅ Deferred log: level %d, %s output", CONFIG_X402_DEFERRED_LOG_LEVEL, output);
+    return true;
+}
@@ -0,0 +1,88 @@
+#include "fee_estimator.h"
+#include <esp_log.h>
+#include <algorithm>
+#include <cstring>
+
+static const char* TAG = "FeeEstimator";
+
+// Slots are ~400 ms; landing in the next slot or two needs a top-decile bid
+static uint8_t percentileForTarget(uint32_t target_ms) {
+    if (target_ms <= 800) return 90;
+    if (target_ms <= 2000) return 75;
+    if (target_ms <= 5000) return 50;
+    return 25;
+}
+
+FeeEstimator::FeeEstimator(uint32_t target_latency_ms)
+    : percentile_(percentileForTarget(target_latency_ms ? target_latency_ms : DEFAULT_TARGET_MS))
+    , fee_count_(0)
+    , fee_head_(0)
+    , unit_count_(0)
+    , unit_head_(0)
+    , price_(MIN_UNIT_PRICE)
+    , units_max_(0)
+{
+    portMUX_INITIALIZE(&lock_);
+    memset(fees_, 0, sizeof(fees_));
+    memset(units_, 0, sizeof(units_));
+}
+
+void FeeEstimator::addFeeSamples(const uint64_t* fees, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        fees_[fee_head_] = (uint32_t)std::min<uint64_t>(fees[i], UINT32_MAX);
+        fee_head_ = (fee_head_ + 1) % MAX_FEE_SAMPLES;
+        if (fee_count_ < MAX_FEE_SAMPLES) fee_count_++;
+    }
+
+    memcpy(scratch_, fees_, fee_count_ * sizeof(uint32_t));
+    size_t k = (fee_count_ - 1) * percentile_ / 100;
+    std::nth_element(scratch_, scratch_ + k, scratch_ + fee_count_);
+    uint64_t price = std::min<uint64_t>(std::max<uint64_t>(scratch_[k], MIN_UNIT_PRICE), MAX_UNIT_PRICE);
+
+    portENTER_CRITICAL(&lock_);
+    price_ = price;
+    portEXIT_CRITICAL(&lock_);
+
+    ESP_LOGI(TAG, "📈 p%u priority fee: %llu uLamports/CU (%zu samples)",
+             percentile_, (unsigned long long)price, fee_count_);
+}
+
+void FeeEstimator::addUnitsSample(uint32_t units_consumed) {
+    units_[unit_head_] = units_consumed;
+    unit_head_ = (unit_head_ + 1) % MAX_UNIT_SAMPLES;
+    if (unit_count_ < MAX_UNIT_SAMPLES) unit_count_++;
+
+    uint32_t max = 0;
+    for (size_t i = 0; i < unit_count_; i++) {
+        max = std::max(max, units_[i]);
+    }
+
+    portENTER_CRITICAL(&lock_);
+    units_max_ = max;
+    portEXIT_CRITICAL(&lock_);
+}
+
+uint64_t FeeEstimator::unitPrice() const {
+    portENTER_CRITICAL(&lock_);
+    uint64_t price = price_;
+    portEXIT_CRITICAL(&lock_);
+    return price;
+}
+
+uint32_t FeeEstimator::unitLimit(size_t transfers) const {
+    portENTER_CRITICAL(&lock_);
+    uint32_t measured = units_max_;
+    portEXIT_CRITICAL(&lock_);
+    if (measured == 0 || transfers == 0) {
+        return 0;
+    }
+
+    // 25% headroom over the worst recent run, rounded up to 1k CU. The
+    // measurement covers a whole single-transfer TX, so scaling it by the
+    // transfer count over-provisions the shared instructions slightly.
+    uint64_t per_transfer = ((uint64_t)measured * 5 / 4 + 999) / 1000 * 1000;
+    return (uint32_t)std::min<uint64_t>(per_transfer * transfers, MAX_UNIT_LIMIT);
+}
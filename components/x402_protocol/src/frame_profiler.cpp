@@ -0,0 +1,92 @@
+#include "frame_profiler.h"
+#include "metrics.h"
+#include "esp_timer.h"
+#include <cstring>
+
+FrameProfiler::FrameProfiler()
+    : head_(0)
+    , count_(0)
+    , transition_(nullptr)
+    , refresh_start_us_(0)
+    , flush_start_us_(0)
+    , flush_us_(0)
+    , flushed_px_(0)
+    , invalidated_px_(0)
+{
+    memset(ring_, 0, sizeof(ring_));
+}
+
+void FrameProfiler::attach(lv_display_t* disp) {
+    lv_display_add_event_cb(disp, eventCallback, LV_EVENT_ALL, this);
+}
+
+void FrameProfiler::markTransition(const char* name) {
+    transition_ = name;
+}
+
+size_t FrameProfiler::samples(FrameSample* out, size_t max) const {
+    size_t n = count_ < max ? count_ : max;
+    size_t first = (head_ + MAX_SAMPLES - count_) % MAX_SAMPLES;
+    for (size_t i = 0; i < n; i++) {
+        out[i] = ring_[(first + i) % MAX_SAMPLES];
+    }
+    return n;
+}
+
+void FrameProfiler::reset() {
+    head_ = 0;
+    count_ = 0;
+}
+
+void FrameProfiler::record(uint32_t total_us) {
+    FrameSample& s = ring_[head_];
+    s.transition = transition_;
+    s.flush_us = (uint32_t)flush_us_;
+    s.render_us = total_us > s.flush_us ? total_us - s.flush_us : 0;
+    s.flushed_px = flushed_px_;
+    s.invalidated_px = invalidated_px_;
+    head_ = (head_ + 1) % MAX_SAMPLES;
+    if (count_ < MAX_SAMPLES) count_++;
+
+    Metrics::observe("ui.refresh_us", total_us);
+    Metrics::observe("ui.render_us", s.render_us);
+    Metrics::observe("ui.flush_us", s.flush_us);
+    Metrics::observe("ui.flushed_px", s.flushed_px);
+    Metrics::observe("ui.invalidated_px", s.invalidated_px);
+}
+
+void FrameProfiler::eventCallback(lv_event_t* e) {
+    FrameProfiler* self = static_cast<FrameProfiler*>(lv_event_get_user_data(e));
+    int64_t now = esp_timer_get_time();
+
+    switch (lv_event_get_code(e)) {
+    case LV_EVENT_INVALIDATE_AREA:
+        self->invalidated_px_ += lv_area_get_size(static_cast<lv_area_t*>(lv_event_get_param(e)));
+        break;
+    case LV_EVENT_REFR_START:
+        self->refresh_start_us_ = now;
+        self->flush_us_ = 0;
+        self->flushed_px_ = 0;
+        break;
+    case LV_EVENT_FLUSH_START:
+        self->flushed_px_ += lv_area_get_size(static_cast<lv_area_t*>(lv_event_get_param(e)));
+        self->flush_start_us_ = now;
+        break;
+    case LV_EVENT_FLUSH_WAIT_START:
+        self->flush_start_us_ = now;
+        break;
+    case LV_EVENT_FLUSH_FINISH:
+    case LV_EVENT_FLUSH_WAIT_FINISH:
+        self->flush_us_ += now - self->flush_start_us_;
+        break;
+    case LV_EVENT_REFR_READY:
+        // Idle timer ticks refresh nothing; only record frames a transition dirtied
+        if (self->invalidated_px_ > 0) {
+            self->record((uint32_t)(now - self->refresh_start_us_));
+            self->invalidated_px_ = 0;
+        }
+        break;
+    default:
+        break;
+    }
+}
@@ -0,0 +1,165 @@
+#include "headless_backend.h"
+#include "esp_log.h"
+#include <chrono>
+#include <cstring>
+
+static const char* TAG = "HeadlessBackend";
+
+std::recursive_timed_mutex HeadlessBackend::mutex_;
+size_t HeadlessBackend::instances_ = 0;
+
+HeadlessBackend::HeadlessBackend(int32_t width, int32_t height)
+    : width_(width)
+    , height_(height)
+    , disp_(nullptr)
+    , touch_(nullptr)
+    , touch_x_(0)
+    , touch_y_(0)
+    , touch_pressed_(false)
+    , backlight_(100)
+    , initialized_(false)
+    , task_period_ms_(0)
+    , task_running_(false)
+    , task_alive_(false)
+{
+}
+
+HeadlessBackend::~HeadlessBackend() {
+    deinit();
+}
+
+bool HeadlessBackend::init() {
+    if (initialized_) {
+        return true;
+    }
+
+    framebuffer_.reset(new uint16_t[(size_t)width_ * height_]());
+    draw_buf_.reset(new uint16_t[(size_t)width_ * BUFFER_LINES]);
+
+    {
+        std::lock_guard<std::recursive_timed_mutex> guard(mutex_);
+        if (instances_++ == 0) {
+            lv_init();
+        }
+
+        disp_ = lv_display_create(width_, height_);
+        if (!disp_) {
+            ESP_LOGE(TAG, "❌ Failed to create display");
+            if (--instances_ == 0) {
+                lv_deinit();
+            }
+            return false;
+        }
+        lv_display_set_color_format(disp_, LV_COLOR_FORMAT_RGB565);
+        lv_display_set_buffers(disp_, draw_buf_.get(), nullptr,
+                               (uint32_t)(width_ * BUFFER_LINES * sizeof(uint16_t)),
+                               LV_DISPLAY_RENDER_MODE_PARTIAL);
+        lv_display_set_flush_cb(disp_, flushCallback);
+        lv_display_set_user_data(disp_, this);
+        lv_disp_set_default(disp_);
+
+        touch_ = lv_indev_create();
+        lv_indev_set_type(touch_, LV_INDEV_TYPE_POINTER);
+        lv_indev_set_read_cb(touch_, touchReadCallback);
+        lv_indev_set_user_data(touch_, this);
+        lv_indev_set_display(touch_, disp_);
+    }
+
+    initialized_ = true;
+    if (task_period_ms_ > 0) {
+        task_running_ = true;
+        task_alive_ = true;
+        if (xTaskCreate(taskEntry, "lvgl_headless", 6144, this, 4, nullptr) != pdPASS) {
+            ESP_LOGE(TAG, "❌ Failed to create LVGL task");
+            task_running_ = false;
+            task_alive_ = false;
+            deinit();
+            return false;
+        }
+    }
+    ESP_LOGI(TAG, "Headless display ready: %ldx%ld", (long)width_, (long)height_);
+    return true;
+}
+
+void HeadlessBackend::deinit() {
+    if (!initialized_) {
+        return;
+    }
+
+    task_running_ = false;
+    while (task_alive_) {
+        vTaskDelay(pdMS_TO_TICKS(task_period_ms_));
+    }
+
+    std::lock_guard<std::recursive_timed_mutex> guard(mutex_);
+    lv_indev_delete(touch_);
+    lv_display_delete(disp_);
+    touch_ = nullptr;
+    disp_ = nullptr;
+    if (--instances_ == 0) {
+        lv_deinit();
+    }
+
+    draw_buf_.reset();
+    framebuffer_.reset();
+    initialized_ = false;
+}
+
+bool HeadlessBackend::lock(uint32_t timeout_ms) {
+    if (timeout_ms == 0) {
+        mutex_.lock();
+        return true;
+    }
+    return mutex_.try_lock_for(std::chrono::milliseconds(timeout_ms));
+}
+
+void HeadlessBackend::unlock() {
+    mutex_.unlock();
+}
+
+void HeadlessBackend::pump(uint32_t elapsed_ms) {
+    std::lock_guard<std::recursive_timed_mutex> guard(mutex_);
+    lv_tick_inc(elapsed_ms);
+    lv_timer_handler();
+}
+
+void HeadlessBackend::taskEntry(void* arg) {
+    HeadlessBackend* self = static_cast<HeadlessBackend*>(arg);
+    while (self->task_running_) {
+        self->pump(self->task_period_ms_);
+        vTaskDelay(pdMS_TO_TICKS(self->task_period_ms_));
+    }
+    self->task_alive_ = false;
+    vTaskDelete(nullptr);
+}
+
+void HeadlessBackend::press(int32_t x, int32_t y) {
+    std::lock_guard<std::recursive_timed_mutex> guard(mutex_);
+    touch_x_ = x;
+    touch_y_ = y;
+    touch_pressed_ = true;
+}
+
+void HeadlessBackend::release() {
+    std::lock_guard<std::recursive_timed_mutex> guard(mutex_);
+    touch_pressed_ = false;
+}
+
+void HeadlessBackend::flushCallback(lv_display_t* disp, const lv_area_t* area, uint8_t* px_map) {
+    HeadlessBackend* self = static_cast<HeadlessBackend*>(lv_display_get_user_data(disp));
+    const int32_t w = lv_area_get_width(area);
+    const uint16_t* src = reinterpret_cast<const uint16_t*>(px_map);
+
+    for (int32_t y = area->y1; y <= area->y2; y++) {
+        memcpy(&self->framebuffer_[(size_t)y * self->width_ + area->x1], src, w * sizeof(uint16_t));
+        src += w;
+    }
+    lv_display_flush_ready(disp);
+}
+
+void HeadlessBackend::touchReadCallback(lv_indev_t* indev, lv_indev_data_t* data) {
+    HeadlessBackend* self = static_cast<HeadlessBackend*>(lv_indev_get_user_data(indev));
+    data->point.x = self->touch_x_;
+    data->point.y = self->touch_y_;
+    data->state = self->touch_pressed_ ? LV_INDEV_STATE_PRESSED : LV_INDEV_STATE_RELEASED;
+}
@@ -1,124 +1,172 @@
 #include "http_client.h"
-#include <esp_http_client.h>
-#include <esp_crt_bundle.h>
+#include "async_http.h"
 #include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <algorithm>
 #include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
 
+static const char* TAG = "HttpClient";
 
-char HttpClient::response_buffer[4096];
-int HttpClient::response_len = 0;
-
-esp_err_t HttpClient::event_handler(esp_http_client_event_t *evt) {
-    switch(evt->event_id) {
-        case HTTP_EVENT_ON_CONNECTED:
-            response_len = 0;
-            break;
-        case HTTP_EVENT_ON_DATA:
-            if (response_len + evt->data_len < sizeof(response_buffer)) {
-                memcpy(response_buffer + response_len, evt->data, evt->data_len);
-                response_len += evt->data_len;
-            }
-            break;
-        case HTTP_EVENT_ON_FINISH:
-            response_buffer[response_len] = '\0';
-            break;
-        default:
-            break;
+static char* copyBody(const AsyncHttp::Response& resp) {
+    char* out = (char*)malloc(resp.len + 1);
+    if (out) {
+        memcpy(out, resp.body, resp.len);
+        out[resp.len] = '\0';
     }
-    return ESP_OK;
+    return out;
 }
 
 HttpClient::HttpClient(const HttpClientConfig& config) : cfg_(config) {}
 
 HttpClient::~HttpClient() {}
 
-bool HttpClient::get(const char* url, char** response_out, size_t* response_len_out) {
-    response_len = 0;
-    memset(response_buffer, 0, sizeof(response_buffer));
-    esp_http_client_config_t config = {};
-    config.url = url;
-    config.method = HTTP_METHOD_GET;
-    config.user_agent = cfg_.user_agent;
-    config.timeout_ms = cfg_.timeout_ms;
-    config.event_handler = event_handler;
-    config.crt_bundle_attach = esp_crt_bundle_attach;
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    if (!client) return false;
-    esp_err_t err = esp_http_client_perform(client);
-    int status = esp_http_client_get_status_code(client);
-    esp_http_client_cleanup(client);
-    if (err == ESP_OK && status == 200) {
-        if (response_out) {
-            *response_out = (char*)malloc(response_len + 1);
-            memcpy(*response_out, response_buffer, response_len);
-            (*response_out)[response_len] = '\0';
-        }
-        if (response_len_out) *response_len_out = response_len;
+// 402 body -> parsed JSON if it carries "accepts"
+static bool parse402(const AsyncHttp::Response& resp, cJSON** json_out, char** raw_response) {
+    if (resp.err != ESP_OK || resp.status != 402 || resp.len == 0 || resp.truncated) {
+        return false;
+    }
+    cJSON* root = cJSON_Parse(resp.body);
+    if (root && cJSON_GetObjectItem(root, "accepts")) {
+        *json_out = root;
+        if (raw_response) *raw_response = copyBody(resp);
         return true;
     }
+    if (root) cJSON_Delete(root);
     return false;
 }
 
 bool HttpClient::get_402(const char* url, cJSON** json_out, char** raw_response) {
-    response_len = 0;
-    memset(response_buffer, 0, sizeof(response_buffer));
-    esp_http_client_config_t config = {};
-    config.url = url;
-    config.method = HTTP_METHOD_GET;
-    config.user_agent = cfg_.user_agent;
-    config.timeout_ms = cfg_.timeout_ms;
-    config.event_handler = event_handler;
-    config.crt_bundle_attach = esp_crt_bundle_attach;
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    if (!client) return false;
-    esp_err_t err = esp_http_client_perform(client);
-    int status = esp_http_client_get_status_code(client);
-    esp_http_client_cleanup(client);
-    if (err == ESP_OK && status == 402 && response_len > 0) {
-        cJSON* root = cJSON_Parse(response_buffer);
-        if (root && cJSON_GetObjectItem(root, "accepts")) {
-            *json_out = root;
-            if (raw_response) {
-                *raw_response = (char*)malloc(response_len + 1);
-                memcpy(*raw_response, response_buffer, response_len);
-                (*raw_response)[response_len] = '\0';
+    AsyncHttp::Request req;
+    req.url = url;
+    req.user_agent = cfg_.user_agent;
+    req.timeout_ms = cfg_.timeout_ms;
+
+    bool ok = false;
+    AsyncHttp::instance().perform(req, [&](const AsyncHttp::Response& resp) {
+        ok = parse402(resp, json_out, raw_response);
+    });
+    return ok;
+}
+
+bool HttpClient::get_402_async(const char* url, std::function<void(cJSON* json)> done) {
+    AsyncHttp::Request req;
+    req.url = url;
+    req.user_agent = cfg_.user_agent;
+    req.timeout_ms = cfg_.timeout_ms;
+
+    return AsyncHttp::instance().submit(req, [done](const AsyncHttp::Response& resp) {
+        cJSON* json = nullptr;
+        done(parse402(resp, &json, nullptr) ? json : nullptr);
+    });
+}
+
+static AsyncHttp::Request paymentRequest(const char* url, const char* b64_payment, const char* user_agent) {
+    AsyncHttp::Request req;
+    req.url = url;
+    req.user_agent = user_agent;
+    req.timeout_ms = 20000;
+    req.header_name = "X-PAYMENT";
+    req.header_value = b64_payment;
+    req.buffer_size_tx = 2048;      // for large X-PAYMENT header
+    return req;
+}
+
+// "bytes 0-99/5000" -> 5000; -1 if absent or "*"
+static int64_t rangeTotal(const char* content_range) {
+    const char* slash = strchr(content_range, '/');
+    if (!slash || slash[1] < '0' || slash[1] > '9') return -1;
+    return strtoll(slash + 1, nullptr, 10);
+}
+
+bool HttpClient::submit_payment_stream(const char* url, const char* b64_payment,
+                                       const AsyncHttp::Sink& sink, StreamResult* out) {
+    memset(out, 0, sizeof(*out));
+    out->total = -1;
+
+    for (int attempt = 0; attempt <= MAX_RESUMES; ++attempt) {
+        AsyncHttp::Request req = paymentRequest(url, b64_payment, cfg_.user_agent);
+        req.max_response = 1024;    // Only error bodies are buffered
+        req.sink = sink;
+        if (attempt > 0) {
+            // Offsets count decoded bytes, so resumes ask for the identity encoding
+            req.range_from = (int64_t)out->received;
+            req.accept_compressed = false;
+        }
+
+        int status = 0;
+        bool refused = false;
+        bool complete = false;
+        bool started = AsyncHttp::instance().perform(req, [&](const AsyncHttp::Response& resp) {
+            // A drop mid-body can surface as a transport error after the
+            // status line; the bytes that did arrive still count
+            status = resp.status;
+            if (attempt == 0) {
+                out->err = resp.err;
+                if (status && (status < 200 || status >= 300)) {
+                    size_t n = std::min(resp.len, sizeof(out->error) - 1);
+                    memcpy(out->error, resp.body, n);
+                    out->error[n] = '\0';
+                }
             }
+            out->received += resp.streamed;
+            refused = resp.truncated && resp.status >= 200 && resp.status < 300;
+            complete = resp.complete;
+            if (status == 200 && attempt == 0) {
+                out->headers = *resp.headers;
+                out->total = resp.content_length;
+            } else if (status == 206 && out->total < 0) {
+                out->total = rangeTotal(resp.headers->content_range);
+            }
+        });
+
+        if (attempt == 0) {
+            out->status = status;
+            if (!started) out->err = ESP_FAIL;
+            if (status != 200) return false;
+        } else if (status != 200 && status != 206) {
+            ESP_LOGE(TAG, "❌ Resume at %zu refused (status %d)", out->received, status);
+            return false;
+        }
+        if (refused) {
+            ESP_LOGE(TAG, "❌ Content sink stopped at %zu bytes", out->received);
+            return false;
+        }
+        if (out->total >= 0 ? (int64_t)out->received >= out->total : complete) {
             return true;
         }
-        if (root) cJSON_Delete(root);
+
+        if (attempt < MAX_RESUMES) {
+            ESP_LOGW(TAG, "⚠️ Transfer dropped at %zu bytes, resuming", out->received);
+            ++out->resumes;
+            vTaskDelay(pdMS_TO_TICKS(RESUME_DELAY_MS));
+        }
     }
+    ESP_LOGE(TAG, "❌ Gave up after %d resumes at %zu bytes", MAX_RESUMES, out->received);
     return false;
 }
 
-bool HttpClient::submit_payment(const char* url, const char* b64_payment, char** content_out) {
-    response_len = 0;
-    memset(response_buffer, 0, sizeof(response_buffer));
-    esp_http_client_config_t config = {};
-    config.url = url;
-    config.method = HTTP_METHOD_GET;
-    config.user_agent = cfg_.user_agent;
-    config.timeout_ms = 20000;
-    config.event_handler = event_handler;
-    config.crt_bundle_attach = esp_crt_bundle_attach;
-
-    // 🚀 Increase TX and RX buffers for large headers + responses
-    config.buffer_size_tx = 2048;  // for large X-PAYMENT header
-    config.buffer_size = 4096;     // for response body
-
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    if (!client) return false;
-    esp_http_client_set_header(client, "X-PAYMENT", b64_payment);
-    esp_err_t err = esp_http_client_perform(client);
-    int status = esp_http_client_get_status_code(client);
-    if (err == ESP_OK && status == 200 && response_len > 0) {
-        if (content_out) {
-            *content_out = (char*)malloc(response_len + 1);
-            memcpy(*content_out, response_buffer, response_len);
-            (*content_out)[response_len] = '\0';
+int HttpClient::get_conditional(const char* url, const char* etag, const char* last_modified,
+                                char** body_out, AsyncHttp::Headers* headers_out) {
+    AsyncHttp::Request req;
+    req.url = url;
+    req.user_agent = cfg_.user_agent;
+    req.timeout_ms = cfg_.timeout_ms;
+    req.if_none_match = (etag && etag[0]) ? etag : nullptr;
+    req.if_modified_since = (last_modified && last_modified[0]) ? last_modified : nullptr;
+
+    int status = 0;
+    *body_out = nullptr;
+    AsyncHttp::instance().perform(req, [&](const AsyncHttp::Response& resp) {
+        if (resp.err != ESP_OK) return;
+        status = resp.status;
+        *headers_out = *resp.headers;
+        if (status == 200 && !resp.truncated) {
+            *body_out = copyBody(resp);
         }
-        esp_http_client_cleanup(client);
-        return true;
-    }
-    esp_http_client_cleanup(client);
-    return false;
-}
\ No newline at end of file
+    });
+    return status;
+}
+
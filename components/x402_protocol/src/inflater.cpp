@@ -0,0 +1,281 @@
+#include "inflater.h"
+#include <esp_log.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+#if !CONFIG_IDF_TARGET_LINUX
+#include <esp_rom_crc.h>
+#endif
+
+static const char* TAG = "Inflater";
+
+// gzip FLG bits (RFC 1952)
+static constexpr uint8_t GZ_FHCRC    = 0x02;
+static constexpr uint8_t GZ_FEXTRA   = 0x04;
+static constexpr uint8_t GZ_FNAME    = 0x08;
+static constexpr uint8_t GZ_FCOMMENT = 0x10;
+
+static constexpr size_t GZ_HEADER_SIZE  = 10;
+static constexpr size_t GZ_TRAILER_SIZE = 8;
+
+static uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t len) {
+#if CONFIG_IDF_TARGET_LINUX
+    return crc32(crc, data, len);
+#else
+    return esp_rom_crc32_le(crc, data, len);
+#endif
+}
+
+bool Inflater::parseEncoding(const char* content_encoding, Format* out) {
+    if (!content_encoding) return false;
+    while (*content_encoding == ' ') content_encoding++;
+    size_t len = strlen(content_encoding);
+    while (len && content_encoding[len - 1] == ' ') len--;
+
+    if ((len == 4 && strncasecmp(content_encoding, "gzip", 4) == 0) ||
+        (len == 6 && strncasecmp(content_encoding, "x-gzip", 6) == 0)) {
+        *out = Format::Gzip;
+        return true;
+    }
+    if (len == 7 && strncasecmp(content_encoding, "deflate", 7) == 0) {
+        *out = Format::Deflate;
+        return true;
+    }
+    return false;
+}
+
+Inflater::Inflater(Format format)
+    : format_(format), stage_(Stage::Header), head_len_(0), skip_(0), flags_(0), crc_(0), decoded_(0) {
+#if CONFIG_IDF_TARGET_LINUX
+    memset(&zs_, 0, sizeof(zs_));
+    zs_ready_ = false;
+    out_ = (uint8_t*)malloc(OUT_CHUNK);
+#else
+    tinfl_ = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+    tinfl_flags_ = 0;
+    window_ = (uint8_t*)malloc(WINDOW_SIZE);
+    window_pos_ = 0;
+#endif
+}
+
+Inflater::~Inflater() {
+#if CONFIG_IDF_TARGET_LINUX
+    if (zs_ready_) inflateEnd(&zs_);
+    free(out_);
+#else
+    free(tinfl_);
+    free(window_);
+#endif
+}
+
+bool Inflater::ok() const {
+#if CONFIG_IDF_TARGET_LINUX
+    return out_ != nullptr;
+#else
+    return tinfl_ && window_;
+#endif
+}
+
+bool Inflater::feed(const uint8_t* data, size_t len, const Output& out) {
+    while (len > 0 && stage_ != Stage::Done && stage_ != Stage::Failed) {
+        size_t used;
+        if (stage_ == Stage::Body) {
+            used = inflateBody(data, len, out);
+        } else if (stage_ == Stage::GzipTrailer) {
+            used = std::min(GZ_TRAILER_SIZE - head_len_, len);
+            memcpy(head_ + head_len_, data, used);
+            head_len_ += used;
+            if (head_len_ == GZ_TRAILER_SIZE) {
+                stage_ = checkTrailer() ? Stage::Done : Stage::Failed;
+            }
+        } else {
+            used = parseHeader(data, len, out);
+        }
+        data += used;
+        len -= used;
+    }
+    return stage_ != Stage::Failed;
+}
+
+size_t Inflater::parseHeader(const uint8_t* data, size_t len, const Output& out) {
+    size_t used = 0;
+    while (used < len && stage_ < Stage::Body) {
+        uint8_t b = data[used++];
+        switch (stage_) {
+        case Stage::Header:
+            head_[head_len_++] = b;
+            if (format_ == Format::Deflate && head_len_ == 2) {
+                // zlib header: CM = 8 and the first two bytes are a multiple of 31
+                bool zlib = (head_[0] & 0x0F) == 8 && ((head_[0] << 8) | head_[1]) % 31 == 0;
+                if (startBody(zlib)) {
+                    inflateBody(head_, 2, out);     // Sniffed bytes belong to the stream
+                }
+            } else if (format_ == Format::Gzip && head_len_ == GZ_HEADER_SIZE) {
+                if (head_[0] != 0x1f || head_[1] != 0x8b || head_[2] != 8) {
+                    ESP_LOGW(TAG, "⚠️ Not a gzip stream");
+                    stage_ = Stage::Failed;
+                    break;
+                }
+                flags_ = head_[3];
+                head_len_ = 0;
+                nextField(Stage::Header);
+            }
+            break;
+        case Stage::GzipExtraLen:
+            head_[head_len_++] = b;
+            if (head_len_ == 2) {
+                skip_ = head_[0] | (head_[1] << 8);
+                head_len_ = 0;
+                if (skip_) {
+                    stage_ = Stage::GzipExtra;
+                } else {
+                    nextField(Stage::GzipExtra);
+                }
+            }
+            break;
+        case Stage::GzipExtra: {
+            size_t n = std::min(skip_ - 1, len - used);
+            used += n;
+            skip_ -= n + 1;
+            if (skip_ == 0) nextField(Stage::GzipExtra);
+            break;
+        }
+        case Stage::GzipName:
+        case Stage::GzipComment:
+            if (b == 0) nextField(stage_);
+            break;
+        case Stage::GzipHeaderCrc:
+            if (--skip_ == 0) nextField(Stage::GzipHeaderCrc);
+            break;
+        default:
+            break;
+        }
+    }
+    return used;
+}
+
+void Inflater::nextField(Stage after) {
+    if (after < Stage::GzipExtraLen && (flags_ & GZ_FEXTRA)) {
+        stage_ = Stage::GzipExtraLen;
+    } else if (after < Stage::GzipName && (flags_ & GZ_FNAME)) {
+        stage_ = Stage::GzipName;
+    } else if (after < Stage::GzipComment && (flags_ & GZ_FCOMMENT)) {
+        stage_ = Stage::GzipComment;
+    } else if (after < Stage::GzipHeaderCrc && (flags_ & GZ_FHCRC)) {
+        skip_ = 2;
+        stage_ = Stage::GzipHeaderCrc;
+    } else {
+        startBody(false);
+    }
+}
+
+bool Inflater::startBody(bool zlib) {
+    if (!ok()) {
+        stage_ = Stage::Failed;
+        return false;
+    }
+#if CONFIG_IDF_TARGET_LINUX
+    zs_ready_ = inflateInit2(&zs_, zlib ? 15 : -15) == Z_OK;
+    if (!zs_ready_) {
+        stage_ = Stage::Failed;
+        return false;
+    }
+#else
+    tinfl_init(tinfl_);
+    tinfl_flags_ = zlib ? TINFL_FLAG_PARSE_ZLIB_HEADER : 0;
+    window_pos_ = 0;
+#endif
+    stage_ = Stage::Body;
+    return true;
+}
+
+void Inflater::endBody() {
+    head_len_ = 0;
+    stage_ = (format_ == Format::Gzip) ? Stage::GzipTrailer : Stage::Done;
+}
+
+bool Inflater::emit(const uint8_t* data, size_t len, const Output& out) {
+    if (format_ == Format::Gzip) {
+        crc_ = crc32Update(crc_, data, len);
+    }
+    decoded_ += len;
+    if (!out(reinterpret_cast<const char*>(data), len)) {
+        stage_ = Stage::Failed;
+        return false;
+    }
+    return true;
+}
+
+#if CONFIG_IDF_TARGET_LINUX
+
+size_t Inflater::inflateBody(const uint8_t* data, size_t len, const Output& out) {
+    zs_.next_in = const_cast<Bytef*>(data);
+    zs_.avail_in = len;
+    for (;;) {
+        zs_.next_out = out_;
+        zs_.avail_out = OUT_CHUNK;
+        int rc = inflate(&zs_, Z_NO_FLUSH);
+        size_t produced = OUT_CHUNK - zs_.avail_out;
+        if (produced && !emit(out_, produced, out)) {
+            break;
+        }
+        if (rc == Z_STREAM_END) {
+            endBody();
+            break;
+        }
+        if (rc != Z_OK && rc != Z_BUF_ERROR) {
+            ESP_LOGW(TAG, "⚠️ Corrupt deflate stream (%d)", rc);
+            stage_ = Stage::Failed;
+            break;
+        }
+        if (zs_.avail_in == 0 && zs_.avail_out != 0) {
+            break;      // All input used, nothing left to flush
+        }
+    }
+    return len - zs_.avail_in;
+}
+
+#else
+
+size_t Inflater::inflateBody(const uint8_t* data, size_t len, const Output& out) {
+    size_t consumed = 0;
+    for (;;) {
+        size_t in_bytes = len - consumed;
+        size_t out_bytes = WINDOW_SIZE - window_pos_;
+        tinfl_status status = tinfl_decompress(tinfl_, data + consumed, &in_bytes,
+                                               window_, window_ + window_pos_, &out_bytes,
+                                               tinfl_flags_ | TINFL_FLAG_HAS_MORE_INPUT);
+        consumed += in_bytes;
+        if (out_bytes && !emit(window_ + window_pos_, out_bytes, out)) {
+            break;
+        }
+        window_pos_ = (window_pos_ + out_bytes) & (WINDOW_SIZE - 1);
+        if (status == TINFL_STATUS_DONE) {
+            endBody();
+            break;
+        }
+        if (status < TINFL_STATUS_DONE) {
+            ESP_LOGW(TAG, "⚠️ Corrupt deflate stream (%d)", (int)status);
+            stage_ = Stage::Failed;
+            break;
+        }
+        if (status == TINFL_STATUS_NEEDS_MORE_INPUT) {
+            break;      // All input used
+        }
+        // TINFL_STATUS_HAS_MORE_OUTPUT: the window wrapped, keep going
+    }
+    return consumed;
+}
+
+#endif
+
+bool Inflater::checkTrailer() const {
+    uint32_t crc = head_[0] | (head_[1] << 8) | (head_[2] << 16) | ((uint32_t)head_[3] << 24);
+    uint32_t size = head_[4] | (head_[5] << 8) | (head_[6] << 16) | ((uint32_t)head_[7] << 24);
+    if (crc != crc_ || size != (uint32_t)decoded_) {
+        ESP_LOGW(TAG, "⚠️ gzip trailer mismatch");
+        return false;
+    }
+    return true;
+}
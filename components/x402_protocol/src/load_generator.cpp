@@ -0,0 +1,408 @@
+#include "load_generator.h"
+
+#if CONFIG_X402_LOADGEN
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <cJSON.h>
+#include <sodium.h>
+#include <malloc.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "payer_wallets.h"
+
+static const char* TAG = "LoadGen";
+
+static constexpr uint32_t WORKER_STACK = 8192;
+static constexpr UBaseType_t WORKER_PRIORITY = 5;
+static constexpr uint32_t STOP_POLL_MS = 100;
+// Per-worker journals and caches, in the working directory
+static constexpr const char* STATE_DIR = "loadgen";
+
+namespace {
+
+// The stages X402PaymentClient reports, between the two measured here
+enum Stage : uint8_t {
+    STAGE_QUEUE,        // Scheduled arrival -> a worker's client is free to pay it
+    STAGE_POOL,
+    STAGE_OFFER,
+    STAGE_PARSE,
+    STAGE_RESERVE,
+    STAGE_BLOCKHASH,
+    STAGE_BUILD,
+    STAGE_SIGN,
+    STAGE_ENCODE,
+    STAGE_SUBMIT,
+    STAGE_TOTAL,        // Scheduled arrival -> content delivered
+    STAGE_COUNT
+};
+
+const char* const STAGE_NAMES[STAGE_COUNT] = {
+    "queue", "pool", "offer", "parse", "reserve", "blockhash", "build", "sign", "encode",
+    "submit", "total",
+};
+
+// Owned by one worker until it exits, then merged by run()
+struct WorkerStats {
+    std::vector<uint32_t> us[STAGE_COUNT];     // Samples of each completed stage
+    std::map<std::string, size_t> errors;      // Failed stages
+    size_t attempted = 0;
+    size_t succeeded = 0;
+};
+
+// A worker's own client and where it keeps its state. Its tasks run until
+// the process exits, so it is never destroyed.
+struct Worker {
+    X402PaymentClient* client;
+    char journal[48];
+    char cache[48];
+};
+
+struct Run {
+    const LoadGenerator::Options* options;
+    Worker* workers = nullptr;
+    std::atomic<uint64_t> bytes{0};             // Counted on the HTTP tasks
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> next_worker{0};
+    QueueHandle_t arrivals = nullptr;           // int64_t scheduled times, OpenLoop only
+    SemaphoreHandle_t finished = nullptr;       // Given by each worker as it exits
+    WorkerStats stats[LoadGenerator::MAX_WORKERS];
+};
+
+struct Usage {
+    int64_t cpu_us;
+    int64_t heap_bytes;         // In use by malloc, arenas and mmap'd blocks
+    long max_rss_kb;
+};
+
+Usage usage() {
+    struct rusage ru = {};
+    getrusage(RUSAGE_SELF, &ru);
+    struct mallinfo2 mi = mallinfo2();
+    return {
+        (int64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000 +
+            ru.ru_utime.tv_usec + ru.ru_stime.tv_usec,
+        (int64_t)(mi.uordblks + mi.hblkhd),
+        ru.ru_maxrss,
+    };
+}
+
+uint32_t clampUs(int64_t us) {
+    return (uint32_t)std::clamp<int64_t>(us, 0, UINT32_MAX);
+}
+
+// Stage observer: files what a worker's client reports
+void onStage(WorkerStats& stats, const char* stage, int64_t us, bool ok) {
+    if (!ok) {
+        stats.errors[stage]++;
+        return;
+    }
+    for (size_t i = 0; i < STAGE_COUNT; i++) {
+        if (strcmp(stage, STAGE_NAMES[i]) == 0) {
+            stats.us[i].push_back(clampUs(us));
+            return;
+        }
+    }
+}
+
+// One payment through X402PaymentClient::executePaymentFlow, as a tap runs it
+void pay(X402PaymentClient& client, WorkerStats& stats, int64_t scheduled) {
+    stats.attempted++;
+    stats.us[STAGE_QUEUE].push_back(clampUs(esp_timer_get_time() - scheduled));
+    if (client.executePaymentFlow()) {
+        stats.us[STAGE_TOTAL].push_back(clampUs(esp_timer_get_time() - scheduled));
+        stats.succeeded++;
+    }
+}
+
+void workerEntry(void* arg) {
+    Run* run = static_cast<Run*>(arg);
+    const size_t index = run->next_worker++;
+    X402PaymentClient& client = *run->workers[index].client;
+    WorkerStats& stats = run->stats[index];
+
+    const bool open = run->options->mode == LoadGenerator::Mode::OpenLoop;
+    while (!run->stop) {
+        int64_t scheduled;
+        if (!open) {
+            pay(client, stats, esp_timer_get_time());
+        } else if (xQueueReceive(run->arrivals, &scheduled, pdMS_TO_TICKS(STOP_POLL_MS)) == pdTRUE) {
+            pay(client, stats, scheduled);
+        }
+    }
+    xSemaphoreGive(run->finished);
+    vTaskDelete(nullptr);
+}
+
+// Nearest-rank percentile of sorted samples
+uint32_t percentile(const std::vector<uint32_t>& sorted, double q) {
+    if (sorted.empty()) return 0;
+    size_t rank = (size_t)(q * sorted.size() + 0.999999);
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+// Client for worker index, paying from its own key (derived from config's
+// payer past the indexes PayerWallets uses, so no key is shared with a
+// sub-wallet) and keeping its own journal and cache. The journal starts
+// empty so no run inherits another's unresolved payments.
+X402PaymentClient* createClient(Run& run, const X402Config& config, size_t index) {
+    Worker& worker = run.workers[index];
+    WorkerStats& stats = run.stats[index];
+    const LoadGenerator::Options& options = *run.options;
+
+    X402Config cfg = config;
+    cfg.payai_url = options.merchant_url;
+    cfg.solana_rpc_url = options.rpc_url;
+    if (!PayerWallets::derive(config.payer_private_key, PayerWallets::MAX_WALLETS + index,
+                              cfg.payer_public_key, cfg.payer_private_key)) {
+        ESP_LOGE(TAG, "❌ Could not derive the payer of worker %zu", index);
+        return nullptr;
+    }
+    snprintf(worker.journal, sizeof(worker.journal), "%s/journal-%zu.bin", STATE_DIR, index);
+    snprintf(worker.cache, sizeof(worker.cache), "%s/cache-%zu", STATE_DIR, index);
+    unlink(worker.journal);
+
+    auto* client = new X402PaymentClient(cfg);
+    sodium_memzero(cfg.payer_private_key, sizeof(cfg.payer_private_key));
+    client->setPaced(false);
+    client->setStorage(worker.journal, worker.cache);
+    client->setStageObserver([&stats](const char* stage, int64_t us, bool ok) {
+        onStage(stats, stage, us, ok);
+    });
+    client->setContentSink([r = &run](const char*, size_t len) {
+        r->bytes += len;
+        return true;
+    });
+    if (!client->init()) {
+        ESP_LOGE(TAG, "❌ Client of worker %zu failed to initialize", index);
+        return nullptr;
+    }
+    return client;
+}
+
+cJSON* latencyJson(std::vector<uint32_t>& samples) {
+    std::sort(samples.begin(), samples.end());
+    double sum = 0;
+    for (uint32_t us : samples) sum += us;
+
+    cJSON* o = cJSON_CreateObject();
+    cJSON_AddNumberToObject(o, "count", samples.size());
+    cJSON_AddNumberToObject(o, "mean", samples.empty() ? 0 : sum / samples.size());
+    cJSON_AddNumberToObject(o, "p50", percentile(samples, 0.50));
+    cJSON_AddNumberToObject(o, "p90", percentile(samples, 0.90));
+    cJSON_AddNumberToObject(o, "p99", percentile(samples, 0.99));
+    cJSON_AddNumberToObject(o, "p999", percentile(samples, 0.999));
+    cJSON_AddNumberToObject(o, "max", samples.empty() ? 0 : samples.back());
+    return o;
+}
+
+} // namespace
+
+const char* LoadGenerator::modeName(Mode mode) {
+    switch (mode) {
+        case Mode::ClosedLoop: return "closed-loop";
+        case Mode::OpenLoop:   return "open-loop";
+    }
+    return "?";
+}
+
+LoadGenerator::Options LoadGenerator::defaults() {
+    Options o = {
+#if CONFIG_X402_LOADGEN_OPEN_LOOP
+        Mode::OpenLoop,
+#else
+        Mode::ClosedLoop,
+#endif
+        CONFIG_X402_LOADGEN_WORKERS,
+        CONFIG_X402_LOADGEN_RATE,
+        CONFIG_X402_LOADGEN_DURATION_S,
+        CONFIG_X402_LOADGEN_MERCHANT_URL,
+        CONFIG_X402_LOADGEN_RPC_URL,
+        CONFIG_X402_LOADGEN_REPORT,
+    };
+
+    // Sweeps change these between runs without a rebuild
+    if (const char* v = getenv("LOADGEN_MODE")) {
+        o.mode = strncmp(v, "open", 4) == 0 ? Mode::OpenLoop : Mode::ClosedLoop;
+    }
+    if (const char* v = getenv("LOADGEN_WORKERS")) o.workers = strtoul(v, nullptr, 10);
+    if (const char* v = getenv("LOADGEN_RATE")) o.rate = strtoul(v, nullptr, 10);
+    if (const char* v = getenv("LOADGEN_DURATION_S")) o.duration_s = strtoul(v, nullptr, 10);
+    if (const char* v = getenv("LOADGEN_REPORT")) o.report_path = v;
+    return o;
+}
+
+bool LoadGenerator::run(const X402Config& config, const Options& options) {
+    const bool open = options.mode == Mode::OpenLoop;
+    if (options.workers == 0 || options.workers > MAX_WORKERS || options.duration_s == 0 ||
+        (open && options.rate == 0)) {
+        ESP_LOGE(TAG, "❌ Invalid options: %zu workers, %u/s, %u s",
+                 options.workers, (unsigned)options.rate, (unsigned)options.duration_s);
+        return false;
+    }
+
+    auto run = std::make_unique<Run>();
+    run->options = &options;
+    run->finished = xSemaphoreCreateCounting(options.workers, 0);
+    if (open) run->arrivals = xQueueCreate(ARRIVAL_QUEUE_DEPTH, sizeof(int64_t));
+    if (!run->finished || (open && !run->arrivals)) {
+        ESP_LOGE(TAG, "❌ Failed to create run queues");
+        return false;
+    }
+
+    // One client per worker, as one device per user would be: every worker
+    // pays concurrently from its own payer
+    mkdir(STATE_DIR, 0755);
+    run->workers = new Worker[options.workers]();
+    for (size_t i = 0; i < options.workers; i++) {
+        run->workers[i].client = createClient(*run, config, i);
+        if (!run->workers[i].client) {
+            return false;
+        }
+    }
+
+    ESP_LOGI(TAG, "🚀 %s, %zu workers, %u/s for %u s: %s (RPC %s)",
+             modeName(options.mode), options.workers, open ? (unsigned)options.rate : 0,
+             (unsigned)options.duration_s, options.merchant_url, options.rpc_url);
+
+    const Usage before = usage();
+    const int64_t t0 = esp_timer_get_time();
+    const int64_t end = t0 + (int64_t)options.duration_s * 1000000;
+
+    size_t started = 0;
+    for (size_t i = 0; i < options.workers; i++) {
+        if (xTaskCreate(workerEntry, "loadgen", WORKER_STACK, run.get(), WORKER_PRIORITY,
+                        nullptr) == pdPASS) {
+            started++;
+        }
+    }
+    if (started < options.workers) {
+        ESP_LOGW(TAG, "⚠️ Only %zu of %zu workers started", started, options.workers);
+    }
+
+    size_t arrivals = 0;
+    size_t dropped = 0;
+    if (open) {
+        // Each arrival carries its exact due time, so tick granularity only
+        // batches sends and never shifts the latency baseline
+        for (;; arrivals++) {
+            int64_t due = t0 + (int64_t)(arrivals * 1e6 / options.rate);
+            if (due >= end) break;
+            int64_t wait_ms = (due - esp_timer_get_time()) / 1000;
+            if (wait_ms >= portTICK_PERIOD_MS) vTaskDelay(pdMS_TO_TICKS(wait_ms));
+            if (xQueueSend(run->arrivals, &due, 0) != pdTRUE) dropped++;
+        }
+    } else {
+        vTaskDelay(pdMS_TO_TICKS(options.duration_s * 1000));
+    }
+
+    run->stop = true;
+    for (size_t i = 0; i < started; i++) {
+        xSemaphoreTake(run->finished, portMAX_DELAY);
+    }
+    const int64_t elapsed_us = std::max<int64_t>(esp_timer_get_time() - t0, 1);
+    const Usage after = usage();
+    const size_t unstarted = open ? uxQueueMessagesWaiting(run->arrivals) : 0;
+    // Both point into run, which ends here
+    for (size_t w = 0; w < options.workers; w++) {
+        run->workers[w].client->setStageObserver(nullptr);
+        run->workers[w].client->setContentSink(nullptr);
+    }
+
+    // Merge per-worker results; the samples' own storage is left out of heap growth
+    WorkerStats total;
+    size_t sample_bytes = 0;
+    for (size_t w = 0; w < started; w++) {
+        WorkerStats& s = run->stats[w];
+        total.attempted += s.attempted;
+        total.succeeded += s.succeeded;
+        for (const auto& [what, n] : s.errors) total.errors[what] += n;
+        for (size_t i = 0; i < STAGE_COUNT; i++) {
+            sample_bytes += s.us[i].capacity() * sizeof(uint32_t);
+            total.us[i].insert(total.us[i].end(), s.us[i].begin(), s.us[i].end());
+            std::vector<uint32_t>().swap(s.us[i]);
+        }
+    }
+
+    const double elapsed_s = elapsed_us / 1e6;
+    const size_t payments = std::max<size_t>(total.attempted, 1);
+    const int64_t heap_growth = after.heap_bytes - before.heap_bytes - (int64_t)sample_bytes;
+
+    cJSON* root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "mode", modeName(options.mode));
+    cJSON_AddNumberToObject(root, "workers", started);
+    cJSON_AddNumberToObject(root, "rate", open ? options.rate : 0);
+    cJSON_AddNumberToObject(root, "duration_s", options.duration_s);
+    cJSON_AddNumberToObject(root, "elapsed_s", elapsed_s);
+    cJSON_AddNumberToObject(root, "arrivals", open ? arrivals : total.attempted);
+    cJSON_AddNumberToObject(root, "dropped_arrivals", dropped);
+    cJSON_AddNumberToObject(root, "unstarted_arrivals", unstarted);
+    cJSON_AddNumberToObject(root, "attempted", total.attempted);
+    cJSON_AddNumberToObject(root, "succeeded", total.succeeded);
+    cJSON_AddNumberToObject(root, "failed", total.attempted - total.succeeded);
+    cJSON_AddNumberToObject(root, "throughput_per_s", total.succeeded / elapsed_s);
+    cJSON_AddNumberToObject(root, "content_bytes", (double)run->bytes.load());
+
+    cJSON* latency = cJSON_AddObjectToObject(root, "latency_us");
+    for (size_t i = 0; i < STAGE_COUNT; i++) {
+        cJSON_AddItemToObject(latency, STAGE_NAMES[i], latencyJson(total.us[i]));
+    }
+    cJSON* errors = cJSON_AddObjectToObject(root, "errors");
+    for (const auto& [what, n] : total.errors) {
+        cJSON_AddNumberToObject(errors, what.c_str(), n);
+    }
+
+    cJSON_AddNumberToObject(root, "cpu_us_per_payment",
+                            (double)(after.cpu_us - before.cpu_us) / payments);
+    cJSON_AddNumberToObject(root, "heap_growth_bytes", (double)heap_growth);
+    cJSON_AddNumberToObject(root, "heap_growth_per_payment", (double)heap_growth / payments);
+    cJSON_AddNumberToObject(root, "max_rss_kb", after.max_rss_kb);
+
+    bool written = false;
+    char* json = cJSON_Print(root);
+    if (json) {
+        FILE* f = fopen(options.report_path, "w");
+        if (f) {
+            written = fputs(json, f) >= 0 && fputc('\n', f) != EOF;
+            written = (fclose(f) == 0) && written;
+        }
+        free(json);
+    }
+    cJSON_Delete(root);
+
+    std::vector<uint32_t>& totals = total.us[STAGE_TOTAL];
+    ESP_LOGI(TAG, "⏱️ %zu/%zu paid in %.1f s: %.1f payments/s, p50 %.1f ms, p99 %.1f ms, "
+             "%.0f us CPU/payment",
+             total.succeeded, total.attempted, elapsed_s, total.succeeded / elapsed_s,
+             percentile(totals, 0.50) / 1000.0, percentile(totals, 0.99) / 1000.0,
+             (double)(after.cpu_us - before.cpu_us) / payments);
+    if (dropped || unstarted) {
+        ESP_LOGW(TAG, "⚠️ Overloaded: %zu arrivals dropped, %zu never started", dropped, unstarted);
+    }
+
+    vSemaphoreDelete(run->finished);
+    if (run->arrivals) vQueueDelete(run->arrivals);
+
+    if (!written) {
+        ESP_LOGE(TAG, "❌ Failed to write %s", options.report_path);
+        return false;
+    }
+    ESP_LOGI(TAG, "📄 Report written to %s", options.report_path);
+    return true;
+}
+
+#endif // CONFIG_X402_LOADGEN
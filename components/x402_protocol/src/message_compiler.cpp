@@ -0,0 +1,196 @@
+#include "message_compiler.h"
+#include <esp_log.h>
+#include <cstring>
+
+static const char* TAG = "MessageCompiler";
+
+static const uint8_t MESSAGE_VERSION_PREFIX = 0x80;
+
+int AddressLookupTable::find(const uint8_t key[32]) const {
+    if (!valid) return -1;
+    for (int i = 0; i < count; i++) {
+        if (memcmp(addresses[i], key, 32) == 0) return i;
+    }
+    return -1;
+}
+
+MessageCompiler::MessageCompiler() {
+    reset();
+}
+
+void MessageCompiler::reset() {
+    accountCount_ = 0;
+    instructionCount_ = 0;
+    instructionDataLen_ = 0;
+    outLen_ = 0;
+    numSigners_ = 0;
+    numLoaded_ = 0;
+    overflow_ = false;
+}
+
+int MessageCompiler::addAccount(const uint8_t pubkey[32], bool isSigner, bool isWritable) {
+    for (size_t i = 0; i < accountCount_; i++) {
+        if (memcmp(accounts_[i].pubkey, pubkey, 32) == 0) {
+            accounts_[i].isSigner |= isSigner;
+            accounts_[i].isWritable |= isWritable;
+            return i;
+        }
+    }
+    if (accountCount_ == MAX_ACCOUNTS) {
+        ESP_LOGE(TAG, "❌ Too many accounts (max %zu)", MAX_ACCOUNTS);
+        overflow_ = true;
+        return -1;
+    }
+    Account& a = accounts_[accountCount_];
+    memcpy(a.pubkey, pubkey, 32);
+    a.isSigner = isSigner;
+    a.isWritable = isWritable;
+    a.isInvoked = false;
+    return accountCount_++;
+}
+
+bool MessageCompiler::addInstruction(const uint8_t programId[32],
+                                     const AccountMeta* metas, size_t metaCount,
+                                     const uint8_t* data, size_t dataLen) {
+    if (instructionCount_ == MAX_INSTRUCTIONS ||
+        metaCount > MAX_INSTRUCTION_ACCOUNTS ||
+        instructionDataLen_ + dataLen > MAX_INSTRUCTION_DATA) {
+        ESP_LOGE(TAG, "❌ Instruction does not fit");
+        overflow_ = true;
+        return false;
+    }
+
+    Instruction& ix = instructions_[instructionCount_];
+    for (size_t i = 0; i < metaCount; i++) {
+        int pos = addAccount(metas[i].pubkey, metas[i].isSigner, metas[i].isWritable);
+        if (pos < 0) return false;
+        ix.accountPos[i] = pos;
+    }
+    int programPos = addAccount(programId, false, false);
+    if (programPos < 0) return false;
+    accounts_[programPos].isInvoked = true;
+
+    ix.programPos = programPos;
+    ix.accountCount = metaCount;
+    ix.dataOffset = instructionDataLen_;
+    ix.dataLen = dataLen;
+    memcpy(instructionData_ + instructionDataLen_, data, dataLen);
+    instructionDataLen_ += dataLen;
+    instructionCount_++;
+    return true;
+}
+
+void MessageCompiler::put(const void* bytes, size_t len) {
+    if (outLen_ + len > sizeof(out_)) {
+        overflow_ = true;
+        return;
+    }
+    memcpy(out_ + outLen_, bytes, len);
+    outLen_ += len;
+}
+
+void MessageCompiler::putCompactU16(uint16_t value) {
+    uint8_t enc[3];
+    size_t n = 0;
+    do {
+        uint8_t b = value & 0x7f;
+        value >>= 7;
+        enc[n++] = value ? (b | 0x80) : b;
+    } while (value);
+    put(enc, n);
+}
+
+bool MessageCompiler::compile(const uint8_t recentBlockhash[32], const AddressLookupTable* lookupTable) {
+    outLen_ = 0;
+    numLoaded_ = 0;
+    if (overflow_ || accountCount_ == 0) {
+        return false;
+    }
+    if (!accounts_[0].isSigner || !accounts_[0].isWritable) {
+        ESP_LOGE(TAG, "❌ First account must be the fee payer (signer, writable)");
+        return false;
+    }
+
+    // Account order in the message: static keys by group, then loaded
+    // writable, then loaded readonly. index[] maps insertion order to it.
+    uint8_t index[MAX_ACCOUNTS];
+    uint8_t staticPos[MAX_ACCOUNTS];
+    uint8_t loadedWritable[MAX_ACCOUNTS], loadedReadonly[MAX_ACCOUNTS];
+    int8_t tableIndex[MAX_ACCOUNTS];
+    size_t staticCount = 0, loadedWritableCount = 0, loadedReadonlyCount = 0;
+    uint8_t numSigned = 0, numSignedReadonly = 0, numUnsignedReadonly = 0;
+
+    for (size_t i = 0; i < accountCount_; i++) {
+        const Account& a = accounts_[i];
+        tableIndex[i] = (lookupTable && !a.isSigner && !a.isInvoked) ? lookupTable->find(a.pubkey) : -1;
+    }
+
+    for (int group = 0; group < 4; group++) {
+        const bool signer = group < 2;
+        const bool writable = (group % 2) == 0;
+        for (size_t i = 0; i < accountCount_; i++) {
+            const Account& a = accounts_[i];
+            if (a.isSigner != signer || a.isWritable != writable || tableIndex[i] >= 0) continue;
+            staticPos[staticCount] = i;
+            index[i] = staticCount++;
+            if (signer) numSigned++;
+            if (signer && !writable) numSignedReadonly++;
+            if (!signer && !writable) numUnsignedReadonly++;
+        }
+    }
+    for (size_t i = 0; i < accountCount_; i++) {
+        if (tableIndex[i] >= 0 && accounts_[i].isWritable) {
+            index[i] = staticCount + loadedWritableCount;
+            loadedWritable[loadedWritableCount++] = tableIndex[i];
+        }
+    }
+    for (size_t i = 0; i < accountCount_; i++) {
+        if (tableIndex[i] >= 0 && !accounts_[i].isWritable) {
+            index[i] = staticCount + loadedWritableCount + loadedReadonlyCount;
+            loadedReadonly[loadedReadonlyCount++] = tableIndex[i];
+        }
+    }
+    numSigners_ = numSigned;
+    numLoaded_ = loadedWritableCount + loadedReadonlyCount;
+
+    if (lookupTable) {
+        put(&MESSAGE_VERSION_PREFIX, 1);
+    }
+    uint8_t header[3] = {numSigned, numSignedReadonly, numUnsignedReadonly};
+    put(header, 3);
+    putCompactU16(staticCount);
+    for (size_t s = 0; s < staticCount; s++) {
+        put(accounts_[staticPos[s]].pubkey, 32);
+    }
+    put(recentBlockhash, 32);
+
+    putCompactU16(instructionCount_);
+    for (size_t n = 0; n < instructionCount_; n++) {
+        const Instruction& ix = instructions_[n];
+        put(&index[ix.programPos], 1);
+        putCompactU16(ix.accountCount);
+        for (size_t i = 0; i < ix.accountCount; i++) {
+            put(&index[ix.accountPos[i]], 1);
+        }
+        putCompactU16(ix.dataLen);
+        put(instructionData_ + ix.dataOffset, ix.dataLen);
+    }
+
+    if (lookupTable) {
+        putCompactU16(numLoaded_ ? 1 : 0);
+        if (numLoaded_) {
+            put(lookupTable->address, 32);
+            putCompactU16(loadedWritableCount);
+            put(loadedWritable, loadedWritableCount);
+            putCompactU16(loadedReadonlyCount);
+            put(loadedReadonly, loadedReadonlyCount);
+        }
+    }
+
+    if (overflow_) {
+        ESP_LOGE(TAG, "❌ Message exceeds %zu bytes", PACKET_DATA_SIZE);
+        outLen_ = 0;
+        return false;
+    }
+    return true;
+}
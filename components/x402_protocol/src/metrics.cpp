@@ -0,0 +1,99 @@
+#include "metrics.h"
+#include <esp_log.h>
+#include <cstring>
+#include "freertos/FreeRTOS.h"
+
+static const char* TAG = "Metrics";
+
+namespace {
+
+struct MetricEntry {
+    const char* name;
+    uint32_t count;
+    int64_t sum;
+    int64_t min;
+    int64_t max;
+    int64_t last;
+    bool sampled;
+};
+
+MetricEntry s_entries[Metrics::MAX_METRICS];
+size_t s_num_entries = 0;
+portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Must be called with s_lock held
+MetricEntry* findOrCreate(const char* name) {
+    for (size_t i = 0; i < s_num_entries; i++) {
+        if (s_entries[i].name == name || strcmp(s_entries[i].name, name) == 0) {
+            return &s_entries[i];
+        }
+    }
+    if (s_num_entries >= Metrics::MAX_METRICS) {
+        return nullptr;
+    }
+    MetricEntry* e = &s_entries[s_num_entries++];
+    memset(e, 0, sizeof(*e));
+    e->name = name;
+    return e;
+}
+
+} // namespace
+
+void Metrics::increment(const char* name, uint32_t delta) {
+    portENTER_CRITICAL(&s_lock);
+    MetricEntry* e = findOrCreate(name);
+    if (e) {
+        e->count += delta;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void Metrics::observe(const char* name, int64_t value) {
+    portENTER_CRITICAL(&s_lock);
+    MetricEntry* e = findOrCreate(name);
+    if (e) {
+        if (!e->sampled || value < e->min) e->min = value;
+        if (!e->sampled || value > e->max) e->max = value;
+        e->sampled = true;
+        e->count++;
+        e->sum += value;
+        e->last = value;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+uint32_t Metrics::count(const char* name) {
+    uint32_t result = 0;
+    portENTER_CRITICAL(&s_lock);
+    for (size_t i = 0; i < s_num_entries; i++) {
+        if (strcmp(s_entries[i].name, name) == 0) {
+            result = s_entries[i].count;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return result;
+}
+
+void Metrics::dump() {
+    portENTER_CRITICAL(&s_lock);
+    size_t n = s_num_entries;
+    portEXIT_CRITICAL(&s_lock);
+
+    ESP_LOGI(TAG, "📊 %u metrics", (unsigned)n);
+    for (size_t i = 0; i < n; i++) {
+        // Entries are never removed, so copy one at a time and log outside the lock
+        portENTER_CRITICAL(&s_lock);
+        MetricEntry e = s_entries[i];
+        portEXIT_CRITICAL(&s_lock);
+
+        if (e.sampled) {
+            ESP_LOGI(TAG, "  %-28s n=%lu avg=%lld min=%lld max=%lld last=%lld",
+                     e.name, (unsigned long)e.count,
+                     (long long)(e.sum / (int64_t)e.count),
+                     (long long)e.min, (long long)e.max, (long long)e.last);
+        } else {
+            ESP_LOGI(TAG, "  %-28s %lu", e.name, (unsigned long)e.count);
+        }
+    }
+}
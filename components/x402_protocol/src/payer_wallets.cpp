@@ -0,0 +1,323 @@
+#include "payer_wallets.h"
+#include "crypto_utils.h"
+#include "solana_client.h"
+#include "transaction_view.h"
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <sodium.h>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+
+static const char* TAG = "PayerWallets";
+
+// m/44'/501'/i'/0', as Solana wallets derive their accounts
+static const uint32_t BIP44_PURPOSE = 44;
+static const uint32_t SOLANA_COIN_TYPE = 501;
+
+static_assert(PayerWallets::MAX_TOPUPS <= SolanaClient::MAX_FUNDINGS,
+              "A top-up plan must fit one funding transaction");
+
+PayerWallets::Lease::Lease(PayerWallets& wallets, int index)
+    : wallets_(wallets), index_(index) {
+    if (index_ == TREASURY) {
+        return;
+    }
+    portENTER_CRITICAL(&wallets_.lock_);
+    Wallet& w = wallets_.wallets_[index_];
+    w.in_flight++;
+    w.last_used_us = esp_timer_get_time();
+    portEXIT_CRITICAL(&wallets_.lock_);
+}
+
+PayerWallets::Lease::~Lease() {
+    wallets_.finish(index_);
+}
+
+const char* PayerWallets::policyName(Policy policy) {
+    switch (policy) {
+        case Policy::RoundRobin:       return "round-robin";
+        case Policy::LeastOutstanding: return "least-outstanding";
+    }
+    return "unknown";
+}
+
+bool PayerWallets::derive(const uint8_t seed[32], size_t index,
+                          uint8_t public_key[32], uint8_t secret_key[32]) {
+    const uint32_t path[] = {BIP44_PURPOSE, SOLANA_COIN_TYPE, (uint32_t)index, 0};
+    uint8_t sk64[64];
+    bool ok = CryptoUtils::slip10DeriveEd25519(seed, 32, path, 4, secret_key) &&
+              crypto_sign_seed_keypair(public_key, sk64, secret_key) == 0;
+    sodium_memzero(sk64, sizeof(sk64));
+    return ok;
+}
+
+PayerWallets::PayerWallets(Policy policy)
+    : policy_(policy)
+    , wallets_{}
+    , count_(0)
+    , next_(0)
+{
+    portMUX_INITIALIZE(&lock_);
+}
+
+PayerWallets::~PayerWallets() {
+    for (size_t i = 0; i < MAX_WALLETS; i++) {
+        sodium_memzero(wallets_[i].secret_key, sizeof(wallets_[i].secret_key));
+    }
+}
+
+bool PayerWallets::init(const uint8_t seed[32], size_t count, const uint8_t mint[32],
+                        SolanaClient& solana) {
+    count_ = 0;
+    if (count < 2) {
+        return true;
+    }
+    count = std::min(count, MAX_WALLETS);
+
+    for (size_t i = 0; i < count; i++) {
+        Wallet& w = wallets_[i];
+        uint8_t bump;
+        if (!derive(seed, i, w.public_key, w.secret_key) ||
+            !solana.deriveAssociatedTokenAddress(w.public_key, mint, w.ata, &bump)) {
+            ESP_LOGE(TAG, "❌ Failed to derive wallet %zu", i);
+            return false;
+        }
+        w.in_flight = 0;
+        w.last_used_us = 0;
+        w.topup_until_us = 0;
+    }
+    count_ = count;
+
+    char address[48];
+    for (size_t i = 0; i < count_; i++) {
+        if (CryptoUtils::bytesToBase58(wallets_[i].public_key, 32, address, sizeof(address))) {
+            ESP_LOGI(TAG, "👛 Wallet %zu (m/44'/501'/%zu'/0'): %s", i, i, address);
+        }
+    }
+    ESP_LOGI(TAG, "✅ %zu payer wallets, %s", count_, policyName(policy_));
+    return true;
+}
+
+int PayerWallets::pick(uint64_t amount) {
+    // Ledgers take their own locks; read them before taking ours
+    bool eligible[MAX_WALLETS];
+    for (size_t i = 0; i < count_; i++) {
+        const BalanceLedger& ledger = wallets_[i].ledger;
+        eligible[i] = ledger.isSeeded() && ledger.available() >= amount;
+    }
+
+    int chosen = TREASURY;
+    portENTER_CRITICAL(&lock_);
+    if (policy_ == Policy::RoundRobin) {
+        for (size_t n = 0; n < count_; n++) {
+            size_t i = (next_ + n) % count_;
+            if (eligible[i]) {
+                chosen = (int)i;
+                next_ = i + 1;
+                break;
+            }
+        }
+    } else {
+        for (size_t i = 0; i < count_; i++) {
+            if (!eligible[i]) continue;
+            const Wallet& w = wallets_[i];
+            if (chosen == TREASURY ||
+                w.in_flight < wallets_[chosen].in_flight ||
+                (w.in_flight == wallets_[chosen].in_flight &&
+                 w.last_used_us < wallets_[chosen].last_used_us)) {
+                chosen = (int)i;
+            }
+        }
+    }
+    portEXIT_CRITICAL(&lock_);
+    return chosen;
+}
+
+void PayerWallets::finish(int index) {
+    if (index == TREASURY) {
+        return;
+    }
+    portENTER_CRITICAL(&lock_);
+    Wallet& w = wallets_[index];
+    if (w.in_flight > 0) {
+        w.in_flight--;
+    }
+    portEXIT_CRITICAL(&lock_);
+}
+
+size_t PayerWallets::planTopUps(uint64_t treasury_available, TopUp* out) const {
+    if (count_ == 0) {
+        return 0;
+    }
+
+    uint64_t balances[MAX_WALLETS];
+    uint64_t total = treasury_available;
+    for (size_t i = 0; i < count_; i++) {
+        const BalanceLedger& ledger = wallets_[i].ledger;
+        balances[i] = ledger.isSeeded() ? ledger.available() : 0;
+        total += balances[i];
+    }
+    const uint64_t target = total / (count_ + 1);
+    if (target == 0) {
+        return 0;
+    }
+
+    int64_t now = esp_timer_get_time();
+    TopUp candidates[MAX_WALLETS];
+    size_t n = 0;
+    portENTER_CRITICAL(&lock_);
+    for (size_t i = 0; i < count_; i++) {
+        if (balances[i] < target / 2 && wallets_[i].topup_until_us <= now) {
+            candidates[n++] = {(uint8_t)i, target - balances[i]};
+        }
+    }
+    portEXIT_CRITICAL(&lock_);
+
+    std::sort(candidates, candidates + n,
+              [](const TopUp& a, const TopUp& b) { return a.amount > b.amount; });
+
+    size_t planned = 0;
+    uint64_t budget = treasury_available;
+    for (size_t i = 0; i < n && planned < MAX_TOPUPS; i++) {
+        if (candidates[i].amount > budget) continue;
+        budget -= candidates[i].amount;
+        out[planned++] = candidates[i];
+    }
+    return planned;
+}
+
+void PayerWallets::markToppedUp(const TopUp* topups, size_t count) {
+    int64_t until = esp_timer_get_time() + TOPUP_WINDOW_US;
+    portENTER_CRITICAL(&lock_);
+    for (size_t i = 0; i < count; i++) {
+        wallets_[topups[i].wallet].topup_until_us = until;
+    }
+    portEXIT_CRITICAL(&lock_);
+}
+
+// === Simulation ===
+
+namespace {
+
+using Key = std::array<uint8_t, 32>;
+
+struct Locks {
+    std::vector<Key> writable;
+    std::vector<Key> all;
+};
+
+bool contains(const std::vector<Key>& keys, const Key& key) {
+    return std::find(keys.begin(), keys.end(), key) != keys.end();
+}
+
+// The runtime runs two transactions in parallel unless one writes an
+// account the other reads or writes
+bool conflicts(const Locks& a, const Locks& b) {
+    for (const Key& k : a.writable) {
+        if (contains(b.all, k)) return true;
+    }
+    for (const Key& k : b.writable) {
+        if (contains(a.all, k)) return true;
+    }
+    return false;
+}
+
+Key syntheticKey(uint8_t tag, size_t index) {
+    Key key = {};
+    key[0] = tag;
+    for (int i = 0; i < 4; i++) key[1 + i] = (index >> (8 * i)) & 0xff;
+    return key;
+}
+
+}  // namespace
+
+void PayerWallets::simulate(const uint8_t seed[32], size_t wallets, size_t payments) {
+    wallets = std::max<size_t>(std::min(wallets, MAX_WALLETS), 1);
+
+    // Payer keys: the configured one, then the derived wallets
+    uint8_t payers[MAX_WALLETS + 1][32];
+    uint8_t sk64[64];
+    crypto_sign_seed_keypair(payers[0], sk64, seed);
+    sodium_memzero(sk64, sizeof(sk64));
+    for (size_t i = 0; i < wallets; i++) {
+        uint8_t secret[32];
+        bool ok = derive(seed, i, payers[i + 1], secret);
+        sodium_memzero(secret, sizeof(secret));
+        if (!ok) return;
+    }
+
+    char mint[48];
+    Key mint_key = syntheticKey(0xA0, 0);
+    CryptoUtils::bytesToBase58(mint_key.data(), 32, mint, sizeof(mint));
+    uint8_t blockhash[32] = {};
+    SolanaClient solana("");
+
+    for (int scenario = 0; scenario < 8; scenario++) {
+        const bool sharded = scenario & 1;
+        const bool many_merchants = scenario & 2;
+        const bool many_fee_payers = scenario & 4;
+
+        std::vector<Locks> txs;
+        txs.reserve(payments);
+        for (size_t p = 0; p < payments; p++) {
+            const uint8_t* payer = sharded ? payers[1 + p % wallets] : payers[0];
+            char pay_to[48], fee_payer[48];
+            Key merchant = syntheticKey(0xB0, many_merchants ? p : 0);
+            Key facilitator = syntheticKey(0xC0, many_fee_payers ? p : 0);
+            CryptoUtils::bytesToBase58(merchant.data(), 32, pay_to, sizeof(pay_to));
+            CryptoUtils::bytesToBase58(facilitator.data(), 32, fee_payer, sizeof(fee_payer));
+
+            std::vector<uint8_t> message;
+            if (!solana.buildTransaction(payer, pay_to, fee_payer, mint, 1000, 6,
+                                         blockhash, message)) {
+                ESP_LOGE(TAG, "❌ Simulation could not build payment %zu", p);
+                return;
+            }
+            // Unsigned wire transaction: the scheduler only looks at the accounts
+            std::vector<uint8_t> wire(1 + 64 * 2, 0);
+            wire[0] = 2;
+            wire.insert(wire.end(), message.begin(), message.end());
+
+            TransactionView view;
+            if (!view.parse(wire.data(), wire.size())) {
+                ESP_LOGE(TAG, "❌ Simulated TX rejected: %s",
+                         TransactionView::errorName(view.error()));
+                return;
+            }
+            Locks locks;
+            for (size_t a = 0; a < view.accountCount(); a++) {
+                Key key;
+                memcpy(key.data(), view.resolve(a), 32);
+                locks.all.push_back(key);
+                if (view.isWritable(a)) {
+                    locks.writable.push_back(key);
+                }
+            }
+            txs.push_back(std::move(locks));
+        }
+
+        // Arrival order is kept: a transaction runs in the round after the
+        // last earlier one it conflicts with
+        std::vector<size_t> round(txs.size(), 0);
+        std::vector<size_t> per_round;
+        for (size_t t = 0; t < txs.size(); t++) {
+            for (size_t e = 0; e < t; e++) {
+                if (round[e] + 1 > round[t] && conflicts(txs[t], txs[e])) {
+                    round[t] = round[e] + 1;
+                }
+            }
+            if (round[t] >= per_round.size()) per_round.resize(round[t] + 1, 0);
+            per_round[round[t]]++;
+        }
+        size_t widest = per_round.empty() ? 0 : *std::max_element(per_round.begin(), per_round.end());
+
+        ESP_LOGI(TAG, "⏱️ %zu payer%s, %s merchant%s, %s fee payer%s: %zu payments in %zu lock rounds "
+                 "(up to %zu in parallel)",
+                 sharded ? wallets : 1, sharded && wallets > 1 ? "s" : "",
+                 many_merchants ? "many" : "one", many_merchants ? "s" : "",
+                 many_fee_payers ? "many" : "one", many_fee_payers ? "s" : "",
+                 txs.size(), per_round.size(), widest);
+    }
+}
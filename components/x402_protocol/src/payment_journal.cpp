@@ -0,0 +1,497 @@
+#include "payment_journal.h"
+#include "metrics.h"
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_rom_crc.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+#if CONFIG_IDF_TARGET_LINUX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char* TAG = "Journal";
+
+// On-flash layout; seq and crc are filled in when the record is written
+struct PaymentJournal::Record {
+    uint32_t seq;               // 0xFFFFFFFF = erased
+    uint32_t id;
+    uint64_t amount;
+    uint8_t type;
+    uint8_t payer;              // Zero in records written before payer wallets
+    uint8_t reserved[2];
+    uint8_t signature[64];
+    char resource[RESOURCE_MAX];
+    uint32_t crc;               // CRC32 of everything before it
+};
+
+static constexpr size_t RECORDS_PER_SECTOR = PaymentJournal::SECTOR_SIZE / PaymentJournal::RECORD_SIZE;
+static constexpr uint32_t ERASED_SEQ = 0xFFFFFFFF;
+
+namespace {
+
+struct MutexGuard {
+    SemaphoreHandle_t m;
+    explicit MutexGuard(SemaphoreHandle_t mutex) : m(mutex) { xSemaphoreTake(m, portMAX_DELAY); }
+    ~MutexGuard() { xSemaphoreGive(m); }
+};
+
+bool isTerminal(uint8_t type) {
+    return type == PaymentJournal::SETTLED || type == PaymentJournal::ABORTED;
+}
+
+}  // namespace
+
+PaymentJournal::PaymentJournal()
+    : open_(false)
+    , size_(0)
+    , slots_(0)
+    , next_slot_(0)
+    , prepared_sector_(SIZE_MAX)
+    , next_seq_(1)
+    , next_id_(1)
+#if CONFIG_IDF_TARGET_LINUX
+    , fd_(-1)
+#else
+    , partition_(nullptr)
+#endif
+    , stage_(new Record[STAGE_CAPACITY])
+    , stage_count_(0)
+    , live_used_{}
+    , mutex_(xSemaphoreCreateMutex())
+{
+    static_assert(sizeof(Record) == RECORD_SIZE, "Record must fill one slot");
+}
+
+PaymentJournal::~PaymentJournal() {
+    if (open_) {
+        flush();
+    }
+    closeBacking();
+    delete[] stage_;
+    if (mutex_) {
+        vSemaphoreDelete(mutex_);
+    }
+}
+
+bool PaymentJournal::openBacking(const char* source) {
+#if CONFIG_IDF_TARGET_LINUX
+    fd_ = ::open(source, O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+        closeBacking();
+        return false;
+    }
+    // A new (or short) file reads as erased flash
+    if ((size_t)st.st_size < FILE_SIZE) {
+        std::vector<uint8_t> erased(FILE_SIZE - st.st_size, 0xFF);
+        if (pwrite(fd_, erased.data(), erased.size(), st.st_size) != (ssize_t)erased.size()) {
+            closeBacking();
+            return false;
+        }
+    }
+    size_ = FILE_SIZE;
+    return true;
+#else
+    partition_ = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, source);
+    if (!partition_) {
+        return false;
+    }
+    size_ = partition_->size / SECTOR_SIZE * SECTOR_SIZE;
+    return true;
+#endif
+}
+
+void PaymentJournal::closeBacking() {
+#if CONFIG_IDF_TARGET_LINUX
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+#else
+    partition_ = nullptr;
+#endif
+}
+
+bool PaymentJournal::readRecord(size_t slot, Record& out) const {
+#if CONFIG_IDF_TARGET_LINUX
+    return pread(fd_, &out, RECORD_SIZE, slot * RECORD_SIZE) == (ssize_t)RECORD_SIZE;
+#else
+    return esp_partition_read(partition_, slot * RECORD_SIZE, &out, RECORD_SIZE) == ESP_OK;
+#endif
+}
+
+bool PaymentJournal::writeRecords(size_t slot, Record* records, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        records[i].seq = next_seq_++;
+        records[i].crc = esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&records[i]),
+                                          offsetof(Record, crc));
+    }
+    size_t len = count * RECORD_SIZE;
+#if CONFIG_IDF_TARGET_LINUX
+    bool ok = pwrite(fd_, records, len, slot * RECORD_SIZE) == (ssize_t)len && fsync(fd_) == 0;
+#else
+    bool ok = esp_partition_write(partition_, slot * RECORD_SIZE, records, len) == ESP_OK;
+#endif
+    if (!ok) {
+        ESP_LOGE(TAG, "❌ Write of %zu records at slot %zu failed", count, slot);
+    }
+    return ok;
+}
+
+bool PaymentJournal::eraseSector(size_t sector) {
+#if CONFIG_IDF_TARGET_LINUX
+    std::vector<uint8_t> erased(SECTOR_SIZE, 0xFF);
+    bool ok = pwrite(fd_, erased.data(), SECTOR_SIZE, sector * SECTOR_SIZE) == (ssize_t)SECTOR_SIZE;
+#else
+    bool ok = esp_partition_erase_range(partition_, sector * SECTOR_SIZE, SECTOR_SIZE) == ESP_OK;
+#endif
+    if (ok) {
+        Metrics::increment("journal.erases");
+    } else {
+        ESP_LOGE(TAG, "❌ Erase of sector %zu failed", sector);
+    }
+    return ok;
+}
+
+bool PaymentJournal::isSectorErased(size_t sector) const {
+    Record rec;
+    for (size_t i = 0; i < RECORDS_PER_SECTOR; i++) {
+        if (!readRecord(sector * RECORDS_PER_SECTOR + i, rec)) {
+            return false;
+        }
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&rec);
+        if (!std::all_of(bytes, bytes + RECORD_SIZE, [](uint8_t b) { return b == 0xFF; })) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PaymentJournal::enterSector(size_t sector) {
+    size_t sectors = size_ / SECTOR_SIZE;
+    size_t oldest = (sector + 1) % sectors;
+
+    if (!isSectorErased(oldest)) {
+        // The oldest sector may still hold the newest record of an unfinished
+        // payment: re-append every live payment before it goes
+        size_t room = RECORDS_PER_SECTOR - next_slot_ % RECORDS_PER_SECTOR;
+        size_t n = 0;
+        std::unique_ptr<Record[]> copies(new Record[std::min(MAX_LIVE, room)]);
+        for (size_t i = 0; i < MAX_LIVE && n < room; i++) {
+            if (!live_used_[i]) continue;
+            const Entry& e = live_[i];
+            Record& r = copies[n++];
+            memset(&r, 0, sizeof(r));
+            r.id = e.id;
+            r.amount = e.amount;
+            r.type = e.state;
+            r.payer = e.payer;
+            memcpy(r.signature, e.signature, 64);
+            memcpy(r.resource, e.resource, RESOURCE_MAX);
+        }
+        if (n > 0) {
+            if (!writeRecords(next_slot_, copies.get(), n)) {
+                return false;
+            }
+            next_slot_ = (next_slot_ + n) % slots_;
+            Metrics::increment("journal.compacted", n);
+        }
+        if (!eraseSector(oldest)) {
+            return false;
+        }
+    }
+    prepared_sector_ = sector;
+    return true;
+}
+
+int PaymentJournal::findLocked(uint32_t id) const {
+    for (size_t i = 0; i < MAX_LIVE; i++) {
+        if (live_used_[i] && live_[i].id == id) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+bool PaymentJournal::applyLocked(const Entry& entry) {
+    int i = findLocked(entry.id);
+    if (isTerminal(entry.state)) {
+        if (i >= 0) live_used_[i] = false;
+        return true;
+    }
+    if (i < 0) {
+        for (size_t j = 0; j < MAX_LIVE; j++) {
+            if (!live_used_[j]) { i = (int)j; break; }
+        }
+        if (i < 0) {
+            return false;
+        }
+        live_used_[i] = true;
+    }
+    live_[i] = entry;
+    return true;
+}
+
+bool PaymentJournal::appendLocked(const Entry& entry) {
+    if (stage_count_ == STAGE_CAPACITY && !flushLocked()) {
+        return false;
+    }
+    if (!applyLocked(entry)) {
+        return false;
+    }
+
+    Record& r = stage_[stage_count_++];
+    memset(&r, 0, sizeof(r));
+    r.id = entry.id;
+    r.amount = entry.amount;
+    r.type = entry.state;
+    r.payer = entry.payer;
+    memcpy(r.signature, entry.signature, 64);
+    memcpy(r.resource, entry.resource, RESOURCE_MAX);
+    Metrics::increment("journal.records");
+    return true;
+}
+
+bool PaymentJournal::flushLocked() {
+    if (stage_count_ == 0) {
+        return true;
+    }
+
+    size_t written = 0;
+    while (written < stage_count_) {
+        if (next_slot_ / RECORDS_PER_SECTOR != prepared_sector_ &&
+            !enterSector(next_slot_ / RECORDS_PER_SECTOR)) {
+            return false;
+        }
+        // One write per sector: the batch only splits where the log crosses into the next one
+        size_t room = RECORDS_PER_SECTOR - next_slot_ % RECORDS_PER_SECTOR;
+        size_t n = std::min(room, stage_count_ - written);
+        bool ok = writeRecords(next_slot_, stage_ + written, n);
+        // A failed write may have programmed part of the range; never reuse it
+        next_slot_ = (next_slot_ + n) % slots_;
+        if (!ok) {
+            // Keep what did not make it for the next attempt
+            memmove(stage_, stage_ + written, (stage_count_ - written) * sizeof(Record));
+            stage_count_ -= written;
+            return false;
+        }
+        written += n;
+    }
+
+    Metrics::increment("journal.flushes");
+    Metrics::observe("journal.batch_records", stage_count_);
+    stage_count_ = 0;
+    return true;
+}
+
+bool PaymentJournal::open(const char* source) {
+    if (!mutex_ || !stage_) {
+        return false;
+    }
+    MutexGuard guard(mutex_);
+    if (open_) {
+        return true;
+    }
+
+    int64_t start = esp_timer_get_time();
+    if (!openBacking(source) || size_ < 2 * SECTOR_SIZE) {
+        ESP_LOGW(TAG, "⚠️ No journal storage '%s'", source);
+        closeBacking();
+        return false;
+    }
+    slots_ = size_ / RECORD_SIZE;
+
+    // (seq, slot) of every intact record
+    std::vector<std::pair<uint32_t, uint16_t>> valid;
+    Record rec;
+    uint32_t max_id = 0;
+    for (size_t slot = 0; slot < slots_; slot++) {
+        if (!readRecord(slot, rec) || rec.seq == ERASED_SEQ) continue;
+        uint32_t crc = esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&rec), offsetof(Record, crc));
+        if (crc != rec.crc) {
+            Metrics::increment("journal.torn_records");
+            continue;
+        }
+        valid.emplace_back(rec.seq, (uint16_t)slot);
+        max_id = std::max(max_id, rec.id);
+    }
+    std::sort(valid.begin(), valid.end());
+
+    // Replay in write order; the newest record of each payment wins
+    for (const auto& v : valid) {
+        if (!readRecord(v.second, rec)) continue;
+        Entry e = {};
+        e.id = rec.id;
+        e.state = static_cast<Type>(rec.type);
+        e.amount = rec.amount;
+        e.payer = rec.payer;
+        memcpy(e.signature, rec.signature, 64);
+        memcpy(e.resource, rec.resource, RESOURCE_MAX);
+        e.resource[RESOURCE_MAX - 1] = '\0';
+        if (!applyLocked(e)) {
+            ESP_LOGW(TAG, "⚠️ More than %zu unfinished payments, dropping #%lu",
+                     MAX_LIVE, (unsigned long)e.id);
+        }
+    }
+
+    if (valid.empty()) {
+        // Blank or foreign contents: start a fresh log
+        for (size_t s = 0; s < 2; s++) {
+            if (!isSectorErased(s) && !eraseSector(s)) {
+                closeBacking();
+                return false;
+            }
+        }
+        next_slot_ = 0;
+        next_seq_ = 1;
+    } else {
+        next_seq_ = valid.back().first + 1;
+        next_slot_ = (valid.back().second + 1) % slots_;
+    }
+    next_id_ = max_id + 1;
+
+    // Skip slots a torn write left dirty; they cannot be programmed again
+    // until their sector is erased
+    if (next_slot_ % RECORDS_PER_SECTOR != 0) {
+        size_t sector = next_slot_ / RECORDS_PER_SECTOR;
+        while (next_slot_ / RECORDS_PER_SECTOR == sector) {
+            if (!readRecord(next_slot_, rec)) break;
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&rec);
+            if (std::all_of(bytes, bytes + RECORD_SIZE, [](uint8_t b) { return b == 0xFF; })) break;
+            next_slot_ = (next_slot_ + 1) % slots_;
+        }
+    }
+    if (next_slot_ % RECORDS_PER_SECTOR == 0) {
+        // The previous run stopped on a boundary; the sector ahead was erased
+        // then, unless that erase was cut short
+        if (!isSectorErased(next_slot_ / RECORDS_PER_SECTOR) &&
+            !eraseSector(next_slot_ / RECORDS_PER_SECTOR)) {
+            closeBacking();
+            return false;
+        }
+    } else if (!enterSector(next_slot_ / RECORDS_PER_SECTOR)) {
+        // Re-checks the sector ahead in case the last compaction was cut short
+        closeBacking();
+        return false;
+    }
+    open_ = true;
+
+    // Anything that never reached SUBMITTED never left the device
+    size_t aborted = 0;
+    size_t unresolved = 0;
+    for (size_t i = 0; i < MAX_LIVE; i++) {
+        if (!live_used_[i]) continue;
+        live_[i].recorded_at_us = 0;
+        if (live_[i].state == SUBMITTED) {
+            unresolved++;
+            continue;
+        }
+        Entry e = live_[i];
+        e.state = ABORTED;
+        appendLocked(e);
+        aborted++;
+    }
+    flushLocked();
+
+    Metrics::observe("journal.open_us", esp_timer_get_time() - start);
+    ESP_LOGI(TAG, "📒 Journal open: %zu records, %zu unresolved, %zu aborted",
+             valid.size(), unresolved, aborted);
+    return true;
+}
+
+uint32_t PaymentJournal::begin(const char* resource, uint64_t amount, uint8_t payer) {
+    if (!open_) {
+        return 0;
+    }
+    MutexGuard guard(mutex_);
+
+    Entry e = {};
+    e.id = next_id_;
+    e.state = INTENT;
+    e.amount = amount;
+    e.payer = payer;
+    strncpy(e.resource, resource, RESOURCE_MAX - 1);
+    e.recorded_at_us = esp_timer_get_time();
+    if (!appendLocked(e)) {
+        ESP_LOGW(TAG, "⚠️ Journal full, payment not journaled");
+        Metrics::increment("journal.full");
+        return 0;
+    }
+    return next_id_++;
+}
+
+bool PaymentJournal::record(uint32_t id, Type type, const uint8_t signature[64]) {
+    if (!open_ || id == 0) {
+        return false;
+    }
+    MutexGuard guard(mutex_);
+
+    int i = findLocked(id);
+    if (i < 0) {
+        return false;
+    }
+    Entry e = live_[i];
+    e.state = type;
+    if (signature) {
+        memcpy(e.signature, signature, 64);
+    }
+    e.recorded_at_us = esp_timer_get_time();
+    if (!appendLocked(e)) {
+        return false;
+    }
+    return type == SUBMITTED ? flushLocked() : true;
+}
+
+bool PaymentJournal::flush() {
+    if (!open_) {
+        return false;
+    }
+    MutexGuard guard(mutex_);
+    return flushLocked();
+}
+
+bool PaymentJournal::findUnresolved(const char* resource, Entry& out) const {
+    if (!open_) {
+        return false;
+    }
+    MutexGuard guard(mutex_);
+    for (size_t i = 0; i < MAX_LIVE; i++) {
+        if (live_used_[i] && live_[i].state == SUBMITTED &&
+            strncmp(live_[i].resource, resource, RESOURCE_MAX - 1) == 0) {
+            out = live_[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t PaymentJournal::unresolved(Entry* out, size_t max) const {
+    if (!open_) {
+        return 0;
+    }
+    MutexGuard guard(mutex_);
+    size_t n = 0;
+    for (size_t i = 0; i < MAX_LIVE && n < max; i++) {
+        if (live_used_[i] && live_[i].state == SUBMITTED) {
+            out[n++] = live_[i];
+        }
+    }
+    return n;
+}
+
+size_t PaymentJournal::staged() const {
+    if (!open_) {
+        return 0;
+    }
+    MutexGuard guard(mutex_);
+    return stage_count_;
+}
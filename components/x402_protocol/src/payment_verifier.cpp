@@ -0,0 +1,348 @@
+#include "payment_verifier.h"
+#include "crypto_utils.h"
+#include "payment_scheme.h"
+#include "solana_client.h"
+#include "transaction_view.h"
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <cJSON.h>
+#include <sodium.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+static const char* TAG = "PaymentVerifier";
+
+static constexpr size_t MAX_TX_SIZE = MessageCompiler::PACKET_DATA_SIZE;
+static constexpr size_t MAX_JSON = PaymentVerifier::MAX_HEADER / 4 * 3;
+
+static constexpr uint8_t COMPUTE_IX_SET_UNIT_LIMIT = 2;
+static constexpr uint8_t COMPUTE_IX_SET_UNIT_PRICE = 3;
+static constexpr size_t SET_UNIT_LIMIT_DATA = 5;        // tag, u32 units
+static constexpr size_t SET_UNIT_PRICE_DATA = 9;        // tag, u64 micro-lamports
+static constexpr uint32_t SYSTEM_IX_ADVANCE_NONCE_ACCOUNT = 4;
+static constexpr size_t ADVANCE_NONCE_ACCOUNTS = 3;     // nonce, RecentBlockhashes, authority
+static constexpr uint8_t TOKEN_IX_TRANSFER_CHECKED = 12;
+static constexpr size_t TRANSFER_CHECKED_DATA = 10;    // tag, u64 amount, u8 decimals
+static constexpr uint8_t FEE_PAYER_INDEX = 0;
+
+static uint64_t readU64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static uint32_t readU32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+const char* PaymentVerifier::resultName(Result result) {
+    switch (result) {
+        case Result::Ok:                 return "ok";
+        case Result::BadEncoding:        return "bad-encoding";
+        case Result::BadJson:            return "bad-json";
+        case Result::WrongScheme:        return "wrong-scheme";
+        case Result::Malformed:          return "malformed";
+        case Result::WrongFeePayer:      return "wrong-fee-payer";
+        case Result::UnknownInstruction: return "unknown-instruction";
+        case Result::ComputeBudget:      return "compute-budget";
+        case Result::FeePayerSpends:     return "fee-payer-spends";
+        case Result::ExtraTransfer:      return "extra-transfer";
+        case Result::NoTransfer:         return "no-transfer";
+        case Result::WrongRecipient:     return "wrong-recipient";
+        case Result::WrongMint:          return "wrong-mint";
+        case Result::WrongAmount:        return "wrong-amount";
+        case Result::Unresolved:         return "unresolved";
+        case Result::BadSignature:       return "bad-signature";
+    }
+    return "?";
+}
+
+PaymentVerifier::PaymentVerifier()
+    : amount_(0), lookup_table_(nullptr), ready_(false),
+      generation_(0), active_(0), stop_(false), jobs_(nullptr), count_(0), next_(0), done_(0) {
+    memset(pay_to_, 0, sizeof(pay_to_));
+    memset(mint_, 0, sizeof(mint_));
+    memset(fee_payer_, 0, sizeof(fee_payer_));
+    memset(destination_, 0, sizeof(destination_));
+    network_[0] = '\0';
+}
+
+PaymentVerifier::~PaymentVerifier() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    work_cv_.notify_all();
+    for (auto& worker : workers_) worker.join();
+}
+
+bool PaymentVerifier::init(const Offer& offer, size_t threads) {
+    if (ready_) return true;
+    if (!offer.network || strlen(offer.network) >= sizeof(network_)) {
+        ESP_LOGE(TAG, "❌ Offer has no usable network");
+        return false;
+    }
+    if (!offer.pay_to || !offer.asset || !offer.fee_payer ||
+        !CryptoUtils::base58ToBytes(offer.pay_to, pay_to_) ||
+        !CryptoUtils::base58ToBytes(offer.asset, mint_) ||
+        !CryptoUtils::base58ToBytes(offer.fee_payer, fee_payer_)) {
+        ESP_LOGE(TAG, "❌ Offer keys do not decode");
+        return false;
+    }
+    if (sodium_init() < 0) {
+        ESP_LOGE(TAG, "❌ libsodium initialization failed");
+        return false;
+    }
+
+    // Derived once here instead of per header
+    SolanaClient solana("");
+    uint8_t bump;
+    if (!solana.deriveAssociatedTokenAddress(pay_to_, mint_, destination_, &bump)) {
+        ESP_LOGE(TAG, "❌ Failed to derive the payTo ATA");
+        return false;
+    }
+
+    strcpy(network_, offer.network);
+    amount_ = offer.amount;
+    lookup_table_ = offer.lookup_table;
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < threads; i++) {
+        workers_.emplace_back(&PaymentVerifier::workerLoop, this);
+    }
+    ready_ = true;
+    ESP_LOGI(TAG, "✅ Verifier ready for %s, %zu workers", network_, threads);
+    return true;
+}
+
+PaymentVerifier::Result PaymentVerifier::check(const char* header, size_t len,
+                                               uint8_t* tx, Signed* out) const {
+    char json[MAX_JSON];
+    size_t json_len = 0;
+    if (len > MAX_HEADER ||
+        !CryptoUtils::base64Decode(header, len, reinterpret_cast<uint8_t*>(json), sizeof(json), &json_len)) {
+        return Result::BadEncoding;
+    }
+
+    cJSON* root = cJSON_ParseWithLength(json, json_len);
+    if (!root) return Result::BadJson;
+
+    cJSON* version = cJSON_GetObjectItemCaseSensitive(root, "x402Version");
+    cJSON* scheme = cJSON_GetObjectItemCaseSensitive(root, "scheme");
+    cJSON* network = cJSON_GetObjectItemCaseSensitive(root, "network");
+    cJSON* payload = cJSON_GetObjectItemCaseSensitive(
+        cJSON_GetObjectItemCaseSensitive(root, "payload"), x402::SolanaExact::PAYLOAD_FIELD);
+
+    Result result = Result::Ok;
+    size_t tx_len = 0;
+    if (!cJSON_IsNumber(version) || !cJSON_IsString(scheme) ||
+        !cJSON_IsString(network) || !cJSON_IsString(payload)) {
+        result = Result::BadJson;
+    } else if (version->valueint != atoi(x402::VERSION) ||
+               strcmp(scheme->valuestring, x402::SolanaExact::NAME) != 0 ||
+               strcmp(network->valuestring, network_) != 0) {
+        result = Result::WrongScheme;
+    } else if (!CryptoUtils::base64Decode(payload->valuestring, strlen(payload->valuestring),
+                                          tx, MAX_TX_SIZE, &tx_len)) {
+        result = Result::BadEncoding;
+    }
+    cJSON_Delete(root);
+    if (result != Result::Ok) return result;
+
+    TransactionView view;
+    if (!view.parse(tx, tx_len)) return Result::Malformed;
+
+    // The facilitator signs as fee payer; nothing else may spend its lamports
+    if (memcmp(view.accountKey(FEE_PAYER_INDEX).data(), fee_payer_, 32) != 0) return Result::WrongFeePayer;
+
+    Result transfer = Result::NoTransfer;
+    for (size_t i = 0; i < view.instructionCount(); i++) {
+        const TransactionView::Instruction& ix = view.instruction(i);
+        const uint8_t* program = view.accountKey(ix.program).data();
+        TransactionView::Bytes data = ix.data;
+
+        // The fee payer pays for every compute unit at the set price
+        if (memcmp(program, SolanaClient::COMPUTE_BUDGET_PROGRAM_ID, 32) == 0) {
+            if (data.size() == SET_UNIT_LIMIT_DATA && data[0] == COMPUTE_IX_SET_UNIT_LIMIT) {
+                if (readU32(data.data() + 1) > MAX_UNIT_LIMIT) return Result::ComputeBudget;
+            } else if (data.size() == SET_UNIT_PRICE_DATA && data[0] == COMPUTE_IX_SET_UNIT_PRICE) {
+                if (readU64(data.data() + 1) > MAX_UNIT_PRICE) return Result::ComputeBudget;
+            } else {
+                return Result::UnknownInstruction;
+            }
+            continue;
+        }
+
+        if (memcmp(program, SolanaClient::SYSTEM_PROGRAM_ID, 32) == 0) {
+            // Only AdvanceNonceAccount, only in first place, and not on the
+            // facilitator's authority
+            if (i != 0 || data.size() != 4 || readU32(data.data()) != SYSTEM_IX_ADVANCE_NONCE_ACCOUNT ||
+                ix.accounts.size() != ADVANCE_NONCE_ACCOUNTS) {
+                return Result::UnknownInstruction;
+            }
+            if (ix.accounts[0] == FEE_PAYER_INDEX || ix.accounts[2] == FEE_PAYER_INDEX) {
+                return Result::FeePayerSpends;
+            }
+            continue;
+        }
+
+        if (memcmp(program, SolanaClient::SPL_TOKEN_PROGRAM_ID, 32) != 0 ||
+            data.size() != TRANSFER_CHECKED_DATA || data[0] != TOKEN_IX_TRANSFER_CHECKED ||
+            ix.accounts.size() != 4) {
+            return Result::UnknownInstruction;
+        }
+
+        // TransferChecked: source, mint, destination, authority. Exactly one,
+        // so the facilitator's signature cannot carry a second transfer.
+        if (transfer != Result::NoTransfer) return Result::ExtraTransfer;
+        uint8_t source = ix.accounts[0];
+        const uint8_t* mint = view.resolve(ix.accounts[1], lookup_table_);
+        const uint8_t* destination = view.resolve(ix.accounts[2], lookup_table_);
+        uint8_t authority = ix.accounts[3];
+
+        if (source == FEE_PAYER_INDEX || authority == FEE_PAYER_INDEX) {
+            transfer = Result::FeePayerSpends;
+        } else if (!mint || !destination) {
+            transfer = Result::Unresolved;
+        } else if (memcmp(destination, destination_, 32) != 0) {
+            transfer = Result::WrongRecipient;
+        } else if (memcmp(mint, mint_, 32) != 0) {
+            transfer = Result::WrongMint;
+        } else if (readU64(data.data() + 1) != amount_) {
+            transfer = Result::WrongAmount;
+        } else if (!view.isSigner(authority)) {
+            transfer = Result::BadSignature;        // Authority is not a signer
+        } else {
+            transfer = Result::Ok;
+            out->message = view.message().data();
+            out->message_len = view.message().size();
+            out->signature = view.signature(authority).data();
+            out->signer = view.accountKey(authority).data();
+        }
+    }
+    return transfer;
+}
+
+bool PaymentVerifier::signatureValid(const Signed& s) {
+    return crypto_sign_verify_detached(s.signature, s.message, s.message_len, s.signer) == 0;
+}
+
+PaymentVerifier::Result PaymentVerifier::verify(const char* header, size_t len) const {
+    uint8_t tx[MAX_TX_SIZE];
+    Signed s;
+    Result result = check(header, len, tx, &s);
+    if (result == Result::Ok && !signatureValid(s)) {
+        result = Result::BadSignature;
+    }
+    return result;
+}
+
+// === Worker pool ===
+
+void PaymentVerifier::runBatch(Job* jobs, size_t count, uint8_t* tx, Signed* pending) const {
+    for (size_t i = 0; i < count; i++) {
+        jobs[i].result = check(jobs[i].header, jobs[i].len, tx + i * MAX_TX_SIZE, &pending[i]);
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (jobs[i].result == Result::Ok && !signatureValid(pending[i])) {
+            jobs[i].result = Result::BadSignature;
+        }
+    }
+}
+
+void PaymentVerifier::workerLoop() {
+    std::vector<uint8_t> tx(BATCH_SIZE * MAX_TX_SIZE);
+    Signed pending[BATCH_SIZE];
+    uint64_t seen = 0;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        work_cv_.wait(lock, [&] { return stop_ || generation_ != seen; });
+        if (stop_) return;
+        seen = generation_;
+        Job* jobs = jobs_;
+        size_t count = count_;
+        active_++;
+        lock.unlock();
+
+        for (;;) {
+            size_t start = next_.fetch_add(BATCH_SIZE);
+            if (start >= count) break;
+            size_t n = std::min(BATCH_SIZE, count - start);
+            runBatch(jobs + start, n, tx.data(), pending);
+            done_.fetch_add(n);
+        }
+
+        lock.lock();
+        active_--;
+        done_cv_.notify_all();
+    }
+}
+
+void PaymentVerifier::verifyAll(Job* jobs, size_t count) {
+    if (count == 0) return;
+    if (workers_.empty()) {
+        for (size_t i = 0; i < count; i++) jobs[i].result = verify(jobs[i].header, jobs[i].len);
+        return;
+    }
+
+    std::lock_guard<std::mutex> call(call_mutex_);
+    std::unique_lock<std::mutex> lock(mutex_);
+    // A worker that woke late for the previous call may still be claiming
+    done_cv_.wait(lock, [&] { return active_ == 0; });
+    jobs_ = jobs;
+    count_ = count;
+    next_ = 0;
+    done_ = 0;
+    generation_++;
+    work_cv_.notify_all();
+    done_cv_.wait(lock, [&] { return active_ == 0 && done_.load() == count; });
+}
+
+void PaymentVerifier::benchmark(const Offer& offer, const char* header, size_t count) {
+    const size_t len = strlen(header);
+    const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+
+    // Single-thread split between the checks and the signature
+    {
+        PaymentVerifier single;
+        if (!single.init(offer, 1)) return;
+        uint8_t tx[MAX_TX_SIZE];
+        Signed s;
+        Result result = single.check(header, len, tx, &s);
+        if (result == Result::Ok && !signatureValid(s)) result = Result::BadSignature;
+        if (result != Result::Ok) {
+            ESP_LOGE(TAG, "❌ Benchmark header rejected: %s", resultName(result));
+            return;
+        }
+
+        int64_t t0 = esp_timer_get_time();
+        for (size_t i = 0; i < count; i++) single.check(header, len, tx, &s);
+        int64_t check_us = esp_timer_get_time() - t0;
+        t0 = esp_timer_get_time();
+        for (size_t i = 0; i < count; i++) signatureValid(s);
+        int64_t sig_us = esp_timer_get_time() - t0;
+        ESP_LOGI(TAG, "⏱️ Per header: %.1f us decode/parse/checks, %.1f us ed25519",
+                 (double)check_us / count, (double)sig_us / count);
+    }
+
+    std::vector<Job> jobs(count, Job{header, len, Result::Ok});
+    for (size_t threads = 1;; threads = std::min(threads * 2, cores)) {
+        PaymentVerifier verifier;
+        if (!verifier.init(offer, threads)) return;
+
+        int64_t t0 = esp_timer_get_time();
+        verifier.verifyAll(jobs.data(), jobs.size());
+        int64_t us = std::max<int64_t>(esp_timer_get_time() - t0, 1);
+
+        size_t ok = std::count_if(jobs.begin(), jobs.end(),
+                                  [](const Job& j) { return j.result == Result::Ok; });
+        double rate = count * 1e6 / us;
+        ESP_LOGI(TAG, "⏱️ %zu workers: %.0f verifications/s, %.0f per core (%zu/%zu ok)",
+                 threads, rate, rate / threads, ok, count);
+        if (threads == cores) break;
+    }
+}
@@ -0,0 +1,132 @@
+#include "presigned_pool.h"
+#include <esp_timer.h>
+#include <cstring>
+#include <cstdlib>
+
+PresignedPool::PresignedPool() {
+    portMUX_INITIALIZE(&lock_);
+    memset(entries_, 0, sizeof(entries_));
+    memset(used_, 0, sizeof(used_));
+}
+
+PresignedPool::~PresignedPool() {
+    for (size_t i = 0; i < CAPACITY; i++) {
+        freeSlot(i);
+    }
+}
+
+bool PresignedPool::isFresh(const Entry& e, int64_t now_us) {
+    int64_t age = now_us - e.built_at_us;
+    return age < MAX_ENTRY_AGE_US && (e.uses_nonce || age < MAX_BLOCKHASH_AGE_US);
+}
+
+void PresignedPool::freeSlot(size_t i) {
+    if (used_[i]) {
+        free(entries_[i].header);
+        entries_[i].header = nullptr;
+        used_[i] = false;
+    }
+}
+
+bool PresignedPool::take(const char* url, Entry& out) {
+    int64_t now = esp_timer_get_time();
+    bool hit = false;
+
+    portENTER_CRITICAL(&lock_);
+    for (size_t i = 0; i < CAPACITY; i++) {
+        if (used_[i] && strcmp(entries_[i].url, url) == 0 && isFresh(entries_[i], now)) {
+            out = entries_[i];
+            entries_[i].header = nullptr;  // Ownership moves to the caller
+            used_[i] = false;
+            hit = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&lock_);
+    return hit;
+}
+
+void PresignedPool::put(const Entry& entry) {
+    char* replaced = nullptr;
+
+    portENTER_CRITICAL(&lock_);
+    size_t slot = CAPACITY;
+    for (size_t i = 0; i < CAPACITY; i++) {
+        if (used_[i] && strcmp(entries_[i].url, entry.url) == 0) { slot = i; break; }
+        if (!used_[i] && slot == CAPACITY) slot = i;
+    }
+    if (slot == CAPACITY) {
+        // Full: evict the oldest entry
+        slot = 0;
+        for (size_t i = 1; i < CAPACITY; i++) {
+            if (entries_[i].built_at_us < entries_[slot].built_at_us) slot = i;
+        }
+    }
+    if (used_[slot]) replaced = entries_[slot].header;
+    entries_[slot] = entry;
+    used_[slot] = true;
+    portEXIT_CRITICAL(&lock_);
+
+    free(replaced);
+}
+
+bool PresignedPool::isCurrent(const char* url, const uint8_t offer_hash[32]) const {
+    int64_t now = esp_timer_get_time();
+    bool current = false;
+
+    portENTER_CRITICAL(&lock_);
+    for (size_t i = 0; i < CAPACITY; i++) {
+        if (used_[i] && strcmp(entries_[i].url, url) == 0 &&
+            memcmp(entries_[i].offer_hash, offer_hash, 32) == 0 && isFresh(entries_[i], now)) {
+            current = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&lock_);
+    return current;
+}
+
+size_t PresignedPool::invalidate(const char* url, const uint8_t offer_hash[32], bool* dropped_nonce) {
+    int64_t now = esp_timer_get_time();
+    char* dropped[CAPACITY] = {};
+    size_t count = 0;
+    *dropped_nonce = false;
+
+    portENTER_CRITICAL(&lock_);
+    for (size_t i = 0; i < CAPACITY; i++) {
+        if (!used_[i] || strcmp(entries_[i].url, url) != 0) continue;
+        if (memcmp(entries_[i].offer_hash, offer_hash, 32) == 0 && isFresh(entries_[i], now)) continue;
+        *dropped_nonce |= entries_[i].uses_nonce;
+        dropped[count++] = entries_[i].header;
+        entries_[i].header = nullptr;
+        used_[i] = false;
+    }
+    portEXIT_CRITICAL(&lock_);
+
+    for (size_t i = 0; i < count; i++) {
+        free(dropped[i]);
+    }
+    return count;
+}
+
+size_t PresignedPool::expire(bool* dropped_nonce) {
+    int64_t now = esp_timer_get_time();
+    char* dropped[CAPACITY] = {};
+    size_t count = 0;
+    *dropped_nonce = false;
+
+    portENTER_CRITICAL(&lock_);
+    for (size_t i = 0; i < CAPACITY; i++) {
+        if (!used_[i] || isFresh(entries_[i], now)) continue;
+        *dropped_nonce |= entries_[i].uses_nonce;
+        dropped[count++] = entries_[i].header;
+        entries_[i].header = nullptr;
+        used_[i] = false;
+    }
+    portEXIT_CRITICAL(&lock_);
+
+    for (size_t i = 0; i < count; i++) {
+        free(dropped[i]);
+    }
+    return count;
+}
@@ -1,6 +1,8 @@
 #include "solana_client.h"
 #include "crypto_utils.h"
 #include "http_client.h"
+#include "async_http.h"
+#include "deferred_log.h"
 
 #include <esp_log.h>
 #include <esp_http_client.h>
@@ -9,6 +11,7 @@
 #include <sodium.h>
 #include <cstring>
 #include <cstdlib>
+#include <cstdio>
 
 static const char* TAG = "SolanaClient";
 
@@ -28,30 +31,37 @@ const uint8_t SolanaClient::COMPUTE_BUDGET_PROGRAM_ID[32] = {
     0xbc,0x8c,0xe5,0xbb,0xc5,0xf7,0x12,0x6b,0x2c,0x43,0x9b,0x3a,0x40,0x00,0x00,0x00
 };
 
-SolanaClient::SolanaClient(const std::string& rpcUrl)
-    : rpcUrl_(rpcUrl) {}
+const uint8_t SolanaClient::SYSTEM_PROGRAM_ID[32] = {0};
 
-// === Helper ===
-void SolanaClient::ByteBuffer::append(const void* ptr, size_t len) {
-    const uint8_t* bytes = static_cast<const uint8_t*>(ptr);
-    data.insert(data.end(), bytes, bytes + len);
-}
+const uint8_t SolanaClient::SYSVAR_RECENT_BLOCKHASHES_ID[32] = {
+    0x06,0xa7,0xd5,0x17,0x19,0x2c,0x56,0x8e,0xe0,0x8a,0x84,0x5f,0x73,0xd2,0x97,0x88,
+    0xcf,0x03,0x5c,0x31,0x45,0xb2,0x1a,0xb3,0x44,0xd8,0x06,0x2e,0xa9,0x40,0x00,0x00
+};
 
-size_t SolanaClient::encodeCompactU16(uint16_t value, uint8_t* output) {
-    if (value <= 0x7f) {
-        output[0] = value;
-        return 1;
-    } else if (value <= 0x3fff) {
-        output[0] = (value & 0x7f) | 0x80;
-        output[1] = value >> 7;
-        return 2;
-    } else {
-        output[0] = (value & 0x7f) | 0x80;
-        output[1] = ((value >> 7) & 0x7f) | 0x80;
-        output[2] = value >> 14;
-        return 3;
-    }
-}
+const uint8_t SolanaClient::ADDRESS_LOOKUP_TABLE_PROGRAM_ID[32] = {
+    0x02,0x77,0xa6,0xaf,0x97,0x33,0x9b,0x7a,0xc8,0x8d,0x18,0x92,0xc9,0x04,0x46,0xf5,
+    0x00,0x02,0x30,0x92,0x66,0xf6,0x2e,0x53,0xc1,0x18,0x24,0x49,0x82,0x00,0x00,0x00
+};
+
+// Nonce account layout: version u32, state u32, authority, nonce, lamports/sig u64
+static const size_t NONCE_ACCOUNT_SIZE = 80;
+static const uint32_t NONCE_STATE_INITIALIZED = 1;
+static const uint32_t SYSTEM_IX_ADVANCE_NONCE_ACCOUNT = 4;
+
+// Compute budget: one TransferChecked (plus nonce advance) fits the base
+// limit; each extra transfer in a batch adds ~6k CU, doubled for headroom
+static const uint32_t COMPUTE_UNIT_LIMIT = 40000;
+static const uint32_t COMPUTE_UNITS_PER_EXTRA_TRANSFER = 12000;
+static const uint64_t DEFAULT_COMPUTE_UNIT_PRICE = 1;
+
+// Associated token program: CreateIdempotent
+static const uint8_t ATA_IX_CREATE_IDEMPOTENT = 1;
+
+// Lookup table account: 56-byte metadata followed by 32-byte addresses
+static const size_t LOOKUP_TABLE_META_SIZE = 56;
+
+SolanaClient::SolanaClient(const std::string& rpcUrl)
+    : rpcUrl_(rpcUrl) {}
 
 // === PDA ===
 bool SolanaClient::findProgramAddress(
@@ -97,75 +107,360 @@ bool SolanaClient::deriveAssociatedTokenAddress(
     uint8_t ataOut[32],
     uint8_t* bumpOut)
 {
-    ESP_LOGI(TAG, "📍 Deriving ATA...");
+    DLOGI(TAG, "📍 Deriving ATA...");
     const uint8_t* seeds[] = {owner, SPL_TOKEN_PROGRAM_ID, mint};
     const size_t seedLens[] = {32, 32, 32};
     bool ok = findProgramAddress(seeds, seedLens, 3, ASSOCIATED_TOKEN_PROGRAM_ID, ataOut, bumpOut);
     if (ok) {
-        ESP_LOGI(TAG, "✅ ATA derived, bump=%u", *bumpOut);
-        ESP_LOG_BUFFER_HEX_LEVEL(TAG, ataOut, 32, ESP_LOG_INFO);
+        DLOGI(TAG, "✅ ATA derived, bump=%u", *bumpOut);
+        DLOG_BUFFER_HEX(TAG, ataOut, 32, ESP_LOG_INFO);
     }
     return ok;
 }
 
 // === RPC ===
+bool SolanaClient::rpcCall(const char* request, cJSON** rootOut, cJSON** resultOut) {
+    *rootOut = nullptr;
+    *resultOut = nullptr;
+
+    AsyncHttp::Request req;
+    req.url = rpcUrl_.c_str();
+    req.method = HTTP_METHOD_POST;
+    req.content_type = "application/json";
+    req.body = request;
+    req.timeout_ms = 15000;
+    req.max_response = RPC_MAX_RESPONSE;
+
+    // Parse on the executor while the response buffer is still alive
+    cJSON* root = nullptr;
+    esp_err_t err = ESP_FAIL;
+    int status = 0;
+    AsyncHttp::instance().perform(req, [&](const AsyncHttp::Response& resp) {
+        err = resp.err;
+        status = resp.status;
+        if (resp.truncated) {
+            ESP_LOGE(TAG, "❌ RPC response exceeds %zu bytes", RPC_MAX_RESPONSE);
+        } else if (err == ESP_OK && status == 200 && resp.len > 0) {
+            root = cJSON_Parse(resp.body);
+        }
+    });
+
+    if (!root) {
+        ESP_LOGE(TAG, "❌ RPC request failed (err=%s, status=%d)", esp_err_to_name(err), status);
+        return false;
+    }
+
+    cJSON* result = cJSON_GetObjectItemCaseSensitive(root, "result");
+    if (!result) {
+        cJSON* msg = cJSON_GetObjectItemCaseSensitive(
+            cJSON_GetObjectItemCaseSensitive(root, "error"), "message");
+        ESP_LOGE(TAG, "❌ RPC error: %s", cJSON_IsString(msg) ? msg->valuestring : "unknown");
+        cJSON_Delete(root);
+        return false;
+    }
+
+    *rootOut = root;
+    *resultOut = result;
+    return true;
+}
+
 bool SolanaClient::fetchRecentBlockhash(uint8_t blockhashOut[32]) {
     ESP_LOGI(TAG, "🔗 Fetching recent blockhash...");
 
-    static char buffer[4096];
-    static int bufLen = 0;
-
     const char* rpcReq = "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"getLatestBlockhash\",\"params\":[{\"commitment\":\"finalized\"}]}";
 
-    esp_http_client_config_t config = {};
-    config.url = rpcUrl_.c_str();
-    config.method = HTTP_METHOD_POST;
-    config.timeout_ms = 15000;
-    config.crt_bundle_attach = esp_crt_bundle_attach;
-
-    auto handler = [](esp_http_client_event_t *evt) -> esp_err_t {
-        switch (evt->event_id) {
-            case HTTP_EVENT_ON_DATA:
-                if (bufLen + evt->data_len < sizeof(buffer)) {
-                    memcpy(buffer + bufLen, evt->data, evt->data_len);
-                    bufLen += evt->data_len;
-                }
-                break;
-            case HTTP_EVENT_ON_FINISH:
-                buffer[bufLen] = '\0';
+    cJSON* root;
+    cJSON* result;
+    if (!rpcCall(rpcReq, &root, &result)) return false;
+
+    cJSON* blockhash = cJSON_GetObjectItemCaseSensitive(
+        cJSON_GetObjectItemCaseSensitive(result, "value"), "blockhash");
+
+    bool ok = (blockhash && cJSON_IsString(blockhash))
+        ? CryptoUtils::base58ToBytes(blockhash->valuestring, blockhashOut)
+        : false;
+    cJSON_Delete(root);
+    return ok;
+}
+
+bool SolanaClient::fetchTokenAccountBalance(const uint8_t tokenAccount[32], uint64_t* amountOut) {
+    char account[48];
+    if (!CryptoUtils::bytesToBase58(tokenAccount, 32, account, sizeof(account))) return false;
+
+    char rpcReq[192];
+    snprintf(rpcReq, sizeof(rpcReq),
+        "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"getTokenAccountBalance\","
+        "\"params\":[\"%s\",{\"commitment\":\"confirmed\"}]}", account);
+
+    cJSON* root;
+    cJSON* result;
+    if (!rpcCall(rpcReq, &root, &result)) return false;
+
+    cJSON* amount = cJSON_GetObjectItemCaseSensitive(
+        cJSON_GetObjectItemCaseSensitive(result, "value"), "amount");
+
+    bool ok = amount && cJSON_IsString(amount);
+    if (ok) {
+        *amountOut = strtoull(amount->valuestring, nullptr, 10);
+        ESP_LOGI(TAG, "💰 Token balance: %llu", (unsigned long long)*amountOut);
+    }
+    cJSON_Delete(root);
+    return ok;
+}
+
+bool SolanaClient::fetchRecentPrioritizationFees(
+    const uint8_t (*accounts)[32],
+    size_t accountCount,
+    uint64_t* feesOut,
+    size_t feesCap,
+    size_t* feesLen)
+{
+    *feesLen = 0;
+    if (accountCount > MAX_FEE_ACCOUNTS) return false;
+
+    char rpcReq[96 + MAX_FEE_ACCOUNTS * 48];
+    int len = snprintf(rpcReq, sizeof(rpcReq),
+        "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"getRecentPrioritizationFees\",\"params\":[[");
+    for (size_t i = 0; i < accountCount; i++) {
+        char account[48];
+        if (!CryptoUtils::bytesToBase58(accounts[i], 32, account, sizeof(account))) return false;
+        len += snprintf(rpcReq + len, sizeof(rpcReq) - len, "%s\"%s\"", i ? "," : "", account);
+    }
+    snprintf(rpcReq + len, sizeof(rpcReq) - len, "]]}");
+
+    cJSON* root;
+    cJSON* result;
+    if (!rpcCall(rpcReq, &root, &result)) return false;
+
+    cJSON* entry;
+    cJSON_ArrayForEach(entry, result) {
+        if (*feesLen == feesCap) break;
+        cJSON* fee = cJSON_GetObjectItemCaseSensitive(entry, "prioritizationFee");
+        if (cJSON_IsNumber(fee)) {
+            feesOut[(*feesLen)++] = (uint64_t)fee->valuedouble;
+        }
+    }
+    cJSON_Delete(root);
+    return *feesLen > 0;
+}
+
+bool SolanaClient::simulateUnitsConsumed(const std::vector<uint8_t>& txMessage, bool durableNonce,
+                                         uint32_t* unitsOut) {
+    static const char* prefix =
+        "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"simulateTransaction\",\"params\":[\"";
+    const char* suffix = durableNonce
+        ? "\",{\"encoding\":\"base64\",\"sigVerify\":false,\"replaceRecentBlockhash\":false,"
+          "\"commitment\":\"confirmed\"}]}"
+        : "\",{\"encoding\":\"base64\",\"sigVerify\":false,\"replaceRecentBlockhash\":true,"
+          "\"commitment\":\"confirmed\"}]}";
+
+    static const uint8_t unsigned_sig[64] = {};
+    std::string base64Tx;
+    if (!buildSignedTransaction(txMessage, unsigned_sig, base64Tx)) return false;
+
+    size_t reqLen = strlen(prefix) + base64Tx.size() + strlen(suffix) + 1;
+    char* rpcReq = (char*)malloc(reqLen);
+    if (!rpcReq) return false;
+    snprintf(rpcReq, reqLen, "%s%s%s", prefix, base64Tx.c_str(), suffix);
+
+    cJSON* root;
+    cJSON* result;
+    bool called = rpcCall(rpcReq, &root, &result);
+    free(rpcReq);
+    if (!called) return false;
+
+    cJSON* value = cJSON_GetObjectItemCaseSensitive(result, "value");
+    cJSON* err = cJSON_GetObjectItemCaseSensitive(value, "err");
+    cJSON* units = cJSON_GetObjectItemCaseSensitive(value, "unitsConsumed");
+
+    // A failed simulation stops early, so its unit count is not representative
+    bool ok = cJSON_IsNull(err) && cJSON_IsNumber(units);
+    if (ok) {
+        *unitsOut = (uint32_t)units->valuedouble;
+        ESP_LOGI(TAG, "🧮 Simulated: %u compute units", (unsigned)*unitsOut);
+    } else {
+        ESP_LOGW(TAG, "⚠️ Simulation failed, units not recorded");
+    }
+    cJSON_Delete(root);
+    return ok;
+}
+
+bool SolanaClient::findSignedTransaction(const uint8_t signer[32], const uint8_t signature[64],
+                                         TxStatus* statusOut) {
+    *statusOut = TxStatus::NotFound;
+    char account[48];
+    char wanted[96];
+    if (!CryptoUtils::bytesToBase58(signer, 32, account, sizeof(account)) ||
+        !CryptoUtils::bytesToBase58(signature, 64, wanted, sizeof(wanted))) {
+        return false;
+    }
+
+    char rpcReq[192];
+    snprintf(rpcReq, sizeof(rpcReq),
+        "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"getSignaturesForAddress\","
+        "\"params\":[\"%s\",{\"limit\":%u,\"commitment\":\"confirmed\"}]}",
+        account, (unsigned)SIGNATURE_SCAN_LIMIT);
+
+    cJSON* root;
+    cJSON* result;
+    if (!rpcCall(rpcReq, &root, &result)) return false;
+
+    char candidates[SIGNATURE_SCAN_LIMIT][96];
+    size_t count = 0;
+    cJSON* entry;
+    cJSON_ArrayForEach(entry, result) {
+        if (count == SIGNATURE_SCAN_LIMIT) break;
+        const char* sig = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(entry, "signature"));
+        if (sig && strlen(sig) < sizeof(candidates[0])) {
+            strcpy(candidates[count++], sig);
+        }
+    }
+    cJSON_Delete(root);
+
+    for (size_t i = 0; i < count; i++) {
+        char txReq[256];
+        snprintf(txReq, sizeof(txReq),
+            "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"getTransaction\",\"params\":[\"%s\","
+            "{\"encoding\":\"json\",\"commitment\":\"confirmed\",\"maxSupportedTransactionVersion\":0}]}",
+            candidates[i]);
+        if (!rpcCall(txReq, &root, &result)) return false;
+
+        bool match = false;
+        cJSON* sig;
+        cJSON* sigs = cJSON_GetObjectItemCaseSensitive(
+            cJSON_GetObjectItemCaseSensitive(result, "transaction"), "signatures");
+        cJSON_ArrayForEach(sig, sigs) {
+            if (cJSON_IsString(sig) && strcmp(sig->valuestring, wanted) == 0) {
+                match = true;
                 break;
-            default: break;
+            }
+        }
+        if (match) {
+            cJSON* err = cJSON_GetObjectItemCaseSensitive(
+                cJSON_GetObjectItemCaseSensitive(result, "meta"), "err");
+            *statusOut = cJSON_IsNull(err) ? TxStatus::Landed : TxStatus::Failed;
+            ESP_LOGI(TAG, "🔎 Found payment in %.8s... (%s)", candidates[i],
+                     *statusOut == TxStatus::Landed ? "landed" : "failed");
         }
-        return ESP_OK;
-    };
-
-    config.event_handler = handler;
-    bufLen = 0;
-    memset(buffer, 0, sizeof(buffer));
-
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    esp_http_client_set_header(client, "Content-Type", "application/json");
-    esp_http_client_set_post_field(client, rpcReq, strlen(rpcReq));
-    esp_err_t err = esp_http_client_perform(client);
-    int status = esp_http_client_get_status_code(client);
-    esp_http_client_cleanup(client);
-
-    if (err == ESP_OK && status == 200 && bufLen > 0) {
-        cJSON* root = cJSON_Parse(buffer);
-        if (!root) return false;
-
-        cJSON* blockhash = cJSON_GetObjectItemCaseSensitive(
-            cJSON_GetObjectItemCaseSensitive(
-                cJSON_GetObjectItemCaseSensitive(root, "result"), "value"),
-            "blockhash");
-
-        bool ok = (blockhash && cJSON_IsString(blockhash))
-            ? CryptoUtils::base58ToBytes(blockhash->valuestring, blockhashOut)
-            : false;
         cJSON_Delete(root);
-        return ok;
+        if (match) break;
     }
-    return false;
+    return true;
+}
+
+bool SolanaClient::fetchAccountInfo(
+    const uint8_t address[32],
+    uint8_t* dataOut,
+    size_t dataCap,
+    size_t* dataLen,
+    uint8_t ownerOut[32])
+{
+    char account[48];
+    if (!CryptoUtils::bytesToBase58(address, 32, account, sizeof(account))) return false;
+
+    char rpcReq[192];
+    snprintf(rpcReq, sizeof(rpcReq),
+        "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"getAccountInfo\","
+        "\"params\":[\"%s\",{\"encoding\":\"base64\",\"commitment\":\"confirmed\"}]}", account);
+
+    cJSON* root;
+    cJSON* result;
+    if (!rpcCall(rpcReq, &root, &result)) return false;
+
+    // value is null when the account does not exist
+    cJSON* value = cJSON_GetObjectItemCaseSensitive(result, "value");
+    cJSON* data = cJSON_GetArrayItem(cJSON_GetObjectItemCaseSensitive(value, "data"), 0);
+    cJSON* owner = cJSON_GetObjectItemCaseSensitive(value, "owner");
+
+    if (cJSON_IsString(data)) {
+        // Too large for the caller: report the real size rather than "malformed"
+        const char* b64 = data->valuestring;
+        size_t chars = strlen(b64);
+        size_t size = chars / 4 * 3;
+        if (size > 0 && b64[chars - 1] == '=') size -= (b64[chars - 2] == '=') ? 2 : 1;
+        if (size > dataCap) {
+            ESP_LOGE(TAG, "❌ Account %s holds %zu bytes, more than %zu", account, size, dataCap);
+            *dataLen = size;
+            cJSON_Delete(root);
+            return false;
+        }
+    }
+
+    bool ok = data && cJSON_IsString(data) &&
+        CryptoUtils::base64Decode(data->valuestring, strlen(data->valuestring),
+                                  dataOut, dataCap, dataLen);
+    if (ok && ownerOut) {
+        ok = cJSON_IsString(owner) && CryptoUtils::base58ToBytes(owner->valuestring, ownerOut);
+    }
+    if (!ok) {
+        ESP_LOGE(TAG, "❌ Account %s not found or malformed", account);
+    }
+    cJSON_Delete(root);
+    return ok;
+}
+
+bool SolanaClient::fetchNonceAccount(const uint8_t address[32], NonceAccount& out) {
+    ESP_LOGI(TAG, "🔗 Loading nonce account...");
+
+    uint8_t data[NONCE_ACCOUNT_SIZE];
+    uint8_t owner[32];
+    size_t len = 0;
+    if (!fetchAccountInfo(address, data, sizeof(data), &len, owner)) return false;
+
+    // Only read the state once the account is known to be a full nonce account
+    if (len != NONCE_ACCOUNT_SIZE || memcmp(owner, SYSTEM_PROGRAM_ID, 32) != 0) {
+        ESP_LOGE(TAG, "❌ Not a nonce account (%zu bytes)", len);
+        return false;
+    }
+    uint32_t state;
+    memcpy(&state, data + 4, sizeof(state));
+    if (state != NONCE_STATE_INITIALIZED) {
+        ESP_LOGE(TAG, "❌ Nonce account is not initialized");
+        return false;
+    }
+
+    memcpy(out.address, address, 32);
+    memcpy(out.authority, data + 8, 32);
+    memcpy(out.nonce, data + 40, 32);
+    memcpy(&out.lamportsPerSignature, data + 72, sizeof(out.lamportsPerSignature));
+    out.valid = true;
+    ESP_LOGI(TAG, "✅ Nonce loaded");
+    return true;
+}
+
+bool SolanaClient::fetchAddressLookupTable(const uint8_t address[32], AddressLookupTable& out) {
+    ESP_LOGI(TAG, "🔗 Loading address lookup table...");
+
+    uint8_t data[LOOKUP_TABLE_META_SIZE + 32 * AddressLookupTable::MAX_ADDRESSES];
+    uint8_t owner[32];
+    size_t len = 0;
+    if (!fetchAccountInfo(address, data, sizeof(data), &len, owner)) {
+        if (len > sizeof(data) && len >= LOOKUP_TABLE_META_SIZE) {
+            ESP_LOGE(TAG, "❌ Lookup table has %zu addresses, at most %d are supported",
+                     (len - LOOKUP_TABLE_META_SIZE) / 32, AddressLookupTable::MAX_ADDRESSES);
+        }
+        return false;
+    }
+
+    // Only read the header once the account is known to hold one
+    if (memcmp(owner, ADDRESS_LOOKUP_TABLE_PROGRAM_ID, 32) != 0 ||
+        len < LOOKUP_TABLE_META_SIZE || (len - LOOKUP_TABLE_META_SIZE) % 32 != 0) {
+        ESP_LOGE(TAG, "❌ Not an address lookup table");
+        return false;
+    }
+    uint64_t deactivationSlot;
+    memcpy(&deactivationSlot, data + 4, sizeof(deactivationSlot));
+    if (deactivationSlot != UINT64_MAX) {
+        ESP_LOGE(TAG, "❌ Address lookup table is deactivated");
+        return false;
+    }
+
+    memcpy(out.address, address, 32);
+    out.count = (len - LOOKUP_TABLE_META_SIZE) / 32;
+    memcpy(out.addresses, data + LOOKUP_TABLE_META_SIZE, out.count * 32);
+    out.valid = true;
+    ESP_LOGI(TAG, "✅ Lookup table loaded (%d addresses)", out.count);
+    return true;
 }
 
 // === Transaction Building ===
@@ -177,18 +472,55 @@ bool SolanaClient::buildTransaction(
     uint64_t amount,
     uint8_t decimals,
     const uint8_t blockhash[32],
-    std::vector<uint8_t>& txOut)
+    std::vector<uint8_t>& txOut,
+    const NonceAccount* nonce,
+    const AddressLookupTable* lookupTable)
+{
+    Transfer transfer = {paytoBase58, amount};
+    return buildBatchTransaction(payerPubkey, &transfer, 1, feePayerBase58, mintBase58,
+                                 decimals, blockhash, txOut, nonce, lookupTable);
+}
+
+bool SolanaClient::buildBatchTransaction(
+    const uint8_t payerPubkey[32],
+    const Transfer* transfers,
+    size_t transferCount,
+    const char* feePayerBase58,
+    const char* mintBase58,
+    uint8_t decimals,
+    const uint8_t blockhash[32],
+    std::vector<uint8_t>& txOut,
+    const NonceAccount* nonce,
+    const AddressLookupTable* lookupTable,
+    const ComputeBudget* budget)
 {
-    ESP_LOGI(TAG, "🔨 Building transaction...");
+    if (transferCount > 1) {
+        ESP_LOGI(TAG, "🔨 Building %s batch transaction (%zu transfers)%s...",
+                 lookupTable ? "v0" : "legacy", transferCount, nonce ? " (durable nonce)" : "");
+    } else {
+        ESP_LOGI(TAG, "🔨 Building %s transaction%s...",
+                 lookupTable ? "v0" : "legacy", nonce ? " (durable nonce)" : "");
+    }
 
-    uint8_t mint[32], payto[32], feePayer[32];
+    if (transferCount == 0 || transferCount > MAX_BATCH_TRANSFERS) {
+        ESP_LOGE(TAG, "❌ Batch must hold 1..%zu transfers", MAX_BATCH_TRANSFERS);
+        return false;
+    }
+    if (nonce && (!nonce->valid || memcmp(nonce->authority, payerPubkey, 32) != 0)) {
+        ESP_LOGE(TAG, "❌ Nonce unusable (stale or authority is not the payer)");
+        return false;
+    }
+    if (!nonce && !blockhash) {
+        return false;
+    }
+
+    uint8_t mint[32], feePayer[32];
     if (!CryptoUtils::base58ToBytes(mintBase58, mint) ||
-        !CryptoUtils::base58ToBytes(paytoBase58, payto) ||
         !CryptoUtils::base58ToBytes(feePayerBase58, feePayer))
         return false;
 
     // Derive ATAs dynamically
-    uint8_t sourceAta[32], destAta[32];
+    uint8_t sourceAta[32], destAta[MAX_BATCH_TRANSFERS][32];
     uint8_t sourceBump, destBump;
     
     if (!deriveAssociatedTokenAddress(payerPubkey, mint, sourceAta, &sourceBump)) {
@@ -197,84 +529,203 @@ bool SolanaClient::buildTransaction(
     }
     ESP_LOGI(TAG, "✅ Source ATA derived with bump=%u", sourceBump);
     
-    if (!deriveAssociatedTokenAddress(payto, mint, destAta, &destBump)) {
-        ESP_LOGE(TAG, "❌ Failed to derive destination ATA");
-        return false;
+    for (size_t t = 0; t < transferCount; t++) {
+        uint8_t payto[32];
+        if (!CryptoUtils::base58ToBytes(transfers[t].paytoBase58, payto))
+            return false;
+        if (!deriveAssociatedTokenAddress(payto, mint, destAta[t], &destBump)) {
+            ESP_LOGE(TAG, "❌ Failed to derive destination ATA");
+            return false;
+        }
+        ESP_LOGI(TAG, "✅ Destination ATA derived with bump=%u", destBump);
     }
-    ESP_LOGI(TAG, "✅ Destination ATA derived with bump=%u", destBump);
 
-    uint8_t accounts[7][32];
-    int accountCount = 0;
-    memcpy(accounts[accountCount++], feePayer, 32);
-    memcpy(accounts[accountCount++], payerPubkey, 32);
-    memcpy(accounts[accountCount++], sourceAta, 32);
-    memcpy(accounts[accountCount++], destAta, 32);
-    memcpy(accounts[accountCount++], mint, 32);
-    memcpy(accounts[accountCount++], SPL_TOKEN_PROGRAM_ID, 32);
-    memcpy(accounts[accountCount++], COMPUTE_BUDGET_PROGRAM_ID, 32);
+    MessageCompiler msg;
 
-    ByteBuffer instr;
-    uint8_t countEnc[3];
-    size_t countLen = encodeCompactU16(3, countEnc);
-    instr.append(countEnc, countLen);
+    // Pin the account layout: fee payer first, then the payer (both sign)
+    msg.addAccount(feePayer, true, true);
+    msg.addAccount(payerPubkey, true, true);
+    msg.addAccount(sourceAta, false, true);
+    for (size_t t = 0; t < transferCount; t++) {
+        msg.addAccount(destAta[t], false, true);
+    }
+    if (nonce) {
+        msg.addAccount(nonce->address, false, true);
+    }
+    msg.addAccount(mint, false, false);
+    msg.addAccount(SPL_TOKEN_PROGRAM_ID, false, false);
+    msg.addAccount(COMPUTE_BUDGET_PROGRAM_ID, false, false);
+    if (nonce) {
+        msg.addAccount(SYSTEM_PROGRAM_ID, false, false);
+        msg.addAccount(SYSVAR_RECENT_BLOCKHASHES_ID, false, false);
+    }
 
-    // ComputeUnitLimit
-    {
-        uint8_t programIdx = 6;
-        instr.append(&programIdx, 1);
-        uint8_t accLen = 0;
-        instr.append(&accLen, 1);
-        uint8_t data[5] = {0x02,0x40,0x9c,0x00,0x00};
-        uint8_t lenEnc[3]; size_t lenSz = encodeCompactU16(5, lenEnc);
-        instr.append(lenEnc, lenSz);
-        instr.append(data, 5);
+    // AdvanceNonceAccount (must be the first instruction)
+    if (nonce) {
+        MessageCompiler::AccountMeta metas[] = {
+            {nonce->address, false, true},
+            {SYSVAR_RECENT_BLOCKHASHES_ID, false, false},
+            {payerPubkey, true, false},
+        };
+        uint8_t data[4];
+        for (int i = 0; i < 4; i++) data[i] = (SYSTEM_IX_ADVANCE_NONCE_ACCOUNT >> (i*8)) & 0xff;
+        msg.addInstruction(SYSTEM_PROGRAM_ID, metas, 3, data, sizeof(data));
     }
 
-    // ComputeUnitPrice
+    // ComputeUnitLimit, measured if the caller has a figure, else sized to the batch
     {
-        uint8_t programIdx = 6;
-        instr.append(&programIdx, 1);
-        uint8_t accLen = 0;
-        instr.append(&accLen, 1);
-        uint8_t data[9] = {0x03,0x01,0,0,0,0,0,0,0};
-        uint8_t lenEnc[3]; size_t lenSz = encodeCompactU16(9, lenEnc);
-        instr.append(lenEnc, lenSz);
-        instr.append(data, 9);
+        uint32_t units = (budget && budget->unitLimit)
+            ? budget->unitLimit
+            : COMPUTE_UNIT_LIMIT + (transferCount - 1) * COMPUTE_UNITS_PER_EXTRA_TRANSFER;
+        uint8_t data[5] = {0x02};
+        for (int i = 0; i < 4; i++) data[i+1] = (units >> (i*8)) & 0xff;
+        msg.addInstruction(COMPUTE_BUDGET_PROGRAM_ID, nullptr, 0, data, sizeof(data));
     }
 
-    // TransferChecked
+    // ComputeUnitPrice (micro-lamports per CU)
     {
-        uint8_t programIdx = 5;
-        instr.append(&programIdx, 1);
-        uint8_t accCount = 4;
-        instr.append(&accCount, 1);
-        uint8_t accIdx[] = {2,4,3,1};
-        instr.append(accIdx, 4);
+        uint64_t price = (budget && budget->unitPrice) ? budget->unitPrice : DEFAULT_COMPUTE_UNIT_PRICE;
+        uint8_t data[9] = {0x03};
+        for (int i = 0; i < 8; i++) data[i+1] = (price >> (i*8)) & 0xff;
+        msg.addInstruction(COMPUTE_BUDGET_PROGRAM_ID, nullptr, 0, data, sizeof(data));
+    }
+
+    // TransferChecked, one per recipient
+    for (size_t t = 0; t < transferCount; t++) {
+        MessageCompiler::AccountMeta metas[] = {
+            {sourceAta, false, true},
+            {mint, false, false},
+            {destAta[t], false, true},
+            {payerPubkey, true, false},
+        };
         uint8_t transferData[10];
         transferData[0] = 12;
-        for (int i = 0; i < 8; i++) transferData[i+1] = (amount >> (i*8)) & 0xff;
+        for (int i = 0; i < 8; i++) transferData[i+1] = (transfers[t].amount >> (i*8)) & 0xff;
         transferData[9] = decimals;
-        uint8_t lenEnc[3]; size_t lenSz = encodeCompactU16(10, lenEnc);
-        instr.append(lenEnc, lenSz);
-        instr.append(transferData, 10);
-    }
-
-    ByteBuffer tx;
-    uint8_t header[3] = {2,0,3};
-    tx.append(header, 3);
-    uint8_t accEnc[3];
-    size_t accLen = encodeCompactU16(accountCount, accEnc);
-    tx.append(accEnc, accLen);
-    for (int i = 0; i < accountCount; i++)
-        tx.append(accounts[i], 32);
-    tx.append(blockhash, 32);
-    tx.append(instr.data.data(), instr.data.size());
-
-    txOut = std::move(tx.data);
+        msg.addInstruction(SPL_TOKEN_PROGRAM_ID, metas, 4, transferData, sizeof(transferData));
+    }
+
+    if (!msg.compile(nonce ? nonce->nonce : blockhash, lookupTable)) {
+        ESP_LOGE(TAG, "❌ Message compilation failed");
+        return false;
+    }
+
+    // Signature count + signatures + message must fit one packet
+    size_t txSize = 1 + 64 * msg.numRequiredSignatures() + msg.size();
+    if (txSize > MessageCompiler::PACKET_DATA_SIZE) {
+        ESP_LOGE(TAG, "❌ Transaction too large (%zu > %zu bytes)", txSize, MessageCompiler::PACKET_DATA_SIZE);
+        return false;
+    }
+    if (lookupTable) {
+        ESP_LOGI(TAG, "📉 v0 message: %zu bytes, %d accounts from lookup table",
+                 msg.size(), msg.numLoadedAccounts());
+    }
+
+    txOut.assign(msg.data(), msg.data() + msg.size());
     ESP_LOGI(TAG, "✅ Transaction built successfully (%zu bytes)", txOut.size());
     return true;
 }
 
+bool SolanaClient::buildFundingTransaction(
+    const uint8_t funderPubkey[32],
+    const Funding* fundings,
+    size_t fundingCount,
+    const char* mintBase58,
+    uint8_t decimals,
+    const uint8_t blockhash[32],
+    std::vector<uint8_t>& txOut)
+{
+    ESP_LOGI(TAG, "🔨 Building funding transaction (%zu wallets)...", fundingCount);
+    if (fundingCount == 0 || fundingCount > MAX_FUNDINGS) {
+        ESP_LOGE(TAG, "❌ Funding must cover 1..%zu wallets", MAX_FUNDINGS);
+        return false;
+    }
+
+    uint8_t mint[32];
+    if (!CryptoUtils::base58ToBytes(mintBase58, mint)) return false;
+
+    uint8_t sourceAta[32], destAta[MAX_FUNDINGS][32];
+    uint8_t bump;
+    if (!deriveAssociatedTokenAddress(funderPubkey, mint, sourceAta, &bump)) return false;
+    for (size_t f = 0; f < fundingCount; f++) {
+        if (!deriveAssociatedTokenAddress(fundings[f].owner, mint, destAta[f], &bump)) return false;
+    }
+
+    MessageCompiler msg;
+    msg.addAccount(funderPubkey, true, true);
+
+    for (size_t f = 0; f < fundingCount; f++) {
+        MessageCompiler::AccountMeta create[] = {
+            {funderPubkey, true, true},
+            {destAta[f], false, true},
+            {fundings[f].owner, false, false},
+            {mint, false, false},
+            {SYSTEM_PROGRAM_ID, false, false},
+            {SPL_TOKEN_PROGRAM_ID, false, false},
+        };
+        msg.addInstruction(ASSOCIATED_TOKEN_PROGRAM_ID, create, 6, &ATA_IX_CREATE_IDEMPOTENT, 1);
+
+        MessageCompiler::AccountMeta transfer[] = {
+            {sourceAta, false, true},
+            {mint, false, false},
+            {destAta[f], false, true},
+            {funderPubkey, true, false},
+        };
+        uint8_t transferData[10];
+        transferData[0] = 12;
+        for (int i = 0; i < 8; i++) transferData[i+1] = (fundings[f].amount >> (i*8)) & 0xff;
+        transferData[9] = decimals;
+        msg.addInstruction(SPL_TOKEN_PROGRAM_ID, transfer, 4, transferData, sizeof(transferData));
+    }
+
+    if (!msg.compile(blockhash)) {
+        ESP_LOGE(TAG, "❌ Message compilation failed");
+        return false;
+    }
+
+    txOut.assign(msg.data(), msg.data() + msg.size());
+    ESP_LOGI(TAG, "✅ Funding transaction built (%zu bytes)", txOut.size());
+    return true;
+}
+
+bool SolanaClient::sendTransaction(const std::vector<uint8_t>& txMessage, const uint8_t signature[64]) {
+    std::vector<uint8_t> fullTx;
+    fullTx.reserve(1 + 64 + txMessage.size());
+    fullTx.push_back(0x01);
+    fullTx.insert(fullTx.end(), signature, signature + 64);
+    fullTx.insert(fullTx.end(), txMessage.begin(), txMessage.end());
+
+    char* encoded = CryptoUtils::base64Encode(fullTx.data(), fullTx.size());
+    if (!encoded) return false;
+
+    static const char* prefix =
+        "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"sendTransaction\",\"params\":[\"";
+    static const char* suffix =
+        "\",{\"encoding\":\"base64\",\"preflightCommitment\":\"confirmed\"}]}";
+
+    size_t reqLen = strlen(prefix) + strlen(encoded) + strlen(suffix) + 1;
+    char* rpcReq = (char*)malloc(reqLen);
+    if (!rpcReq) {
+        free(encoded);
+        return false;
+    }
+    snprintf(rpcReq, reqLen, "%s%s%s", prefix, encoded, suffix);
+    free(encoded);
+
+    cJSON* root;
+    cJSON* result;
+    bool called = rpcCall(rpcReq, &root, &result);
+    free(rpcReq);
+    if (!called) return false;
+
+    bool ok = cJSON_IsString(result);
+    if (ok) {
+        ESP_LOGI(TAG, "📤 Transaction sent: %s", result->valuestring);
+    }
+    cJSON_Delete(root);
+    return ok;
+}
+
 bool SolanaClient::buildSignedTransaction(
     const std::vector<uint8_t>& txMessage,
     const uint8_t signature[64],
@@ -289,6 +740,9 @@ bool SolanaClient::buildSignedTransaction(
     fullTx.insert(fullTx.end(), signature, signature + 64);
     fullTx.insert(fullTx.end(), txMessage.begin(), txMessage.end());
 
-    base64Out = CryptoUtils::base64Encode(fullTx.data(), fullTx.size());
+    char* encoded = CryptoUtils::base64Encode(fullTx.data(), fullTx.size());
+    if (!encoded) return false;
+    base64Out = encoded;
+    free(encoded);
     return !base64Out.empty();
 }
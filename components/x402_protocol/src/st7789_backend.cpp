@@ -0,0 +1,276 @@
+#include "st7789_backend.h"
+#include "esp_log.h"
+#include "driver/spi_master.h"
+#include "driver/gpio.h"
+#include "esp_lcd_panel_ops.h"
+#include "esp_lcd_touch_cst816s.h"
+#include "esp_lvgl_port.h"
+#include "driver/i2c_master.h"
+
+static const char* TAG = "St7789Backend";
+
+// Hardware pin definitions for ESP32-C6 Touch LCD 1.69"
+#define LCD_HOST            SPI2_HOST
+#define LCD_PIXEL_CLOCK_HZ  (40 * 1000 * 1000)
+#define LCD_H_RES           240
+#define LCD_V_RES           280
+
+#define PIN_NUM_MOSI        2
+#define PIN_NUM_CLK         1
+#define PIN_NUM_CS          5
+#define PIN_NUM_DC          3
+#define PIN_NUM_RST         4
+#define PIN_NUM_BL          6
+
+// Touch pins
+#define PIN_NUM_TOUCH_SDA   8
+#define PIN_NUM_TOUCH_SCL   7
+#define PIN_NUM_TOUCH_INT   11
+#define PIN_NUM_TOUCH_RST   (-1)
+
+St7789Backend::St7789Backend()
+    : io_handle_(nullptr)
+    , panel_handle_(nullptr)
+    , touch_handle_(nullptr)
+    , lvgl_disp_(nullptr)
+    , lvgl_touch_(nullptr)
+    , initialized_(false)
+{
+}
+
+St7789Backend::~St7789Backend() {
+    deinit();
+}
+
+bool St7789Backend::init() {
+    if (initialized_) {
+        return true;
+    }
+
+    // Initialize LVGL library
+    initLVGL();
+
+    // Initialize display hardware
+    initDisplay();
+
+    // Initialize touch input
+    initTouch();
+
+    // Initialize backlight
+    initBacklight();
+
+    initialized_ = lvgl_disp_ != nullptr;
+    return initialized_;
+}
+
+void St7789Backend::deinit() {
+    if (!initialized_) {
+        return;
+    }
+
+    if (lvgl_touch_) {
+        lvgl_port_remove_touch(lvgl_touch_);
+        lvgl_touch_ = nullptr;
+    }
+
+    if (lvgl_disp_) {
+        lvgl_port_remove_disp(lvgl_disp_);
+        lvgl_disp_ = nullptr;
+    }
+
+    if (touch_handle_) {
+        esp_lcd_touch_del(touch_handle_);
+        touch_handle_ = nullptr;
+    }
+
+    if (panel_handle_) {
+        esp_lcd_panel_del(panel_handle_);
+        panel_handle_ = nullptr;
+    }
+
+    if (io_handle_) {
+        esp_lcd_panel_io_del(io_handle_);
+        io_handle_ = nullptr;
+    }
+
+    spi_bus_free(LCD_HOST);
+    lvgl_port_deinit();
+
+    initialized_ = false;
+}
+
+void St7789Backend::initLVGL() {
+    ESP_LOGI(TAG, "Initializing LVGL...");
+    
+    lv_init();
+    
+    const lvgl_port_cfg_t lvgl_cfg = ESP_LVGL_PORT_INIT_CONFIG();
+    esp_err_t ret = lvgl_port_init(&lvgl_cfg);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "LVGL port initialization failed: %s", esp_err_to_name(ret));
+    }
+}
+
+void St7789Backend::initDisplay() {
+    ESP_LOGI(TAG, "Initializing SPI bus...");
+    
+    spi_bus_config_t buscfg = {};
+    buscfg.mosi_io_num = PIN_NUM_MOSI;
+    buscfg.miso_io_num = -1;
+    buscfg.sclk_io_num = PIN_NUM_CLK;
+    buscfg.quadwp_io_num = -1;
+    buscfg.quadhd_io_num = -1;
+    buscfg.max_transfer_sz = LCD_H_RES * 80 * sizeof(uint16_t);
+    
+    ESP_ERROR_CHECK(spi_bus_initialize(LCD_HOST, &buscfg, SPI_DMA_CH_AUTO));
+
+    ESP_LOGI(TAG, "Installing panel IO...");
+    
+    esp_lcd_panel_io_spi_config_t io_config = {};
+    io_config.cs_gpio_num = PIN_NUM_CS;
+    io_config.dc_gpio_num = PIN_NUM_DC;
+    io_config.spi_mode = 0;
+    io_config.pclk_hz = LCD_PIXEL_CLOCK_HZ;
+    io_config.trans_queue_depth = 10;
+    io_config.lcd_cmd_bits = 8;
+    io_config.lcd_param_bits = 8;
+    
+    ESP_ERROR_CHECK(esp_lcd_new_panel_io_spi(
+        (esp_lcd_spi_bus_handle_t)LCD_HOST, &io_config, &io_handle_));
+
+    ESP_LOGI(TAG, "Installing ST7789 panel driver...");
+    
+    esp_lcd_panel_dev_config_t panel_config = {};
+    panel_config.reset_gpio_num = PIN_NUM_RST;
+    panel_config.rgb_ele_order = LCD_RGB_ELEMENT_ORDER_RGB;
+    panel_config.bits_per_pixel = 16;
+    
+    ESP_ERROR_CHECK(esp_lcd_new_panel_st7789(io_handle_, &panel_config, &panel_handle_));
+    ESP_ERROR_CHECK(esp_lcd_panel_reset(panel_handle_));
+    ESP_ERROR_CHECK(esp_lcd_panel_init(panel_handle_));
+    ESP_ERROR_CHECK(esp_lcd_panel_invert_color(panel_handle_, true));
+    ESP_ERROR_CHECK(esp_lcd_panel_mirror(panel_handle_, false, false));
+    ESP_ERROR_CHECK(esp_lcd_panel_disp_on_off(panel_handle_, true));
+
+    ESP_LOGI(TAG, "Initializing LVGL display driver...");
+    
+    lvgl_port_display_cfg_t disp_cfg = {};
+    disp_cfg.io_handle = io_handle_;
+    disp_cfg.panel_handle = panel_handle_;
+    disp_cfg.buffer_size = LCD_H_RES * 40;
+    disp_cfg.double_buffer = true;
+    disp_cfg.hres = LCD_H_RES;
+    disp_cfg.vres = LCD_V_RES;
+    disp_cfg.monochrome = false;
+    disp_cfg.color_format = LV_COLOR_FORMAT_RGB565;
+    disp_cfg.rotation.swap_xy = false;
+    disp_cfg.rotation.mirror_x = false;
+    disp_cfg.rotation.mirror_y = false;
+    disp_cfg.flags.buff_dma = true;
+    disp_cfg.flags.buff_spiram = false;
+    disp_cfg.flags.sw_rotate = false;
+    disp_cfg.flags.swap_bytes = true;
+
+    lvgl_disp_ = lvgl_port_add_disp(&disp_cfg);
+    lv_disp_set_default(lvgl_disp_);
+    
+    // Set gap after adding display
+    ESP_ERROR_CHECK(esp_lcd_panel_set_gap(panel_handle_, 0, 20));
+    
+    ESP_LOGI(TAG, "Display initialized: %dx%d", LCD_H_RES, LCD_V_RES);
+}
+
+void St7789Backend::initTouch() {
+    ESP_LOGI(TAG, "Initializing I2C for touch...");
+    
+    // Initialize I2C bus
+    i2c_master_bus_handle_t i2c_bus_handle;
+    i2c_master_bus_config_t i2c_bus_config = {};
+    i2c_bus_config.clk_source = I2C_CLK_SRC_DEFAULT;
+    i2c_bus_config.i2c_port = I2C_NUM_0;
+    i2c_bus_config.scl_io_num = (gpio_num_t)PIN_NUM_TOUCH_SCL;
+    i2c_bus_config.sda_io_num = (gpio_num_t)PIN_NUM_TOUCH_SDA;
+    i2c_bus_config.glitch_ignore_cnt = 7;
+    i2c_bus_config.flags.enable_internal_pullup = true;
+    
+    esp_err_t ret = i2c_new_master_bus(&i2c_bus_config, &i2c_bus_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize I2C bus: %s", esp_err_to_name(ret));
+        return;
+    }
+
+    ESP_LOGI(TAG, "Initializing touch panel IO...");
+    
+    esp_lcd_panel_io_handle_t touch_io_handle = NULL;
+    esp_lcd_panel_io_i2c_config_t touch_io_config = {};
+    touch_io_config.dev_addr = ESP_LCD_TOUCH_IO_I2C_CST816S_ADDRESS;
+    touch_io_config.control_phase_bytes = 1;
+    touch_io_config.dc_bit_offset = 0;
+    touch_io_config.lcd_cmd_bits = 8;
+    touch_io_config.lcd_param_bits = 8;
+    touch_io_config.flags.disable_control_phase = 1;
+    touch_io_config.scl_speed_hz = 400000;  // 400kHz
+    
+    ret = esp_lcd_new_panel_io_i2c(i2c_bus_handle, &touch_io_config, &touch_io_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create touch panel IO: %s", esp_err_to_name(ret));
+        return;
+    }
+
+    ESP_LOGI(TAG, "Initializing CST816S touch controller...");
+    
+    esp_lcd_touch_config_t touch_config = {};
+    touch_config.x_max = LCD_H_RES;
+    touch_config.y_max = LCD_V_RES;
+    touch_config.rst_gpio_num = (gpio_num_t)PIN_NUM_TOUCH_RST;
+    touch_config.int_gpio_num = (gpio_num_t)PIN_NUM_TOUCH_INT;
+    touch_config.flags.swap_xy = false;
+    touch_config.flags.mirror_x = false;
+    touch_config.flags.mirror_y = false;
+    
+    ret = esp_lcd_touch_new_i2c_cst816s(touch_io_handle, &touch_config, &touch_handle_);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create touch handle: %s", esp_err_to_name(ret));
+        return;
+    }
+
+    // Register touch with LVGL
+    const lvgl_port_touch_cfg_t touch_cfg = {
+        .disp = lvgl_disp_,
+        .handle = touch_handle_,
+        .scale = {1.0f, 1.0f}
+    };
+    
+    lvgl_touch_ = lvgl_port_add_touch(&touch_cfg);
+    
+    ESP_LOGI(TAG, "Touch initialized successfully");
+}
+
+void St7789Backend::initBacklight() {
+    ESP_LOGI(TAG, "Initializing backlight...");
+    
+    gpio_config_t bk_gpio_config = {};
+    bk_gpio_config.pin_bit_mask = 1ULL << PIN_NUM_BL;
+    bk_gpio_config.mode = GPIO_MODE_OUTPUT;
+    bk_gpio_config.pull_up_en = GPIO_PULLUP_DISABLE;
+    bk_gpio_config.pull_down_en = GPIO_PULLDOWN_DISABLE;
+    bk_gpio_config.intr_type = GPIO_INTR_DISABLE;
+    
+    ESP_ERROR_CHECK(gpio_config(&bk_gpio_config));
+    gpio_set_level((gpio_num_t)PIN_NUM_BL, 1);
+    
+    ESP_LOGI(TAG, "Backlight enabled");
+}
+
+bool St7789Backend::lock(uint32_t timeout_ms) {
+    return lvgl_port_lock(timeout_ms);
+}
+
+void St7789Backend::unlock() {
+    lvgl_port_unlock();
+}
+
+void St7789Backend::setBacklight(uint8_t brightness) {
+    // Simple on/off control (can be enhanced with PWM)
+    gpio_set_level((gpio_num_t)PIN_NUM_BL, brightness > 0 ? 1 : 0);
+}
@@ -0,0 +1,206 @@
+#include "transaction_view.h"
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <cstring>
+
+static const char* TAG = "TransactionView";
+
+static constexpr uint8_t MESSAGE_VERSION_PREFIX = 0x80;
+
+namespace {
+
+// Bounds-checked cursor; the first error sticks and later reads return nothing
+class Reader {
+public:
+    using Error = TransactionView::Error;
+
+    Reader(const uint8_t* data, size_t len) : pos_(data), end_(data + len), error_(Error::None) {}
+
+    Error error() const { return error_; }
+    bool ok() const { return error_ == Error::None; }
+    bool atEnd() const { return pos_ == end_; }
+    const uint8_t* pos() const { return pos_; }
+
+    const uint8_t* take(size_t n) {
+        if (!ok()) return nullptr;
+        if ((size_t)(end_ - pos_) < n) {
+            error_ = Error::Truncated;
+            return nullptr;
+        }
+        const uint8_t* at = pos_;
+        pos_ += n;
+        return at;
+    }
+
+    uint8_t byte() {
+        const uint8_t* b = take(1);
+        return b ? *b : 0;
+    }
+
+    // compact-u16: 7 bits per byte, low first, at most 3 bytes, canonical only
+    size_t compactU16() {
+        size_t value = 0;
+        for (int i = 0; i < 3; i++) {
+            uint8_t b = byte();
+            if (!ok()) return 0;
+            if ((i > 0 && b == 0) || (i == 2 && b > 0x03)) break;
+            value |= (size_t)(b & 0x7f) << (7 * i);
+            if (!(b & 0x80)) return value;
+        }
+        error_ = Error::BadLength;
+        return 0;
+    }
+
+    TransactionView::Bytes bytes(size_t n) {
+        const uint8_t* at = take(n);
+        return at ? TransactionView::Bytes(at, n) : TransactionView::Bytes();
+    }
+
+private:
+    const uint8_t* pos_;
+    const uint8_t* end_;
+    Error error_;
+};
+
+} // namespace
+
+const char* TransactionView::errorName(Error error) {
+    switch (error) {
+        case Error::None:                return "none";
+        case Error::Truncated:           return "truncated";
+        case Error::TrailingBytes:       return "trailing-bytes";
+        case Error::BadLength:           return "bad-length";
+        case Error::UnsupportedVersion:  return "unsupported-version";
+        case Error::BadHeader:           return "bad-header";
+        case Error::SignatureCount:      return "signature-count";
+        case Error::TooManyInstructions: return "too-many-instructions";
+        case Error::TooManyLookups:      return "too-many-lookups";
+        case Error::AccountIndex:        return "account-index";
+    }
+    return "?";
+}
+
+bool TransactionView::fail(Error error) {
+    *this = TransactionView();
+    error_ = error;
+    return false;
+}
+
+bool TransactionView::parse(const uint8_t* data, size_t len) {
+    Reader r(data, len);
+
+    size_t signature_count = r.compactU16();
+    signatures_ = r.take(64 * signature_count);
+    message_ = Bytes(r.pos(), data + len - r.pos());
+
+    uint8_t first = r.byte();
+    versioned_ = first & MESSAGE_VERSION_PREFIX;
+    if (versioned_) {
+        if ((first & ~MESSAGE_VERSION_PREFIX) != 0) return fail(Error::UnsupportedVersion);
+        header_[0] = r.byte();
+    } else {
+        header_[0] = first;
+    }
+    header_[1] = r.byte();
+    header_[2] = r.byte();
+
+    key_count_ = r.compactU16();
+    keys_ = r.take(32 * key_count_);
+    blockhash_ = r.take(32);
+
+    instruction_count_ = r.compactU16();
+    if (instruction_count_ > MAX_INSTRUCTIONS) return fail(Error::TooManyInstructions);
+    for (size_t i = 0; i < instruction_count_ && r.ok(); i++) {
+        Instruction& ix = instructions_[i];
+        ix.program = r.byte();
+        ix.accounts = r.bytes(r.compactU16());
+        ix.data = r.bytes(r.compactU16());
+    }
+
+    lookup_count_ = 0;
+    loaded_writable_ = 0;
+    loaded_count_ = 0;
+    if (versioned_) {
+        lookup_count_ = r.compactU16();
+        if (lookup_count_ > MAX_LOOKUPS) return fail(Error::TooManyLookups);
+        for (size_t i = 0; i < lookup_count_ && r.ok(); i++) {
+            Lookup& l = lookups_[i];
+            l.table = r.take(32);
+            l.writable = r.bytes(r.compactU16());
+            l.readonly = r.bytes(r.compactU16());
+            loaded_writable_ += l.writable.size();
+            loaded_count_ += l.writable.size() + l.readonly.size();
+        }
+    }
+
+    if (!r.ok()) return fail(r.error());
+    if (!r.atEnd()) return fail(Error::TrailingBytes);
+
+    // The fee payer signs and is writable; readonly counts fit their groups
+    if (header_[0] == 0 || header_[0] > key_count_ || header_[1] >= header_[0] ||
+        header_[2] > key_count_ - header_[0]) {
+        return fail(Error::BadHeader);
+    }
+    if (signature_count != header_[0]) return fail(Error::SignatureCount);
+
+    // Programs are invoked from static keys; accounts may also be loaded
+    for (size_t i = 0; i < instruction_count_; i++) {
+        const Instruction& ix = instructions_[i];
+        if (ix.program >= key_count_) return fail(Error::AccountIndex);
+        for (uint8_t index : ix.accounts) {
+            if (index >= accountCount()) return fail(Error::AccountIndex);
+        }
+    }
+
+    error_ = Error::None;
+    return true;
+}
+
+bool TransactionView::isWritable(size_t index) const {
+    if (index < header_[0]) return index < (size_t)(header_[0] - header_[1]);
+    if (index < key_count_) return index < key_count_ - header_[2];
+    return index - key_count_ < loaded_writable_;
+}
+
+const uint8_t* TransactionView::resolve(size_t index, const AddressLookupTable* table) const {
+    if (index < key_count_) return keys_ + 32 * index;
+    index -= key_count_;
+    // Loaded order: every table's writable entries, then every table's readonly ones
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t i = 0; i < lookup_count_; i++) {
+            Bytes entries = pass == 0 ? lookups_[i].writable : lookups_[i].readonly;
+            if (index >= entries.size()) {
+                index -= entries.size();
+                continue;
+            }
+            uint8_t entry = entries[index];
+            if (!table || !table->valid || memcmp(table->address, lookups_[i].table, 32) != 0 ||
+                entry >= table->count) {
+                return nullptr;
+            }
+            return table->addresses[entry];
+        }
+    }
+    return nullptr;
+}
+
+void TransactionView::benchmark(const uint8_t* data, size_t len, size_t iterations) {
+    TransactionView view;
+    if (!view.parse(data, len)) {
+        ESP_LOGE(TAG, "❌ Benchmark transaction rejected: %s", errorName(view.error()));
+        return;
+    }
+
+    size_t parsed = 0;
+    int64_t t0 = esp_timer_get_time();
+    for (size_t i = 0; i < iterations; i++) {
+        parsed += view.parse(data, len);
+    }
+    int64_t us = esp_timer_get_time() - t0;
+    if (us <= 0) us = 1;
+
+    double rate = iterations * 1e6 / us;
+    ESP_LOGI(TAG, "⏱️ %zu-byte %s TX, %zu instructions: %.0f parses/s, %.1f MB/s (%zu/%zu ok)",
+             len, view.versioned() ? "v0" : "legacy", view.instructionCount(),
+             rate, rate * len / 1e6, parsed, iterations);
+}
@@ -0,0 +1,34 @@
+#include "ui_command_queue.h"
+#include <cstring>
+
+// Truncates before a UTF-8 sequence that would not fit, never inside one
+static void copyText(char* dst, size_t cap, const char* src) {
+    size_t len = 0;
+    if (src) {
+        len = strnlen(src, cap - 1);
+        while (len > 0 && ((uint8_t)src[len] & 0xC0) == 0x80) {
+            len--;
+        }
+        memcpy(dst, src, len);
+    }
+    dst[len] = '\0';
+}
+
+bool UiCommandQueue::push(Type type, const char* title, const char* message) {
+    uint32_t pos;
+    Command* cmd = ring_.claim(pos);
+    if (!cmd) {
+        return false;
+    }
+
+    cmd->type = type;
+    cmd->has_message = message != nullptr;
+    copyText(cmd->title, TITLE_MAX, title);
+    copyText(cmd->message, MESSAGE_MAX, message);
+    ring_.publish(pos);
+    return true;
+}
+
+bool UiCommandQueue::pop(Command& out) {
+    return ring_.pop(out);
+}
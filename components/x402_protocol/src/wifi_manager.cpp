@@ -5,7 +5,7 @@ static const char* TAG = "WiFiManager";
 #define WIFI_CONNECTED_BIT BIT0
 
 WiFiManager::WiFiManager(const std::string& ssid, const std::string& password)
-    : ssid_(ssid), password_(password), connected_(false)
+    : ssid_(ssid), password_(password), started_(false)
 {
     eventGroup_ = xEventGroupCreate();
 }
@@ -24,13 +24,13 @@ void WiFiManager::eventHandler(void* arg, esp_event_base_t event_base,
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
         esp_wifi_connect();
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
+        xEventGroupClearBits(self->eventGroup_, WIFI_CONNECTED_BIT);
         esp_wifi_connect();
         ESP_LOGW(TAG, "Disconnected, retrying...");
     } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
         ESP_LOGI(TAG, "Got IP: " IPSTR, IP2STR(&event->ip_info.ip));
         xEventGroupSetBits(self->eventGroup_, WIFI_CONNECTED_BIT);
-        self->connected_ = true;
     }
 }
 
@@ -48,7 +48,10 @@ void WiFiManager::initWiFi() {
         IP_EVENT, IP_EVENT_STA_GOT_IP, &WiFiManager::eventHandler, this, nullptr));
 }
 
-bool WiFiManager::connect() {
+bool WiFiManager::start() {
+    if (started_) {
+        return true;
+    }
     initWiFi();
 
     wifi_config_t wifi_config = {};
@@ -63,14 +66,21 @@ bool WiFiManager::connect() {
     ESP_ERROR_CHECK(esp_wifi_start());
 
     ESP_LOGI(TAG, "Connecting to WiFi SSID: %s", ssid_.c_str());
+    started_ = true;
+    return true;
+}
 
+bool WiFiManager::waitConnected(uint32_t timeout_ms) {
+    TickType_t ticks = (timeout_ms == WAIT_FOREVER) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
     EventBits_t bits = xEventGroupWaitBits(
-        eventGroup_, WIFI_CONNECTED_BIT, pdFALSE, pdFALSE, portMAX_DELAY);
+        eventGroup_, WIFI_CONNECTED_BIT, pdFALSE, pdFALSE, ticks);
+    return (bits & WIFI_CONNECTED_BIT) != 0;
+}
 
-    connected_ = (bits & WIFI_CONNECTED_BIT);
-    return connected_;
+bool WiFiManager::connect() {
+    return start() && waitConnected(WAIT_FOREVER);
 }
 
 bool WiFiManager::isConnected() const {
-    return connected_;
+    return (xEventGroupGetBits(eventGroup_) & WIFI_CONNECTED_BIT) != 0;
 }
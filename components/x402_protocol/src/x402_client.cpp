@@ -1,44 +1,112 @@
 #include "x402_client.h"
 #include "crypto_utils.h"
+#include "metrics.h"
+#include "boot_profiler.h"
+#include "config_manager.h"
+#include "deferred_log.h"
 #include <esp_log.h>
 #include <sodium.h>
 #include <cJSON.h>
-#include <nvs_flash.h>
+#include <esp_timer.h>
+#include <esp_random.h>
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
+#if CONFIG_IDF_TARGET_LINUX
+#include "headless_backend.h"
+#else
+#include "st7789_backend.h"
+#include <nvs_flash.h>
+#endif
 
 static const char* TAG = "x402";
 
-char* X402PaymentClient::buildPaymentPayload(const char* base64_tx) {
-    cJSON* root = cJSON_CreateObject();
-    cJSON_AddNumberToObject(root, "x402Version", 1);
-    cJSON_AddStringToObject(root, "scheme", "exact");
-    cJSON_AddStringToObject(root, "network", "solana-devnet");
+#if CONFIG_X402_PAYER_WALLETS
+static constexpr bool PAYER_WALLETS = true;
+#else
+static constexpr bool PAYER_WALLETS = false;
+#endif
 
-    cJSON* payload = cJSON_CreateObject();
-    cJSON_AddStringToObject(payload, "transaction", base64_tx);
-    cJSON_AddItemToObject(root, "payload", payload);
+#if CONFIG_X402_WALLET_ROUND_ROBIN
+static constexpr PayerWallets::Policy WALLET_POLICY = PayerWallets::Policy::RoundRobin;
+#else
+static constexpr PayerWallets::Policy WALLET_POLICY = PayerWallets::Policy::LeastOutstanding;
+#endif
 
-    char* json_str = cJSON_PrintUnformatted(root);
-    char* final_header = CryptoUtils::base64Encode(
-        reinterpret_cast<const unsigned char*>(json_str),
-        strlen(json_str));
-
-    cJSON_Delete(root);
-    free(json_str);
-    return final_header;
-}
+static constexpr int64_t METRICS_DUMP_PERIOD_US = (int64_t)CONFIG_X402_METRICS_DUMP_PERIOD_S * 1000000;
 
 X402PaymentClient::X402PaymentClient(const X402Config& config)
     : cfg_(config)
+    , wallets_(WALLET_POLICY)
+    , source_ata_ready_(false)
+    , maintenance_task_(nullptr)
+    , boot_events_(xEventGroupCreate())
+    , nonce_mode_(false)
+    , nonce_{}
+    , lookup_table_ready_(false)
+    , ui_events_(xQueueCreate(UI_EVENT_QUEUE_DEPTH, sizeof(UiEvent)))
+    , payment_jobs_(xQueueCreate(PAYMENT_QUEUE_DEPTH, sizeof(PaymentJob)))
+    , payment_worker_(nullptr)
+    , pending_urls_{}
+    , fees_(config.fee_target_ms)
+    , fee_payer_known_(false)
+    , last_flow_us_(0)
+    , pool_paused_(false)
+    , journal_source_(PaymentJournal::JOURNAL_SOURCE)
+    , cache_dir_(ContentCache::CACHE_DIR)
+    , paced_(true)
+    , stage_task_(nullptr)
+    , stage_mark_us_(0)
+    , payment_active_(false)
     , env_initialized_(false)
 {
+    portMUX_INITIALIZE(&nonce_lock_);
+    portMUX_INITIALIZE(&pending_lock_);
+    if (!CryptoUtils::bytesToBase58(cfg_.payer_public_key, 32, cache_scope_, sizeof(cache_scope_))) {
+        cache_scope_[0] = '\0';
+    }
+    if (cfg_.nonce_account && cfg_.nonce_account[0]) {
+        nonce_mode_ = CryptoUtils::base58ToBytes(cfg_.nonce_account, nonce_.address);
+        if (!nonce_mode_) {
+            ESP_LOGW(TAG, "⚠️ Invalid nonce_account, using recent blockhashes");
+        }
+    }
+    if (cfg_.lookup_table && cfg_.lookup_table[0]) {
+        lookup_table_ = std::make_unique<SolanaClient::AddressLookupTable>();
+        lookup_table_->valid = false;
+        if (!CryptoUtils::base58ToBytes(cfg_.lookup_table, lookup_table_->address)) {
+            ESP_LOGW(TAG, "⚠️ Invalid lookup_table, using legacy transactions");
+            lookup_table_.reset();
+        }
+    }
+
     solana_ = std::make_unique<SolanaClient>(cfg_.solana_rpc_url);
     wifi_   = std::make_unique<WiFiManager>(cfg_.wifi_ssid, cfg_.wifi_password);
     http_   = std::make_unique<HttpClient>(HttpClientConfig{cfg_.user_agent, 20000});
-    display_ = std::make_unique<DisplayManager>();
+#if CONFIG_IDF_TARGET_LINUX
+    auto backend = std::make_unique<HeadlessBackend>();
+    backend->runTask(HeadlessBackend::TASK_PERIOD_MS);
+    display_ = std::make_unique<DisplayManager>(std::move(backend));
+#else
+    display_ = std::make_unique<DisplayManager>(std::make_unique<St7789Backend>());
+#endif
+}
+
+void X402PaymentClient::displayInitEntry(void* arg) {
+    auto* self = static_cast<X402PaymentClient*>(arg);
+    bool ok = self->display_->init();
+    BootProfiler::mark("display ready");
+    xEventGroupSetBits(self->boot_events_, ok ? BOOT_DISPLAY_OK : BOOT_DISPLAY_FAILED);
+    vTaskDelete(nullptr);
+}
+
+bool X402PaymentClient::waitDisplayReady() {
+    EventBits_t bits = xEventGroupWaitBits(boot_events_, BOOT_DISPLAY_OK | BOOT_DISPLAY_FAILED,
+                                           pdFALSE, pdFALSE, portMAX_DELAY);
+    return (bits & BOOT_DISPLAY_OK) != 0;
 }
 
 bool X402PaymentClient::init() {
@@ -48,13 +116,19 @@ bool X402PaymentClient::init() {
     }
 
     ESP_LOGI(TAG, "🔧 [INIT] Initializing environment...");
+    BootProfiler::mark("init start");
+    if (!boot_events_) {
+        ESP_LOGE(TAG, "❌ Failed to create boot event group");
+        BootProfiler::finish("init failed");
+        return false;
+    }
 
-    // Initialize display
+    // Display (SPI, panel, LVGL) comes up on its own task meanwhile
     ESP_LOGI(TAG, "Initializing display");
-
-    if (!display_->init()) {
-        ESP_LOGE(TAG, "❌ Display initialization failed");
-        return false;
+    if (xTaskCreate(displayInitEntry, "boot_display", 4096, this, 5, nullptr) != pdPASS) {
+        ESP_LOGW(TAG, "⚠️ Display init task failed, initializing inline");
+        xEventGroupSetBits(boot_events_, display_->init() ? BOOT_DISPLAY_OK : BOOT_DISPLAY_FAILED);
+        BootProfiler::mark("display ready");
     }
 
     // libsodium
@@ -62,13 +136,15 @@ bool X402PaymentClient::init() {
     
     if (sodium_init() < 0) {
         ESP_LOGE(TAG, "❌ libsodium initialization failed");
-        vTaskDelay(pdMS_TO_TICKS(2000));
+        waitDisplayReady();     // The display task still uses this object
+        BootProfiler::finish("init failed");
         return false;
     }
     ESP_LOGI(TAG, "✅ libsodium initialized successfully.");
-    vTaskDelay(pdMS_TO_TICKS(500));
+    BootProfiler::mark("crypto ready");
 
-    // NVS
+#if !CONFIG_IDF_TARGET_LINUX
+    // NVS (WiFi keeps its calibration data here, so it goes first)
     ESP_LOGI(TAG, "💾 Initializing NVS...");
     
     esp_err_t ret = nvs_flash_init();
@@ -78,46 +154,418 @@ bool X402PaymentClient::init() {
         nvs_flash_init();
     }
     ESP_LOGI(TAG, "✅ NVS initialized successfully.");
-    vTaskDelay(pdMS_TO_TICKS(500));
+    BootProfiler::mark("nvs ready");
+#endif
+
+    // Payments left SUBMITTED by the last run are looked up once the network is up
+    if (!journal_.open(journal_source_)) {
+        ESP_LOGW(TAG, "⚠️ Payment journal unavailable, payments are not journaled");
+    }
+    PaymentJournal::Entry unresolved;
+    const bool resume = journal_.unresolved(&unresolved, 1) > 0;
+    BootProfiler::mark("journal ready");
 
-    // WiFi
+    // WiFi associates in the background; tasks that need the network wait on it
     ESP_LOGI(TAG, "📶 Connecting to WiFi '%s'...", cfg_.wifi_ssid);
     
-    // Try to connect with timeout
-    int retry_count = 0;
-    const int max_retries = 10;  // 10 seconds timeout
-    
-    if (!wifi_->connect()) {
+    if (!wifi_->start()) {
         ESP_LOGE(TAG, "❌ WiFi connect start failed");
-        vTaskDelay(pdMS_TO_TICKS(2000));
+        waitDisplayReady();
+        BootProfiler::finish("init failed");
         return false;
     }
-    
-    // Wait for connection with timeout
-    while (retry_count < max_retries) {
-        if (wifi_->isConnected()) {
-            ESP_LOGI(TAG, "✅ WiFi connected!");
-            break;
+    BootProfiler::mark("wifi started");
+
+    // Source ATA is fixed for the configured payer/mint, derive it once
+    uint8_t mint[32];
+    uint8_t bump;
+    if (CryptoUtils::base58ToBytes(cfg_.token_mint, mint) &&
+        solana_->deriveAssociatedTokenAddress(cfg_.payer_public_key, mint, source_ata_, &bump)) {
+        source_ata_ready_ = true;
+    } else {
+        ESP_LOGW(TAG, "⚠️ Source ATA derivation failed, balance checks disabled");
+    }
+
+    // Sub-wallets draw on the configured payer, so they need its ATA too
+    if (cfg_.payer_wallets > 1) {
+        if (!PAYER_WALLETS) {
+            ESP_LOGW(TAG, "⚠️ payer_wallets ignored, enable CONFIG_X402_PAYER_WALLETS");
+        } else if (nonce_mode_) {
+            // AdvanceNonceAccount must be signed by the nonce authority, the configured payer
+            ESP_LOGW(TAG, "⚠️ payer_wallets ignored with a durable nonce");
+        } else if (!source_ata_ready_ ||
+                   !wallets_.init(cfg_.payer_private_key, cfg_.payer_wallets, mint, *solana_)) {
+            ESP_LOGW(TAG, "⚠️ Payer wallets unavailable, paying from the configured payer");
         }
-        
-        ESP_LOGI(TAG, "Waiting for WiFi... (%d/%d)", retry_count + 1, max_retries);
-        vTaskDelay(pdMS_TO_TICKS(1000));
-        retry_count++;
     }
-    
-    if (retry_count >= max_retries) {
-        ESP_LOGE(TAG, "❌ WiFi connection timeout");
-        vTaskDelay(pdMS_TO_TICKS(2000));
+
+    // Background task seeds the balance ledger and reconciles it later
+    if (xTaskCreate(maintenanceTaskEntry, "x402_maint", 8192, this, 3, &maintenance_task_) != pdPASS) {
+        ESP_LOGW(TAG, "⚠️ Failed to create maintenance task");
+        maintenance_task_ = nullptr;
+    }
+    // One long-lived worker runs every payment, in order
+    if (!ui_events_ || !payment_jobs_ ||
+        xTaskCreate(paymentWorkerEntry, "payment_worker", 8192, this, 5, &payment_worker_) != pdPASS) {
+        ESP_LOGE(TAG, "❌ Failed to create payment worker");
+        waitDisplayReady();
+        BootProfiler::finish("init failed");
+        return false;
+    }
+
+    // Boot counts as use: the pool fills for the first tap
+    last_flow_us_ = esp_timer_get_time();
+
+    // Lookup table goes first so the first pooled payment is already v0
+    requestMaintenance(MAINT_RECONCILE_BALANCE | MAINT_REFILL_POOL | MAINT_REFRESH_FEES |
+                       (resume ? MAINT_RESOLVE_JOURNAL : 0) |
+                       (nonce_mode_ ? MAINT_REFRESH_NONCE : 0) |
+                       (lookup_table_ ? MAINT_LOAD_LOOKUP_TABLE : 0));
+
+    // The idle screen can go up as soon as the panel is ready
+    if (!waitDisplayReady()) {
+        ESP_LOGE(TAG, "❌ Display initialization failed");
+        BootProfiler::finish("init failed");
         return false;
     }
 
     ESP_LOGI(TAG, "✅ Environment initialized.");
-    vTaskDelay(pdMS_TO_TICKS(1000));
+    if (maintenance_task_) {
+        BootProfiler::mark("ui ready");     // Printed once the network is up
+    } else {
+        BootProfiler::finish("ui ready");   // Nothing waits for the network
+    }
     
     env_initialized_ = true;
     return true;
 }
 
+void X402PaymentClient::maintenanceTaskEntry(void* arg) {
+    static_cast<X402PaymentClient*>(arg)->maintenanceLoop();
+}
+
+void X402PaymentClient::maintenanceLoop() {
+    ESP_LOGI(TAG, "🛠️ Maintenance task started");
+
+    // Off the boot path: mounting SPIFFS can take a while, longer if it has to format
+    if (ConfigManager::init()) {
+        cache_.openDisk(cache_dir_);
+    }
+
+    // Everything below needs RPC; requests posted meanwhile stay pending
+    bool timed_out = false;
+    while (!wifi_->waitConnected(WIFI_CONNECT_TIMEOUT_MS)) {
+        ESP_LOGW(TAG, "⚠️ WiFi not connected after %lu ms, still trying", WIFI_CONNECT_TIMEOUT_MS);
+        if (!timed_out) {
+            // Print what booted so far; the full timeline follows if WiFi comes up
+            BootProfiler::finish("network timeout");
+            timed_out = true;
+        }
+    }
+    ESP_LOGI(TAG, "✅ WiFi connected!");
+    BootProfiler::finish("network ready");
+    Metrics::observe("boot.network_ready_ms", BootProfiler::elapsedMs("network ready"));
+    int64_t last_reconcile_us = esp_timer_get_time();
+    int64_t last_fees_us = last_reconcile_us;
+    int64_t last_metrics_us = last_reconcile_us;
+
+    while (1) {
+        uint32_t bits = 0;
+        if (xTaskNotifyWait(0, UINT32_MAX, &bits, pdMS_TO_TICKS(MAINTENANCE_PERIOD_MS)) != pdTRUE) {
+            // Idle tick: keep the pool fresh, reconcile now and then
+            bits = MAINT_REFILL_POOL;
+            if (esp_timer_get_time() - last_reconcile_us >= (int64_t)RECONCILE_PERIOD_MS * 1000) {
+                bits |= MAINT_RECONCILE_BALANCE;
+            }
+            if (esp_timer_get_time() - last_fees_us >= (int64_t)FEE_REFRESH_PERIOD_MS * 1000) {
+                bits |= MAINT_REFRESH_FEES;
+            }
+            if (METRICS_DUMP_PERIOD_US > 0 &&
+                esp_timer_get_time() - last_metrics_us >= METRICS_DUMP_PERIOD_US) {
+                Metrics::dump();
+                last_metrics_us = esp_timer_get_time();
+            }
+            // Settled/aborted records wait in RAM for the next batch; write them out
+            journal_.flush();
+            PaymentJournal::Entry unresolved;
+            if (journal_.unresolved(&unresolved, 1) > 0) {
+                bits |= MAINT_RESOLVE_JOURNAL;
+            }
+        }
+
+        if (lookup_table_ && !lookup_table_ready_ && !(bits & MAINT_LOAD_LOOKUP_TABLE)) {
+            // Retry a failed load on the next pass
+            bits |= MAINT_LOAD_LOOKUP_TABLE;
+        }
+        if (bits & MAINT_LOAD_LOOKUP_TABLE) {
+            loadLookupTable();
+        }
+        // Before reconciling, so a payment found on chain is not taken for drift
+        if (bits & MAINT_RESOLVE_JOURNAL) {
+            resolveJournal();
+        }
+        if (bits & MAINT_RECONCILE_BALANCE) {
+            // Top-ups are planned from balances read in the same pass
+            if (reconcileBalance() && wallets_.count() > 0) {
+                rebalanceWallets();
+            }
+            last_reconcile_us = esp_timer_get_time();
+        }
+        if ((bits & MAINT_REFRESH_NONCE) && nonce_mode_) {
+            refreshNonce();
+        }
+        if (bits & MAINT_REFILL_POOL) {
+            refillPool();
+        }
+        // After the pool so the first refresh can include the offer's fee payer
+        if (bits & MAINT_REFRESH_FEES) {
+            refreshFees();
+            last_fees_us = esp_timer_get_time();
+        }
+    }
+}
+
+void X402PaymentClient::requestMaintenance(uint32_t bits) {
+    if (maintenance_task_) {
+        xTaskNotify(maintenance_task_, bits, eSetBits);
+    }
+}
+
+bool X402PaymentClient::reconcileBalance() {
+    if (!source_ata_ready_) {
+        return false;
+    }
+
+    uint64_t on_chain = 0;
+    if (!solana_->fetchTokenAccountBalance(source_ata_, &on_chain)) {
+        ESP_LOGW(TAG, "⚠️ Balance fetch failed, ledger left as is");
+        Metrics::increment("ledger.fetch_failed");
+        return false;
+    }
+    ledger_.reconcile(on_chain);
+
+    bool complete = true;
+    for (size_t i = 0; i < wallets_.count(); i++) {
+        if (solana_->fetchTokenAccountBalance(wallets_.wallet(i).ata, &on_chain)) {
+            wallets_.ledger(i).reconcile(on_chain);
+        } else if (wallets_.ledger(i).isSeeded()) {
+            Metrics::increment("ledger.fetch_failed");
+            complete = false;
+        }
+        // A wallet's token account does not exist before its first top-up
+    }
+    return complete;
+}
+
+int X402PaymentClient::pickPayer(uint64_t amount) {
+    if (wallets_.count() == 0) {
+        return PayerWallets::TREASURY;
+    }
+    int wallet = wallets_.pick(amount);
+    Metrics::increment(wallet == PayerWallets::TREASURY ? "wallet.fallback" : "wallet.assigned");
+    return wallet;
+}
+
+BalanceLedger& X402PaymentClient::payerLedger(int wallet) {
+    return wallet == PayerWallets::TREASURY ? ledger_ : wallets_.ledger(wallet);
+}
+
+bool X402PaymentClient::journalPayerKey(uint8_t payer, uint8_t out[32]) const {
+    if (payer == 0) {
+        memcpy(out, cfg_.payer_public_key, 32);
+        return true;
+    }
+    if (payer <= wallets_.count()) {
+        memcpy(out, wallets_.wallet(payer - 1).public_key, 32);
+        return true;
+    }
+    // Signed by a wallet that is no longer configured: its key is still derivable
+    uint8_t secret[32];
+    bool ok = PayerWallets::derive(cfg_.payer_private_key, payer - 1, out, secret);
+    sodium_memzero(secret, sizeof(secret));
+    return ok;
+}
+
+bool X402PaymentClient::rebalanceWallets() {
+    PayerWallets::TopUp plan[PayerWallets::MAX_TOPUPS];
+    size_t count = wallets_.planTopUps(ledger_.available(), plan);
+    if (count == 0) {
+        return true;
+    }
+
+    SolanaClient::Funding fundings[PayerWallets::MAX_TOPUPS];
+    uint64_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        fundings[i] = {wallets_.wallet(plan[i].wallet).public_key, plan[i].amount};
+        total += plan[i].amount;
+    }
+    // Held like a payment, so the treasury cannot promise the same funds twice
+    if (!ledger_.tryReserve(total)) {
+        return false;
+    }
+    BalanceLedger::Reservation reservation(ledger_, total);
+
+    uint8_t blockhash[32];
+    std::vector<uint8_t> tx_message;
+    uint8_t signature[64];
+    if (!solana_->fetchRecentBlockhash(blockhash) ||
+        !solana_->buildFundingTransaction(cfg_.payer_public_key, fundings, count,
+                                          cfg_.token_mint, cfg_.token_decimals,
+                                          blockhash, tx_message) ||
+        !CryptoUtils::ed25519Sign(signature, tx_message.data(), tx_message.size(),
+                                  cfg_.payer_private_key, cfg_.payer_public_key) ||
+        !solana_->sendTransaction(tx_message, signature)) {
+        ESP_LOGW(TAG, "⚠️ Wallet top-up failed");
+        Metrics::increment("wallet.topup_failed");
+        return false;
+    }
+
+    // Wallet ledgers pick the funds up once the top-up lands and they reconcile
+    reservation.commit();
+    wallets_.markToppedUp(plan, count);
+    Metrics::increment("wallet.topups", count);
+    ESP_LOGI(TAG, "👛 Topped up %zu payer wallets with %llu", count, (unsigned long long)total);
+    return true;
+}
+
+PaymentJournal::Type X402PaymentClient::resolvePayment(const PaymentJournal::Entry& entry) {
+    uint8_t signer[32];
+    SolanaClient::TxStatus status;
+    if (!journalPayerKey(entry.payer, signer) ||
+        !solana_->findSignedTransaction(signer, entry.signature, &status)) {
+        Metrics::increment("journal.lookup_failed");
+        return PaymentJournal::SUBMITTED;
+    }
+
+    if (status == SolanaClient::TxStatus::Landed) {
+        ESP_LOGI(TAG, "🧾 Payment #%lu landed on chain, marking settled", (unsigned long)entry.id);
+        journal_.record(entry.id, PaymentJournal::SETTLED);
+        Metrics::increment("journal.resolved_settled");
+        return PaymentJournal::SETTLED;
+    }
+    // Recovered entries were sent before the reboot, long enough ago
+    bool expired = entry.recorded_at_us == 0 ||
+                   esp_timer_get_time() - entry.recorded_at_us >= TX_LANDING_WINDOW_US;
+    if (status == SolanaClient::TxStatus::Failed || expired) {
+        ESP_LOGI(TAG, "🧾 Payment #%lu did not land, marking aborted", (unsigned long)entry.id);
+        journal_.record(entry.id, PaymentJournal::ABORTED);
+        Metrics::increment("journal.resolved_aborted");
+        return PaymentJournal::ABORTED;
+    }
+    return PaymentJournal::SUBMITTED;
+}
+
+void X402PaymentClient::resolveJournal() {
+    PaymentJournal::Entry entries[PaymentJournal::MAX_LIVE];
+    size_t n = journal_.unresolved(entries, PaymentJournal::MAX_LIVE);
+    for (size_t i = 0; i < n; i++) {
+        resolvePayment(entries[i]);
+    }
+    journal_.flush();
+}
+
+bool X402PaymentClient::clearToPay(const char* resource, bool* already_paid) {
+    *already_paid = false;
+    PaymentJournal::Entry prior;
+    if (!journal_.findUnresolved(resource, prior)) {
+        return true;
+    }
+
+    ESP_LOGW(TAG, "⚠️ Payment #%lu for this resource has no outcome yet, checking chain",
+             (unsigned long)prior.id);
+    display_->showStatus("Payment", "Checking previous...");
+    switch (resolvePayment(prior)) {
+        case PaymentJournal::ABORTED:
+            return true;
+        case PaymentJournal::SETTLED:
+            Metrics::increment("journal.deduplicated");
+            display_->showSuccess("Already\nPaid!");
+            *already_paid = true;
+            return false;
+        default:
+            display_->showError("Payment\nPending!");
+            uiPause(2000);
+            return false;
+    }
+}
+
+bool X402PaymentClient::refreshNonce() {
+    SolanaClient::NonceAccount fresh;
+    if (!solana_->fetchNonceAccount(nonce_.address, fresh)) {
+        Metrics::increment("nonce.fetch_failed");
+        return false;
+    }
+
+    portENTER_CRITICAL(&nonce_lock_);
+    // Unchanged value means the last TX built on it never landed, so it is reusable
+    bool advanced = memcmp(fresh.nonce, nonce_.nonce, 32) != 0;
+    nonce_ = fresh;
+    portEXIT_CRITICAL(&nonce_lock_);
+
+    Metrics::increment(advanced ? "nonce.advanced" : "nonce.unchanged");
+    return true;
+}
+
+bool X402PaymentClient::refreshFees() {
+    // Fees are local to the accounts a TX write-locks: our token account and
+    // the facilitator's fee payer, which every one of its settlements touches
+    uint8_t accounts[2][32];
+    size_t count = 0;
+    if (source_ata_ready_) {
+        memcpy(accounts[count++], source_ata_, 32);
+    }
+    if (fee_payer_known_) {
+        memcpy(accounts[count++], fee_payer_key_, 32);
+    }
+    if (count == 0) {
+        return false;
+    }
+
+    uint64_t samples[160];
+    size_t n = 0;
+    if (!solana_->fetchRecentPrioritizationFees(accounts, count, samples, 160, &n)) {
+        Metrics::increment("fee.fetch_failed");
+        return false;
+    }
+    fees_.addFeeSamples(samples, n);
+    Metrics::observe("fee.unit_price", fees_.unitPrice());
+    return true;
+}
+
+bool X402PaymentClient::loadLookupTable() {
+    if (!lookup_table_ || lookup_table_ready_) {
+        return lookup_table_ready_;
+    }
+    if (!solana_->fetchAddressLookupTable(lookup_table_->address, *lookup_table_)) {
+        Metrics::increment("alt.load_failed");
+        return false;
+    }
+    lookup_table_ready_ = true;
+    return true;
+}
+
+bool X402PaymentClient::acquireNonce(SolanaClient::NonceAccount& out) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+        portENTER_CRITICAL(&nonce_lock_);
+        bool valid = nonce_.valid;
+        if (valid) {
+            out = nonce_;
+            nonce_.valid = false;  // Consumed until the next refresh
+        }
+        portEXIT_CRITICAL(&nonce_lock_);
+
+        if (valid) {
+            Metrics::increment("nonce.used");
+            return true;
+        }
+        // Background refresh has not happened yet, do it inline once
+        if (attempt == 0 && !refreshNonce()) {
+            break;
+        }
+    }
+    return false;
+}
+
 bool X402PaymentClient::fetchPaymentOffer(cJSON** offer_json) {
     ESP_LOGI(TAG, "🌍 [STEP 1] Requesting payment offer...");
     display_->showStatus("Payment", "Fetching offer...");
@@ -125,48 +573,57 @@ bool X402PaymentClient::fetchPaymentOffer(cJSON** offer_json) {
     if (!http_->get_402(cfg_.payai_url, offer_json)) {
         ESP_LOGE(TAG, "❌ Failed to fetch payment offer");
         display_->showError("Offer Fetch\nFailed!");
-        vTaskDelay(pdMS_TO_TICKS(2000));
+        stageDone("offer", false);
+        uiPause(2000);
         return false;
     }
     
     ESP_LOGI(TAG, "✅ Payment offer received");
     display_->showStatus("Payment", "Offer received");
-    vTaskDelay(pdMS_TO_TICKS(500));
+    stageDone("offer");
+    uiPause(500);
     
     return true;
 }
 
-bool X402PaymentClient::executePaymentFlow() {
-    ESP_LOGI(TAG, "");
-    ESP_LOGI(TAG, "🚀 Starting payment flow...");
-
-    // Environment should already be initialized from main
-    // Just verify WiFi is connected
-    if (!env_initialized_) {
-        ESP_LOGW(TAG, "Environment not initialized, initializing now...");
-        if (!init()) {
-            return false;
-        }
+bool X402PaymentClient::parseOffer(cJSON* offer_json, const X402Config& config, PaymentOffer& out) {
+    cJSON* accepts = cJSON_GetObjectItem(offer_json, "accepts");
+    if (!accepts || !cJSON_IsArray(accepts) || cJSON_GetArraySize(accepts) == 0) {
+        ESP_LOGE(TAG, "❌ Invalid offer");
+        return false;
     }
 
-    cJSON* offer_json = nullptr;
-    if (!fetchPaymentOffer(&offer_json)) {
+    // A signed transfer of another mint, or on another cluster, is money the
+    // merchant asked for in terms this device never agreed to
+    const char* network = config.network ? config.network : x402::DEFAULT_NETWORK;
+    if (!network || !config.token_mint) {
+        ESP_LOGE(TAG, "❌ Config needs \"network\" and \"token_mint\" to accept offers");
         return false;
     }
 
-    ESP_LOGI(TAG, "🔍 Parsing offer details...");
-    display_->showStatus("Payment", "Parsing offer...");
-    
-    cJSON* accepts = cJSON_GetObjectItem(offer_json, "accepts");
-    if (!accepts || !cJSON_IsArray(accepts) || cJSON_GetArraySize(accepts) == 0) {
-        ESP_LOGE(TAG, "❌ Invalid offer");
-        display_->showError("Invalid\nOffer!");
-        cJSON_Delete(offer_json);
-        vTaskDelay(pdMS_TO_TICKS(2000));
+    // One pass: the first entry this build can pay, on the configured
+    // network and in the configured mint, is the offer
+    cJSON* offer = nullptr;
+    cJSON* item = nullptr;
+    cJSON_ArrayForEach(item, accepts) {
+        const char* item_network = cJSON_GetStringValue(cJSON_GetObjectItem(item, "network"));
+        const char* item_asset = cJSON_GetStringValue(cJSON_GetObjectItem(item, "asset"));
+        if (!item_network || strcmp(item_network, network) != 0 ||
+            !item_asset || strcmp(item_asset, config.token_mint) != 0) {
+            continue;
+        }
+        out.policy = x402::EnabledSchemes::match(
+            cJSON_GetStringValue(cJSON_GetObjectItem(item, "scheme")), item_network);
+        if (out.policy >= 0) {
+            offer = item;
+            break;
+        }
+    }
+    if (!offer) {
+        ESP_LOGE(TAG, "❌ No offer in the configured token mint on %s", network);
         return false;
     }
 
-    cJSON* offer = cJSON_GetArrayItem(accepts, 0);
     const char* payTo = cJSON_GetStringValue(cJSON_GetObjectItem(offer, "payTo"));
     const char* asset = cJSON_GetStringValue(cJSON_GetObjectItem(offer, "asset"));
     const char* amount_str = cJSON_GetStringValue(cJSON_GetObjectItem(offer, "maxAmountRequired"));
@@ -176,112 +633,437 @@ bool X402PaymentClient::executePaymentFlow() {
 
     if (!payTo || !asset || !amount_str || !resource || !feePayer) {
         ESP_LOGE(TAG, "❌ Incomplete offer data");
-        display_->showError("Invalid\nOffer Data!");
-        cJSON_Delete(offer_json);
-        vTaskDelay(pdMS_TO_TICKS(2000));
+        return false;
+    }
+    if (strlen(payTo) >= sizeof(out.pay_to) || strlen(asset) >= sizeof(out.asset) ||
+        strlen(feePayer) >= sizeof(out.fee_payer) || strlen(resource) >= sizeof(out.resource)) {
+        ESP_LOGE(TAG, "❌ Offer field too long");
         return false;
     }
 
-    uint64_t amount = strtoull(amount_str, nullptr, 10);
-    ESP_LOGI(TAG, "💰 Amount: %.6f %s", (double)amount / 1e6, asset);
+    strcpy(out.pay_to, payTo);
+    strcpy(out.asset, asset);
+    strcpy(out.fee_payer, feePayer);
+    strcpy(out.resource, resource);
+    out.amount = strtoull(amount_str, nullptr, 10);
 
-    char amount_display[64];
-    snprintf(amount_display, sizeof(amount_display), "Amount:\n%.6f", (double)amount / 1e6);
-    display_->showStatus("Transaction", amount_display);
-    vTaskDelay(pdMS_TO_TICKS(1500));
+    // Fingerprint of everything the signed transaction depends on
+    char material[sizeof(out.pay_to) + sizeof(out.asset) + sizeof(out.fee_payer) +
+                  sizeof(out.resource) + 32];
+    int len = snprintf(material, sizeof(material), "%d|%s|%s|%s|%s|%llu",
+                       out.policy, out.pay_to, out.asset, out.fee_payer, out.resource,
+                       (unsigned long long)out.amount);
+    crypto_hash_sha256(out.hash, reinterpret_cast<const uint8_t*>(material), len);
+    return true;
+}
+
+void X402PaymentClient::uiStatus(bool interactive, const char* title, const char* message, uint32_t pause_ms) {
+    if (interactive) {
+        display_->showStatus(title, message);
+        if (pause_ms) uiPause(pause_ms);
+    }
+}
+
+void X402PaymentClient::uiError(bool interactive, const char* message) {
+    if (interactive) {
+        display_->showError(message);
+        uiPause(2000);
+    }
+}
+
+void X402PaymentClient::uiPause(uint32_t ms) {
+    if (paced_) {
+        vTaskDelay(pdMS_TO_TICKS(ms));
+    }
+}
+
+void X402PaymentClient::stageDone(const char* stage, bool ok) {
+    if (!stage_observer_ || stage_task_ != xTaskGetCurrentTaskHandle()) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    stage_observer_(stage, now - stage_mark_us_, ok);
+    stage_mark_us_ = now;
+}
+
+bool X402PaymentClient::buildPayment(const PaymentOffer* offers, size_t count, int wallet,
+                                     PreparedPayment& out, bool interactive, bool allow_nonce) {
+    out.header = nullptr;
+    out.uses_nonce = false;
+
+    const uint8_t* payer_public = cfg_.payer_public_key;
+    const uint8_t* payer_secret = cfg_.payer_private_key;
+    if (wallet != PayerWallets::TREASURY) {
+        payer_public = wallets_.wallet(wallet).public_key;
+        payer_secret = wallets_.wallet(wallet).secret_key;
+    }
+
+    // Durable nonce replaces the blockhash RPC
+    SolanaClient::NonceAccount nonce;
+    const bool use_nonce = nonce_mode_ && allow_nonce && acquireNonce(nonce);
 
     uint8_t blockhash[32];
-    ESP_LOGI(TAG, "🔗 [STEP 3] Fetching blockhash...");
-    display_->showStatus("Solana", "Fetching blockhash...");
-    
-    if (!solana_->fetchRecentBlockhash(blockhash)) {
-        ESP_LOGE(TAG, "❌ Failed to fetch blockhash");
-        display_->showError("Blockhash\nFailed!");
-        cJSON_Delete(offer_json);
-        vTaskDelay(pdMS_TO_TICKS(2000));
-        return false;
+    if (use_nonce) {
+        ESP_LOGI(TAG, "🔗 [STEP 3] Using durable nonce, skipping blockhash fetch");
+    } else {
+        ESP_LOGI(TAG, "🔗 [STEP 3] Fetching blockhash...");
+        uiStatus(interactive, "Solana", "Fetching blockhash...", 0);
+
+        if (!solana_->fetchRecentBlockhash(blockhash)) {
+            ESP_LOGE(TAG, "❌ Failed to fetch blockhash");
+            stageDone("blockhash", false);
+            uiError(interactive, "Blockhash\nFailed!");
+            return false;
+        }
+
+        ESP_LOGI(TAG, "✅ Blockhash obtained");
+        stageDone("blockhash");
+        uiStatus(interactive, "Solana", "Blockhash OK", 500);
     }
-    
-    ESP_LOGI(TAG, "✅ Blockhash obtained");
-    display_->showStatus("Solana", "Blockhash OK");
-    vTaskDelay(pdMS_TO_TICKS(500));
+
+    // Refresh the nonce if the build fails; on success the caller refreshes
+    // it once the TX has been submitted (or the pooled entry is dropped)
+    struct NonceRefresh {
+        X402PaymentClient* client;
+        bool armed;
+        ~NonceRefresh() { if (armed) client->requestMaintenance(MAINT_REFRESH_NONCE); }
+    } nonce_refresh{this, use_nonce};
 
     std::vector<uint8_t> tx_message;
     ESP_LOGI(TAG, "🔨 [STEP 4] Building transaction...");
-    display_->showStatus("Transaction", "Building...");
+    uiStatus(interactive, "Transaction", "Building...", 0);
     
-    if (!solana_->buildTransaction(
-            cfg_.payer_public_key, payTo, feePayer,
-            cfg_.token_mint, amount, cfg_.token_decimals,
-            blockhash, tx_message)) {
+    SolanaClient::Transfer transfers[SolanaClient::MAX_BATCH_TRANSFERS];
+    if (count == 0 || count > SolanaClient::MAX_BATCH_TRANSFERS) {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        transfers[i] = {offers[i].pay_to, offers[i].amount};
+    }
+
+    SolanaClient::ComputeBudget budget = {fees_.unitLimit(count), fees_.unitPrice()};
+    ESP_LOGI(TAG, "⛽ Priority fee: %llu uLamports/CU, limit %u CU",
+             (unsigned long long)budget.unitPrice, (unsigned)budget.unitLimit);
+
+    if (!solana_->buildBatchTransaction(
+            payer_public, transfers, count, offers[0].fee_payer,
+            cfg_.token_mint, cfg_.token_decimals,
+            blockhash, tx_message, use_nonce ? &nonce : nullptr,
+            lookup_table_ready_ ? lookup_table_.get() : nullptr, &budget)) {
         ESP_LOGE(TAG, "❌ Failed to build transaction");
-        display_->showError("TX Build\nFailed!");
-        cJSON_Delete(offer_json);
-        vTaskDelay(pdMS_TO_TICKS(2000));
+        stageDone("build", false);
+        uiError(interactive, "TX Build\nFailed!");
         return false;
     }
     
     ESP_LOGI(TAG, "✅ Transaction built (%zu bytes)", tx_message.size());
-    display_->showStatus("Transaction", "Built!");
-    vTaskDelay(pdMS_TO_TICKS(500));
+    stageDone("build");
+    Metrics::observe(lookup_table_ready_ ? "tx.v0_message_bytes" : "tx.legacy_message_bytes",
+                     tx_message.size());
+    uiStatus(interactive, "Transaction", "Built!", 500);
 
     uint8_t signature[64];
     ESP_LOGI(TAG, "🔐 [STEP 5] Signing...");
-    display_->showStatus("Signing", "Signing TX...");
+    uiStatus(interactive, "Signing", "Signing TX...", 0);
     
     if (!CryptoUtils::ed25519Sign(signature,
                                   tx_message.data(),
                                   tx_message.size(),
-                                  cfg_.payer_private_key,
-                                  cfg_.payer_public_key)) {
+                                  payer_secret,
+                                  payer_public)) {
         ESP_LOGE(TAG, "❌ Signing failed");
-        display_->showError("Signing\nFailed!");
-        cJSON_Delete(offer_json);
-        vTaskDelay(pdMS_TO_TICKS(2000));
+        stageDone("sign", false);
+        uiError(interactive, "Signing\nFailed!");
         return false;
     }
     
     ESP_LOGI(TAG, "✅ Transaction signed");
-    display_->showStatus("Signing", "Signed!");
-    vTaskDelay(pdMS_TO_TICKS(500));
+    stageDone("sign");
+    uiStatus(interactive, "Signing", "Signed!", 500);
 
     std::string base64_tx;
     ESP_LOGI(TAG, "📦 [STEP 6] Encoding...");
-    display_->showStatus("Encoding", "Encoding...");
+    uiStatus(interactive, "Encoding", "Encoding...", 0);
     
     if (!solana_->buildSignedTransaction(tx_message, signature, base64_tx)) {
         ESP_LOGE(TAG, "❌ Encoding failed");
-        display_->showError("Encoding\nFailed!");
-        cJSON_Delete(offer_json);
-        vTaskDelay(pdMS_TO_TICKS(2000));
+        stageDone("encode", false);
+        uiError(interactive, "Encoding\nFailed!");
         return false;
     }
     
     ESP_LOGI(TAG, "✅ Transaction encoded");
-    display_->showStatus("Encoding", "Encoded!");
-    vTaskDelay(pdMS_TO_TICKS(500));
+    uiStatus(interactive, "Encoding", "Encoded!", 500);
+
+    // Measure real compute usage off the payment path to size future limits
+    uint32_t units = 0;
+    if (!interactive && count == 1 && solana_->simulateUnitsConsumed(tx_message, use_nonce, &units)) {
+        fees_.addUnitsSample(units);
+        Metrics::observe("fee.units_consumed", units);
+    }
+
+    out.header = x402::EnabledSchemes::buildHeader(offers[0].policy, base64_tx.c_str());
+    stageDone("encode", out.header != nullptr);
+    if (out.header) {
+        Metrics::observe("payment.header_bytes", strlen(out.header));
+    }
+    memcpy(out.signature, signature, 64);
+    out.uses_nonce = use_nonce;
+    out.built_at_us = esp_timer_get_time();
+
+    nonce_refresh.armed = (out.header == nullptr) && use_nonce;
+    return out.header != nullptr;
+}
+
+X402PaymentClient::SubmitFailure X402PaymentClient::classifySubmit(
+        const HttpClient::StreamResult& result, bool delivered) {
+    int status = result.status;
+    if (status == 200) {
+        return delivered ? SubmitFailure::None : SubmitFailure::Undelivered;
+    }
+    if (status == 0) {
+        return SubmitFailure::Network;
+    }
+    if (status == 408 || status == 429 || status >= 500) {
+        return SubmitFailure::ServerError;
+    }
+    // Facilitators word it "Blockhash not found", "blockhash_not_found", ...
+    if (status == 402 && strcasestr(result.error, "blockhash")) {
+        return SubmitFailure::BlockhashExpired;
+    }
+    return SubmitFailure::Rejected;
+}
+
+const char* X402PaymentClient::failureName(SubmitFailure failure) {
+    switch (failure) {
+        case SubmitFailure::None:             return "none";
+        case SubmitFailure::Network:          return "network";
+        case SubmitFailure::ServerError:      return "server";
+        case SubmitFailure::BlockhashExpired: return "blockhash";
+        case SubmitFailure::Rejected:         return "rejected";
+        case SubmitFailure::Undelivered:      return "undelivered";
+    }
+    return "?";
+}
+
+// Metric names must be literals
+static const char* retryMetric(const char* cause) {
+    if (strcmp(cause, "network") == 0) return "submit.retry.network";
+    if (strcmp(cause, "server") == 0) return "submit.retry.server";
+    return "submit.retry.blockhash";
+}
+
+static const char* recoveredMetric(const char* cause) {
+    if (strcmp(cause, "network") == 0) return "submit.recovered.network";
+    if (strcmp(cause, "server") == 0) return "submit.recovered.server";
+    return "submit.recovered.blockhash";
+}
 
+uint32_t X402PaymentClient::retryDelayMs(int attempt) {
+    uint32_t ceiling = RETRY_BASE_MS << std::min(attempt, 4);
+    return ceiling / 2 + esp_random() % (ceiling / 2 + 1);
+}
+
+bool X402PaymentClient::retryPause(int attempt, int64_t deadline_us) {
+    uint32_t delay_ms = retryDelayMs(attempt);
+    if (esp_timer_get_time() + (int64_t)delay_ms * 1000 >= deadline_us) {
+        ESP_LOGW(TAG, "⏱️ Payment deadline reached, not retrying");
+        Metrics::increment("submit.deadline_exceeded");
+        return false;
+    }
+    display_->showStatus("Payment", "Retrying...");
+    vTaskDelay(pdMS_TO_TICKS(delay_ms));
+    return true;
+}
+
+void X402PaymentClient::showSubmitFailure(SubmitFailure failure) {
+    if (failure == SubmitFailure::Undelivered) {
+        display_->showError("Paid, Download\nIncomplete!");
+    } else {
+        display_->showError("Payment\nFailed!");
+    }
+    uiPause(3000);
+}
+
+const char* X402PaymentClient::submitStage(SubmitFailure failure) {
+    switch (failure) {
+        case SubmitFailure::None:             return "submit";
+        case SubmitFailure::Network:          return "submit.network";
+        case SubmitFailure::ServerError:      return "submit.server";
+        case SubmitFailure::BlockhashExpired: return "submit.blockhash";
+        case SubmitFailure::Rejected:         return "submit.rejected";
+        case SubmitFailure::Undelivered:      return "submit.undelivered";
+    }
+    return "submit";
+}
+
+X402PaymentClient::SubmitFailure X402PaymentClient::submitPayment(
+        const char* resource, const char* x_payment_header, BalanceLedger::Reservation& reservation,
+        uint32_t journal_id, const char* cache_url, bool resent) {
     ESP_LOGI(TAG, "💸 [STEP 7] Submitting payment...");
     display_->showStatus("Payment", "Submitting...");
-    
-    char* x_payment_header = buildPaymentPayload(base64_tx.c_str());
-    char* content = nullptr;
-    bool ok = http_->submit_payment(resource, x_payment_header, &content);
 
-    free(x_payment_header);
-    cJSON_Delete(offer_json);
+    // The head of the body is kept for the display and the cache; all of it
+    // streams to the content sink, so delivery memory does not grow with size
+    const size_t preview_cap = ContentCache::MAX_ENTRY_BYTES;
+    char* preview = (char*)malloc(preview_cap + 1);
+    size_t preview_len = 0;
+    bool preview_cut = (preview == nullptr);
+    AsyncHttp::Sink sink = [&](const char* data, size_t len) {
+        if (!preview_cut) {
+            size_t n = std::min(len, preview_cap - preview_len);
+            memcpy(preview + preview_len, data, n);
+            preview_len += n;
+            preview_cut = n < len;
+        }
+        return !content_sink_ || content_sink_(data, len);
+    };
 
-    if (!ok) {
-        ESP_LOGE(TAG, "❌ Payment submission failed");
-        display_->showError("Payment\nFailed!");
-        vTaskDelay(pdMS_TO_TICKS(3000));
+    HttpClient::StreamResult result;
+    bool delivered = http_->submit_payment_stream(resource, x_payment_header, sink, &result);
+    SubmitFailure failure = classifySubmit(result, delivered);
+
+    if (result.status == 200) {
+        reservation.commit();
+        journal_.record(journal_id, PaymentJournal::SETTLED);
+    } else if (result.status == 402 && !resent) {
+        // Rejected by the merchant, so the facilitator never settled it
+        journal_.record(journal_id, PaymentJournal::ABORTED);
+    } else if (result.status == 402) {
+        // An earlier send may have settled before its response was lost,
+        // and the merchant now refuses the spent proof: only the chain can tell
+        ESP_LOGW(TAG, "⚠️ Resent payment refused, checking chain before giving up");
+        Metrics::increment("submit.resent_refused");
+        PaymentJournal::Entry entry;
+        PaymentJournal::Type outcome = PaymentJournal::SUBMITTED;
+        if (journal_.findUnresolved(resource, entry) && entry.id == journal_id) {
+            outcome = resolvePayment(entry);
+        }
+        if (outcome == PaymentJournal::SETTLED) {
+            reservation.commit();
+            failure = SubmitFailure::Undelivered;   // Paid; the content went with the lost response
+        } else if (outcome == PaymentJournal::SUBMITTED) {
+            failure = SubmitFailure::Rejected;      // May still land: never signed again
+        }
+    }
+    // Settle the optimistic debit against the chain off the payment path
+    requestMaintenance(MAINT_RECONCILE_BALANCE);
+
+    if (result.status != 200) {
+        ESP_LOGE(TAG, "❌ Payment submission failed (%s, status %d, %s)%s%s",
+                 failureName(failure), result.status, esp_err_to_name(result.err),
+                 result.error[0] ? ": " : "", result.error);
+        free(preview);
+        return failure;
+    }
+
+    Metrics::observe("content.bytes", result.received);
+    if (result.resumes) {
+        Metrics::increment("content.resumes", result.resumes);
+    }
+    if (!delivered) {
+        ESP_LOGE(TAG, "❌ Paid, but content stopped at %zu bytes", result.received);
+        Metrics::increment("content.incomplete");
+        free(preview);
+        return failure;
+    }
+
+    ESP_LOGI(TAG, "✅ [SUCCESS] Payment completed! (%zu bytes, %u resumes)",
+             result.received, (unsigned)result.resumes);
+    const char* content = nullptr;
+    if (!preview_cut && preview_len > 0) {
+        preview[preview_len] = '\0';
+        content = preview;
+        cache_.put(cache_url, cache_scope_, content, preview_len, result.headers);
+    }
+    showPaymentResult(content);     // Too large to show: a plain success screen
+    free(preview);
+    return SubmitFailure::None;
+}
+
+X402PaymentClient::SubmitFailure X402PaymentClient::submitWithRetry(
+        const char* resource, const char* x_payment_header, BalanceLedger::Reservation& reservation,
+        uint32_t journal_id, const char* cache_url, int64_t deadline_us) {
+    // On flash before the header leaves: a reboot from here on is looked up, not repaid
+    journal_.record(journal_id, PaymentJournal::SUBMITTED);
+
+    const char* retried = nullptr;
+    for (int attempt = 0; ; ++attempt) {
+        SubmitFailure failure = submitPayment(resource, x_payment_header, reservation,
+                                              journal_id, cache_url, attempt > 0);
+        if (failure == SubmitFailure::None) {
+            if (retried) {
+                ESP_LOGI(TAG, "✅ Recovered from %s failure after %d retries", retried, attempt);
+                Metrics::increment(recoveredMetric(retried));
+            }
+            return failure;
+        }
+        // Resending the same signed TX cannot pay twice; anything else has
+        // to be rebuilt or given up by the caller
+        if (failure != SubmitFailure::Network && failure != SubmitFailure::ServerError) {
+            return failure;
+        }
+        if (attempt + 1 >= MAX_SUBMIT_ATTEMPTS || !retryPause(attempt, deadline_us)) {
+            return failure;
+        }
+        retried = failureName(failure);
+        ESP_LOGW(TAG, "🔁 Resending the same payment after a %s failure", retried);
+        Metrics::increment(retryMetric(retried));
+    }
+}
+
+bool X402PaymentClient::serveCached(const char* url) {
+    ContentCache::Hit hit;
+    if (!cache_.get(url, cache_scope_, hit)) {
         return false;
     }
 
-    ESP_LOGI(TAG, "✅ [SUCCESS] Payment completed!");
-    
+    bool served = hit.fresh;
+    if (!hit.fresh) {
+        ESP_LOGI(TAG, "🔄 Cached content is stale, revalidating...");
+        display_->showStatus("Payment", "Revalidating...");
+
+        char* body = nullptr;
+        AsyncHttp::Headers headers;
+        int status = http_->get_conditional(url, hit.etag, hit.last_modified, &body, &headers);
+        if (status == 304) {
+            cache_.refresh(url, cache_scope_, headers);
+            Metrics::increment("cache.revalidated");
+            served = true;
+        } else if (status == 200 && body) {
+            // Still served without payment, but downloaded again
+            cache_.put(url, cache_scope_, body, strlen(body), headers);
+            showPaymentResult(body);
+            free(body);
+            free(hit.content);
+            return true;
+        } else if (status == 402 && !hit.expired) {
+            // Merchants want a payment proof on every request, so a refusal
+            // says nothing about the copy: show it until its lifetime ends
+            ESP_LOGW(TAG, "⚠️ Revalidation answered 402, showing the copy until it expires");
+            Metrics::increment("cache.revalidate_refused");
+            served = true;
+        } else if (status == 402) {
+            // Its lifetime is over and the merchant wants a new payment
+            cache_.remove(url, cache_scope_);
+            Metrics::increment("cache.expired");
+        }
+        free(body);
+    }
+
+    if (served) {
+        ESP_LOGI(TAG, "💾 Showing cached content, no payment needed");
+        Metrics::increment("cache.bytes_saved", hit.len);
+        showPaymentResult(hit.content);
+    }
+    free(hit.content);
+    return served;
+}
+
+void X402PaymentClient::showPaymentResult(const char* content) {
     if (content) {
-        ESP_LOGI(TAG, "📦 Response:\n%s", content);
+        // Queued, not printed here; a long body is cut to what fits a record
+        DLOGI(TAG, "📦 Response (%u bytes):\n%s", (unsigned)strlen(content), content);
 
         cJSON* response_json = cJSON_Parse(content);
         if (response_json) {
@@ -323,54 +1105,591 @@ bool X402PaymentClient::executePaymentFlow() {
         } else {
             display_->showSuccess("Payment\nSuccessful!");
         }
-
-        free(content);
     } else {
         display_->showSuccess("Payment\nSuccessful!");
     }
+}
 
-    ESP_LOGI(TAG, "🏁 Payment flow finished");
+X402PaymentClient::ActiveFlow::ActiveFlow(X402PaymentClient* client) : client_(client) {
+    client_->payment_active_ = true;
+    client_->last_flow_us_ = esp_timer_get_time();
+}
+
+X402PaymentClient::ActiveFlow::~ActiveFlow() {
+    client_->stage_task_ = nullptr;
+    client_->payment_active_ = false;
+    client_->requestMaintenance(MAINT_REFILL_POOL);
+}
+
+bool X402PaymentClient::payOffer(const PaymentOffer& offer, const char* cache_url, int wallet,
+                                 BalanceLedger::Reservation& reservation, int64_t deadline_us,
+                                 bool allow_nonce, SubmitFailure& failure) {
+    // A blockhash rejection means the TX was never settled (the journal
+    // marks it ABORTED), so only the build and signature are redone; the
+    // offer, reservation and derived accounts are kept
+    failure = SubmitFailure::Rejected;
+    for (int signing = 0; signing <= MAX_RESIGNS; ++signing) {
+        if (signing > 0) {
+            if (!retryPause(signing - 1, deadline_us)) {
+                break;
+            }
+            ESP_LOGW(TAG, "🔁 Blockhash rejected, signing again with a fresh one");
+            Metrics::increment("submit.retry.blockhash");
+        }
+
+        uint32_t journal_id = journal_.begin(offer.resource, offer.amount, wallet + 1);
+        PreparedPayment payment;
+        if (!buildPayment(&offer, 1, wallet, payment, true, allow_nonce)) {
+            journal_.record(journal_id, PaymentJournal::ABORTED);
+            return false;
+        }
+        journal_.record(journal_id, PaymentJournal::SIGNED, payment.signature);
+
+        failure = submitWithRetry(offer.resource, payment.header, reservation, journal_id,
+                                  cache_url, deadline_us);
+        stageDone(submitStage(failure), failure == SubmitFailure::None);
+        free(payment.header);
+        if (payment.uses_nonce) {
+            requestMaintenance(MAINT_REFRESH_NONCE);
+        }
+        if (failure != SubmitFailure::BlockhashExpired) {
+            if (failure == SubmitFailure::None && signing > 0) {
+                Metrics::increment("submit.recovered.blockhash");
+            }
+            break;
+        }
+    }
     return true;
 }
 
-// Static task wrapper
-static void paymentTaskWrapper(void* arg) {
-    X402PaymentClient* client = static_cast<X402PaymentClient*>(arg);
-    
-    ESP_LOGI(TAG, "💡 Payment task started");
-    
-    bool success = client->executePaymentFlow();
-    
-    // Return to idle after showing result
-    if (success) {
-        client->returnToIdleAfterDelay(5000);  // 5 seconds
+bool X402PaymentClient::executePaymentFlow() {
+    ESP_LOGI(TAG, "");
+    ESP_LOGI(TAG, "🚀 Starting payment flow...");
+
+    // Environment should already be initialized from main
+    // Just verify WiFi is connected
+    if (!env_initialized_) {
+        ESP_LOGW(TAG, "Environment not initialized, initializing now...");
+        if (!init()) {
+            return false;
+        }
+    }
+
+    ActiveFlow active(this);
+    stage_task_ = xTaskGetCurrentTaskHandle();
+    stage_mark_us_ = esp_timer_get_time();
+
+    // Retries stop here, however far the flow got
+    const int64_t deadline_us = esp_timer_get_time() + PAYMENT_DEADLINE_US;
+
+    // Already bought: no offer, no payment, possibly no request at all
+    if (serveCached(cfg_.payai_url)) {
+        ESP_LOGI(TAG, "🏁 Payment flow finished (cached)");
+        return true;
+    }
+
+    // Pre-signed hit: skip offer, blockhash, build and sign entirely
+    PresignedPool::Entry pooled;
+    if (pool_.take(cfg_.payai_url, pooled)) {
+        int64_t age_ms = (esp_timer_get_time() - pooled.built_at_us) / 1000;
+        ESP_LOGI(TAG, "⚡ Using pre-signed payment (%lld ms old)", (long long)age_ms);
+        Metrics::increment("pool.hit");
+        Metrics::observe("pool.entry_age_ms", age_ms);
+        stageDone("pool");
+
+        SubmitFailure failure = SubmitFailure::Rejected;
+        bool already_paid = false;
+        bool rebuild = false;
+        BalanceLedger& payer_ledger = payerLedger(pooled.wallet);
+        if (!clearToPay(pooled.resource, &already_paid)) {
+            failure = already_paid ? SubmitFailure::None : SubmitFailure::Rejected;
+            if (!already_paid) stageDone("reserve", false);
+        } else if (!payer_ledger.tryReserve(pooled.amount)) {
+            if (pooled.wallet != PayerWallets::TREASURY) {
+                // Its wallet ran low since; another payer may still cover it
+                rebuild = true;
+            } else {
+                ESP_LOGE(TAG, "❌ Insufficient balance: need %llu, available %llu",
+                         (unsigned long long)pooled.amount, (unsigned long long)payer_ledger.available());
+                display_->showError("Insufficient\nBalance!");
+                stageDone("reserve", false);
+                uiPause(2000);
+            }
+        } else {
+            BalanceLedger::Reservation reservation(payer_ledger, pooled.amount);
+            PayerWallets::Lease lease(wallets_, pooled.wallet);
+            stageDone("reserve");
+            uint32_t journal_id = journal_.begin(pooled.resource, pooled.amount, pooled.wallet + 1);
+            journal_.record(journal_id, PaymentJournal::SIGNED, pooled.signature);
+            failure = submitWithRetry(pooled.resource, pooled.header, reservation, journal_id,
+                                      cfg_.payai_url, deadline_us);
+            stageDone(submitStage(failure), failure == SubmitFailure::None);
+            if (failure != SubmitFailure::None && failure != SubmitFailure::BlockhashExpired) {
+                showSubmitFailure(failure);
+            }
+        }
+
+        free(pooled.header);
+        if (pooled.uses_nonce) {
+            requestMaintenance(MAINT_REFRESH_NONCE);
+        }
+        if (rebuild) {
+            ESP_LOGW(TAG, "🔁 Pre-signed payer wallet ran low, building a fresh payment");
+        } else if (failure != SubmitFailure::BlockhashExpired) {
+            ESP_LOGI(TAG, "🏁 Payment flow finished");
+            return failure == SubmitFailure::None;
+        } else {
+            // Pre-signed too long ago and rejected unsettled: build a fresh one below
+            ESP_LOGW(TAG, "🔁 Pre-signed payment expired, building a fresh one");
+            Metrics::increment("submit.retry.blockhash");
+        }
     } else {
-        client->returnToIdleAfterDelay(3000);  // 3 seconds
+        Metrics::increment("pool.miss");
     }
-    
-    ESP_LOGI(TAG, "💡 Payment task finished");
-    
-    // Delete task
-    vTaskDelete(NULL);
+
+    cJSON* offer_json = nullptr;
+    if (!fetchPaymentOffer(&offer_json)) {
+        return false;
+    }
+
+    ESP_LOGI(TAG, "🔍 Parsing offer details...");
+    display_->showStatus("Payment", "Parsing offer...");
+
+    PaymentOffer offer;
+    bool parsed = parseOffer(offer_json, cfg_, offer);
+    cJSON_Delete(offer_json);
+    if (!parsed) {
+        display_->showError("Invalid\nOffer!");
+        stageDone("parse", false);
+        uiPause(2000);
+        return false;
+    }
+    stageDone("parse");
+
+    ESP_LOGI(TAG, "💰 Amount: %.6f %s", (double)offer.amount / 1e6, offer.asset);
+
+    bool already_paid = false;
+    if (!clearToPay(offer.resource, &already_paid)) {
+        if (!already_paid) stageDone("reserve", false);
+        return already_paid;
+    }
+
+    char amount_display[64];
+    snprintf(amount_display, sizeof(amount_display), "Amount:\n%.6f", (double)offer.amount / 1e6);
+    display_->showStatus("Transaction", amount_display);
+
+    // Local balance check before any further network work
+    const int wallet = pickPayer(offer.amount);
+    BalanceLedger& payer_ledger = payerLedger(wallet);
+    if (!payer_ledger.tryReserve(offer.amount)) {
+        ESP_LOGE(TAG, "❌ Insufficient balance: need %llu, available %llu",
+                 (unsigned long long)offer.amount, (unsigned long long)payer_ledger.available());
+        display_->showError("Insufficient\nBalance!");
+        stageDone("reserve", false);
+        uiPause(2000);
+        return false;
+    }
+    BalanceLedger::Reservation reservation(payer_ledger, offer.amount);
+    PayerWallets::Lease lease(wallets_, wallet);
+    stageDone("reserve");
+    uiPause(1500);
+
+    SubmitFailure failure;
+    if (!payOffer(offer, cfg_.payai_url, wallet, reservation, deadline_us, true, failure)) {
+        return false;
+    }
+    if (failure != SubmitFailure::None) {
+        showSubmitFailure(failure);
+    }
+
+    ESP_LOGI(TAG, "🏁 Payment flow finished");
+    return failure == SubmitFailure::None;
+}
+
+bool X402PaymentClient::executeBatchPaymentFlow(const char* const* urls, size_t count) {
+    ESP_LOGI(TAG, "");
+    ESP_LOGI(TAG, "🚀 Starting batch payment flow (%zu resources)...", count);
+
+    if (count == 0 || count > SolanaClient::MAX_BATCH_TRANSFERS) {
+        ESP_LOGE(TAG, "❌ Batch must hold 1..%zu resources", SolanaClient::MAX_BATCH_TRANSFERS);
+        return false;
+    }
+    if (!env_initialized_) {
+        ESP_LOGW(TAG, "Environment not initialized, initializing now...");
+        if (!init()) {
+            return false;
+        }
+    }
+
+    ActiveFlow active(this);
+
+    const int64_t deadline_us = esp_timer_get_time() + PAYMENT_DEADLINE_US;
+
+    // Resources bought before are shown from the cache and left out of the batch
+    const char* unpaid[SolanaClient::MAX_BATCH_TRANSFERS];
+    size_t remaining = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!serveCached(urls[i])) {
+            unpaid[remaining++] = urls[i];
+        }
+    }
+    if (remaining == 0) {
+        ESP_LOGI(TAG, "🏁 Batch payment flow finished (cached)");
+        return true;
+    }
+    urls = unpaid;
+    count = remaining;
+
+    // Offers are ~0.5 KB each, keep them off the task stack
+    std::unique_ptr<PaymentOffer[]> offers(new PaymentOffer[count]);
+    uint64_t total = 0;
+
+    ESP_LOGI(TAG, "🌍 [STEP 1] Requesting %zu payment offers...", count);
+    display_->showStatus("Payment", "Fetching offers...");
+
+    // All offers are fetched concurrently on the HTTP executor
+    cJSON* offer_jsons[SolanaClient::MAX_BATCH_TRANSFERS] = {};
+    StaticSemaphore_t fetched_buf;
+    SemaphoreHandle_t fetched = xSemaphoreCreateCountingStatic(count, 0, &fetched_buf);
+    size_t started = 0;
+    for (size_t i = 0; i < count; i++) {
+        cJSON** slot = &offer_jsons[i];
+        bool async = http_->get_402_async(urls[i], [slot, fetched](cJSON* json) {
+            *slot = json;
+            xSemaphoreGive(fetched);
+        });
+        if (async) {
+            started++;
+        } else {
+            http_->get_402(urls[i], slot);   // Engine busy: fetch inline
+        }
+    }
+    for (size_t i = 0; i < started; i++) {
+        xSemaphoreTake(fetched, portMAX_DELAY);   // Every request completes or times out
+    }
+
+    bool offers_ok = true;
+    for (size_t i = 0; i < count; i++) {
+        if (!offer_jsons[i]) {
+            ESP_LOGE(TAG, "❌ Failed to fetch payment offer for %s", urls[i]);
+            offers_ok = false;
+        } else if (!parseOffer(offer_jsons[i], cfg_, offers[i])) {
+            offers_ok = false;
+        }
+        cJSON_Delete(offer_jsons[i]);
+    }
+    if (!offers_ok) {
+        display_->showError("Offer Fetch\nFailed!");
+        uiPause(2000);
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        bool already_paid = false;
+        if (!clearToPay(offers[i].resource, &already_paid)) {
+            return false;
+        }
+        total += offers[i].amount;
+    }
+
+    ESP_LOGI(TAG, "💰 Total: %.6f %s", (double)total / 1e6, offers[0].asset);
+    char amount_display[64];
+    snprintf(amount_display, sizeof(amount_display), "%zu items:\n%.6f", count, (double)total / 1e6);
+    display_->showStatus("Transaction", amount_display);
+
+    const int wallet = pickPayer(total);
+    BalanceLedger& payer_ledger = payerLedger(wallet);
+    if (!payer_ledger.tryReserve(total)) {
+        ESP_LOGE(TAG, "❌ Insufficient balance: need %llu, available %llu",
+                 (unsigned long long)total, (unsigned long long)payer_ledger.available());
+        display_->showError("Insufficient\nBalance!");
+        uiPause(2000);
+        return false;
+    }
+    PayerWallets::Lease lease(wallets_, wallet);
+    Metrics::observe("batch.size", count);
+
+    size_t accepted = 0;
+    if (sharesTransaction(offers.get(), count)) {
+        BalanceLedger::Reservation reservation(payer_ledger, total);
+        accepted = payShared(offers.get(), urls, count, wallet, reservation, deadline_us);
+    } else {
+        // Several merchants or facilitators: whichever settled a shared TX
+        // first would settle every transfer in it, so each gets its own
+        ESP_LOGI(TAG, "🔀 Offers do not share a merchant, paying them one at a time");
+        Metrics::increment("batch.split");
+        for (size_t i = 0; i < count; i++) {
+            // This resource's share of the flow's reservation
+            BalanceLedger::Reservation reservation(payer_ledger, offers[i].amount);
+            SubmitFailure failure;
+            // The nonce is refreshed in the background after each use, so
+            // only the first transaction may take it
+            if (!payOffer(offers[i], urls[i], wallet, reservation, deadline_us, i == 0, failure)) {
+                continue;
+            }
+            if (failure == SubmitFailure::None) {
+                accepted++;
+            } else {
+                showSubmitFailure(failure);
+            }
+        }
+    }
+
+    if (accepted != count) {
+        ESP_LOGW(TAG, "⚠️ %zu of %zu resources accepted their payment", accepted, count);
+        Metrics::increment("batch.partial");
+    }
+    ESP_LOGI(TAG, "🏁 Batch payment flow finished");
+    return accepted == count;
+}
+
+bool X402PaymentClient::sharesTransaction(const PaymentOffer* offers, size_t count) {
+    // One transaction has one fee payer (the facilitator's), moves one mint
+    // on one network, and is settled once, for one merchant
+    for (size_t i = 1; i < count; i++) {
+        if (strcmp(offers[i].pay_to, offers[0].pay_to) != 0 ||
+            strcmp(offers[i].fee_payer, offers[0].fee_payer) != 0 ||
+            strcmp(offers[i].asset, offers[0].asset) != 0 ||
+            offers[i].policy != offers[0].policy) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t X402PaymentClient::payShared(const PaymentOffer* offers, const char* const* urls, size_t count,
+                                    int wallet, BalanceLedger::Reservation& reservation,
+                                    int64_t deadline_us) {
+    size_t accepted = 0;
+    bool resign = false;
+    for (int signing = 0; signing <= MAX_RESIGNS; ++signing) {
+        if (signing > 0) {
+            if (!retryPause(signing - 1, deadline_us)) {
+                break;
+            }
+            ESP_LOGW(TAG, "🔁 Blockhash rejected, signing the batch again with a fresh one");
+            Metrics::increment("submit.retry.blockhash");
+        }
+
+        // One journal entry per resource, all tracking the same transaction
+        uint32_t journal_ids[SolanaClient::MAX_BATCH_TRANSFERS] = {};
+        for (size_t i = 0; i < count; i++) {
+            journal_ids[i] = journal_.begin(offers[i].resource, offers[i].amount, wallet + 1);
+        }
+
+        PreparedPayment payment;
+        if (!buildPayment(offers, count, wallet, payment, true)) {
+            for (size_t i = 0; i < count; i++) {
+                journal_.record(journal_ids[i], PaymentJournal::ABORTED);
+            }
+            return 0;
+        }
+        for (size_t i = 0; i < count; i++) {
+            journal_.record(journal_ids[i], PaymentJournal::SIGNED, payment.signature);
+        }
+        Metrics::increment("batch.built");
+
+        // The first accepted submission settles the transaction; every resource
+        // still needs to see the payment to release its content. Kept sequential
+        // so only one facilitator call races to settle it.
+        resign = false;
+        for (size_t i = 0; i < count; i++) {
+            SubmitFailure failure = submitWithRetry(offers[i].resource, payment.header, reservation,
+                                                    journal_ids[i], urls[i], deadline_us);
+            stageDone(submitStage(failure), failure == SubmitFailure::None);
+            if (failure == SubmitFailure::None) {
+                accepted++;
+            } else if (failure == SubmitFailure::BlockhashExpired && i == 0) {
+                // Nothing settled and no other resource has seen this TX
+                for (size_t j = 1; j < count; j++) {
+                    journal_.record(journal_ids[j], PaymentJournal::ABORTED);
+                }
+                resign = true;
+                break;
+            } else {
+                showSubmitFailure(failure);
+            }
+        }
+        free(payment.header);
+        if (payment.uses_nonce) {
+            requestMaintenance(MAINT_REFRESH_NONCE);
+        }
+        if (!resign) {
+            if (signing > 0 && accepted > 0) {
+                Metrics::increment("submit.recovered.blockhash");
+            }
+            break;
+        }
+    }
+    if (resign) {
+        showSubmitFailure(SubmitFailure::BlockhashExpired);
+    }
+    return accepted;
+}
+
+void X402PaymentClient::refillPool() {
+    if (payment_active_) {
+        return;
+    }
+
+    // Expired entries are freed even while filling is paused
+    bool dropped_nonce = false;
+    size_t expired = pool_.expire(&dropped_nonce);
+    if (expired) {
+        Metrics::increment("pool.expired", expired);
+    }
+    if (dropped_nonce) {
+        // The dropped TX was never sent, so the on-chain nonce is still usable
+        refreshNonce();
+    }
+
+    // Nobody is tapping: stop polling the merchant until the next flow
+    if (esp_timer_get_time() - last_flow_us_ >= (int64_t)POOL_IDLE_TIMEOUT_MS * 1000) {
+        if (!pool_paused_) {
+            ESP_LOGI(TAG, "💤 No payments for %lu s, pre-signing paused",
+                     (unsigned long)(POOL_IDLE_TIMEOUT_MS / 1000));
+            pool_paused_ = true;
+        }
+        return;
+    }
+    pool_paused_ = false;
+
+    cJSON* offer_json = nullptr;
+    if (!http_->get_402(cfg_.payai_url, &offer_json)) {
+        Metrics::increment("pool.offer_fetch_failed");
+        return;
+    }
+    PaymentOffer offer;
+    bool parsed = parseOffer(offer_json, cfg_, offer);
+    cJSON_Delete(offer_json);
+    if (parsed) {
+        fee_payer_known_ = CryptoUtils::base58ToBytes(offer.fee_payer, fee_payer_key_);
+    }
+    if (!parsed || pool_.isCurrent(cfg_.payai_url, offer.hash)) {
+        return;
+    }
+
+    // Entry is missing, expired, or was built for a different offer
+    size_t dropped = pool_.invalidate(cfg_.payai_url, offer.hash, &dropped_nonce);
+    if (dropped) {
+        Metrics::increment("pool.invalidated", dropped);
+    }
+    if (dropped_nonce) {
+        // The dropped TX was never sent, so the on-chain nonce is still usable
+        refreshNonce();
+    }
+
+    // A tap may have started while we were fetching the offer
+    if (payment_active_) {
+        return;
+    }
+
+    const int wallet = pickPayer(offer.amount);
+    PreparedPayment payment;
+    if (!buildPayment(&offer, 1, wallet, payment, false)) {
+        Metrics::increment("pool.build_failed");
+        return;
+    }
+
+    PresignedPool::Entry entry = {};
+    strncpy(entry.url, cfg_.payai_url, sizeof(entry.url) - 1);
+    strcpy(entry.resource, offer.resource);
+    memcpy(entry.offer_hash, offer.hash, 32);
+    entry.amount = offer.amount;
+    entry.header = payment.header;
+    memcpy(entry.signature, payment.signature, 64);
+    entry.uses_nonce = payment.uses_nonce;
+    entry.wallet = wallet;
+    entry.built_at_us = payment.built_at_us;
+    pool_.put(entry);
+
+    Metrics::increment("pool.built");
+    ESP_LOGI(TAG, "⚡ Pre-signed payment ready (%llu)", (unsigned long long)offer.amount);
+}
+
+void X402PaymentClient::paymentWorkerEntry(void* arg) {
+    static_cast<X402PaymentClient*>(arg)->paymentWorkerLoop();
+}
+
+void X402PaymentClient::paymentWorkerLoop() {
+    ESP_LOGI(TAG, "💡 Payment worker started");
+
+    PaymentJob job;
+    while (1) {
+        if (xQueueReceive(payment_jobs_, &job, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        Metrics::observe("queue.wait_ms", (esp_timer_get_time() - job.enqueued_at_us) / 1000);
+
+        // A tap during boot waits for the network instead of failing outright
+        bool success = false;
+        if (!wifi_->waitConnected(WIFI_CONNECT_TIMEOUT_MS)) {
+            ESP_LOGE(TAG, "❌ WiFi connection timeout");
+            display_->showError("No WiFi!");
+        } else if (strcmp(job.url, cfg_.payai_url) == 0) {
+            success = executePaymentFlow();
+        } else {
+            // Other URLs take the batch path with a single offer (no pre-signed entry)
+            success = executeBatchPaymentFlow(&job.url, 1);
+        }
+        clearPending(job.url);
+
+        // Leave the result up; only go back to idle once the queue is drained
+        if (uxQueueMessagesWaiting(payment_jobs_) == 0) {
+            returnToIdleAfterDelay(success ? 5000 : 3000);
+        } else {
+            vTaskDelay(pdMS_TO_TICKS(success ? 5000 : 3000));
+        }
+    }
+}
+
+bool X402PaymentClient::markPending(const char* url) {
+    bool added = false;
+    portENTER_CRITICAL(&pending_lock_);
+    bool duplicate = false;
+    for (const char* p : pending_urls_) {
+        if (p && strcmp(p, url) == 0) { duplicate = true; break; }
+    }
+    if (!duplicate) {
+        for (const char*& p : pending_urls_) {
+            if (!p) { p = url; added = true; break; }
+        }
+    }
+    portEXIT_CRITICAL(&pending_lock_);
+    return added;
+}
+
+void X402PaymentClient::clearPending(const char* url) {
+    portENTER_CRITICAL(&pending_lock_);
+    for (const char*& p : pending_urls_) {
+        if (p == url) { p = nullptr; break; }
+    }
+    portEXIT_CRITICAL(&pending_lock_);
+}
+
+bool X402PaymentClient::enqueuePayment(const char* url) {
+    if (!markPending(url)) {
+        ESP_LOGW(TAG, "⚠️ Payment for %s already pending, ignoring", url);
+        Metrics::increment("queue.deduplicated");
+        return false;
+    }
+
+    PaymentJob job = {url, esp_timer_get_time()};
+    if (xQueueSend(payment_jobs_, &job, 0) != pdTRUE) {
+        clearPending(url);
+        ESP_LOGW(TAG, "⚠️ Payment queue full, rejecting");
+        Metrics::increment("queue.rejected");
+        return false;
+    }
+    Metrics::observe("queue.depth", uxQueueMessagesWaiting(payment_jobs_));
+    return true;
 }
 
 void X402PaymentClient::onPaymentButtonPressed() {
-    ESP_LOGI(TAG, "💡 Payment button pressed - creating payment task");
-    
-    // Create task with large stack for network operations
-    BaseType_t ret = xTaskCreate(
-        paymentTaskWrapper,
-        "payment_task",
-        8192,  // 8KB stack
-        this,
-        5,     // Priority
-        NULL
-    );
-    
-    if (ret != pdPASS) {
-        ESP_LOGE(TAG, "❌ Failed to create payment task");
-        display_->showError("Task\nCreation\nFailed!");
-        returnToIdleAfterDelay(3000);
+    // Runs in the LVGL handler; hand off to the dispatcher and return
+    UiEvent event = UiEvent::PaymentTap;
+    if (xQueueSend(ui_events_, &event, 0) != pdTRUE) {
+        Metrics::increment("ui.events_dropped");
     }
 }
 
@@ -392,8 +1711,17 @@ void X402PaymentClient::runEventLoop() {
         this->onPaymentButtonPressed();
     });
     
-    // Keep running forever
+    // Block until the UI posts something
+    UiEvent event;
     while (1) {
-        vTaskDelay(pdMS_TO_TICKS(1000));
+        if (xQueueReceive(ui_events_, &event, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        switch (event) {
+            case UiEvent::PaymentTap:
+                ESP_LOGI(TAG, "💡 Payment button pressed - queueing payment");
+                enqueuePayment(cfg_.payai_url);
+                break;
+        }
     }
-}
\ No newline at end of file
+}
@@ -1,25 +1,53 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include "esp_log.h"
 #include "x402_client.h"
 #include "config_manager.h"
+#include "boot_profiler.h"
+#include "load_generator.h"
+#include "deferred_log.h"
+#include "benchmarks.h"
 
 static const char *TAG = "main";
 
 extern "C" void app_main(void) {
     ESP_LOGI(TAG, "🚀 Starting ESP32-C6 X402 Payment Client");
 
-    // Initialize SPIFFS for config storage
-    if (!ConfigManager::init()) {
-        ESP_LOGE(TAG, "❌ SPIFFS initialization failed, aborting.");
-        return;
-    }
+    // Hot-path logs are queued from here on and written by a low-priority task
+    DeferredLog::start();
 
-    // Load configuration from file
+#if CONFIG_X402_BENCHMARKS
+    // Host benchmarks instead of the client; exit so scripts see the result
+    exit(Benchmarks::run() ? 0 : 1);
+#endif
+
+    // Binary blob from the config partition: no mount, no parse, no heap
     X402Config config = {};
-    if (!ConfigManager::load("/spiffs/config.json", config)) {
-        ESP_LOGE(TAG, "❌ Failed to load configuration, aborting.");
-        return;
+    if (!ConfigManager::loadBinary(ConfigManager::BLOB_SOURCE, config)) {
+        ESP_LOGW(TAG, "⚠️ No valid config blob, falling back to config.json");
+
+        // Initialize SPIFFS for config storage
+        if (!ConfigManager::init()) {
+            ESP_LOGE(TAG, "❌ SPIFFS initialization failed, aborting.");
+            BootProfiler::finish("config failed");
+            return;
+        }
+
+        // Load configuration from file
+        config = {};
+        if (!ConfigManager::load(ConfigManager::JSON_PATH, config)) {
+            ESP_LOGE(TAG, "❌ Failed to load configuration, aborting.");
+            BootProfiler::finish("config failed");
+            return;
+        }
     }
+    BootProfiler::mark("config ready");
+
+#if CONFIG_X402_LOADGEN
+    // Host load run against the stand-in servers, through its own headless
+    // client. Exit so scripted sweeps see the result.
+    exit(LoadGenerator::run(config, LoadGenerator::defaults()) ? 0 : 1);
+#endif
 
     // Create payment client
     X402PaymentClient client(config);
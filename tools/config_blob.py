@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+"""Pack config.json into the binary blob read by ConfigManager::loadBinary().
+
+Usage: config_blob.py <config.json> <config.bin>
+
+The layout mirrors components/x402_protocol/include/config_blob.h: a
+108-byte little-endian header followed by NUL-terminated strings. The
+CRC-32 (zlib polynomial) covers everything after the crc32 field.
+
+A key that is missing or an empty array (the template's placeholder) is
+packed as zeros; any other key that is not 32 integers 0-255 is an error.
+"""
+import json
+import re
+import struct
+import sys
+import zlib
+
+MAGIC = 0x46433458  # "X4CF"
+VERSION = 2
+CRC_OFFSET = 16
+
+# Order matches ConfigBlob::StringId; append only
+STRINGS = [
+    "wifi_ssid",
+    "wifi_password",
+    "payai_url",
+    "solana_rpc_url",
+    "user_agent",
+    "token_mint",
+    "nonce_account",
+    "lookup_table",
+    "network",
+]
+
+HEADER = struct.Struct("<IHHII32s32sIBB2x%dH2x" % len(STRINGS))
+assert HEADER.size == 108
+
+
+def load_json(path):
+    with open(path, "r", encoding="utf-8") as f:
+        text = f.read()
+    # The shipped template carries /* ... */ placeholders
+    return json.loads(re.sub(r"/\*.*?\*/", "", text, flags=re.S))
+
+
+def key_bytes(cfg, name):
+    value = cfg.get(name)
+    # The template's placeholder: no key configured yet
+    if value is None or value == []:
+        print("config_blob: warning: %s is not set, left zeroed" % name, file=sys.stderr)
+        return bytes(32)
+    if (not isinstance(value, list) or len(value) != 32 or
+            not all(isinstance(b, int) and not isinstance(b, bool) and 0 <= b <= 255 for b in value)):
+        raise SystemExit("config_blob: %s must be an array of 32 integers 0-255" % name)
+    return bytes(value)
+
+
+def pack(cfg):
+    table = bytearray()
+    offsets = []
+    for name in STRINGS:
+        value = cfg.get(name)
+        if not isinstance(value, str):
+            offsets.append(0)
+            continue
+        offsets.append(HEADER.size + len(table))
+        table += value.encode("utf-8") + b"\0"
+
+    size = HEADER.size + len(table)
+    if size > 0xFFFF:
+        raise SystemExit("config_blob: %d bytes does not fit 16-bit string offsets" % size)
+
+    def header(crc):
+        return HEADER.pack(
+            MAGIC, VERSION, len(STRINGS), size, crc,
+            key_bytes(cfg, "payer_private_key"),
+            key_bytes(cfg, "payer_public_key"),
+            int(cfg.get("fee_target_ms", 0)),
+            int(cfg.get("token_decimals", 0)),
+            int(cfg.get("payer_wallets", 0)),
+            *offsets)
+
+    blob = bytearray(header(0)) + table
+    crc = zlib.crc32(bytes(blob[CRC_OFFSET:])) & 0xFFFFFFFF
+    blob[12:16] = struct.pack("<I", crc)
+    return bytes(blob)
+
+
+def main():
+    if len(sys.argv) != 3:
+        raise SystemExit(__doc__.strip().splitlines()[2])
+    blob = pack(load_json(sys.argv[1]))
+    with open(sys.argv[2], "wb") as f:
+        f.write(blob)
+    print("config_blob: wrote %d bytes to %s" % (len(blob), sys.argv[2]))
+
+
+if __name__ == "__main__":
+    main()
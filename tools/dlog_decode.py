@@ -0,0 +1,258 @@
+#!/usr/bin/env python3
+"""Turn DeferredLog binary frames back into log lines.
+
+Usage: dlog_decode.py [--src DIR ...] [capture]
+
+Reads console output (a file, or stdin) from a build with
+CONFIG_X402_DEFERRED_LOG_BINARY. Ordinary log lines pass through; each
+frame is matched to its DLOG call site by the ID the firmware computed at
+compile time (FNV-1a of the source file's base name, ':' and the format,
+see components/x402_protocol/include/deferred_log.h) and formatted here.
+
+Frame: 'D' 'L' level len | id:u32 | ms:u32 | payload | xor of the rest.
+Frame bytes 0x0A, 0x0D and 0x1B are sent as 0x1B, byte ^ 0x20, so the
+console's newline translation leaves frames intact; the checksum covers the
+unescaped bytes.
+"""
+import argparse
+import codecs
+import os
+import re
+import struct
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+DEFAULT_SRC = [os.path.join(ROOT, "components"), os.path.join(ROOT, "main")]
+
+HEADER = struct.Struct("<2sBBII")
+PAYLOAD_MAX = 96
+LEVELS = "NEWIDV"
+ESCAPE = 0x1B
+ESCAPED = (0x0A, 0x0D, ESCAPE)
+
+CALL = re.compile(r'\bDLOG[EWID]\s*\(\s*\w+\s*,\s*((?:"(?:[^"\\\n]|\\.)*"\s*)+)')
+HEX_CALL = re.compile(r"\bDLOG_BUFFER_HEX\s*\(")
+LITERAL = re.compile(r'"((?:[^"\\\n]|\\.)*)"')
+TAG = re.compile(r'static\s+const\s+char\s*\*\s*TAG\s*=\s*"([^"]*)"')
+SPEC = re.compile(r"%([-+ #0]*\d*(?:\.\d*)?)[hlLqjzt]*([a-zA-Z%])")
+
+
+def fnv1a(data, h=2166136261):
+    for b in data:
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def unescape(literal):
+    """Bytes of one C string literal's contents (UTF-8 source)."""
+    out = bytearray()
+    raw = literal.encode("utf-8")
+    i = 0
+    simple = {b"n": 10, b"t": 9, b"r": 13, b"0": 0, b"\\": 92, b'"': 34, b"'": 39}
+    while i < len(raw):
+        c = raw[i:i + 1]
+        if c != b"\\":
+            out += c
+            i += 1
+            continue
+        e = raw[i + 1:i + 2]
+        if e == b"x":
+            m = re.match(rb"[0-9a-fA-F]+", raw[i + 2:])
+            out.append(int(m.group(0), 16) & 0xFF)
+            i += 2 + len(m.group(0))
+        elif e.isdigit() and e not in (b"8", b"9"):
+            m = re.match(rb"[0-7]{1,3}", raw[i + 1:])
+            out.append(int(m.group(0), 8))
+            i += 1 + len(m.group(0))
+        else:
+            out.append(simple.get(e, e[0]))
+            i += 2
+    return bytes(out)
+
+
+def scan(dirs):
+    """Map site ID -> (tag, format bytes) for every DLOG call in dirs."""
+    sites = {}
+    for top in dirs:
+        for base, _, files in os.walk(top):
+            for name in files:
+                if not name.endswith((".cpp", ".c", ".h")):
+                    continue
+                with open(os.path.join(base, name), encoding="utf-8", errors="replace") as f:
+                    text = f.read()
+                m = TAG.search(text)
+                tag = m.group(1) if m else os.path.splitext(name)[0]
+                prefix = name.encode("utf-8") + b":"
+                fmts = [b"".join(unescape(l) for l in LITERAL.findall(c.group(1)))
+                        for c in CALL.finditer(text)]
+                if HEX_CALL.search(text):
+                    fmts.append(b"%b")
+                for fmt in fmts:
+                    sites[fnv1a(prefix + fmt)] = (tag, fmt)
+    return sites
+
+
+def read_args(payload):
+    args = []
+    i = 0
+    while i < len(payload):
+        t = chr(payload[i])
+        i += 1
+        if t in "ui":
+            args.append(struct.unpack_from("<I" if t == "u" else "<i", payload, i)[0])
+            i += 4
+        elif t in "qQp":
+            args.append(struct.unpack_from("<q" if t == "q" else "<Q", payload, i)[0])
+            i += 8
+        elif t == "d":
+            args.append(struct.unpack_from("<d", payload, i)[0])
+            i += 8
+        elif t in "sx":
+            n = payload[i]
+            blob = payload[i + 1:i + 1 + n]
+            args.append(blob.decode("utf-8", "replace") if t == "s" else bytes(blob))
+            i += 1 + n
+        else:
+            break
+    return args
+
+
+def hexdump(data):
+    return "\n".join(" ".join("%02x" % b for b in data[i:i + 16]) for i in range(0, len(data), 16))
+
+
+def format_record(fmt, args):
+    args = iter(args)
+
+    def conv(m):
+        flags, c = m.group(1), m.group(2)
+        if c == "%":
+            return "%"
+        a = next(args, None)
+        if a is None:
+            return "?"
+        if isinstance(a, bytes):
+            return hexdump(a)
+        if c == "p":
+            return "0x%x" % a
+        if c == "c":
+            return chr(a & 0xFF)
+        if c == "u":
+            c = "d"
+        try:
+            return ("%" + flags + c) % a
+        except (TypeError, ValueError):
+            return str(a)
+
+    return SPEC.sub(conv, fmt.decode("utf-8", "replace"))
+
+
+def unframe(buf, want):
+    """First want unescaped bytes of buf as (bytes, bytes consumed).
+
+    None if buf ends first, False on an escape the firmware never writes.
+    """
+    out = bytearray()
+    i = 0
+    while len(out) < want:
+        if i >= len(buf):
+            return None
+        b = buf[i]
+        if b == ESCAPE:
+            if i + 1 >= len(buf):
+                return None
+            b = buf[i + 1] ^ 0x20
+            if b not in ESCAPED:
+                return False
+            i += 1
+        elif b in ESCAPED:
+            return False
+        out.append(b)
+        i += 1
+    return bytes(out), i
+
+
+def decode(stream, sites, out):
+    buf = b""
+    text = bytearray()
+    utf8 = codecs.getincrementaldecoder("utf-8")("replace")
+
+    def flush_text(final=False):
+        if text or final:
+            out.write(utf8.decode(bytes(text), final))
+            text.clear()
+
+    while True:
+        chunk = stream.read(4096)
+        if chunk:
+            buf += chunk
+        while buf:
+            start = buf.find(b"DL")
+            if start < 0:
+                keep = 1 if buf.endswith(b"D") else 0
+                text.extend(buf[:len(buf) - keep])
+                buf = buf[len(buf) - keep:]
+                break
+            text.extend(buf[:start])
+            buf = buf[start:]
+            head = unframe(buf, HEADER.size)
+            if head is None:
+                break
+            if head is False:
+                text.extend(buf[:1])
+                buf = buf[1:]
+                continue
+            _, level, length, site_id, ms = HEADER.unpack_from(head[0])
+            if length > PAYLOAD_MAX or level >= len(LEVELS):
+                text.extend(buf[:1])
+                buf = buf[1:]
+                continue
+            frame = unframe(buf, HEADER.size + length + 1)
+            if frame is None:
+                break
+            if frame is False:
+                text.extend(buf[:1])
+                buf = buf[1:]
+                continue
+            frame, used = frame
+            check = 0
+            for b in frame[:-1]:
+                check ^= b
+            if check != frame[-1]:
+                text.extend(buf[:1])
+                buf = buf[1:]
+                continue
+            flush_text()
+            payload = frame[HEADER.size:-1]
+            buf = buf[used:]
+            if site_id in sites:
+                tag, fmt = sites[site_id]
+                msg = format_record(fmt, read_args(payload))
+            else:
+                tag, msg = "?", "unknown site %08x (sources out of date?) %s" % (site_id, payload.hex())
+            out.write("%s (%d) %s: %s\n" % (LEVELS[level], ms, tag, msg))
+        flush_text()
+        out.flush()
+        if not chunk:
+            break
+    text.extend(buf)
+    flush_text(final=True)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--src", action="append", help="source directory to scan (repeatable)")
+    parser.add_argument("capture", nargs="?", help="console capture; stdin if omitted")
+    args = parser.parse_args()
+
+    sites = scan(args.src or DEFAULT_SRC)
+    if args.capture:
+        with open(args.capture, "rb") as f:
+            decode(f, sites, sys.stdout)
+    else:
+        decode(sys.stdin.buffer.raw if hasattr(sys.stdin.buffer, "raw") else sys.stdin.buffer,
+               sites, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
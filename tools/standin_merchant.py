@@ -0,0 +1,217 @@
+#!/usr/bin/env python3
+"""Local stand-in for an x402 merchant serving large paid content.
+
+Usage: standin_merchant.py [--port 8402] [--size BYTES] [--drop-every BYTES]
+                           [--chunked] [--no-range] [--gzip] [--quiet]
+                           [--self-check]
+
+Without an X-PAYMENT header every path answers 402 with one "exact" offer.
+Any X-PAYMENT is accepted (nothing is settled); once accepted, the same
+header is honoured again, which is how a dropped download is resumed with
+"Range: bytes=N-" without paying twice.
+
+The body is --size bytes of 16-byte lines "<15 hex digits of offset>\\n",
+so any byte range can be checked on its own. --drop-every closes the
+connection after that many body bytes of each response, --chunked omits
+Content-Length, and --no-range ignores Range requests. --gzip sends the
+body gzip-encoded (chunked) when the request accepts it and has no Range.
+--quiet stops the per-request log, which would otherwise bound a load run.
+--self-check downloads the body once through the resume path and
+verifies it.
+
+Point config.json "payai_url" at http://<host>:<port>/premium.
+"""
+import argparse
+import hashlib
+import http.client
+import json
+import re
+import sys
+import threading
+import zlib
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+LINE = 16
+PAY_TO = "11111111111111111111111111111111"
+ASSET = "4zMMC9srt5Ri5X14GAgXhaHii3GnPAEERYPJgZJDncDU"  # devnet USDC
+FEE_PAYER = "2wKupLR9q6wXYppw8Gr2NvWxKBUqm4PPJKkQfoxHDBg4"
+
+
+def body_range(start, end):
+    """Bytes [start, end) of the content."""
+    first = start // LINE
+    last = (end + LINE - 1) // LINE
+    text = "".join("%015x\n" % (i * LINE) for i in range(first, last))
+    offset = first * LINE
+    return text.encode()[start - offset:end - offset]
+
+
+class Merchant(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    accepted = set()
+    lock = threading.Lock()
+
+    def log_message(self, fmt, *args):
+        if self.server.cfg.quiet:
+            return
+        sys.stderr.write("[merchant] " + fmt % args + "\n")
+
+    def offer(self):
+        resource = "http://%s%s" % (self.headers.get("Host", "localhost"), self.path)
+        body = json.dumps({
+            "x402Version": 1,
+            "error": "X-PAYMENT header is required",
+            "accepts": [{
+                "scheme": "exact",
+                "network": "solana-devnet",
+                "maxAmountRequired": "1000",
+                "resource": resource,
+                "description": "Stand-in paid content",
+                "mimeType": "application/octet-stream",
+                "payTo": PAY_TO,
+                "maxTimeoutSeconds": 60,
+                "asset": ASSET,
+                "extra": {"feePayer": FEE_PAYER},
+            }],
+        }).encode()
+        self.send_response(402)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def do_GET(self):
+        cfg = self.server.cfg
+        proof = self.headers.get("X-PAYMENT")
+        if not proof:
+            self.offer()
+            return
+        with self.lock:
+            resumed = proof in self.accepted
+            self.accepted.add(proof)
+
+        size = cfg.size
+        start = 0
+        match = re.fullmatch(r"bytes=(\d+)-", self.headers.get("Range", ""))
+        if match and not cfg.no_range:
+            start = int(match.group(1))
+            if start >= size:
+                self.send_response(416)
+                self.send_header("Content-Range", "bytes */%d" % size)
+                self.send_header("Content-Length", "0")
+                self.end_headers()
+                return
+            self.send_response(206)
+            self.send_header("Content-Range", "bytes %d-%d/%d" % (start, size - 1, size))
+        else:
+            self.send_response(200)
+        gzip = cfg.gzip and start == 0 and "gzip" in self.headers.get("Accept-Encoding", "")
+        if resumed:
+            self.log_message("resuming at %d with an accepted proof", start)
+        self.send_header("Content-Type", "application/octet-stream")
+        self.send_header("Cache-Control", "no-store")
+        if gzip:
+            self.send_header("Content-Encoding", "gzip")
+        if cfg.chunked or gzip:
+            self.send_header("Transfer-Encoding", "chunked")
+        else:
+            self.send_header("Content-Length", str(size - start))
+        self.end_headers()
+
+        sent = 0
+        pos = start
+        encoder = zlib.compressobj(6, zlib.DEFLATED, 31) if gzip else None
+        while pos < size:
+            n = min(4096, size - pos)
+            if cfg.drop_every and sent + n > cfg.drop_every:
+                n = cfg.drop_every - sent
+            data = body_range(pos, pos + n)
+            if encoder:
+                data = encoder.compress(data)
+                if pos + n == size:
+                    data += encoder.flush()
+            if cfg.chunked or gzip:
+                if data:
+                    self.wfile.write(b"%x\r\n%s\r\n" % (len(data), data))
+            else:
+                self.wfile.write(data)
+            sent += n
+            pos += n
+            if cfg.drop_every and sent >= cfg.drop_every and pos < size:
+                self.log_message("dropping connection at %d", pos)
+                self.close_connection = True
+                return
+        if cfg.chunked or gzip:
+            self.wfile.write(b"0\r\n\r\n")
+
+
+def self_check(port, size):
+    """Fetch the body like HttpClient::submit_payment_stream and verify it."""
+    digest = hashlib.sha256()
+    received = 0
+    resumes = 0
+    wire = 0
+    while received < size and resumes <= 64:
+        conn = http.client.HTTPConnection("127.0.0.1", port, timeout=10)
+        headers = {"X-PAYMENT": "c2VsZi1jaGVjaw=="}
+        if received:
+            headers["Range"] = "bytes=%d-" % received
+            resumes += 1
+        else:
+            headers["Accept-Encoding"] = "gzip, deflate"
+        conn.request("GET", "/premium", headers=headers)
+        resp = conn.getresponse()
+        skip = received if resp.status == 200 else 0
+        decoder = None
+        if resp.getheader("Content-Encoding") == "gzip":
+            decoder = zlib.decompressobj(31)
+        try:
+            while True:
+                chunk = resp.read1(8192)
+                if not chunk:
+                    break
+                if decoder:
+                    wire += len(chunk)
+                    chunk = decoder.decompress(chunk)
+                drop = min(skip, len(chunk))
+                skip -= drop
+                digest.update(chunk[drop:])
+                received += len(chunk) - drop
+        except (http.client.IncompleteRead, ConnectionError):
+            pass
+        conn.close()
+    ok = received == size and digest.digest() == hashlib.sha256(body_range(0, size)).digest()
+    if wire:
+        print("self-check: %d gzip bytes on the wire" % wire)
+    print("self-check: %d bytes, %d resumes, %s" % (received, resumes, "OK" if ok else "MISMATCH"))
+    return ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--port", type=int, default=8402)
+    parser.add_argument("--size", type=int, default=4 * 1024 * 1024)
+    parser.add_argument("--drop-every", type=int, default=0)
+    parser.add_argument("--chunked", action="store_true")
+    parser.add_argument("--no-range", action="store_true")
+    parser.add_argument("--gzip", action="store_true")
+    parser.add_argument("--quiet", action="store_true")
+    parser.add_argument("--self-check", action="store_true")
+    args = parser.parse_args()
+
+    server = ThreadingHTTPServer(("0.0.0.0", args.port), Merchant)
+    server.cfg = args
+    print("stand-in merchant on :%d, %d bytes, sha256 %s" % (
+        args.port, args.size, hashlib.sha256(body_range(0, args.size)).hexdigest()))
+
+    if args.self_check:
+        threading.Thread(target=server.serve_forever, daemon=True).start()
+        sys.exit(0 if self_check(args.port, args.size) else 1)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+"""Local stand-in for the Solana JSON-RPC methods the client calls.
+
+Usage: standin_rpc.py [--port 8899] [--latency-ms MS] [--quiet]
+
+Answers getLatestBlockhash with a fresh random blockhash, and
+getTokenAccountBalance, getRecentPrioritizationFees, simulateTransaction,
+getSignaturesForAddress and getAccountInfo with fixed, plausible values.
+Other methods get JSON-RPC error -32601. Nothing is checked or stored.
+--latency-ms delays every answer, to stand in for a remote RPC node.
+
+Used with standin_merchant.py by the load generator; set
+CONFIG_X402_LOADGEN_RPC_URL to http://<host>:<port>.
+"""
+import argparse
+import json
+import os
+import sys
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+ALPHABET = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz"
+SLOT = 300_000_000
+
+
+def b58encode(data):
+    n = int.from_bytes(data, "big")
+    out = ""
+    while n:
+        n, r = divmod(n, 58)
+        out = ALPHABET[r] + out
+    return "1" * (len(data) - len(data.lstrip(b"\0"))) + out
+
+
+def answer(method):
+    """(result, error) for one call."""
+    context = {"slot": SLOT}
+    if method == "getLatestBlockhash":
+        return {"context": context, "value": {
+            "blockhash": b58encode(os.urandom(32)),
+            "lastValidBlockHeight": SLOT + 150}}, None
+    if method == "getTokenAccountBalance":
+        return {"context": context, "value": {
+            "amount": "1000000000000", "decimals": 6,
+            "uiAmount": 1000000.0, "uiAmountString": "1000000"}}, None
+    if method == "getRecentPrioritizationFees":
+        return [{"slot": SLOT - i, "prioritizationFee": 1000 * (i % 4)} for i in range(20)], None
+    if method == "simulateTransaction":
+        return {"context": context, "value": {
+            "err": None, "logs": [], "unitsConsumed": 6200}}, None
+    if method == "getSignaturesForAddress":
+        return [], None
+    if method == "getAccountInfo":
+        return {"context": context, "value": None}, None
+    return None, {"code": -32601, "message": "Method not found"}
+
+
+class Rpc(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def log_message(self, fmt, *args):
+        if self.server.cfg.quiet:
+            return
+        sys.stderr.write("[rpc] " + fmt % args + "\n")
+
+    def do_POST(self):
+        length = int(self.headers.get("Content-Length", 0))
+        try:
+            request = json.loads(self.rfile.read(length))
+            result, error = answer(request.get("method"))
+            reply = {"jsonrpc": "2.0", "id": request.get("id")}
+        except (ValueError, AttributeError):
+            result, error = None, {"code": -32700, "message": "Parse error"}
+            reply = {"jsonrpc": "2.0", "id": None}
+        if error:
+            reply["error"] = error
+        else:
+            reply["result"] = result
+
+        if self.server.cfg.latency_ms:
+            time.sleep(self.server.cfg.latency_ms / 1000.0)
+        body = json.dumps(reply).encode()
+        self.send_response(200)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--port", type=int, default=8899)
+    parser.add_argument("--latency-ms", type=int, default=0)
+    parser.add_argument("--quiet", action="store_true")
+    args = parser.parse_args()
+
+    server = ThreadingHTTPServer(("0.0.0.0", args.port), Rpc)
+    server.cfg = args
+    print("stand-in RPC on :%d, %d ms latency" % (args.port, args.latency_ms))
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()